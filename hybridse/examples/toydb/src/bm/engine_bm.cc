@@ -56,6 +56,12 @@ static void BM_EngineWindowSumFeature5(benchmark::State& state) {  // NOLINT
     EngineWindowSumFeature5(&state, BENCHMARK, state.range(0), state.range(1));
 }
 
+static void BM_EngineWindowColumnarAggFeature5(
+    benchmark::State& state) {  // NOLINT
+    EngineWindowColumnarAggFeature5(&state, BENCHMARK, state.range(0) != 0,
+                                    state.range(1));
+}
+
 static void BM_EngineWindowSumFeature1ExcludeCurrentTime(
     benchmark::State& state) {  // NOLINT
     EngineWindowSumFeature1ExcludeCurrentTime(&state, BENCHMARK, state.range(0),
@@ -144,6 +150,11 @@ static void BM_EngineRunBatchWindowSumFeature5ExcludeCurrentTime(
     EngineRunBatchWindowSumFeature5ExcludeCurrentTime(
         &state, BENCHMARK, state.range(0), state.range(1));
 }
+static void BM_EngineRunBatchWindowSumFeature5Parallel(
+    benchmark::State& state) {  // NOLINT
+    EngineRunBatchWindowSumFeature5Parallel(&state, BENCHMARK, state.range(0),
+                                            state.range(1));
+}
 static void BM_EngineRunBatchWindowSumFeature5Window5(
     benchmark::State& state) {  // NOLINT
     EngineRunBatchWindowSumFeature5Window5(&state, BENCHMARK, state.range(0),
@@ -188,6 +199,17 @@ BENCHMARK(BM_EngineWindowSumFeature5)
     ->Args({1000, 1000})
     ->Args({10000, 10000});
 
+// columnar, window size
+BENCHMARK(BM_EngineWindowColumnarAggFeature5)
+    ->Args({0, 100})
+    ->Args({1, 100})
+    ->Args({0, 1000})
+    ->Args({1, 1000})
+    ->Args({0, 10000})
+    ->Args({1, 10000})
+    ->Args({0, 100000})
+    ->Args({1, 100000});
+
 BENCHMARK(BM_MapTop)
     ->Args({1, 2})
     ->Args({1, 10})
@@ -257,6 +279,14 @@ BENCHMARK(BM_EngineRunBatchWindowSumFeature5)
     ->Args({100, 100})
     ->Args({1000, 1000})
     ->Args({10000, 10000});
+// thread num, data size
+BENCHMARK(BM_EngineRunBatchWindowSumFeature5Parallel)
+    ->Args({1, 100000})
+    ->Args({2, 100000})
+    ->Args({4, 100000})
+    ->Args({8, 100000})
+    ->Args({16, 100000})
+    ->UseRealTime();
 BENCHMARK(BM_EngineRunBatchWindowSumFeature5Window5)
     ->Args({1, 2})
     ->Args({1, 10})
@@ -22,6 +22,7 @@
 #include <vector>
 #include "benchmark/benchmark.h"
 #include "codec/type_codec.h"
+#include "gflags/gflags.h"
 #include "gtest/gtest.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
 #include "llvm/IR/Function.h"
@@ -38,6 +39,9 @@
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "tablet/tablet_catalog.h"
 
+DECLARE_uint32(batch_runner_thread_num);
+DECLARE_bool(enable_columnar_window_agg);
+
 namespace hybridse {
 namespace bm {
 using codec::Row;
@@ -251,6 +255,27 @@ void EngineRunBatchWindowSumFeature5(benchmark::State* state, MODE mode,
     EngineBatchMode(sql, mode, limit_cnt, size, state);
 }
 
+// col1 has 100 distinct values, so the window aggregation runs on 100 keys
+void EngineRunBatchWindowSumFeature5Parallel(benchmark::State* state,
+                                             MODE mode, int64_t thread_num,
+                                             int64_t size) {  // NOLINT
+    const std::string sql =
+        "SELECT "
+        "sum(col1) OVER w1 as w1_col1_sum, "
+        "sum(col3) OVER w1 as w1_col3_sum, "
+        "sum(col4) OVER w1 as w1_col4_sum, "
+        "sum(col2) OVER w1 as w1_col2_sum, "
+        "sum(col5) OVER w1 as w1_col5_sum "
+        "FROM t1 WINDOW w1 AS (PARTITION BY col1 ORDER BY col5 ROWS_RANGE "
+        "BETWEEN "
+        "30d "
+        "PRECEDING AND CURRENT ROW);";
+    // restore the flag even if the benchmark stops early
+    gflags::FlagSaver flag_saver;
+    FLAGS_batch_runner_thread_num = thread_num;
+    EngineBatchMode(sql, mode, size, size, state);
+}
+
 void EngineRunBatchWindowSumFeature1ExcludeCurrentTime(
     benchmark::State* state, MODE mode, int64_t limit_cnt,
     int64_t size) {  // NOLINT
@@ -425,6 +450,26 @@ void EngineWindowSumFeature5(benchmark::State* state, MODE mode,
     EngineRequestMode(sql, mode, limit_cnt, size, state);
 }
 
+// the request row gets a window of all the size rows
+void EngineWindowColumnarAggFeature5(benchmark::State* state, MODE mode,
+                                     bool columnar,
+                                     int64_t size) {  // NOLINT
+    const std::string sql =
+        "SELECT "
+        "sum(col1) OVER w1 as w1_col1_sum, "
+        "avg(col3) OVER w1 as w1_col3_avg, "
+        "min(col4) OVER w1 as w1_col4_min, "
+        "max(col2) OVER w1 as w1_col2_max, "
+        "count(col5) OVER w1 as w1_col5_cnt "
+        "FROM t1 WINDOW w1 AS (PARTITION BY col0 ORDER BY col5 ROWS_RANGE "
+        "BETWEEN "
+        "30d "
+        "PRECEDING AND CURRENT ROW) limit 1;";
+    FLAGS_enable_columnar_window_agg = columnar;
+    EngineRequestMode(sql, mode, 1, size, state);
+    FLAGS_enable_columnar_window_agg = false;
+}
+
 void EngineWindowDistinctCntFeature(benchmark::State* state, MODE mode,
                                     int64_t limit_cnt,
                                     int64_t size) {  // NOLINT
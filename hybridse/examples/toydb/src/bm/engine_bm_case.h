@@ -62,9 +62,15 @@ void EngineRunBatchWindowSumFeature5ExcludeCurrentTime(benchmark::State* state,
                                                        MODE mode,
                                                        int64_t limit_cnt,
                                                        int64_t size);  // NOLINT
+void EngineRunBatchWindowSumFeature5Parallel(benchmark::State* state,
+                                             MODE mode, int64_t thread_num,
+                                             int64_t size);  // NOLINT
 void EngineWindowSumFeature5(benchmark::State* state, MODE mode,
                              int64_t limit_cnt,
                              int64_t size);  // NOLINT
+void EngineWindowColumnarAggFeature5(benchmark::State* state, MODE mode,
+                                     bool columnar,
+                                     int64_t size);  // NOLINT
 void EngineWindowSumFeature5ExcludeCurrentTime(benchmark::State* state,
                                                MODE mode, int64_t limit_cnt,
                                                int64_t size);  // NOLINT
@@ -43,6 +43,11 @@ TEST_F(EngineBMCaseTest, EngineWindowSumFeature5_TEST) {
     EngineWindowSumFeature5(nullptr, TEST, 100L, 100L);
     EngineWindowSumFeature5(nullptr, TEST, 1000L, 1000L);
 }
+TEST_F(EngineBMCaseTest, EngineWindowColumnarAggFeature5_TEST) {
+    EngineWindowColumnarAggFeature5(nullptr, TEST, false, 100L);
+    EngineWindowColumnarAggFeature5(nullptr, TEST, true, 100L);
+    EngineWindowColumnarAggFeature5(nullptr, TEST, true, 1000L);
+}
 TEST_F(EngineBMCaseTest, EngineWindowSumFeature5Window5_TEST) {
     EngineWindowSumFeature5Window5(nullptr, TEST, 1L, 100L);
     EngineWindowSumFeature5Window5(nullptr, TEST, 1L, 1000L);
@@ -55,6 +60,11 @@ TEST_F(EngineBMCaseTest, EngineWindowMultiAggWindow25Feature25_TEST) {
     EngineWindowMultiAggWindow25Feature25(nullptr, TEST, 100L, 100L);
     EngineWindowMultiAggWindow25Feature25(nullptr, TEST, 1000L, 1000L);
 }
+TEST_F(EngineBMCaseTest, EngineRunBatchWindowSumFeature5Parallel_TEST) {
+    EngineRunBatchWindowSumFeature5Parallel(nullptr, TEST, 1L, 1000L);
+    EngineRunBatchWindowSumFeature5Parallel(nullptr, TEST, 4L, 1000L);
+}
+
 TEST_F(EngineBMCaseTest, EngineRunBatchWindowMultiAggWindow25Feature25_TEST) {
     EngineRunBatchWindowMultiAggWindow25Feature25(nullptr, TEST, 1L, 100L);
     EngineRunBatchWindowMultiAggWindow25Feature25(nullptr, TEST, 1L, 1000L);
@@ -14,10 +14,15 @@
  * limitations under the License.
  */
 
+#include "gflags/gflags.h"
 #include "gtest/gtest.h"
 #include "gtest/internal/gtest-param-util.h"
 #include "testing/toydb_engine_test_base.h"
 
+DECLARE_bool(enable_incremental_window_agg);
+DECLARE_uint32(batch_runner_thread_num);
+DECLARE_bool(enable_columnar_window_agg);
+
 using namespace llvm;       // NOLINT (build/namespaces)
 using namespace llvm::orc;  // NOLINT (build/namespaces)
 
@@ -35,6 +40,20 @@ TEST_P(EngineTest, TestRequestEngine) {
         LOG(INFO) << "Skip mode " << sql_case.mode();
     }
 }
+TEST_P(EngineTest, TestRequestEngineWithColumnarWindowAgg) {
+    ParamType sql_case = GetParam();
+    EngineOptions options;
+    LOG(INFO) << "ID: " << sql_case.id() << ", DESC: " << sql_case.desc();
+    if (!boost::contains(sql_case.mode(), "request-unsupport") &&
+        !boost::contains(sql_case.mode(), "performance-sensitive-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-unsupport")) {
+        FLAGS_enable_columnar_window_agg = true;
+        EngineCheck(sql_case, options, kRequestMode);
+        FLAGS_enable_columnar_window_agg = false;
+    } else {
+        LOG(INFO) << "Skip mode " << sql_case.mode();
+    }
+}
 TEST_P(EngineTest, TestBatchEngine) {
     ParamType sql_case = GetParam();
     EngineOptions options;
@@ -48,6 +67,39 @@ TEST_P(EngineTest, TestBatchEngine) {
         LOG(INFO) << "Skip mode " << sql_case.mode();
     }
 }
+TEST_P(EngineTest, TestBatchEngineWithIncrementalWindowAgg) {
+    ParamType sql_case = GetParam();
+    EngineOptions options;
+    LOG(INFO) << "ID: " << sql_case.id() << ", DESC: " << sql_case.desc();
+    if (!boost::contains(sql_case.mode(), "batch-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-unsupport") &&
+        !boost::contains(sql_case.mode(), "performance-sensitive-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-batch-unsupport")) {
+        FLAGS_enable_incremental_window_agg = true;
+        EngineCheck(sql_case, options, kBatchMode);
+        FLAGS_enable_incremental_window_agg = false;
+    } else {
+        LOG(INFO) << "Skip mode " << sql_case.mode();
+    }
+}
+
+TEST_P(EngineTest, TestBatchEngineWithParallelRunners) {
+    ParamType sql_case = GetParam();
+    EngineOptions options;
+    LOG(INFO) << "ID: " << sql_case.id() << ", DESC: " << sql_case.desc();
+    if (!boost::contains(sql_case.mode(), "batch-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-unsupport") &&
+        !boost::contains(sql_case.mode(), "performance-sensitive-unsupport") &&
+        !boost::contains(sql_case.mode(), "rtidb-batch-unsupport")) {
+        // restore the flag even if a failed assertion returns early
+        gflags::FlagSaver flag_saver;
+        FLAGS_batch_runner_thread_num = 4;
+        EngineCheck(sql_case, options, kBatchMode);
+    } else {
+        LOG(INFO) << "Skip mode " << sql_case.mode();
+    }
+}
+
 TEST_P(EngineTest, TestBatchRequestEngineForLastRow) {
     ParamType sql_case = GetParam();
     EngineOptions options;
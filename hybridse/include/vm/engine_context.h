@@ -101,11 +101,21 @@ class JitOptions {
     bool IsEnablePerf() const { return enable_perf_; }
     void SetEnablePerf(bool flag) { enable_perf_ = flag; }
 
+    // the directory to persist the compiled objects, empty to disable
+    const std::string& GetObjectCacheDir() const { return object_cache_dir_; }
+    void SetObjectCacheDir(const std::string& dir) { object_cache_dir_ = dir; }
+
+    // the max total bytes of the persisted objects, 0 means unlimited
+    uint64_t GetObjectCacheMaxSize() const { return object_cache_max_size_; }
+    void SetObjectCacheMaxSize(uint64_t size) { object_cache_max_size_ = size; }
+
  private:
     bool enable_mcjit_ = false;
     bool enable_vtune_ = false;
     bool enable_gdb_ = false;
     bool enable_perf_ = false;
+    std::string object_cache_dir_ = "";
+    uint64_t object_cache_max_size_ = 0;
 };
 }  // namespace vm
 }  // namespace hybridse
@@ -17,6 +17,7 @@
 #ifndef HYBRIDSE_INCLUDE_VM_MEM_CATALOG_H_
 #define HYBRIDSE_INCLUDE_VM_MEM_CATALOG_H_
 
+#include <algorithm>
 #include <deque>
 #include <functional>
 #include <map>
@@ -239,6 +240,121 @@ class MemTimeTableHandler : public TableHandler {
     OrderType order_type_;
 };
 
+// a window of the values of a min or max aggregation, the front is the min
+// (or max) of the values pushed and not evicted yet
+template <class T>
+class MonotonicQueue {
+ public:
+    MonotonicQueue() : push_seq_(0), evict_seq_(0) {}
+
+    void Push(T value, bool is_null, bool is_max) {
+        if (!is_null) {
+            while (!queue_.empty() && (is_max ? queue_.back().second <= value : queue_.back().second >= value)) {
+                queue_.pop_back();
+            }
+            queue_.emplace_back(push_seq_, value);
+        }
+        push_seq_++;
+    }
+
+    // evict the oldest value
+    void Evict() {
+        if (!queue_.empty() && queue_.front().first == evict_seq_) {
+            queue_.pop_front();
+        }
+        evict_seq_++;
+    }
+
+    T Front(T default_value) const { return queue_.empty() ? default_value : queue_.front().second; }
+
+    void Clear() {
+        queue_.clear();
+        push_seq_ = 0;
+        evict_seq_ = 0;
+    }
+
+ private:
+    std::deque<std::pair<uint64_t, T>> queue_;
+    uint64_t push_seq_;
+    uint64_t evict_seq_;
+};
+
+// the running state of an incremental window aggregation. the add and evict
+// functions are generated by codegen::AggregateIRBuilder, they update the state
+// with a row entering or leaving the window. the sums and counts are kept in
+// the slots of buf, the min and max by monotonic queues
+class WindowAggState {
+ public:
+    // row, state, buf
+    typedef void (*UpdateFn)(const int8_t*, int8_t*, int8_t*);
+
+    WindowAggState(UpdateFn add, UpdateFn evict, size_t slot_num, size_t int_queue_num, size_t double_queue_num)
+        : add_(add),
+          evict_(evict),
+          buf_(slot_num, 0),
+          int_queues_(int_queue_num),
+          double_queues_(double_queue_num),
+          row_cnt_(0),
+          valid_(true) {}
+
+    UpdateFn add_fn() const { return add_; }
+
+    int8_t* buf() { return reinterpret_cast<int8_t*>(buf_.data()); }
+
+    uint64_t row_cnt() const { return row_cnt_; }
+
+    bool valid() const { return valid_; }
+
+    void Add(const Row& row) {
+        if (valid_) {
+            add_(reinterpret_cast<const int8_t*>(&row), reinterpret_cast<int8_t*>(this), buf());
+            row_cnt_++;
+        }
+    }
+
+    void EvictOldest(const Row& row) {
+        if (valid_) {
+            evict_(reinterpret_cast<const int8_t*>(&row), reinterpret_cast<int8_t*>(this), buf());
+            row_cnt_--;
+        }
+    }
+
+    // the monotonic queues can not evict the latest value, the state has to
+    // be rebuilt if there are any
+    void EvictLatest(const Row& row) {
+        if (int_queues_.empty() && double_queues_.empty()) {
+            EvictOldest(row);
+        } else {
+            valid_ = false;
+        }
+    }
+
+    void Reset() {
+        std::fill(buf_.begin(), buf_.end(), 0);
+        for (auto& queue : int_queues_) {
+            queue.Clear();
+        }
+        for (auto& queue : double_queues_) {
+            queue.Clear();
+        }
+        row_cnt_ = 0;
+        valid_ = true;
+    }
+
+    MonotonicQueue<int64_t>& int_queue(size_t idx) { return int_queues_[idx]; }
+    MonotonicQueue<double>& double_queue(size_t idx) { return double_queues_[idx]; }
+
+ private:
+    UpdateFn add_;
+    UpdateFn evict_;
+    // 8 bytes slots
+    std::vector<int64_t> buf_;
+    std::vector<MonotonicQueue<int64_t>> int_queues_;
+    std::vector<MonotonicQueue<double>> double_queues_;
+    uint64_t row_cnt_;
+    bool valid_;
+};
+
 class Window : public MemTimeTableHandler {
  public:
     enum WindowFrameType {
@@ -249,7 +365,8 @@ class Window : public MemTimeTableHandler {
     Window()
         : MemTimeTableHandler(),
           exclude_current_time_(false),
-          instance_not_in_window_(false) {}
+          instance_not_in_window_(false),
+          incremental_agg_(false) {}
     virtual ~Window() {}
 
     std::unique_ptr<RowIterator> GetIterator() override {
@@ -286,9 +403,40 @@ class Window : public MemTimeTableHandler {
         exclude_current_time_ = flag;
     }
 
+    // keep the aggregation states up to date as the rows enter and leave
+    // the window, so that the aggregations need not iterate the window
+    const bool incremental_agg() const { return incremental_agg_; }
+    void set_incremental_agg(const bool flag) { incremental_agg_ = flag; }
+
+    // get the state of the aggregation generated with add and evict, it is
+    // built from the rows of the window on the first call
+    WindowAggState* GetAggState(WindowAggState::UpdateFn add, WindowAggState::UpdateFn evict, size_t slot_num,
+                                size_t int_queue_num, size_t double_queue_num);
+
+    void AddFrontRow(const uint64_t key, const Row& row) {
+        MemTimeTableHandler::AddFrontRow(key, row);
+        for (auto& state : agg_states_) {
+            state->Add(table_.front().second);
+        }
+    }
+    void PopBackRow() {
+        for (auto& state : agg_states_) {
+            state->EvictOldest(table_.back().second);
+        }
+        MemTimeTableHandler::PopBackRow();
+    }
+    void PopFrontRow() {
+        for (auto& state : agg_states_) {
+            state->EvictLatest(table_.front().second);
+        }
+        MemTimeTableHandler::PopFrontRow();
+    }
+
  protected:
     bool exclude_current_time_;
     bool instance_not_in_window_;
+    bool incremental_agg_;
+    std::vector<std::unique_ptr<WindowAggState>> agg_states_;
 };
 class WindowRange {
  public:
@@ -633,6 +781,145 @@ class MemPartitionHandler
     IndexHint index_hint_;
     OrderType order_type_;
 };
+
+typedef std::vector<std::pair<uint64_t, Row>> MemTimeRows;
+
+class MemTimeRowsIterator : public RowIterator {
+ public:
+    MemTimeRowsIterator(const MemTimeRows* rows, const vm::Schema* schema);
+    ~MemTimeRowsIterator();
+    void Seek(const uint64_t& ts);
+    void SeekToFirst();
+    const uint64_t& GetKey() const;
+    void Next();
+    bool Valid() const;
+    const Row& GetValue() override;
+    bool IsSeekable() const override;
+
+ private:
+    const MemTimeRows* rows_;
+    const Schema* schema_;
+    size_t pos_;
+};
+
+class HashPartitionHandler;
+
+class HashSegmentHandler : public TableHandler {
+ public:
+    HashSegmentHandler(std::shared_ptr<HashPartitionHandler> partition_handler,
+                       const MemTimeRows* rows);
+    ~HashSegmentHandler() {}
+
+    const vm::Schema* GetSchema() override;
+    const std::string& GetName() override;
+    const std::string& GetDatabase() override;
+    const vm::Types& GetTypes() override;
+    const vm::IndexHint& GetIndex() override;
+    const OrderType GetOrderType() const override;
+    std::unique_ptr<vm::RowIterator> GetIterator() override;
+    RowIterator* GetRawIterator() override;
+    std::unique_ptr<vm::WindowIterator> GetWindowIterator(
+        const std::string& idx_name) override {
+        LOG(WARNING) << "SegmentHandler can't support window iterator";
+        return std::unique_ptr<WindowIterator>();
+    }
+    const uint64_t GetCount() override {
+        return rows_ == nullptr ? 0 : rows_->size();
+    }
+    Row At(uint64_t pos) override {
+        return rows_ != nullptr && pos < rows_->size() ? rows_->at(pos).second
+                                                       : Row();
+    }
+    const std::string GetHandlerTypeName() override {
+        return "HashSegmentHandler";
+    }
+
+ private:
+    std::shared_ptr<HashPartitionHandler> partition_handler_;
+    const MemTimeRows* rows_;
+};
+
+// a partition handler built by batch mode grouping. the keys are found by an
+// open addressing hash table with the key bytes kept in one buffer, and the
+// rows of every key are appended to a vector. the keys are iterated in the
+// order of MemPartitionHandler, which is built once by SortKeys
+class HashPartitionHandler
+    : public PartitionHandler,
+      public std::enable_shared_from_this<HashPartitionHandler> {
+ public:
+    explicit HashPartitionHandler(const Schema* schema);
+    ~HashPartitionHandler();
+    const Types& GetTypes() override { return types_; }
+    const IndexHint& GetIndex() override { return index_hint_; }
+    const Schema* GetSchema() override { return schema_; }
+    const std::string& GetName() override { return table_name_; }
+    const std::string& GetDatabase() override { return db_; }
+    std::unique_ptr<WindowIterator> GetWindowIterator() override;
+    bool AddRow(const std::string& key, uint64_t ts, const Row& row);
+    // order the keys, it is called once all the rows are added
+    void SortKeys();
+    void Sort(const bool is_asc);
+    void Reverse();
+    const uint64_t GetCount() override { return groups_.size(); }
+    std::shared_ptr<TableHandler> GetSegment(const std::string& key) override;
+    void SetOrderType(const OrderType order_type) { order_type_ = order_type; }
+    const OrderType GetOrderType() const { return order_type_; }
+    const std::string GetHandlerTypeName() override {
+        return "HashPartitionHandler";
+    }
+
+ private:
+    friend class HashWindowIterator;
+
+    struct Group {
+        uint64_t hash;
+        size_t key_offset;
+        size_t key_size;
+        MemTimeRows rows;
+    };
+
+    // return the index of the group of key, or -1 if not found
+    int64_t Find(const char* key, size_t key_size, uint64_t hash) const;
+    void Rehash();
+    int CompareKey(const Group& l, const Group& r) const;
+    std::string GetKey(const Group& group) const {
+        return key_bytes_.substr(group.key_offset, group.key_size);
+    }
+
+    std::string table_name_;
+    std::string db_;
+    const Schema* schema_;
+    Types types_;
+    IndexHint index_hint_;
+    OrderType order_type_;
+    std::vector<Group> groups_;
+    // group index + 1 of every slot, 0 for empty
+    std::vector<uint32_t> slots_;
+    std::string key_bytes_;
+    // the iteration order of the groups and the position of every group in it
+    std::vector<uint32_t> order_;
+    std::vector<uint32_t> rank_;
+};
+
+class HashWindowIterator : public WindowIterator {
+ public:
+    HashWindowIterator(const HashPartitionHandler* partitions,
+                       const Schema* schema);
+    ~HashWindowIterator();
+    void Seek(const std::string& key);
+    void SeekToFirst();
+    void Next();
+    bool Valid();
+    std::unique_ptr<RowIterator> GetValue();
+    RowIterator* GetRawValue();
+    const Row GetKey();
+
+ private:
+    const HashPartitionHandler* partitions_;
+    const Schema* schema_;
+    size_t pos_;
+};
+
 class ConcatTableHandler : public MemTimeTableHandler {
  public:
     ConcatTableHandler(std::shared_ptr<TableHandler> left, size_t left_slices,
@@ -772,6 +1059,18 @@ size_t RowIterGetCurSliceSize(int8_t* iter, size_t idx);
 void RowIterDelete(int8_t* iter);
 int8_t* RowGetSlice(int8_t* row_ptr, size_t idx);
 size_t RowGetSliceSize(int8_t* row_ptr, size_t idx);
+
+// incremental window aggregation interfaces for llvm, see WindowAggState.
+// GetWindowAggState returns null if the window does not support it
+int8_t* GetWindowAggState(int8_t* input, int8_t* add_fn, int8_t* evict_fn, int64_t slot_num, int64_t int_queue_num,
+                          int64_t double_queue_num);
+int8_t* WindowAggStateGetBuf(int8_t* state);
+void WindowAggPushInt64(int8_t* state, int64_t idx, int64_t value, int32_t is_null, int32_t is_max);
+void WindowAggPushDouble(int8_t* state, int64_t idx, double value, int32_t is_null, int32_t is_max);
+void WindowAggEvictInt64(int8_t* state, int64_t idx);
+void WindowAggEvictDouble(int8_t* state, int64_t idx);
+int64_t WindowAggFrontInt64(int8_t* state, int64_t idx, int64_t default_value);
+double WindowAggFrontDouble(int8_t* state, int64_t idx, double default_value);
 }  // namespace vm
 }  // namespace hybridse
 #endif  // HYBRIDSE_INCLUDE_VM_MEM_CATALOG_H_
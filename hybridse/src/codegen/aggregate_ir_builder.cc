@@ -26,6 +26,11 @@
 #include "codegen/variable_ir_builder.h"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
+#include "vm/window_columns.h"
+
+DECLARE_bool(enable_incremental_window_agg);
+DECLARE_bool(enable_columnar_window_agg);
+
 namespace hybridse {
 namespace codegen {
 
@@ -149,7 +154,9 @@ class StatisticalAggGenerator {
           avg_states_(col_num_, nullptr),
           min_states_(col_num_, nullptr),
           max_states_(col_num_, nullptr),
-          count_state_(nullptr) {}
+          count_state_(nullptr),
+          min_queues_(col_num_, 0),
+          max_queues_(col_num_, 0) {}
 
     ::llvm::Value* GenSumInitState(::llvm::IRBuilder<>* builder) {
         ::llvm::LLVMContext& llvm_ctx = builder->getContext();
@@ -182,11 +189,8 @@ class StatisticalAggGenerator {
         return cnt;
     }
 
-    ::llvm::Value* GenMinInitState(::llvm::IRBuilder<>* builder) {
-        ::llvm::LLVMContext& llvm_ctx = builder->getContext();
-        ::llvm::Type* llvm_ty =
-            AggregateIRBuilder::GetOutputLlvmType(llvm_ctx, "min", col_type_);
-        ::llvm::Value* accum = CreateAllocaAtHead(builder, llvm_ty, "min");
+    static ::llvm::Value* GetMinInitValue(::llvm::LLVMContext& llvm_ctx,  // NOLINT
+                                          ::llvm::Type* llvm_ty) {
         ::llvm::Value* min;
         if (llvm_ty == ::llvm::Type::getInt16Ty(llvm_ctx)) {
             min = ::llvm::ConstantInt::get(
@@ -204,15 +208,11 @@ class StatisticalAggGenerator {
             min = ::llvm::ConstantFP::get(llvm_ty,
                                           std::numeric_limits<double>::max());
         }
-        builder->CreateStore(min, accum);
-        return accum;
+        return min;
     }
 
-    ::llvm::Value* GenMaxInitState(::llvm::IRBuilder<>* builder) {
-        ::llvm::LLVMContext& llvm_ctx = builder->getContext();
-        ::llvm::Type* llvm_ty =
-            AggregateIRBuilder::GetOutputLlvmType(llvm_ctx, "max", col_type_);
-        ::llvm::Value* accum = CreateAllocaAtHead(builder, llvm_ty, "max");
+    static ::llvm::Value* GetMaxInitValue(::llvm::LLVMContext& llvm_ctx,  // NOLINT
+                                          ::llvm::Type* llvm_ty) {
         ::llvm::Value* max;
         if (llvm_ty == ::llvm::Type::getInt16Ty(llvm_ctx)) {
             max = ::llvm::ConstantInt::get(
@@ -230,11 +230,37 @@ class StatisticalAggGenerator {
             max = ::llvm::ConstantFP::get(
                 llvm_ty, std::numeric_limits<double>::lowest());
         }
-        builder->CreateStore(max, accum);
+        return max;
+    }
+
+    ::llvm::Value* GenMinInitState(::llvm::IRBuilder<>* builder) {
+        ::llvm::LLVMContext& llvm_ctx = builder->getContext();
+        ::llvm::Type* llvm_ty =
+            AggregateIRBuilder::GetOutputLlvmType(llvm_ctx, "min", col_type_);
+        ::llvm::Value* accum = CreateAllocaAtHead(builder, llvm_ty, "min");
+        builder->CreateStore(GetMinInitValue(llvm_ctx, llvm_ty), accum);
         return accum;
     }
 
+    ::llvm::Value* GenMaxInitState(::llvm::IRBuilder<>* builder) {
+        ::llvm::LLVMContext& llvm_ctx = builder->getContext();
+        ::llvm::Type* llvm_ty =
+            AggregateIRBuilder::GetOutputLlvmType(llvm_ctx, "max", col_type_);
+        ::llvm::Value* accum = CreateAllocaAtHead(builder, llvm_ty, "max");
+        builder->CreateStore(GetMaxInitValue(llvm_ctx, llvm_ty), accum);
+        return accum;
+    }
+
+    void ResetStates() {
+        std::fill(sum_states_.begin(), sum_states_.end(), nullptr);
+        std::fill(avg_states_.begin(), avg_states_.end(), nullptr);
+        std::fill(min_states_.begin(), min_states_.end(), nullptr);
+        std::fill(max_states_.begin(), max_states_.end(), nullptr);
+        count_state_ = nullptr;
+    }
+
     void GenInitState(::llvm::IRBuilder<>* builder) {
+        ResetStates();
         for (size_t i = 0; i < col_num_; ++i) {
             if (!sum_idxs_[i].empty()) {
                 sum_states_[i] = GenSumInitState(builder);
@@ -270,38 +296,39 @@ class StatisticalAggGenerator {
     }
 
     void GenSumUpdate(size_t i, ::llvm::Value* input, ::llvm::Value* is_null,
-                      ::llvm::IRBuilder<>* builder) {
+                      ::llvm::IRBuilder<>* builder, bool evict = false) {
         ::llvm::Value* accum = builder->CreateLoad(sum_states_[i]);
         ::llvm::Value* add;
         if (input->getType()->isIntegerTy()) {
-            add = builder->CreateAdd(accum, input);
+            add = evict ? builder->CreateSub(accum, input) : builder->CreateAdd(accum, input);
         } else {
-            add = builder->CreateFAdd(accum, input);
+            add = evict ? builder->CreateFSub(accum, input) : builder->CreateFAdd(accum, input);
         }
         add = builder->CreateSelect(is_null, accum, add);
         builder->CreateStore(add, sum_states_[i]);
     }
 
     void GenAvgUpdate(size_t i, ::llvm::Value* input, ::llvm::Value* is_null,
-                      ::llvm::IRBuilder<>* builder) {
+                      ::llvm::IRBuilder<>* builder, bool evict = false) {
         ::llvm::Value* accum = builder->CreateLoad(avg_states_[i]);
         if (input->getType()->isIntegerTy()) {
             input = builder->CreateSIToFP(input, accum->getType());
         } else {
             input = builder->CreateFPCast(input, accum->getType());
         }
-        ::llvm::Value* sum = builder->CreateFAdd(accum, input);
+        ::llvm::Value* sum = evict ? builder->CreateFSub(accum, input) : builder->CreateFAdd(accum, input);
         sum = builder->CreateSelect(is_null, accum, sum);
         builder->CreateStore(sum, avg_states_[i]);
     }
 
-    void GenCountUpdate(::llvm::IRBuilder<>* builder, ::llvm::Value* is_null) {
+    void GenCountUpdate(::llvm::IRBuilder<>* builder, ::llvm::Value* is_null,
+                        bool evict = false) {
         ::llvm::Value* one = ::llvm::ConstantInt::get(
             reinterpret_cast<::llvm::PointerType*>(count_state_->getType())
                 ->getElementType(),
             1, true);
         ::llvm::Value* cnt = builder->CreateLoad(count_state_);
-        ::llvm::Value* new_cnt = builder->CreateAdd(cnt, one);
+        ::llvm::Value* new_cnt = evict ? builder->CreateSub(cnt, one) : builder->CreateAdd(cnt, one);
         new_cnt = builder->CreateSelect(is_null, cnt, new_cnt);
         builder->CreateStore(new_cnt, count_state_);
     }
@@ -336,29 +363,180 @@ class StatisticalAggGenerator {
         builder->CreateStore(max, max_states_[i]);
     }
 
+    // update the min or max monotonic queue of the incremental aggregation
+    // state, the values are widened to int64 or double
+    void GenQueueUpdate(::llvm::IRBuilder<>* builder, ::llvm::Value* state,
+                        size_t queue_idx, ::llvm::Value* input,
+                        ::llvm::Value* is_null, bool is_max, bool evict) {
+        ::llvm::Module* module = builder->GetInsertBlock()->getModule();
+        ::llvm::Type* ptr_ty = builder->getInt8PtrTy();
+        ::llvm::Type* int64_ty = builder->getInt64Ty();
+        bool is_double = input->getType()->isFloatingPointTy();
+        if (evict) {
+            auto evict_func = module->getOrInsertFunction(
+                is_double ? "hybridse_window_agg_evict_double"
+                          : "hybridse_window_agg_evict_int64",
+                ::llvm::FunctionType::get(builder->getVoidTy(),
+                                          {ptr_ty, int64_ty}, false));
+            builder->CreateCall(evict_func,
+                                {state, builder->getInt64(queue_idx)});
+            return;
+        }
+        ::llvm::Type* value_ty = is_double ? builder->getDoubleTy() : int64_ty;
+        ::llvm::Value* value = is_double
+                                   ? builder->CreateFPExt(input, value_ty)
+                                   : builder->CreateSExt(input, value_ty);
+        auto push_func = module->getOrInsertFunction(
+            is_double ? "hybridse_window_agg_push_double"
+                      : "hybridse_window_agg_push_int64",
+            ::llvm::FunctionType::get(
+                builder->getVoidTy(),
+                {ptr_ty, int64_ty, value_ty, builder->getInt32Ty(),
+                 builder->getInt32Ty()},
+                false));
+        builder->CreateCall(
+            push_func,
+            {state, builder->getInt64(queue_idx), value,
+             builder->CreateZExt(is_null, builder->getInt32Ty()),
+             builder->getInt32(is_max ? 1 : 0)});
+    }
+
+    // update the states with a row, the min and max go to the monotonic
+    // queues of the incremental aggregation state if there is one, and
+    // evict subtracts the row from the states
     void GenUpdate(::llvm::IRBuilder<>* builder,
                    const std::vector<::llvm::Value*>& inputs,
-                   const std::vector<::llvm::Value*>& is_null) {
+                   const std::vector<::llvm::Value*>& is_null,
+                   ::llvm::Value* state = nullptr, bool evict = false) {
         bool count_updated = false;
         for (size_t i = 0; i < col_num_; ++i) {
             if (!sum_idxs_[i].empty() ||
                 (!avg_idxs_[i].empty() && avg_states_[i] == nullptr)) {
-                GenSumUpdate(i, inputs[i], is_null[i], builder);
+                GenSumUpdate(i, inputs[i], is_null[i], builder, evict);
             }
             if (!avg_idxs_[i].empty() && avg_states_[i] != nullptr) {
-                GenAvgUpdate(i, inputs[i], is_null[i], builder);
+                GenAvgUpdate(i, inputs[i], is_null[i], builder, evict);
             }
             if ((!avg_idxs_[i].empty() || !count_idxs_[i].empty() ||
                  !min_idxs_[i].empty() || !max_idxs_[i].empty()) &&
                 !count_updated) {
-                GenCountUpdate(builder, is_null[i]);
+                GenCountUpdate(builder, is_null[i], evict);
                 count_updated = true;
             }
             if (!min_idxs_[i].empty()) {
-                GenMinUpdate(i, inputs[i], is_null[i], builder);
+                if (state == nullptr) {
+                    GenMinUpdate(i, inputs[i], is_null[i], builder);
+                } else {
+                    GenQueueUpdate(builder, state, min_queues_[i], inputs[i],
+                                   is_null[i], false, evict);
+                }
+            }
+            if (!max_idxs_[i].empty()) {
+                if (state == nullptr) {
+                    GenMaxUpdate(i, inputs[i], is_null[i], builder);
+                } else {
+                    GenQueueUpdate(builder, state, max_queues_[i], inputs[i],
+                                   is_null[i], true, evict);
+                }
+            }
+        }
+    }
+
+    ::llvm::Value* GenSlotState(::llvm::IRBuilder<>* builder,
+                                ::llvm::Value* buf, const std::string& fname,
+                                size_t* slot_num) {
+        ::llvm::Type* llvm_ty = AggregateIRBuilder::GetOutputLlvmType(
+            builder->getContext(), fname, col_type_);
+        ::llvm::Value* slot = builder->CreateGEP(
+            builder->getInt8Ty(), buf, builder->getInt64(*slot_num * 8));
+        *slot_num += 1;
+        return builder->CreateBitCast(slot, llvm_ty->getPointerTo());
+    }
+
+    size_t NextQueue(size_t* int_queue_num, size_t* double_queue_num) {
+        if (col_type_ == node::kFloat || col_type_ == node::kDouble) {
+            return (*double_queue_num)++;
+        }
+        return (*int_queue_num)++;
+    }
+
+    // bind the states to the 8 bytes slots of the incremental aggregation
+    // state buf in the order of GenInitState, the min and max values are
+    // loaded from the monotonic queues by GenLoadQueues
+    void BindSlotStates(::llvm::IRBuilder<>* builder, ::llvm::Value* buf,
+                        size_t* slot_num, size_t* int_queue_num,
+                        size_t* double_queue_num) {
+        ResetStates();
+        for (size_t i = 0; i < col_num_; ++i) {
+            if (!sum_idxs_[i].empty()) {
+                sum_states_[i] = GenSlotState(builder, buf, "sum", slot_num);
+            }
+            if (!avg_idxs_[i].empty()) {
+                if (col_type_ == ::hybridse::node::kDouble) {
+                    if (sum_states_[i] == nullptr) {
+                        sum_states_[i] =
+                            GenSlotState(builder, buf, "sum", slot_num);
+                    }
+                } else {
+                    avg_states_[i] =
+                        GenSlotState(builder, buf, "avg", slot_num);
+                }
+            }
+            if (!avg_idxs_[i].empty() || !count_idxs_[i].empty() ||
+                !min_idxs_[i].empty() || !max_idxs_[i].empty()) {
+                if (count_state_ == nullptr) {
+                    count_state_ =
+                        GenSlotState(builder, buf, "count", slot_num);
+                }
+            }
+            if (!min_idxs_[i].empty()) {
+                min_states_[i] = GenSlotState(builder, buf, "min", slot_num);
+                min_queues_[i] = NextQueue(int_queue_num, double_queue_num);
+            }
+            if (!max_idxs_[i].empty()) {
+                max_states_[i] = GenSlotState(builder, buf, "max", slot_num);
+                max_queues_[i] = NextQueue(int_queue_num, double_queue_num);
+            }
+        }
+    }
+
+    void GenLoadQueue(::llvm::IRBuilder<>* builder, ::llvm::Value* state,
+                      size_t queue_idx, const std::string& fname,
+                      ::llvm::Value* accum) {
+        ::llvm::LLVMContext& llvm_ctx = builder->getContext();
+        ::llvm::Module* module = builder->GetInsertBlock()->getModule();
+        ::llvm::Type* llvm_ty =
+            AggregateIRBuilder::GetOutputLlvmType(llvm_ctx, fname, col_type_);
+        ::llvm::Value* init = fname == "min" ? GetMinInitValue(llvm_ctx, llvm_ty)
+                                             : GetMaxInitValue(llvm_ctx, llvm_ty);
+        bool is_double = llvm_ty->isFloatingPointTy();
+        ::llvm::Type* value_ty =
+            is_double ? builder->getDoubleTy() : builder->getInt64Ty();
+        auto front_func = module->getOrInsertFunction(
+            is_double ? "hybridse_window_agg_front_double"
+                      : "hybridse_window_agg_front_int64",
+            ::llvm::FunctionType::get(
+                value_ty,
+                {builder->getInt8PtrTy(), builder->getInt64Ty(), value_ty},
+                false));
+        ::llvm::Value* value = builder->CreateCall(
+            front_func, {state, builder->getInt64(queue_idx),
+                         is_double ? builder->CreateFPExt(init, value_ty)
+                                   : builder->CreateSExt(init, value_ty)});
+        value = is_double ? builder->CreateFPTrunc(value, llvm_ty)
+                          : builder->CreateTrunc(value, llvm_ty);
+        builder->CreateStore(value, accum);
+    }
+
+    void GenLoadQueues(::llvm::IRBuilder<>* builder, ::llvm::Value* state) {
+        for (size_t i = 0; i < col_num_; ++i) {
+            if (!min_idxs_[i].empty()) {
+                GenLoadQueue(builder, state, min_queues_[i], "min",
+                             min_states_[i]);
             }
             if (!max_idxs_[i].empty()) {
-                GenMaxUpdate(i, inputs[i], is_null[i], builder);
+                GenLoadQueue(builder, state, max_queues_[i], "max",
+                             max_states_[i]);
             }
         }
     }
@@ -459,6 +637,10 @@ class StatisticalAggGenerator {
     std::vector<::llvm::Value*> min_states_;
     std::vector<::llvm::Value*> max_states_;
     ::llvm::Value* count_state_;
+
+    // monotonic queue indexes of the incremental aggregation state
+    std::vector<size_t> min_queues_;
+    std::vector<size_t> max_queues_;
 };
 
 llvm::Type* AggregateIRBuilder::GetOutputLlvmType(
@@ -589,6 +771,259 @@ base::Status ScheduleAggGenerators(
     return base::Status::OK();
 }
 
+static base::Status GetGeneratorInputs(const StatisticalAggGenerator& agg_generator,
+                                       const std::unordered_map<std::string, NativeValue>& row_fields_dict,
+                                       ::llvm::IRBuilder<>* builder, std::vector<::llvm::Value*>* fields,
+                                       std::vector<::llvm::Value*>* fields_is_null) {
+    for (auto& key : agg_generator.GetColKeys()) {
+        auto iter = row_fields_dict.find(key);
+        CHECK_TRUE(iter != row_fields_dict.end(), common::kCodegenUdafError, "Fail to find row field of ", key)
+        auto& field_value = iter->second;
+        fields->push_back(field_value.GetValue(builder));
+        fields_is_null->push_back(field_value.GetIsNull(builder));
+    }
+    return base::Status::OK();
+}
+
+base::Status AggregateIRBuilder::BuildFieldFetches(::llvm::IRBuilder<>* builder,
+                                                   ::llvm::FunctionCallee get_slice_func,
+                                                   ::llvm::FunctionCallee get_slice_size_func, ::llvm::Value* row,
+                                                   std::unordered_map<std::string, NativeValue>* row_fields_dict) {
+    auto int64_ty = builder->getInt64Ty();
+    std::unordered_map<size_t, std::pair<::llvm::Value*, ::llvm::Value*>>
+        used_slices;
+
+    // compute current row's slices
+    for (auto& pair : agg_col_infos_) {
+        size_t schema_idx = pair.second.schema_idx;
+
+        size_t slice_idx = schema_idx;
+        // TODO(tobe): Check row format before getting
+        if (schema_context_->GetRowFormat() != nullptr) {
+            slice_idx = schema_context_->GetRowFormat()->GetSliceId(schema_idx);
+        }
+
+        auto iter = used_slices.find(slice_idx);
+        if (iter == used_slices.end()) {
+            ::llvm::Value* idx_value =
+                llvm::ConstantInt::get(int64_ty, slice_idx, true);
+            ::llvm::Value* buf_ptr =
+                builder->CreateCall(get_slice_func, {row, idx_value});
+            ::llvm::Value* buf_size =
+                builder->CreateCall(get_slice_size_func, {row, idx_value});
+            used_slices[slice_idx] = {buf_ptr, buf_size};
+        }
+    }
+
+    // compute row field fetches
+    for (auto& pair : agg_col_infos_) {
+        auto& info = pair.second;
+        std::string col_key = info.GetColKey();
+        if (row_fields_dict->find(col_key) == row_fields_dict->end()) {
+            size_t schema_idx = info.schema_idx;
+            size_t slice_idx = schema_idx;
+            // TODO(tobe): Check row format before getting
+            if (schema_context_->GetRowFormat() != nullptr) {
+                slice_idx = schema_context_->GetRowFormat()->GetSliceId(schema_idx);
+            }
+
+            auto& slice_info = used_slices[slice_idx];
+
+            ScopeVar dummy_scope_var;
+            BufNativeIRBuilder buf_builder(
+                schema_idx, schema_context_->GetRowFormat(),
+                builder->GetInsertBlock(), &dummy_scope_var);
+            NativeValue field_value;
+            CHECK_TRUE(buf_builder.BuildGetField(info.col_idx, slice_info.first, slice_info.second, &field_value),
+                       common::kCodegenGetFieldError, "fail to gen fetch column")
+            (*row_fields_dict)[col_key] = field_value;
+        }
+    }
+    return base::Status::OK();
+}
+
+base::Status AggregateIRBuilder::BuildIncrementalUpdate(const std::string& fn_name, bool evict,
+                                                        std::vector<StatisticalAggGenerator>* generators,
+                                                        ::llvm::Function** update_fn, size_t* slot_num,
+                                                        size_t* int_queue_num, size_t* double_queue_num) {
+    ::llvm::LLVMContext& llvm_ctx = module_->getContext();
+    ::llvm::IRBuilder<> builder(llvm_ctx);
+    auto ptr_ty = builder.getInt8PtrTy();
+    auto int64_ty = builder.getInt64Ty();
+
+    // row, state, buf
+    ::llvm::FunctionType* fnt =
+        ::llvm::FunctionType::get(builder.getVoidTy(), {ptr_ty, ptr_ty, ptr_ty}, false);
+    ::llvm::Function* fn = ::llvm::Function::Create(fnt, llvm::Function::ExternalLinkage, fn_name, module_);
+    builder.SetInsertPoint(::llvm::BasicBlock::Create(llvm_ctx, "entry", fn));
+    ::llvm::Value* row_arg = fn->arg_begin();
+    ::llvm::Value* state_arg = fn->arg_begin() + 1;
+    ::llvm::Value* buf_arg = fn->arg_begin() + 2;
+
+    auto get_slice_func = module_->getOrInsertFunction(
+        "hybridse_storage_get_row_slice", ::llvm::FunctionType::get(ptr_ty, {ptr_ty, int64_ty}, false));
+    auto get_slice_size_func = module_->getOrInsertFunction(
+        "hybridse_storage_get_row_slice_size", ::llvm::FunctionType::get(int64_ty, {ptr_ty, int64_ty}, false));
+    std::unordered_map<std::string, NativeValue> row_fields_dict;
+    CHECK_STATUS(BuildFieldFetches(&builder, get_slice_func, get_slice_size_func, row_arg, &row_fields_dict))
+
+    *slot_num = 0;
+    *int_queue_num = 0;
+    *double_queue_num = 0;
+    for (auto& agg_generator : *generators) {
+        agg_generator.BindSlotStates(&builder, buf_arg, slot_num, int_queue_num, double_queue_num);
+        std::vector<::llvm::Value*> fields;
+        std::vector<::llvm::Value*> fields_is_null;
+        CHECK_STATUS(GetGeneratorInputs(agg_generator, row_fields_dict, &builder, &fields, &fields_is_null))
+        agg_generator.GenUpdate(&builder, fields, fields_is_null, state_arg, evict);
+    }
+    builder.CreateRetVoid();
+    *update_fn = fn;
+    return base::Status::OK();
+}
+
+// the aggregation of a window keeping an incremental aggregation state needs
+// not iterate the window, the outputs are loaded from the state. otherwise
+// it goes to the iteration from loop_block
+base::Status AggregateIRBuilder::BuildIncremental(const std::string& fn_name, ::llvm::Function* fn,
+                                                  ::llvm::BasicBlock* loop_block, const vm::Schema& output_schema,
+                                                  std::vector<StatisticalAggGenerator>* generators) {
+    ::llvm::LLVMContext& llvm_ctx = module_->getContext();
+    ::llvm::IRBuilder<> builder(llvm_ctx);
+    auto ptr_ty = builder.getInt8PtrTy();
+    auto int64_ty = builder.getInt64Ty();
+
+    size_t slot_num = 0;
+    size_t int_queue_num = 0;
+    size_t double_queue_num = 0;
+    ::llvm::Function* add_fn = nullptr;
+    ::llvm::Function* evict_fn = nullptr;
+    CHECK_STATUS(BuildIncrementalUpdate(fn_name + "add__", false, generators, &add_fn, &slot_num, &int_queue_num,
+                                        &double_queue_num))
+    CHECK_STATUS(BuildIncrementalUpdate(fn_name + "evict__", true, generators, &evict_fn, &slot_num, &int_queue_num,
+                                        &double_queue_num))
+
+    ::llvm::Value* input_arg = fn->arg_begin();
+    ::llvm::Value* output_arg = fn->arg_begin() + 1;
+    ::llvm::BasicBlock* entry_block = ::llvm::BasicBlock::Create(llvm_ctx, "entry", fn, loop_block);
+    ::llvm::BasicBlock* incr_block = ::llvm::BasicBlock::Create(llvm_ctx, "incremental", fn);
+
+    builder.SetInsertPoint(entry_block);
+    auto get_state_func = module_->getOrInsertFunction(
+        "hybridse_window_agg_state",
+        ::llvm::FunctionType::get(ptr_ty, {ptr_ty, ptr_ty, ptr_ty, int64_ty, int64_ty, int64_ty}, false));
+    ::llvm::Value* state = builder.CreateCall(
+        get_state_func, {input_arg, builder.CreateBitCast(add_fn, ptr_ty), builder.CreateBitCast(evict_fn, ptr_ty),
+                         builder.getInt64(slot_num), builder.getInt64(int_queue_num),
+                         builder.getInt64(double_queue_num)});
+    builder.CreateCondBr(builder.CreateIsNull(state), loop_block, incr_block);
+
+    builder.SetInsertPoint(incr_block);
+    auto get_buf_func = module_->getOrInsertFunction("hybridse_window_agg_state_buf",
+                                                     ::llvm::FunctionType::get(ptr_ty, {ptr_ty}, false));
+    ::llvm::Value* buf = builder.CreateCall(get_buf_func, {state});
+    std::map<uint32_t, NativeValue> dummy_map;
+    BufNativeEncoderIRBuilder output_encoder(&dummy_map, &output_schema, incr_block);
+    size_t slot_idx = 0;
+    size_t int_queue_idx = 0;
+    size_t double_queue_idx = 0;
+    for (auto& agg_generator : *generators) {
+        agg_generator.BindSlotStates(&builder, buf, &slot_idx, &int_queue_idx, &double_queue_idx);
+        agg_generator.GenLoadQueues(&builder, state);
+        std::vector<std::pair<size_t, NativeValue>> outputs;
+        agg_generator.GenOutputs(&builder, &outputs);
+        for (auto pair : outputs) {
+            output_encoder.BuildEncodePrimaryField(output_arg, pair.first, pair.second);
+        }
+    }
+    builder.CreateRetVoid();
+    return base::Status::OK();
+}
+
+// decode the aggregated columns of the window once into typed arrays, the
+// aggregations run as the simd kernels of vm::WindowColumns over them
+base::Status AggregateIRBuilder::BuildColumnar(::llvm::Function* fn, ::llvm::BasicBlock* block,
+                                               const vm::Schema& output_schema) {
+    ::llvm::LLVMContext& llvm_ctx = module_->getContext();
+    ::llvm::IRBuilder<> builder(block);
+    auto ptr_ty = builder.getInt8PtrTy();
+    auto int64_ty = builder.getInt64Ty();
+    auto int32_ty = builder.getInt32Ty();
+    ::llvm::Value* input_arg = fn->arg_begin();
+    ::llvm::Value* output_arg = fn->arg_begin() + 1;
+
+    std::vector<std::string> col_keys;
+    for (auto& pair : agg_col_infos_) {
+        col_keys.push_back(pair.first);
+    }
+    std::sort(col_keys.begin(), col_keys.end());
+
+    auto acquire_func = module_->getOrInsertFunction("hybridse_window_columns_acquire",
+                                                     ::llvm::FunctionType::get(ptr_ty, {int64_ty}, false));
+    ::llvm::Value* columns = builder.CreateCall(acquire_func, {builder.getInt64(col_keys.size())});
+    auto set_column_func = module_->getOrInsertFunction(
+        "hybridse_window_columns_set_column",
+        ::llvm::FunctionType::get(int32_ty, {ptr_ty, int64_ty, int32_ty, int32_ty, int32_ty, int32_ty}, false));
+    const codec::RowFormat* row_format = schema_context_->GetRowFormat();
+    for (size_t i = 0; i < col_keys.size(); ++i) {
+        auto& info = agg_col_infos_[col_keys[i]];
+        size_t slice_idx = info.schema_idx;
+        size_t null_idx = info.col_idx;
+        if (row_format != nullptr) {
+            slice_idx = row_format->GetSliceId(info.schema_idx);
+            null_idx = row_format->GetColumnInfo(info.schema_idx, info.col_idx)->idx;
+        }
+        builder.CreateCall(set_column_func,
+                           {columns, builder.getInt64(i), builder.getInt32(info.col_type),
+                            builder.getInt32(slice_idx), builder.getInt32(null_idx), builder.getInt32(info.offset)});
+    }
+    auto decode_func = module_->getOrInsertFunction(
+        "hybridse_window_columns_decode", ::llvm::FunctionType::get(builder.getVoidTy(), {ptr_ty, ptr_ty}, false));
+    builder.CreateCall(decode_func, {columns, input_arg});
+
+    auto aggregate_func = module_->getOrInsertFunction(
+        "hybridse_window_columns_aggregate",
+        ::llvm::FunctionType::get(int32_ty, {ptr_ty, int64_ty, int32_ty, ptr_ty}, false));
+    std::map<uint32_t, NativeValue> dummy_map;
+    BufNativeEncoderIRBuilder output_encoder(&dummy_map, &output_schema, block);
+    for (size_t i = 0; i < col_keys.size(); ++i) {
+        auto& info = agg_col_infos_[col_keys[i]];
+        for (size_t j = 0; j < info.GetOutputNum(); ++j) {
+            auto& fname = info.agg_funcs[j];
+            vm::WindowColumnAggType agg_type;
+            if (fname == "sum") {
+                agg_type = vm::kWindowColumnSum;
+            } else if (fname == "avg") {
+                agg_type = vm::kWindowColumnAvg;
+            } else if (fname == "count") {
+                agg_type = vm::kWindowColumnCount;
+            } else if (fname == "min") {
+                agg_type = vm::kWindowColumnMin;
+            } else if (fname == "max") {
+                agg_type = vm::kWindowColumnMax;
+            } else {
+                FAIL_STATUS(common::kCodegenUdafError, "Unknown agg function name: ", fname)
+            }
+            ::llvm::Type* llvm_ty = GetOutputLlvmType(llvm_ctx, fname, info.col_type);
+            ::llvm::Value* accum = CreateAllocaAtHead(&builder, llvm_ty, fname);
+            ::llvm::Value* is_null = builder.CreateICmpNE(
+                builder.CreateCall(aggregate_func, {columns, builder.getInt64(i), builder.getInt32(agg_type),
+                                                    builder.CreateBitCast(accum, ptr_ty)}),
+                builder.getInt32(0));
+            ::llvm::Value* value = builder.CreateLoad(accum);
+            NativeValue output = agg_type == vm::kWindowColumnMin || agg_type == vm::kWindowColumnMax
+                                     ? NativeValue::CreateWithFlag(value, is_null)
+                                     : NativeValue::Create(value);
+            output_encoder.BuildEncodePrimaryField(output_arg, info.output_idxs[j], output);
+        }
+    }
+    auto release_func = module_->getOrInsertFunction(
+        "hybridse_window_columns_release", ::llvm::FunctionType::get(builder.getVoidTy(), {ptr_ty}, false));
+    builder.CreateCall(release_func, {columns});
+    builder.CreateRetVoid();
+    return base::Status::OK();
+}
+
 base::Status AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
                                     ExprIRBuilder* expr_ir_builder,
                                     VariableIRBuilder* variable_ir_builder,
@@ -624,6 +1059,19 @@ base::Status AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
 
     ::llvm::BasicBlock* head_block =
         ::llvm::BasicBlock::Create(llvm_ctx, "head", fn);
+
+    std::vector<StatisticalAggGenerator> generators;
+    CHECK_STATUS(ScheduleAggGenerators(agg_col_infos_, &generators), common::kCodegenUdafError,
+                 "Schedule agg ops failed")
+
+    if (FLAGS_enable_incremental_window_agg) {
+        CHECK_STATUS(BuildIncremental(base_funcname + "_multi_column_agg_" + std::to_string(id_) + "_", fn,
+                                      head_block, output_schema, &generators))
+    }
+    if (FLAGS_enable_columnar_window_agg) {
+        return BuildColumnar(fn, head_block, output_schema);
+    }
+
     ::llvm::BasicBlock* enter_block =
         ::llvm::BasicBlock::Create(llvm_ctx, "enter_iter", fn);
     ::llvm::BasicBlock* body_block =
@@ -631,10 +1079,6 @@ base::Status AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
     ::llvm::BasicBlock* exit_block =
         ::llvm::BasicBlock::Create(llvm_ctx, "exit_iter", fn);
 
-    std::vector<StatisticalAggGenerator> generators;
-    CHECK_STATUS(ScheduleAggGenerators(agg_col_infos_, &generators), common::kCodegenUdafError,
-                 "Schedule agg ops failed")
-
     // gen head
     builder.SetInsertPoint(head_block);
     for (auto& agg_generator : generators) {
@@ -671,68 +1115,14 @@ base::Status AggregateIRBuilder::BuildMulti(const std::string& base_funcname,
     auto get_slice_size_func = module_->getOrInsertFunction(
         "hybridse_storage_row_iter_get_cur_slice_size",
         ::llvm::FunctionType::get(int64_ty, {ptr_ty, int64_ty}, false));
-    std::unordered_map<size_t, std::pair<::llvm::Value*, ::llvm::Value*>>
-        used_slices;
-
-    // compute current row's slices
-    for (auto& pair : agg_col_infos_) {
-        size_t schema_idx = pair.second.schema_idx;
-
-        size_t slice_idx = schema_idx;
-        // TODO(tobe): Check row format before getting
-        if (schema_context_->GetRowFormat() != nullptr) {
-            slice_idx = schema_context_->GetRowFormat()->GetSliceId(schema_idx);
-        }
-
-        auto iter = used_slices.find(slice_idx);
-        if (iter == used_slices.end()) {
-            ::llvm::Value* idx_value =
-                llvm::ConstantInt::get(int64_ty, slice_idx, true);
-            ::llvm::Value* buf_ptr =
-                builder.CreateCall(get_slice_func, {iter_ptr, idx_value});
-            ::llvm::Value* buf_size =
-                builder.CreateCall(get_slice_size_func, {iter_ptr, idx_value});
-            used_slices[slice_idx] = {buf_ptr, buf_size};
-        }
-    }
-
-    // compute row field fetches
     std::unordered_map<std::string, NativeValue> cur_row_fields_dict;
-    for (auto& pair : agg_col_infos_) {
-        auto& info = pair.second;
-        std::string col_key = info.GetColKey();
-        if (cur_row_fields_dict.find(col_key) == cur_row_fields_dict.end()) {
-            size_t schema_idx = info.schema_idx;
-            size_t slice_idx = schema_idx;
-            // TODO(tobe): Check row format before getting
-            if (schema_context_->GetRowFormat() != nullptr) {
-                slice_idx = schema_context_->GetRowFormat()->GetSliceId(schema_idx);
-            }
-
-            auto& slice_info = used_slices[slice_idx];
-
-            ScopeVar dummy_scope_var;
-            BufNativeIRBuilder buf_builder(
-                schema_idx, schema_context_->GetRowFormat(),
-                body_block, &dummy_scope_var);
-            NativeValue field_value;
-            CHECK_TRUE(buf_builder.BuildGetField(info.col_idx, slice_info.first, slice_info.second, &field_value),
-                       common::kCodegenGetFieldError, "fail to gen fetch column")
-            cur_row_fields_dict[col_key] = field_value;
-        }
-    }
+    CHECK_STATUS(BuildFieldFetches(&builder, get_slice_func, get_slice_size_func, iter_ptr, &cur_row_fields_dict))
 
     // compute accumulation
     for (auto& agg_generator : generators) {
         std::vector<::llvm::Value*> fields;
         std::vector<::llvm::Value*> fields_is_null;
-        for (auto& key : agg_generator.GetColKeys()) {
-            auto iter = cur_row_fields_dict.find(key);
-            CHECK_TRUE(iter != cur_row_fields_dict.end(), common::kCodegenUdafError, "Fail to find row field of ", key)
-            auto& field_value = iter->second;
-            fields.push_back(field_value.GetValue(&builder));
-            fields_is_null.push_back(field_value.GetIsNull(&builder));
-        }
+        CHECK_STATUS(GetGeneratorInputs(agg_generator, cur_row_fields_dict, &builder, &fields, &fields_is_null))
         agg_generator.GenUpdate(&builder, fields, fields_is_null);
     }
     auto next_func = module_->getOrInsertFunction(
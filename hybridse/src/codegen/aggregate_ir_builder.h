@@ -32,6 +32,8 @@
 namespace hybridse {
 namespace codegen {
 
+class StatisticalAggGenerator;
+
 struct AggColumnInfo {
     ::hybridse::node::ColumnRefNode* col;
     node::DataType col_type;
@@ -104,6 +106,25 @@ class AggregateIRBuilder {
     bool empty() const { return agg_col_infos_.empty(); }
 
  private:
+    base::Status BuildFieldFetches(::llvm::IRBuilder<>* builder,
+                                   ::llvm::FunctionCallee get_slice_func,
+                                   ::llvm::FunctionCallee get_slice_size_func,
+                                   ::llvm::Value* row,
+                                   std::unordered_map<std::string, NativeValue>* row_fields_dict);
+
+    base::Status BuildIncrementalUpdate(const std::string& fn_name, bool evict,
+                                        std::vector<StatisticalAggGenerator>* generators,
+                                        ::llvm::Function** update_fn, size_t* slot_num,
+                                        size_t* int_queue_num, size_t* double_queue_num);
+
+    base::Status BuildColumnar(::llvm::Function* fn, ::llvm::BasicBlock* block,
+                               const vm::Schema& output_schema);
+
+    base::Status BuildIncremental(const std::string& fn_name, ::llvm::Function* fn,
+                                  ::llvm::BasicBlock* loop_block,
+                                  const vm::Schema& output_schema,
+                                  std::vector<StatisticalAggGenerator>* generators);
+
     const vm::SchemasContext* schema_context_;
     ::llvm::Module* module_;
     const node::FrameNode* frame_node_;
@@ -22,3 +22,17 @@ DEFINE_string(default_db_name, "_hybridse",
 // Offline Spark config
 DEFINE_bool(enable_spark_unsaferow_format, false,
             "config if codec uses Spark UnsafeRow format");
+
+// Batch runner config
+DEFINE_uint32(batch_runner_thread_num, 1,
+              "config the thread num to run the window and group aggregations "
+              "of the partition keys in batch mode");
+
+// Window aggregation config
+DEFINE_bool(enable_incremental_window_agg, false,
+            "config if the sliding window aggregations keep their states "
+            "incrementally instead of iterating the window for every row");
+DEFINE_bool(enable_columnar_window_agg, false,
+            "config if the window aggregations decode the aggregated columns "
+            "once into typed arrays and run simd kernels over them instead of "
+            "iterating the window rows");
@@ -43,6 +43,7 @@ extern "C" {
 #ifdef LLVM_EXT_ENABLE
 #include "llvm_ext/symbol_resolve.h"
 #endif
+#include "vm/jit_object_cache.h"
 
 namespace hybridse {
 namespace vm {
@@ -150,8 +151,20 @@ bool HybridSeJit::AddSymbol(::llvm::orc::JITDylib& jd,
 
 bool HybridSeLlvmJitWrapper::Init() {
     DLOG(INFO) << "Start to initialize hybridse jit";
-    auto jit = ::llvm::Expected<std::unique_ptr<HybridSeJit>>(
-        HybridSeJitBuilder().create());
+    HybridSeJitBuilder builder;
+    if (!jit_options_.GetObjectCacheDir().empty()) {
+        auto cache =
+            JitObjectCache::GetInstance(jit_options_.GetObjectCacheDir(),
+                                        jit_options_.GetObjectCacheMaxSize());
+        builder.setCompileFunctionCreator(
+            [cache](::llvm::orc::JITTargetMachineBuilder jtmb)
+                -> ::llvm::Expected<
+                    ::llvm::orc::IRCompileLayer::CompileFunction> {
+                return ::llvm::orc::ConcurrentIRCompiler(std::move(jtmb),
+                                                         cache);
+            });
+    }
+    auto jit = ::llvm::Expected<std::unique_ptr<HybridSeJit>>(builder.create());
     {
         ::llvm::Error e = jit.takeError();
         if (e) {
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "vm/jit_object_cache.h"
+
+#include <utime.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "base/fe_hash.h"
+#include "glog/logging.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace hybridse {
+namespace vm {
+
+// the objects are only valid on the same llvm and the same target
+static const std::string& GetTargetSignature() {
+    static const std::string signature = [] {
+        std::string str = std::string(LLVM_VERSION_STRING) + ";" +
+                          ::llvm::sys::getProcessTriple() + ";" +
+                          ::llvm::sys::getHostCPUName().str();
+        ::llvm::StringMap<bool> features;
+        std::vector<std::string> enabled;
+        if (::llvm::sys::getHostCPUFeatures(features)) {
+            for (auto& feature : features) {
+                if (feature.second) {
+                    enabled.push_back(feature.first().str());
+                }
+            }
+        }
+        std::sort(enabled.begin(), enabled.end());
+        for (auto& feature : enabled) {
+            str.append(";+").append(feature);
+        }
+        return str;
+    }();
+    return signature;
+}
+
+std::string JitObjectCache::GetKey(const ::llvm::Module& m) {
+    std::string str = GetTargetSignature();
+    ::llvm::raw_string_ostream ss(str);
+    ss << "\n" << m;
+    ss.flush();
+    // two hashes of different seeds keep the collision negligible
+    uint64_t h1 = base::MurmurHash64A(str.data(), str.size(), 0xe17a1465);
+    uint64_t h2 = base::MurmurHash64A(str.data(), str.size(), 0x9747b28c);
+    char key[33];
+    snprintf(key, sizeof(key), "%016lx%016lx", h1, h2);
+    return std::string(key);
+}
+
+std::string JitObjectCache::GetObjectPath(const ::llvm::Module& m) const {
+    return dir_ + "/" + GetKey(m) + ".o";
+}
+
+void JitObjectCache::notifyObjectCompiled(const ::llvm::Module* m,
+                                          ::llvm::MemoryBufferRef obj) {
+    std::error_code ec = ::llvm::sys::fs::create_directories(dir_);
+    if (ec) {
+        LOG(WARNING) << "fail to create jit object cache dir " << dir_ << ": "
+                     << ec.message();
+        return;
+    }
+    // write to a temporary file and rename it, so a concurrent or an
+    // interrupted compile never leaves a partial object
+    int fd = -1;
+    ::llvm::SmallString<128> tmp_path;
+    ec = ::llvm::sys::fs::createUniqueFile(dir_ + "/%%%%%%%%.tmp", fd,
+                                           tmp_path);
+    if (ec) {
+        LOG(WARNING) << "fail to create jit object file in " << dir_ << ": "
+                     << ec.message();
+        return;
+    }
+    {
+        ::llvm::raw_fd_ostream os(fd, true);
+        os << obj.getBuffer();
+        os.close();
+        if (os.has_error()) {
+            LOG(WARNING) << "fail to write jit object file " << tmp_path.str()
+                         << ": " << os.error().message();
+            os.clear_error();
+            ::llvm::sys::fs::remove(tmp_path);
+            return;
+        }
+    }
+    std::string path = GetObjectPath(*m);
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!size_loaded_) {
+        Evict(path);
+    }
+    ec = ::llvm::sys::fs::rename(tmp_path, path);
+    if (ec) {
+        LOG(WARNING) << "fail to rename jit object file to " << path << ": "
+                     << ec.message();
+        ::llvm::sys::fs::remove(tmp_path);
+        return;
+    }
+    DLOG(INFO) << "cache jit object " << path;
+    size_ += obj.getBufferSize();
+    if (max_size_ > 0 && size_ > max_size_) {
+        Evict(path);
+    }
+}
+
+void JitObjectCache::Evict(const std::string& keep) {
+    struct Object {
+        std::string path;
+        uint64_t size;
+        ::llvm::sys::TimePoint<> mtime;
+    };
+    std::vector<Object> objects;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (::llvm::sys::fs::directory_iterator it(dir_, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        if (::llvm::sys::path::extension(it->path()) != ".o") {
+            continue;
+        }
+        ::llvm::sys::fs::file_status status;
+        if (::llvm::sys::fs::status(it->path(), status)) {
+            continue;
+        }
+        objects.push_back(
+            {it->path(), status.getSize(), status.getLastModificationTime()});
+        total += status.getSize();
+    }
+    size_loaded_ = true;
+    if (max_size_ > 0 && total > max_size_) {
+        std::sort(objects.begin(), objects.end(),
+                  [](const Object& a, const Object& b) {
+                      return a.mtime < b.mtime;
+                  });
+        for (const auto& object : objects) {
+            if (total <= max_size_) {
+                break;
+            }
+            if (object.path != keep && !::llvm::sys::fs::remove(object.path)) {
+                total -= object.size;
+                DLOG(INFO) << "evict jit object " << object.path;
+            }
+        }
+    }
+    size_ = total;
+}
+
+std::unique_ptr<::llvm::MemoryBuffer> JitObjectCache::getObject(
+    const ::llvm::Module* m) {
+    std::string path = GetObjectPath(*m);
+    auto buf = ::llvm::MemoryBuffer::getFile(path, -1, false);
+    if (!buf) {
+        return nullptr;
+    }
+    DLOG(INFO) << "load jit object " << path;
+    hit_cnt_.fetch_add(1, std::memory_order_relaxed);
+    // the eviction removes the objects not loaded for the longest time
+    utime(path.c_str(), nullptr);
+    return std::move(buf.get());
+}
+
+JitObjectCache* JitObjectCache::GetInstance(const std::string& dir,
+                                            uint64_t max_size) {
+    static std::mutex mu;
+    static std::map<std::string, std::unique_ptr<JitObjectCache>> caches;
+    std::lock_guard<std::mutex> lock(mu);
+    auto& cache = caches[dir];
+    if (!cache) {
+        cache.reset(new JitObjectCache(dir, max_size));
+    }
+    return cache.get();
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYBRIDSE_SRC_VM_JIT_OBJECT_CACHE_H_
+#define HYBRIDSE_SRC_VM_JIT_OBJECT_CACHE_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace hybridse {
+namespace vm {
+
+// persist the objects compiled by the jit under a directory, so a module
+// compiled again, e.g. the deployments reloaded after a restart, skips the
+// llvm code generation. the key is the hash of the optimized module ir, which
+// covers the sql, the schemas and the inlined udfs, together with the llvm
+// version and the host cpu. the directory should be separated by the engine
+// version, since the external functions are resolved by their names.
+// a loaded object is touched, and the least recently used objects are removed
+// once the objects exceed max_size
+class JitObjectCache : public ::llvm::ObjectCache {
+ public:
+    JitObjectCache(const std::string& dir, uint64_t max_size)
+        : dir_(dir), max_size_(max_size), size_(0), size_loaded_(false),
+          hit_cnt_(0) {}
+    ~JitObjectCache() {}
+
+    void notifyObjectCompiled(const ::llvm::Module* m,
+                              ::llvm::MemoryBufferRef obj) override;
+
+    std::unique_ptr<::llvm::MemoryBuffer> getObject(
+        const ::llvm::Module* m) override;
+
+    std::string GetObjectPath(const ::llvm::Module& m) const;
+
+    // the number of objects loaded instead of compiled
+    uint64_t GetHitCount() const {
+        return hit_cnt_.load(std::memory_order_relaxed);
+    }
+
+    // the jit keeps the cache, so the instance of a directory lives with the
+    // process. max_size of the first call is used, 0 means unlimited
+    static JitObjectCache* GetInstance(const std::string& dir,
+                                       uint64_t max_size = 0);
+
+    static std::string GetKey(const ::llvm::Module& m);
+
+ private:
+    // remove the least recently used objects except keep until they fit
+    // max_size_, need hold mu_
+    void Evict(const std::string& keep);
+
+    const std::string dir_;
+    const uint64_t max_size_;
+    std::mutex mu_;
+    // the total size of the objects, loaded from dir_ on the first write
+    uint64_t size_;
+    bool size_loaded_;
+    std::atomic<uint64_t> hit_cnt_;
+};
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // HYBRIDSE_SRC_VM_JIT_OBJECT_CACHE_H_
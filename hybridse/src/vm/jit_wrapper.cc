@@ -39,6 +39,7 @@
 #include "udf/default_udf_library.h"
 #include "udf/udf.h"
 #include "vm/jit.h"
+#include "vm/window_columns.h"
 
 namespace hybridse {
 namespace vm {
@@ -76,14 +77,14 @@ HybridSeJitWrapper* HybridSeJitWrapper::Create(const JitOptions& jit_options) {
         return new HybridSeMcJitWrapper(jit_options);
 #else
         LOG(WARNING) << "McJit support is not enabled";
-        return new HybridSeLlvmJitWrapper();
+        return new HybridSeLlvmJitWrapper(jit_options);
 #endif
     } else {
         if (jit_options.IsEnableVtune() || jit_options.IsEnablePerf() ||
             jit_options.IsEnableGdb()) {
             LOG(WARNING) << "LLJIT do not support jit events";
         }
-        return new HybridSeLlvmJitWrapper();
+        return new HybridSeLlvmJitWrapper(jit_options);
     }
 }
 
@@ -204,6 +205,49 @@ void InitBuiltinJitSymbols(HybridSeJitWrapper* jit) {
         "hybridse_storage_get_row_slice_size",
         reinterpret_cast<void*>(&hybridse::vm::RowGetSliceSize));
 
+    // incremental window aggregation
+    jit->AddExternalFunction(
+        "hybridse_window_agg_state",
+        reinterpret_cast<void*>(&hybridse::vm::GetWindowAggState));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_state_buf",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggStateGetBuf));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_push_int64",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggPushInt64));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_push_double",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggPushDouble));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_evict_int64",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggEvictInt64));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_evict_double",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggEvictDouble));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_front_int64",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggFrontInt64));
+    jit->AddExternalFunction(
+        "hybridse_window_agg_front_double",
+        reinterpret_cast<void*>(&hybridse::vm::WindowAggFrontDouble));
+
+    // columnar window aggregation
+    jit->AddExternalFunction(
+        "hybridse_window_columns_acquire",
+        reinterpret_cast<void*>(&hybridse::vm::AcquireWindowColumns));
+    jit->AddExternalFunction(
+        "hybridse_window_columns_set_column",
+        reinterpret_cast<void*>(&hybridse::vm::WindowColumnsSetColumn));
+    jit->AddExternalFunction(
+        "hybridse_window_columns_decode",
+        reinterpret_cast<void*>(&hybridse::vm::WindowColumnsDecode));
+    jit->AddExternalFunction(
+        "hybridse_window_columns_aggregate",
+        reinterpret_cast<void*>(&hybridse::vm::WindowColumnsAggregate));
+    jit->AddExternalFunction(
+        "hybridse_window_columns_release",
+        reinterpret_cast<void*>(&hybridse::vm::ReleaseWindowColumns));
+
     jit->AddExternalFunction(
         "hybridse_memery_pool_alloc",
         reinterpret_cast<void*>(&udf::v1::AllocManagedStringBuf));
@@ -17,8 +17,12 @@
 #include "vm/jit_wrapper.h"
 #include "codec/fe_row_codec.h"
 #include "gtest/gtest.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
 #include "udf/udf.h"
 #include "vm/engine.h"
+#include "vm/jit_object_cache.h"
 #include "vm/simple_catalog.h"
 #include "vm/sql_compiler.h"
 
@@ -74,24 +78,7 @@ std::shared_ptr<SqlCompileInfo> CompileNotPerformanceSensitive(
     return std::dynamic_pointer_cast<SqlCompileInfo>(session.GetCompileInfo());
 }
 
-void simple_test(const EngineOptions &options) {
-    auto catalog = GetTestCatalog();
-    std::string sql = "select col_1, col_2 from t1;";
-    auto compile_info = Compile(sql, options, catalog);
-    auto &sql_context = compile_info->get_sql_context();
-    std::string ir_str = sql_context.ir;
-    ASSERT_FALSE(ir_str.empty());
-    HybridSeJitWrapper *jit = HybridSeJitWrapper::Create();
-    ASSERT_TRUE(jit->Init());
-    HybridSeJitWrapper::InitJitSymbols(jit);
-
-    base::RawBuffer ir_buf(const_cast<char *>(ir_str.data()), ir_str.size());
-    ASSERT_TRUE(jit->AddModuleFromBuffer(ir_buf));
-
-    auto fn_name = sql_context.physical_plan->GetFnInfos()[0]->fn_name();
-    auto fn = jit->FindFunction(fn_name);
-    ASSERT_TRUE(fn != nullptr);
-
+void check_project(const int8_t *fn, std::shared_ptr<SimpleCatalog> catalog) {
     int8_t buf[1024];
     auto schema = catalog->GetTable("db", "t1")->GetSchema();
     codec::RowBuilder row_builder(*schema);
@@ -109,6 +96,26 @@ void simple_test(const EngineOptions &options) {
     ASSERT_EQ(row_view.GetInt64(1, &c2), 0);
     ASSERT_EQ(c1, 3.14);
     ASSERT_EQ(c2, 42);
+}
+
+void simple_test(const EngineOptions &options) {
+    auto catalog = GetTestCatalog();
+    std::string sql = "select col_1, col_2 from t1;";
+    auto compile_info = Compile(sql, options, catalog);
+    auto &sql_context = compile_info->get_sql_context();
+    std::string ir_str = sql_context.ir;
+    ASSERT_FALSE(ir_str.empty());
+    HybridSeJitWrapper *jit = HybridSeJitWrapper::Create();
+    ASSERT_TRUE(jit->Init());
+    HybridSeJitWrapper::InitJitSymbols(jit);
+
+    base::RawBuffer ir_buf(const_cast<char *>(ir_str.data()), ir_str.size());
+    ASSERT_TRUE(jit->AddModuleFromBuffer(ir_buf));
+
+    auto fn_name = sql_context.physical_plan->GetFnInfos()[0]->fn_name();
+    auto fn = jit->FindFunction(fn_name);
+    ASSERT_TRUE(fn != nullptr);
+    check_project(fn, catalog);
     delete jit;
 }
 
@@ -130,6 +137,68 @@ TEST_F(JitWrapperTest, test_mcjit) {
 }
 #endif
 
+size_t count_cached_objects(const std::string &dir) {
+    size_t cnt = 0;
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(dir, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        if (llvm::sys::path::extension(it->path()) == ".o") {
+            cnt++;
+        }
+    }
+    return cnt;
+}
+
+TEST_F(JitWrapperTest, test_object_cache) {
+    llvm::SmallString<128> path;
+    ASSERT_FALSE(
+        llvm::sys::fs::createUniqueDirectory("jit_object_cache_test", path));
+    std::string dir = path.str().str();
+    EngineOptions options;
+    options.jit_options().SetObjectCacheDir(dir);
+    auto cache = JitObjectCache::GetInstance(dir);
+    auto catalog = GetTestCatalog();
+    std::string sql = "select col_1, col_2 from t1;";
+    for (int i = 0; i < 2; i++) {
+        // the second compile loads the object of the first one
+        auto compile_info = Compile(sql, options, catalog);
+        ASSERT_TRUE(compile_info != nullptr);
+        ASSERT_EQ(1u, count_cached_objects(dir));
+        ASSERT_EQ(static_cast<uint64_t>(i), cache->GetHitCount());
+        auto &sql_context = compile_info->get_sql_context();
+        auto fn = sql_context.physical_plan->GetFnInfos()[0]->fn_ptr();
+        ASSERT_TRUE(fn != nullptr);
+        check_project(fn, catalog);
+    }
+    Compile("select col_2 from t1;", options, catalog);
+    ASSERT_EQ(2u, count_cached_objects(dir));
+    ASSERT_EQ(1u, cache->GetHitCount());
+    llvm::sys::fs::remove_directories(dir);
+}
+
+TEST_F(JitWrapperTest, test_object_cache_evict) {
+    llvm::SmallString<128> path;
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory(
+        "jit_object_cache_evict_test", path));
+    std::string dir = path.str().str();
+    EngineOptions options;
+    options.jit_options().SetObjectCacheDir(dir);
+    // any object is beyond it, so only the last one is kept
+    options.jit_options().SetObjectCacheMaxSize(1);
+    auto cache = JitObjectCache::GetInstance(dir, 1);
+    auto catalog = GetTestCatalog();
+    Compile("select col_1, col_2 from t1;", options, catalog);
+    Compile("select col_2 from t1;", options, catalog);
+    ASSERT_EQ(1u, count_cached_objects(dir));
+    Compile("select col_2 from t1;", options, catalog);
+    ASSERT_EQ(1u, cache->GetHitCount());
+    // the evicted one is compiled again
+    Compile("select col_1, col_2 from t1;", options, catalog);
+    ASSERT_EQ(1u, cache->GetHitCount());
+    ASSERT_EQ(1u, count_cached_objects(dir));
+    llvm::sys::fs::remove_directories(dir);
+}
+
 TEST_F(JitWrapperTest, test_window) {
     EngineOptions options;
     options.SetKeepIr(true);
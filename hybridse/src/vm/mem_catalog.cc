@@ -15,7 +15,9 @@
  */
 
 #include "vm/mem_catalog.h"
+#include <string.h>
 #include <algorithm>
+#include "base/fe_hash.h"
 namespace hybridse {
 namespace vm {
 MemTimeTableIterator::MemTimeTableIterator(const MemTimeTable* table,
@@ -133,6 +135,29 @@ void MemTimeTableHandler::PopBackRow() { table_.pop_back(); }
 
 void MemTimeTableHandler::PopFrontRow() { table_.pop_front(); }
 
+WindowAggState* Window::GetAggState(WindowAggState::UpdateFn add, WindowAggState::UpdateFn evict, size_t slot_num,
+                                    size_t int_queue_num, size_t double_queue_num) {
+    WindowAggState* state = nullptr;
+    for (auto& agg_state : agg_states_) {
+        if (agg_state->add_fn() == add) {
+            state = agg_state.get();
+            break;
+        }
+    }
+    if (state == nullptr) {
+        agg_states_.emplace_back(new WindowAggState(add, evict, slot_num, int_queue_num, double_queue_num));
+        state = agg_states_.back().get();
+    } else if (state->valid() && state->row_cnt() == table_.size()) {
+        return state;
+    }
+    // add the rows from the oldest one
+    state->Reset();
+    for (auto iter = table_.rbegin(); iter != table_.rend(); ++iter) {
+        state->Add(iter->second);
+    }
+    return state;
+}
+
 const Types& MemTimeTableHandler::GetTypes() { return types_; }
 
 void MemTimeTableHandler::Sort(const bool is_asc) {
@@ -232,6 +257,217 @@ void MemPartitionHandler::Print() {
     }
 }
 
+MemTimeRowsIterator::MemTimeRowsIterator(const MemTimeRows* rows,
+                                         const vm::Schema* schema)
+    : rows_(rows), schema_(schema), pos_(0) {}
+MemTimeRowsIterator::~MemTimeRowsIterator() {}
+void MemTimeRowsIterator::Seek(const uint64_t& ts) {
+    pos_ = 0;
+    while (pos_ < rows_->size() && (*rows_)[pos_].first > ts) {
+        pos_++;
+    }
+}
+void MemTimeRowsIterator::SeekToFirst() { pos_ = 0; }
+const uint64_t& MemTimeRowsIterator::GetKey() const {
+    return (*rows_)[pos_].first;
+}
+const Row& MemTimeRowsIterator::GetValue() { return (*rows_)[pos_].second; }
+void MemTimeRowsIterator::Next() { pos_++; }
+bool MemTimeRowsIterator::Valid() const { return pos_ < rows_->size(); }
+bool MemTimeRowsIterator::IsSeekable() const { return true; }
+
+HashSegmentHandler::HashSegmentHandler(
+    std::shared_ptr<HashPartitionHandler> partition_handler,
+    const MemTimeRows* rows)
+    : partition_handler_(partition_handler), rows_(rows) {}
+const vm::Schema* HashSegmentHandler::GetSchema() {
+    return partition_handler_->GetSchema();
+}
+const std::string& HashSegmentHandler::GetName() {
+    return partition_handler_->GetName();
+}
+const std::string& HashSegmentHandler::GetDatabase() {
+    return partition_handler_->GetDatabase();
+}
+const vm::Types& HashSegmentHandler::GetTypes() {
+    return partition_handler_->GetTypes();
+}
+const vm::IndexHint& HashSegmentHandler::GetIndex() {
+    return partition_handler_->GetIndex();
+}
+const OrderType HashSegmentHandler::GetOrderType() const {
+    return partition_handler_->GetOrderType();
+}
+std::unique_ptr<vm::RowIterator> HashSegmentHandler::GetIterator() {
+    return std::unique_ptr<RowIterator>(GetRawIterator());
+}
+RowIterator* HashSegmentHandler::GetRawIterator() {
+    if (rows_ == nullptr) {
+        return nullptr;
+    }
+    return new MemTimeRowsIterator(rows_, partition_handler_->GetSchema());
+}
+
+// the load factor of the hash table is kept under 1/2
+static const size_t HASH_PARTITION_INIT_SLOTS = 64;
+static const uint32_t HASH_PARTITION_SEED = 0xe17a1465;
+
+HashPartitionHandler::HashPartitionHandler(const Schema* schema)
+    : PartitionHandler(),
+      table_name_(""),
+      db_(""),
+      schema_(schema),
+      order_type_(kNoneOrder),
+      groups_(),
+      slots_(HASH_PARTITION_INIT_SLOTS, 0),
+      key_bytes_(),
+      order_(),
+      rank_() {}
+HashPartitionHandler::~HashPartitionHandler() {}
+
+int64_t HashPartitionHandler::Find(const char* key, size_t key_size,
+                                   uint64_t hash) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+        uint32_t slot = slots_[pos];
+        if (slot == 0) {
+            return -1;
+        }
+        const Group& group = groups_[slot - 1];
+        if (group.hash == hash && group.key_size == key_size &&
+            memcmp(key_bytes_.data() + group.key_offset, key, key_size) == 0) {
+            return slot - 1;
+        }
+    }
+}
+
+void HashPartitionHandler::Rehash() {
+    slots_.assign(slots_.size() * 2, 0);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = 0; i < groups_.size(); i++) {
+        size_t pos = groups_[i].hash & mask;
+        while (slots_[pos] != 0) {
+            pos = (pos + 1) & mask;
+        }
+        slots_[pos] = i + 1;
+    }
+}
+
+bool HashPartitionHandler::AddRow(const std::string& key, uint64_t ts,
+                                  const Row& row) {
+    uint64_t hash =
+        base::MurmurHash64A(key.data(), key.size(), HASH_PARTITION_SEED);
+    int64_t idx = Find(key.data(), key.size(), hash);
+    if (idx < 0) {
+        if ((groups_.size() + 1) * 2 > slots_.size()) {
+            Rehash();
+        }
+        size_t mask = slots_.size() - 1;
+        size_t pos = hash & mask;
+        while (slots_[pos] != 0) {
+            pos = (pos + 1) & mask;
+        }
+        idx = groups_.size();
+        slots_[pos] = idx + 1;
+        groups_.push_back({hash, key_bytes_.size(), key.size(), MemTimeRows()});
+        key_bytes_.append(key);
+    }
+    groups_[idx].rows.emplace_back(ts, row);
+    return true;
+}
+
+int HashPartitionHandler::CompareKey(const Group& l, const Group& r) const {
+    int ret = memcmp(key_bytes_.data() + l.key_offset,
+                     key_bytes_.data() + r.key_offset,
+                     std::min(l.key_size, r.key_size));
+    if (ret != 0) {
+        return ret;
+    }
+    return l.key_size < r.key_size ? -1 : l.key_size > r.key_size ? 1 : 0;
+}
+
+void HashPartitionHandler::SortKeys() {
+    order_.resize(groups_.size());
+    for (size_t i = 0; i < groups_.size(); i++) {
+        order_[i] = i;
+    }
+    // descending as the std::greater map of MemPartitionHandler
+    std::sort(order_.begin(), order_.end(), [this](uint32_t l, uint32_t r) {
+        return CompareKey(groups_[l], groups_[r]) > 0;
+    });
+    rank_.resize(groups_.size());
+    for (size_t i = 0; i < order_.size(); i++) {
+        rank_[order_[i]] = i;
+    }
+}
+
+std::unique_ptr<WindowIterator> HashPartitionHandler::GetWindowIterator() {
+    if (order_.size() != groups_.size()) {
+        SortKeys();
+    }
+    return std::unique_ptr<WindowIterator>(
+        new HashWindowIterator(this, schema_));
+}
+
+std::shared_ptr<TableHandler> HashPartitionHandler::GetSegment(
+    const std::string& key) {
+    uint64_t hash =
+        base::MurmurHash64A(key.data(), key.size(), HASH_PARTITION_SEED);
+    int64_t idx = Find(key.data(), key.size(), hash);
+    return std::make_shared<HashSegmentHandler>(
+        shared_from_this(), idx < 0 ? nullptr : &groups_[idx].rows);
+}
+
+void HashPartitionHandler::Sort(const bool is_asc) {
+    if (is_asc) {
+        AscComparor comparor;
+        for (auto& group : groups_) {
+            std::sort(group.rows.begin(), group.rows.end(), comparor);
+        }
+        order_type_ = kAscOrder;
+    } else {
+        DescComparor comparor;
+        for (auto& group : groups_) {
+            std::sort(group.rows.begin(), group.rows.end(), comparor);
+        }
+        order_type_ = kDescOrder;
+    }
+}
+
+void HashPartitionHandler::Reverse() {
+    for (auto& group : groups_) {
+        std::reverse(group.rows.begin(), group.rows.end());
+    }
+    order_type_ = kAscOrder == order_type_
+                      ? kDescOrder
+                      : kDescOrder == order_type_ ? kAscOrder : kNoneOrder;
+}
+
+HashWindowIterator::HashWindowIterator(const HashPartitionHandler* partitions,
+                                       const Schema* schema)
+    : WindowIterator(), partitions_(partitions), schema_(schema), pos_(0) {}
+HashWindowIterator::~HashWindowIterator() {}
+void HashWindowIterator::Seek(const std::string& key) {
+    uint64_t hash =
+        base::MurmurHash64A(key.data(), key.size(), HASH_PARTITION_SEED);
+    int64_t idx = partitions_->Find(key.data(), key.size(), hash);
+    pos_ = idx < 0 ? partitions_->order_.size() : partitions_->rank_[idx];
+}
+void HashWindowIterator::SeekToFirst() { pos_ = 0; }
+void HashWindowIterator::Next() { pos_++; }
+bool HashWindowIterator::Valid() { return pos_ < partitions_->order_.size(); }
+std::unique_ptr<RowIterator> HashWindowIterator::GetValue() {
+    return std::unique_ptr<RowIterator>(GetRawValue());
+}
+RowIterator* HashWindowIterator::GetRawValue() {
+    return new MemTimeRowsIterator(
+        &partitions_->groups_[partitions_->order_[pos_]].rows, schema_);
+}
+const Row HashWindowIterator::GetKey() {
+    return Row(partitions_->GetKey(
+        partitions_->groups_[partitions_->order_[pos_]]));
+}
+
 std::unique_ptr<WindowIterator> MemTableHandler::GetWindowIterator(
     const std::string& idx_name) {
     return std::unique_ptr<WindowIterator>();
@@ -425,5 +661,37 @@ size_t RowGetSliceSize(int8_t* row_ptr, size_t idx) {
     auto row = reinterpret_cast<Row*>(row_ptr);
     return row->size(idx);
 }
+
+// incremental window aggregation interfaces for llvm
+int8_t* GetWindowAggState(int8_t* input, int8_t* add_fn, int8_t* evict_fn, int64_t slot_num, int64_t int_queue_num,
+                          int64_t double_queue_num) {
+    auto list_ref = reinterpret_cast<codec::ListRef<Row>*>(input);
+    auto window = dynamic_cast<Window*>(reinterpret_cast<codec::ListV<Row>*>(list_ref->list));
+    if (window == nullptr || !window->incremental_agg()) {
+        return nullptr;
+    }
+    return reinterpret_cast<int8_t*>(window->GetAggState(reinterpret_cast<WindowAggState::UpdateFn>(add_fn),
+                                                         reinterpret_cast<WindowAggState::UpdateFn>(evict_fn),
+                                                         slot_num, int_queue_num, double_queue_num));
+}
+int8_t* WindowAggStateGetBuf(int8_t* state) { return reinterpret_cast<WindowAggState*>(state)->buf(); }
+void WindowAggPushInt64(int8_t* state, int64_t idx, int64_t value, int32_t is_null, int32_t is_max) {
+    reinterpret_cast<WindowAggState*>(state)->int_queue(idx).Push(value, is_null, is_max);
+}
+void WindowAggPushDouble(int8_t* state, int64_t idx, double value, int32_t is_null, int32_t is_max) {
+    reinterpret_cast<WindowAggState*>(state)->double_queue(idx).Push(value, is_null, is_max);
+}
+void WindowAggEvictInt64(int8_t* state, int64_t idx) {
+    reinterpret_cast<WindowAggState*>(state)->int_queue(idx).Evict();
+}
+void WindowAggEvictDouble(int8_t* state, int64_t idx) {
+    reinterpret_cast<WindowAggState*>(state)->double_queue(idx).Evict();
+}
+int64_t WindowAggFrontInt64(int8_t* state, int64_t idx, int64_t default_value) {
+    return reinterpret_cast<WindowAggState*>(state)->int_queue(idx).Front(default_value);
+}
+double WindowAggFrontDouble(int8_t* state, int64_t idx, double default_value) {
+    return reinterpret_cast<WindowAggState*>(state)->double_queue(idx).Front(default_value);
+}
 }  // namespace vm
 }  // namespace hybridse
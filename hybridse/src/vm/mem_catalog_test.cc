@@ -15,6 +15,8 @@
  */
 
 #include "vm/mem_catalog.h"
+#include <algorithm>
+#include <functional>
 #include "gtest/gtest.h"
 #include "vm/catalog_wrapper.h"
 #include "testing/test_base.h"
@@ -421,6 +423,65 @@ TEST_F(MemCataLogTest, mem_partition_test) {
     }
 }
 
+TEST_F(MemCataLogTest, hash_partition_test) {
+    std::vector<Row> rows;
+    ::hybridse::type::TableDef table;
+    BuildRows(table, rows);
+    auto partition_handler =
+        std::make_shared<vm::HashPartitionHandler>(&(table.columns()));
+
+    // enough keys to rehash the slots
+    uint64_t ts = 1;
+    for (int i = 0; i < 100; i++) {
+        for (auto row : rows) {
+            partition_handler->AddRow("group" + std::to_string(i), ts++,
+                                      row);
+        }
+    }
+    partition_handler->SortKeys();
+    partition_handler->Sort(false);
+    ASSERT_EQ(100u, partition_handler->GetCount());
+
+    // keys are in the order of MemPartitionHandler
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100; i++) {
+        keys.push_back("group" + std::to_string(i));
+    }
+    std::sort(keys.begin(), keys.end(), std::greater<std::string>());
+    auto window_iter = partition_handler->GetWindowIterator();
+    window_iter->SeekToFirst();
+    for (auto& key : keys) {
+        ASSERT_TRUE(window_iter->Valid());
+        ASSERT_EQ(key, window_iter->GetKey().ToString());
+        window_iter->Next();
+    }
+    ASSERT_FALSE(window_iter->Valid());
+
+    window_iter->Seek("group1");
+    ASSERT_TRUE(window_iter->Valid());
+    ASSERT_EQ("group1", window_iter->GetKey().ToString());
+    {
+        auto iter = window_iter->GetValue();
+        iter->SeekToFirst();
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_TRUE(iter->GetValue().buf() == rows[4].buf());
+        ASSERT_EQ(10u, iter->GetKey());
+
+        iter->Seek(8);
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_TRUE(iter->GetValue().buf() == rows[2].buf());
+    }
+
+    auto segment = partition_handler->GetSegment("group1");
+    ASSERT_EQ(5u, segment->GetCount());
+    ASSERT_TRUE(segment->At(0).buf() == rows[4].buf());
+    ASSERT_EQ(0u, partition_handler->GetSegment("group100")->GetCount());
+
+    partition_handler->Reverse();
+    ASSERT_TRUE(partition_handler->GetSegment("group1")->At(0).buf() ==
+                rows[0].buf());
+}
+
 TEST_F(MemCataLogTest, mem_row_handler_test) {
     std::vector<Row> rows;
     ::hybridse::type::TableDef table;
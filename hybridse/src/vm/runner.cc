@@ -16,8 +16,12 @@
 
 #include "vm/runner.h"
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -30,6 +34,8 @@
 #include "vm/mem_catalog.h"
 
 DECLARE_bool(enable_spark_unsaferow_format);
+DECLARE_bool(enable_incremental_window_agg);
+DECLARE_uint32(batch_runner_thread_num);
 
 namespace hybridse {
 namespace vm {
@@ -1408,6 +1414,49 @@ std::shared_ptr<DataHandler> SelectSliceRunner::Run(
     return nullptr;
 }
 
+// split the keys into morsels of contiguous keys and run fn on them with
+// FLAGS_batch_runner_thread_num threads. every thread picks the next morsel
+// once it finishes one, and the morsel outputs are merged in the key order.
+// the JIT runtime and its memory pool are thread local, so the udfs run on
+// every thread as they do on the session thread
+static void RunKeyMorsels(
+    const std::vector<std::string>& keys,
+    const std::function<void(const std::string&, std::shared_ptr<MemTableHandler>)>& fn,
+    std::shared_ptr<MemTableHandler> output_table) {
+    size_t thread_num = std::min(static_cast<size_t>(FLAGS_batch_runner_thread_num), keys.size());
+    if (thread_num == 0) {
+        return;
+    }
+    // a few morsels per thread to balance the keys of different sizes
+    size_t morsel_size = std::max(static_cast<size_t>(1), keys.size() / (thread_num * 4));
+    size_t morsel_num = (keys.size() + morsel_size - 1) / morsel_size;
+    std::vector<std::shared_ptr<MemTableHandler>> outputs(morsel_num);
+    std::atomic<size_t> next_morsel(0);
+    auto worker = [&]() {
+        size_t morsel = 0;
+        while ((morsel = next_morsel.fetch_add(1, std::memory_order_relaxed)) < morsel_num) {
+            outputs[morsel] = std::make_shared<MemTableHandler>();
+            size_t end = std::min(keys.size(), (morsel + 1) * morsel_size);
+            for (size_t i = morsel * morsel_size; i < end; i++) {
+                fn(keys[i], outputs[morsel]);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_num; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& output : outputs) {
+        for (uint64_t pos = 0; pos < output->GetCount(); pos++) {
+            output_table->AddRow(output->At(pos));
+        }
+    }
+}
+
 std::shared_ptr<DataHandler> WindowAggRunner::Run(
     RunnerContext& ctx,
     const std::vector<std::shared_ptr<DataHandler>>& inputs) {
@@ -1446,6 +1495,21 @@ std::shared_ptr<DataHandler> WindowAggRunner::Run(
     // Compute output
     std::shared_ptr<MemTableHandler> output_table =
         std::shared_ptr<MemTableHandler>(new MemTableHandler());
+    // the limit stops at the first keys, so it runs sequentially
+    if (FLAGS_batch_runner_thread_num > 1 && limit_cnt_ <= 0) {
+        std::vector<std::string> keys;
+        while (instance_partition_iter->Valid()) {
+            keys.push_back(instance_partition_iter->GetKey().ToString());
+            instance_partition_iter->Next();
+        }
+        RunKeyMorsels(
+            keys,
+            [&](const std::string& key, std::shared_ptr<MemTableHandler> output) {
+                RunWindowAggOnKey(parameter, instance_partition, union_partitions, join_right_tables, key, output);
+            },
+            output_table);
+        return output_table;
+    }
     while (instance_partition_iter->Valid()) {
         auto key = instance_partition_iter->GetKey().ToString();
         RunWindowAggOnKey(parameter, instance_partition, union_partitions,
@@ -1516,6 +1580,7 @@ void WindowAggRunner::RunWindowAggOnKey(
     HistoryWindow window(instance_window_gen_.range_gen_.window_range_);
     window.set_instance_not_in_window(instance_not_in_window_);
     window.set_exclude_current_time(exclude_current_time_);
+    window.set_incremental_agg(FLAGS_enable_incremental_window_agg);
 
     while (instance_segment_iter->Valid()) {
         if (limit_cnt_ > 0 && cnt >= limit_cnt_) {
@@ -1707,8 +1772,7 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
     if (!table) {
         return std::shared_ptr<PartitionHandler>();
     }
-    auto output_partitions = std::shared_ptr<MemPartitionHandler>(
-        new MemPartitionHandler(table->GetSchema()));
+    auto output_partitions = std::make_shared<HashPartitionHandler>(table->GetSchema());
     auto partitions = std::dynamic_pointer_cast<PartitionHandler>(table);
     auto iter = partitions->GetWindowIterator();
     if (!iter) {
@@ -1734,6 +1798,7 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
         }
         iter->Next();
     }
+    output_partitions->SortKeys();
     return output_partitions;
 }
 std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
@@ -1749,8 +1814,7 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
         return fail_ptr;
     }
 
-    auto output_partitions = std::shared_ptr<MemPartitionHandler>(
-        new MemPartitionHandler(table->GetSchema()));
+    auto output_partitions = std::make_shared<HashPartitionHandler>(table->GetSchema());
 
     auto iter = std::dynamic_pointer_cast<TableHandler>(table)->GetIterator();
     if (!iter) {
@@ -1763,6 +1827,7 @@ std::shared_ptr<PartitionHandler> PartitionGenerator::Partition(
         output_partitions->AddRow(keys, iter->GetKey(), iter->GetValue());
         iter->Next();
     }
+    output_partitions->SortKeys();
     output_partitions->SetOrderType(table->GetOrderType());
     return output_partitions;
 }
@@ -2655,6 +2720,32 @@ std::shared_ptr<DataHandler> GroupAggRunner::Run(
             return std::shared_ptr<DataHandler>();
         }
         iter->SeekToFirst();
+        if (FLAGS_batch_runner_thread_num > 1 && limit_cnt_ <= 0) {
+            std::vector<std::string> keys;
+            while (iter->Valid()) {
+                keys.push_back(iter->GetKey().ToString());
+                iter->Next();
+            }
+            std::atomic<bool> fail(false);
+            RunKeyMorsels(
+                keys,
+                [&](const std::string& key, std::shared_ptr<MemTableHandler> output) {
+                    auto segment = partition->GetSegment(key);
+                    if (!segment) {
+                        fail.store(true, std::memory_order_relaxed);
+                        return;
+                    }
+                    if (!having_condition_.Valid() || having_condition_.Gen(segment, parameter)) {
+                        output->AddRow(agg_gen_.Gen(parameter, segment));
+                    }
+                },
+                output_table);
+            if (fail.load(std::memory_order_relaxed)) {
+                LOG(WARNING) << "group aggregation fail: segment segment is null";
+                return std::shared_ptr<DataHandler>();
+            }
+            return output_table;
+        }
         int32_t cnt = 0;
         while (iter->Valid()) {
             if (limit_cnt_ > 0 && cnt++ >= limit_cnt_) {
@@ -0,0 +1,529 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "vm/window_columns.h"
+
+#include <string.h>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+#include "codec/type_codec.h"
+#include "glog/logging.h"
+
+// the avx2 kernels are built with the target attribute and picked at runtime,
+// so the binary still runs on the cpus without avx2
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HYBRIDSE_WINDOW_COLUMNS_AVX2
+#include <immintrin.h>
+#define HYBRIDSE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace hybridse {
+namespace vm {
+
+// the integer sums wrap around as the row-wise aggregation does
+template <class T>
+static inline T AddValue(T l, T r) {
+    if constexpr (std::is_integral<T>::value) {
+        typedef typename std::make_unsigned<T>::type U;
+        return static_cast<T>(static_cast<U>(l) + static_cast<U>(r));
+    } else {
+        return l + r;
+    }
+}
+
+template <class T>
+static T SumScalar(const T* values, size_t begin, size_t end) {
+    T sum = 0;
+    for (size_t i = begin; i < end; ++i) {
+        sum = AddValue(sum, values[i]);
+    }
+    return sum;
+}
+
+template <class T>
+static double SumDoubleScalar(const T* values, size_t begin, size_t end) {
+    double sum = 0;
+    for (size_t i = begin; i < end; ++i) {
+        sum += static_cast<double>(values[i]);
+    }
+    return sum;
+}
+
+template <class T>
+static T MinScalar(const T* values, size_t begin, size_t end, T init) {
+    T min = init;
+    for (size_t i = begin; i < end; ++i) {
+        min = values[i] < min ? values[i] : min;
+    }
+    return min;
+}
+
+template <class T>
+static T MaxScalar(const T* values, size_t begin, size_t end, T init) {
+    T max = init;
+    for (size_t i = begin; i < end; ++i) {
+        max = max < values[i] ? values[i] : max;
+    }
+    return max;
+}
+
+#ifdef HYBRIDSE_WINDOW_COLUMNS_AVX2
+static bool HasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+struct Avx2Int16 {
+    typedef int16_t T;
+    typedef __m256i V;
+    static const size_t kLanes = 16;
+    HYBRIDSE_TARGET_AVX2 static V Load(const T* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    HYBRIDSE_TARGET_AVX2 static void Store(T* p, V v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+    HYBRIDSE_TARGET_AVX2 static V Set1(T v) { return _mm256_set1_epi16(v); }
+    HYBRIDSE_TARGET_AVX2 static V Add(V l, V r) {
+        return _mm256_add_epi16(l, r);
+    }
+    HYBRIDSE_TARGET_AVX2 static V Min(V l, V r) {
+        return _mm256_min_epi16(l, r);
+    }
+    HYBRIDSE_TARGET_AVX2 static V Max(V l, V r) {
+        return _mm256_max_epi16(l, r);
+    }
+};
+
+struct Avx2Int32 {
+    typedef int32_t T;
+    typedef __m256i V;
+    static const size_t kLanes = 8;
+    HYBRIDSE_TARGET_AVX2 static V Load(const T* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    HYBRIDSE_TARGET_AVX2 static void Store(T* p, V v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+    HYBRIDSE_TARGET_AVX2 static V Set1(T v) { return _mm256_set1_epi32(v); }
+    HYBRIDSE_TARGET_AVX2 static V Add(V l, V r) {
+        return _mm256_add_epi32(l, r);
+    }
+    HYBRIDSE_TARGET_AVX2 static V Min(V l, V r) {
+        return _mm256_min_epi32(l, r);
+    }
+    HYBRIDSE_TARGET_AVX2 static V Max(V l, V r) {
+        return _mm256_max_epi32(l, r);
+    }
+};
+
+// avx2 has no min and max of int64, they are blended by the compare
+struct Avx2Int64 {
+    typedef int64_t T;
+    typedef __m256i V;
+    static const size_t kLanes = 4;
+    HYBRIDSE_TARGET_AVX2 static V Load(const T* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    HYBRIDSE_TARGET_AVX2 static void Store(T* p, V v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+    HYBRIDSE_TARGET_AVX2 static V Set1(T v) { return _mm256_set1_epi64x(v); }
+    HYBRIDSE_TARGET_AVX2 static V Add(V l, V r) {
+        return _mm256_add_epi64(l, r);
+    }
+    HYBRIDSE_TARGET_AVX2 static V Min(V l, V r) {
+        return _mm256_blendv_epi8(l, r, _mm256_cmpgt_epi64(l, r));
+    }
+    HYBRIDSE_TARGET_AVX2 static V Max(V l, V r) {
+        return _mm256_blendv_epi8(r, l, _mm256_cmpgt_epi64(l, r));
+    }
+};
+
+struct Avx2Float {
+    typedef float T;
+    typedef __m256 V;
+    static const size_t kLanes = 8;
+    HYBRIDSE_TARGET_AVX2 static V Load(const T* p) { return _mm256_loadu_ps(p); }
+    HYBRIDSE_TARGET_AVX2 static void Store(T* p, V v) { _mm256_storeu_ps(p, v); }
+    HYBRIDSE_TARGET_AVX2 static V Set1(T v) { return _mm256_set1_ps(v); }
+    HYBRIDSE_TARGET_AVX2 static V Add(V l, V r) { return _mm256_add_ps(l, r); }
+    HYBRIDSE_TARGET_AVX2 static V Min(V l, V r) { return _mm256_min_ps(l, r); }
+    HYBRIDSE_TARGET_AVX2 static V Max(V l, V r) { return _mm256_max_ps(l, r); }
+};
+
+struct Avx2Double {
+    typedef double T;
+    typedef __m256d V;
+    static const size_t kLanes = 4;
+    HYBRIDSE_TARGET_AVX2 static V Load(const T* p) { return _mm256_loadu_pd(p); }
+    HYBRIDSE_TARGET_AVX2 static void Store(T* p, V v) { _mm256_storeu_pd(p, v); }
+    HYBRIDSE_TARGET_AVX2 static V Set1(T v) { return _mm256_set1_pd(v); }
+    HYBRIDSE_TARGET_AVX2 static V Add(V l, V r) { return _mm256_add_pd(l, r); }
+    HYBRIDSE_TARGET_AVX2 static V Min(V l, V r) { return _mm256_min_pd(l, r); }
+    HYBRIDSE_TARGET_AVX2 static V Max(V l, V r) { return _mm256_max_pd(l, r); }
+};
+
+template <class T>
+struct Avx2OpsOf;
+template <>
+struct Avx2OpsOf<int16_t> {
+    typedef Avx2Int16 type;
+};
+template <>
+struct Avx2OpsOf<int32_t> {
+    typedef Avx2Int32 type;
+};
+template <>
+struct Avx2OpsOf<int64_t> {
+    typedef Avx2Int64 type;
+};
+template <>
+struct Avx2OpsOf<float> {
+    typedef Avx2Float type;
+};
+template <>
+struct Avx2OpsOf<double> {
+    typedef Avx2Double type;
+};
+
+// sum by lanes, so the float sums may differ from the row-wise aggregation
+// in the last bits
+template <class Ops>
+HYBRIDSE_TARGET_AVX2 static typename Ops::T SumAvx2(const typename Ops::T* values, size_t n) {
+    typedef typename Ops::T T;
+    typename Ops::V acc = Ops::Set1(0);
+    size_t i = 0;
+    for (; i + Ops::kLanes <= n; i += Ops::kLanes) {
+        acc = Ops::Add(acc, Ops::Load(values + i));
+    }
+    T lanes[Ops::kLanes];
+    Ops::Store(lanes, acc);
+    T sum = SumScalar(lanes, 0, Ops::kLanes);
+    return AddValue(sum, SumScalar(values, i, n));
+}
+
+template <class Ops>
+HYBRIDSE_TARGET_AVX2 static typename Ops::T MinAvx2(const typename Ops::T* values, size_t n,
+                                                   typename Ops::T init) {
+    typedef typename Ops::T T;
+    typename Ops::V acc = Ops::Set1(init);
+    size_t i = 0;
+    for (; i + Ops::kLanes <= n; i += Ops::kLanes) {
+        acc = Ops::Min(acc, Ops::Load(values + i));
+    }
+    T lanes[Ops::kLanes];
+    Ops::Store(lanes, acc);
+    return MinScalar(values, i, n, MinScalar(lanes, 0, Ops::kLanes, init));
+}
+
+template <class Ops>
+HYBRIDSE_TARGET_AVX2 static typename Ops::T MaxAvx2(const typename Ops::T* values, size_t n,
+                                                   typename Ops::T init) {
+    typedef typename Ops::T T;
+    typename Ops::V acc = Ops::Set1(init);
+    size_t i = 0;
+    for (; i + Ops::kLanes <= n; i += Ops::kLanes) {
+        acc = Ops::Max(acc, Ops::Load(values + i));
+    }
+    T lanes[Ops::kLanes];
+    Ops::Store(lanes, acc);
+    return MaxScalar(values, i, n, MaxScalar(lanes, 0, Ops::kLanes, init));
+}
+
+HYBRIDSE_TARGET_AVX2 static double SumDoubleAvx2(const float* values, size_t n) {
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_add_pd(acc, _mm256_cvtps_pd(_mm_loadu_ps(values + i)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+           SumDoubleScalar(values, i, n);
+}
+
+HYBRIDSE_TARGET_AVX2 static double SumDoubleAvx2(const int32_t* values, size_t n) {
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_add_pd(
+            acc, _mm256_cvtepi32_pd(_mm_loadu_si128(
+                     reinterpret_cast<const __m128i*>(values + i))));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+           SumDoubleScalar(values, i, n);
+}
+#endif
+
+template <class T>
+static T SumKernel(const T* values, size_t n) {
+#ifdef HYBRIDSE_WINDOW_COLUMNS_AVX2
+    if (HasAvx2()) {
+        return SumAvx2<typename Avx2OpsOf<T>::type>(values, n);
+    }
+#endif
+    return SumScalar(values, 0, n);
+}
+
+// the avg sums the values as double as the row-wise aggregation does
+template <class T>
+static double SumDoubleKernel(const T* values, size_t n) {
+#ifdef HYBRIDSE_WINDOW_COLUMNS_AVX2
+    if (HasAvx2()) {
+        if constexpr (std::is_same<T, double>::value) {
+            return SumAvx2<Avx2Double>(values, n);
+        } else if constexpr (std::is_same<T, float>::value ||
+                             std::is_same<T, int32_t>::value) {
+            return SumDoubleAvx2(values, n);
+        }
+    }
+#endif
+    return SumDoubleScalar(values, 0, n);
+}
+
+template <class T>
+static T MinKernel(const T* values, size_t n, T init) {
+#ifdef HYBRIDSE_WINDOW_COLUMNS_AVX2
+    if (HasAvx2()) {
+        return MinAvx2<typename Avx2OpsOf<T>::type>(values, n, init);
+    }
+#endif
+    return MinScalar(values, 0, n, init);
+}
+
+template <class T>
+static T MaxKernel(const T* values, size_t n, T init) {
+#ifdef HYBRIDSE_WINDOW_COLUMNS_AVX2
+    if (HasAvx2()) {
+        return MaxAvx2<typename Avx2OpsOf<T>::type>(values, n, init);
+    }
+#endif
+    return MaxScalar(values, 0, n, init);
+}
+
+// the min and max skip the null rows, the kernels run on the runs of non
+// null rows
+template <class T>
+static T MinMax(const WindowColumns& columns, size_t idx, size_t row_cnt,
+                bool is_max) {
+    const auto& column = columns.GetColumn(idx);
+    const T* values = reinterpret_cast<const T*>(column.values.data());
+    T res = is_max ? std::numeric_limits<T>::lowest()
+                   : std::numeric_limits<T>::max();
+    size_t begin = 0;
+    while (begin < row_cnt) {
+        if (column.null_count > 0 && columns.IsNull(idx, begin)) {
+            begin++;
+            continue;
+        }
+        size_t end = begin + 1;
+        if (column.null_count == 0) {
+            end = row_cnt;
+        } else {
+            while (end < row_cnt && !columns.IsNull(idx, end)) {
+                end++;
+            }
+        }
+        res = is_max ? MaxKernel(values + begin, end - begin, res)
+                     : MinKernel(values + begin, end - begin, res);
+        begin = end;
+    }
+    return res;
+}
+
+template <class T>
+static bool AggregateColumn(const WindowColumns& columns, size_t idx,
+                            WindowColumnAggType agg_type, int8_t* output) {
+    const auto& column = columns.GetColumn(idx);
+    size_t row_cnt = columns.GetRowCount();
+    const T* values = reinterpret_cast<const T*>(column.values.data());
+    int64_t cnt = row_cnt - column.null_count;
+    switch (agg_type) {
+        case kWindowColumnSum:
+            *reinterpret_cast<T*>(output) = SumKernel(values, row_cnt);
+            return false;
+        case kWindowColumnAvg:
+            *reinterpret_cast<double*>(output) =
+                SumDoubleKernel(values, row_cnt) / static_cast<double>(cnt);
+            return false;
+        case kWindowColumnCount:
+            *reinterpret_cast<int64_t*>(output) = cnt;
+            return false;
+        case kWindowColumnMin:
+        case kWindowColumnMax:
+            *reinterpret_cast<T*>(output) = MinMax<T>(
+                columns, idx, row_cnt, agg_type == kWindowColumnMax);
+            return cnt == 0;
+        default:
+            LOG(WARNING) << "unknown window column agg type " << agg_type;
+            return true;
+    }
+}
+
+static uint32_t GetColumnWidth(node::DataType type) {
+    switch (type) {
+        case node::kInt16:
+            return sizeof(int16_t);
+        case node::kInt32:
+            return sizeof(int32_t);
+        case node::kInt64:
+            return sizeof(int64_t);
+        case node::kFloat:
+            return sizeof(float);
+        case node::kDouble:
+            return sizeof(double);
+        default:
+            return 0;
+    }
+}
+
+void WindowColumns::Reset(size_t col_num) {
+    columns_.resize(col_num);
+    row_cnt_ = 0;
+}
+
+bool WindowColumns::SetColumn(size_t idx, node::DataType type,
+                              uint32_t slice_idx, uint32_t col_idx,
+                              uint32_t offset) {
+    uint32_t width = GetColumnWidth(type);
+    if (idx >= columns_.size() || width == 0) {
+        LOG(WARNING) << "fail to set window column " << idx << " of type "
+                     << type;
+        return false;
+    }
+    auto& column = columns_[idx];
+    column.type = type;
+    column.slice_idx = slice_idx;
+    column.col_idx = col_idx;
+    column.offset = offset;
+    column.width = width;
+    column.values.resize(capacity_ * width);
+    column.null_bitmap.resize(capacity_ >> 6);
+    column.null_count = 0;
+    return true;
+}
+
+void WindowColumns::Grow() {
+    capacity_ = capacity_ == 0 ? 64 : capacity_ << 1;
+    for (auto& column : columns_) {
+        column.values.resize(capacity_ * column.width);
+        column.null_bitmap.resize(capacity_ >> 6);
+    }
+}
+
+void WindowColumns::Decode(codec::ListV<codec::Row>* window) {
+    row_cnt_ = 0;
+    for (auto& column : columns_) {
+        column.null_count = 0;
+    }
+    auto iter = window->GetIterator();
+    iter->SeekToFirst();
+    while (iter->Valid()) {
+        if (row_cnt_ == capacity_) {
+            Grow();
+        }
+        const codec::Row& row = iter->GetValue();
+        size_t word = row_cnt_ >> 6;
+        uint64_t bit = 1ull << (row_cnt_ & 63);
+        for (auto& column : columns_) {
+            if (bit == 1) {
+                column.null_bitmap[word] = 0;
+            }
+            int8_t* value = column.values.data() + row_cnt_ * column.width;
+            const int8_t* buf = row.buf(column.slice_idx);
+            if (codec::v1::IsNullAt(buf, column.col_idx)) {
+                memset(value, 0, column.width);
+                column.null_bitmap[word] |= bit;
+                column.null_count++;
+            } else {
+                memcpy(value, buf + column.offset, column.width);
+            }
+        }
+        row_cnt_++;
+        iter->Next();
+    }
+}
+
+bool WindowColumns::Aggregate(size_t idx, WindowColumnAggType agg_type,
+                              int8_t* output) const {
+    switch (columns_[idx].type) {
+        case node::kInt16:
+            return AggregateColumn<int16_t>(*this, idx, agg_type, output);
+        case node::kInt32:
+            return AggregateColumn<int32_t>(*this, idx, agg_type, output);
+        case node::kInt64:
+            return AggregateColumn<int64_t>(*this, idx, agg_type, output);
+        case node::kFloat:
+            return AggregateColumn<float>(*this, idx, agg_type, output);
+        case node::kDouble:
+            return AggregateColumn<double>(*this, idx, agg_type, output);
+        default:
+            return true;
+    }
+}
+
+static thread_local std::vector<std::unique_ptr<WindowColumns>>
+    window_columns_pool;
+static thread_local size_t window_columns_depth = 0;
+
+WindowColumns* WindowColumns::Acquire() {
+    if (window_columns_depth == window_columns_pool.size()) {
+        window_columns_pool.emplace_back(new WindowColumns());
+    }
+    return window_columns_pool[window_columns_depth++].get();
+}
+
+void WindowColumns::Release(WindowColumns* columns) {
+    DCHECK(window_columns_depth > 0 &&
+           window_columns_pool[window_columns_depth - 1].get() == columns);
+    window_columns_depth--;
+}
+
+int8_t* AcquireWindowColumns(int64_t col_num) {
+    auto columns = WindowColumns::Acquire();
+    columns->Reset(col_num);
+    return reinterpret_cast<int8_t*>(columns);
+}
+
+int32_t WindowColumnsSetColumn(int8_t* columns, int64_t idx, int32_t type,
+                               int32_t slice_idx, int32_t col_idx,
+                               int32_t offset) {
+    return reinterpret_cast<WindowColumns*>(columns)->SetColumn(
+        idx, static_cast<node::DataType>(type), slice_idx, col_idx, offset);
+}
+
+void WindowColumnsDecode(int8_t* columns, int8_t* input) {
+    auto list_ref = reinterpret_cast<codec::ListRef<codec::Row>*>(input);
+    reinterpret_cast<WindowColumns*>(columns)->Decode(
+        reinterpret_cast<codec::ListV<codec::Row>*>(list_ref->list));
+}
+
+int32_t WindowColumnsAggregate(int8_t* columns, int64_t idx, int32_t agg_type,
+                               int8_t* output) {
+    return reinterpret_cast<WindowColumns*>(columns)->Aggregate(
+        idx, static_cast<WindowColumnAggType>(agg_type), output);
+}
+
+void ReleaseWindowColumns(int8_t* columns) {
+    WindowColumns::Release(reinterpret_cast<WindowColumns*>(columns));
+}
+
+}  // namespace vm
+}  // namespace hybridse
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYBRIDSE_SRC_VM_WINDOW_COLUMNS_H_
+#define HYBRIDSE_SRC_VM_WINDOW_COLUMNS_H_
+
+#include <vector>
+
+#include "codec/row_list.h"
+#include "node/node_enum.h"
+
+namespace hybridse {
+namespace vm {
+
+enum WindowColumnAggType {
+    kWindowColumnSum = 0,
+    kWindowColumnAvg,
+    kWindowColumnCount,
+    kWindowColumnMin,
+    kWindowColumnMax,
+};
+
+// the columns of a window decoded once into contiguous typed arrays with
+// null bitmaps, so the aggregations run as simd kernels over the arrays
+// instead of decoding every row field through the row iterator.
+// only the int16, int32, int64, float and double columns are supported
+class WindowColumns {
+ public:
+    struct Column {
+        node::DataType type;
+        uint32_t slice_idx;
+        uint32_t col_idx;
+        uint32_t offset;
+        uint32_t width;
+        // the values of the null rows are zero
+        std::vector<int8_t> values;
+        std::vector<uint64_t> null_bitmap;
+        uint64_t null_count;
+    };
+
+    WindowColumns() : row_cnt_(0), capacity_(0) {}
+
+    // clear the columns, the buffers are kept for the next window
+    void Reset(size_t col_num);
+    bool SetColumn(size_t idx, node::DataType type, uint32_t slice_idx,
+                   uint32_t col_idx, uint32_t offset);
+    void Decode(codec::ListV<codec::Row>* window);
+
+    size_t GetRowCount() const { return row_cnt_; }
+    const Column& GetColumn(size_t idx) const { return columns_[idx]; }
+    bool IsNull(size_t idx, size_t row) const {
+        return (columns_[idx].null_bitmap[row >> 6] >> (row & 63)) & 1;
+    }
+
+    // write the aggregation of the column to output in the output type of
+    // the aggregation, return true if the result is null
+    bool Aggregate(size_t idx, WindowColumnAggType agg_type,
+                   int8_t* output) const;
+
+    // get a thread local instance, Release must be called in the reverse
+    // order. a window may compute its rows lazily by other jit functions,
+    // so the instances are stacked
+    static WindowColumns* Acquire();
+    static void Release(WindowColumns* columns);
+
+ private:
+    void Grow();
+
+    std::vector<Column> columns_;
+    size_t row_cnt_;
+    size_t capacity_;
+};
+
+// window columns interfaces for llvm
+int8_t* AcquireWindowColumns(int64_t col_num);
+int32_t WindowColumnsSetColumn(int8_t* columns, int64_t idx, int32_t type,
+                               int32_t slice_idx, int32_t col_idx,
+                               int32_t offset);
+void WindowColumnsDecode(int8_t* columns, int8_t* input);
+int32_t WindowColumnsAggregate(int8_t* columns, int64_t idx, int32_t agg_type,
+                               int8_t* output);
+void ReleaseWindowColumns(int8_t* columns);
+
+}  // namespace vm
+}  // namespace hybridse
+#endif  // HYBRIDSE_SRC_VM_WINDOW_COLUMNS_H_
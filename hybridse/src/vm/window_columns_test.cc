@@ -0,0 +1,181 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "vm/window_columns.h"
+
+#include <limits>
+#include <memory>
+
+#include "codec/fe_row_codec.h"
+#include "gtest/gtest.h"
+#include "vm/mem_catalog.h"
+
+namespace hybridse {
+namespace vm {
+using hybridse::codec::Row;
+
+class WindowColumnsTest : public ::testing::Test {
+ public:
+    WindowColumnsTest() {
+        AddColumn("c2", type::kInt16);
+        AddColumn("c3", type::kInt32);
+        AddColumn("c4", type::kInt64);
+        AddColumn("c5", type::kFloat);
+        AddColumn("c6", type::kDouble);
+    }
+    ~WindowColumnsTest() {}
+
+    void AddColumn(const std::string& name, type::Type type) {
+        auto column = schema_.Add();
+        column->set_name(name);
+        column->set_type(type);
+    }
+
+    // every third row is null since row 70, row i has the value i
+    Row BuildRow(int32_t i) {
+        codec::RowBuilder builder(schema_);
+        uint32_t size = builder.CalTotalLength(0);
+        int8_t* buf = static_cast<int8_t*>(malloc(size));
+        builder.SetBuffer(buf, size);
+        if (i >= 70 && i % 3 == 0) {
+            for (int j = 0; j < schema_.size(); j++) {
+                builder.AppendNULL();
+            }
+        } else {
+            builder.AppendInt16(static_cast<int16_t>(i - 50));
+            builder.AppendInt32(i - 50);
+            builder.AppendInt64(i - 50);
+            builder.AppendFloat(i - 50.0f);
+            builder.AppendDouble(i - 50.0);
+        }
+        return Row(base::RefCountedSlice::CreateManaged(buf, size));
+    }
+
+    void Decode(WindowColumns* columns, TableHandler* window) {
+        codec::SingleSliceRowFormat format(&schema_);
+        node::DataType types[] = {node::kInt16, node::kInt32, node::kInt64,
+                                  node::kFloat, node::kDouble};
+        columns->Reset(schema_.size());
+        for (int i = 0; i < schema_.size(); i++) {
+            ASSERT_TRUE(columns->SetColumn(i, types[i], 0, i,
+                                           format.GetColumnInfo(0, i)->offset));
+        }
+        columns->Decode(window);
+    }
+
+ protected:
+    vm::Schema schema_;
+};
+
+TEST_F(WindowColumnsTest, DecodeAndAggregateTest) {
+    MemTimeTableHandler window(&schema_);
+    int64_t sum = 0;
+    int64_t cnt = 0;
+    for (int32_t i = 0; i < 150; i++) {
+        window.AddRow(i, BuildRow(i));
+        if (!(i >= 70 && i % 3 == 0)) {
+            sum += i - 50;
+            cnt++;
+        }
+    }
+    std::unique_ptr<WindowColumns> columns(new WindowColumns());
+    Decode(columns.get(), &window);
+    ASSERT_EQ(150u, columns->GetRowCount());
+    ASSERT_FALSE(columns->IsNull(0, 69));
+    ASSERT_TRUE(columns->IsNull(0, 72));
+    ASSERT_EQ(150u - cnt, columns->GetColumn(1).null_count);
+
+    for (size_t idx = 0; idx < 5; idx++) {
+        int64_t count = 0;
+        ASSERT_FALSE(columns->Aggregate(
+            idx, kWindowColumnCount, reinterpret_cast<int8_t*>(&count)));
+        ASSERT_EQ(cnt, count);
+
+        double avg = 0;
+        ASSERT_FALSE(columns->Aggregate(idx, kWindowColumnAvg,
+                                        reinterpret_cast<int8_t*>(&avg)));
+        ASSERT_DOUBLE_EQ(static_cast<double>(sum) / cnt, avg);
+    }
+
+    int16_t sum16 = 0;
+    int64_t sum64 = 0;
+    double sum_double = 0;
+    columns->Aggregate(0, kWindowColumnSum, reinterpret_cast<int8_t*>(&sum16));
+    columns->Aggregate(2, kWindowColumnSum, reinterpret_cast<int8_t*>(&sum64));
+    columns->Aggregate(4, kWindowColumnSum,
+                       reinterpret_cast<int8_t*>(&sum_double));
+    ASSERT_EQ(static_cast<int16_t>(sum), sum16);
+    ASSERT_EQ(sum, sum64);
+    ASSERT_DOUBLE_EQ(sum, sum_double);
+
+    int32_t min32 = 0;
+    int64_t max64 = 0;
+    float min_float = 0;
+    double max_double = 0;
+    ASSERT_FALSE(columns->Aggregate(1, kWindowColumnMin,
+                                    reinterpret_cast<int8_t*>(&min32)));
+    ASSERT_FALSE(columns->Aggregate(2, kWindowColumnMax,
+                                    reinterpret_cast<int8_t*>(&max64)));
+    ASSERT_FALSE(columns->Aggregate(3, kWindowColumnMin,
+                                    reinterpret_cast<int8_t*>(&min_float)));
+    ASSERT_FALSE(columns->Aggregate(4, kWindowColumnMax,
+                                    reinterpret_cast<int8_t*>(&max_double)));
+    ASSERT_EQ(-50, min32);
+    ASSERT_EQ(99, max64);
+    ASSERT_EQ(-50.0f, min_float);
+    ASSERT_EQ(99.0, max_double);
+}
+
+TEST_F(WindowColumnsTest, NullWindowTest) {
+    MemTimeTableHandler window(&schema_);
+    window.AddRow(72, BuildRow(72));
+    window.AddRow(75, BuildRow(75));
+    std::unique_ptr<WindowColumns> columns(new WindowColumns());
+    Decode(columns.get(), &window);
+
+    int64_t count = -1;
+    int32_t sum = -1;
+    int64_t min = 0;
+    ASSERT_FALSE(columns->Aggregate(1, kWindowColumnCount,
+                                    reinterpret_cast<int8_t*>(&count)));
+    ASSERT_FALSE(columns->Aggregate(1, kWindowColumnSum,
+                                    reinterpret_cast<int8_t*>(&sum)));
+    ASSERT_TRUE(columns->Aggregate(2, kWindowColumnMin,
+                                   reinterpret_cast<int8_t*>(&min)));
+    ASSERT_EQ(0, count);
+    ASSERT_EQ(0, sum);
+}
+
+TEST_F(WindowColumnsTest, AcquireTest) {
+    MemTimeTableHandler window(&schema_);
+    window.AddRow(1, BuildRow(1));
+    auto columns = WindowColumns::Acquire();
+    // a nested acquire gets another instance
+    auto nested = WindowColumns::Acquire();
+    ASSERT_NE(columns, nested);
+    Decode(nested, &window);
+    WindowColumns::Release(nested);
+    ASSERT_EQ(nested, WindowColumns::Acquire());
+    WindowColumns::Release(nested);
+    WindowColumns::Release(columns);
+}
+
+}  // namespace vm
+}  // namespace hybridse
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
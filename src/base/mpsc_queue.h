@@ -0,0 +1,89 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SRC_BASE_MPSC_QUEUE_H_
+#define SRC_BASE_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace openmldb {
+namespace base {
+
+// an unbounded multi producer single consumer queue. Push is wait free and can
+// be called from any thread, Pop must be called from one consumer only
+template <class T>
+class MPSCQueue {
+ public:
+    MPSCQueue() : head_(&stub_), tail_(&stub_) { stub_.next.store(NULL, std::memory_order_relaxed); }
+
+    ~MPSCQueue() {
+        T value;
+        while (Pop(&value)) {
+        }
+        if (tail_ != &stub_) {
+            delete tail_;
+        }
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    void Push(T value) {
+        Node* node = new Node();
+        node->value = std::move(value);
+        node->next.store(NULL, std::memory_order_relaxed);
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        // the node is invisible to the consumer until it is linked
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // return false if the queue is empty or the next push is not linked yet
+    bool Pop(T* value) {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (next == NULL) {
+            return false;
+        }
+        // next becomes the dummy head of the queue
+        *value = std::move(next->value);
+        tail_ = next;
+        if (tail != &stub_) {
+            delete tail;
+        }
+        return true;
+    }
+
+    // called by the consumer only
+    bool Empty() const { return tail_->next.load(std::memory_order_acquire) == NULL; }
+
+ private:
+    struct Node {
+        T value;
+        std::atomic<Node*> next;
+    };
+
+    Node stub_;
+    std::atomic<Node*> head_;
+    Node* tail_;
+};
+
+}  // namespace base
+}  // namespace openmldb
+
+#endif  // SRC_BASE_MPSC_QUEUE_H_
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "base/mpsc_queue.h"
+
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace base {
+
+class MPSCQueueTest : public ::testing::Test {
+ public:
+    MPSCQueueTest() {}
+    ~MPSCQueueTest() {}
+};
+
+TEST_F(MPSCQueueTest, PushPop) {
+    MPSCQueue<uint32_t> queue;
+    uint32_t value = 0;
+    ASSERT_TRUE(queue.Empty());
+    ASSERT_FALSE(queue.Pop(&value));
+    for (uint32_t i = 0; i < 10; i++) {
+        queue.Push(i);
+    }
+    ASSERT_FALSE(queue.Empty());
+    for (uint32_t i = 0; i < 10; i++) {
+        ASSERT_TRUE(queue.Pop(&value));
+        ASSERT_EQ(i, value);
+    }
+    ASSERT_TRUE(queue.Empty());
+    ASSERT_FALSE(queue.Pop(&value));
+    // the left values are freed by the destructor
+    queue.Push(10);
+    queue.Push(11);
+}
+
+TEST_F(MPSCQueueTest, MultiProducer) {
+    MPSCQueue<std::unique_ptr<uint64_t>> queue;
+    const uint32_t producer_num = 4;
+    const uint64_t cnt = 100000;
+    std::vector<std::thread> producers;
+    for (uint32_t i = 0; i < producer_num; i++) {
+        producers.emplace_back([&queue, i, cnt] {
+            for (uint64_t j = 0; j < cnt; j++) {
+                queue.Push(std::unique_ptr<uint64_t>(new uint64_t(i * cnt + j)));
+            }
+        });
+    }
+    // the values of one producer come out in the order they are pushed
+    std::vector<uint64_t> next(producer_num, 0);
+    uint64_t total = 0;
+    std::unique_ptr<uint64_t> value;
+    while (total < producer_num * cnt) {
+        if (!queue.Pop(&value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t producer = *value / cnt;
+        ASSERT_LT(producer, producer_num);
+        ASSERT_EQ(next[producer], *value % cnt);
+        next[producer]++;
+        total++;
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    ASSERT_TRUE(queue.Empty());
+}
+
+}  // namespace base
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
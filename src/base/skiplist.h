@@ -22,6 +22,7 @@
 
 #include <atomic>
 #include <iostream>
+#include <new>
 
 #include "base/random.h"
 
@@ -39,18 +40,22 @@ struct DefaultComparator {
     }
 };
 
-// Skiplist node , a thread safe structure
+// Skiplist node , a thread safe structure. the next pointers are allocated
+// inline after the node, so a node must be created by Create and freed by delete
 template <class K, class V>
 class Node {
  public:
-    // Set data reference and Node height
-    Node(const K& key, V& value, uint8_t height)  // NOLINT
-        : height_(height), key_(key), value_(value) {
-        nexts_ = new std::atomic<Node<K, V>*>[height];
+    static Node<K, V>* Create(const K& key, V& value, uint8_t height) {  // NOLINT
+        return new (Allocate(height)) Node<K, V>(key, value, height);
     }
 
-    Node(uint8_t height) : height_(height), key_(), value_() {  // NOLINT
-        nexts_ = new std::atomic<Node<K, V>*>[height];
+    static Node<K, V>* Create(uint8_t height) { return new (Allocate(height)) Node<K, V>(height); }
+
+    static void operator delete(void* p) { ::operator delete(p); }
+
+    // the byte size of a node of height
+    static size_t GetByteSize(uint8_t height) {
+        return sizeof(Node<K, V>) + sizeof(std::atomic<Node<K, V>*>) * (height > 1 ? height - 1 : 0);
     }
 
     // Set the next node with memory barrier
@@ -81,13 +86,36 @@ class Node {
 
     const K& GetKey() const { return key_; }
 
-    ~Node() { delete[] nexts_; }
+    ~Node() {
+        for (uint8_t i = 1; i < height_; i++) {
+            nexts_[i].~atomic();
+        }
+    }
 
  private:
+    Node(const K& key, V& value, uint8_t height)  // NOLINT
+        : height_(height), key_(key), value_(value) {
+        InitNexts();
+    }
+
+    explicit Node(uint8_t height) : height_(height), key_(), value_() { InitNexts(); }
+
+    static void* Allocate(uint8_t height) { return ::operator new(GetByteSize(height)); }
+
+    static void* operator new(size_t, void* p) { return p; }
+
+    void InitNexts() {
+        nexts_[0].store(NULL, std::memory_order_relaxed);
+        for (uint8_t i = 1; i < height_; i++) {
+            new (&nexts_[i]) std::atomic<Node<K, V>*>(NULL);
+        }
+    }
+
     uint8_t const height_;
     K const key_;
     V value_;
-    std::atomic<Node<K, V>*>* nexts_;
+    // the first of height_ next pointers
+    std::atomic<Node<K, V>*> nexts_[1];
 };
 
 template <class K, class V, class Comparator>
@@ -101,7 +129,7 @@ class Skiplist {
           rand_(0xdeadbeef),
           head_(NULL),
           tail_(NULL) {
-        head_ = new Node<K, V>(MaxHeight);
+        head_ = Node<K, V>::Create(MaxHeight);
         for (uint8_t i = 0; i < head_->Height(); i++) {
             head_->SetNext(i, NULL);
         }
@@ -364,7 +392,7 @@ class Skiplist {
 
  private:
     Node<K, V>* NewNode(const K& key, V& value, uint8_t height) {  // NOLINT
-        Node<K, V>* node = new Node<K, V>(key, value, height);
+        Node<K, V>* node = Node<K, V>::Create(key, value, height);
         return node;
     }
 
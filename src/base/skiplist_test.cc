@@ -77,14 +77,18 @@ struct StrComparator {
 TEST_F(NodeTest, SetNext) {
     uint32_t key = 1;
     uint32_t value = 2;
-    Node<uint32_t, uint32_t> node(key, value, 2);
+    Node<uint32_t, uint32_t>* node = Node<uint32_t, uint32_t>::Create(key, value, 2);
     uint32_t key2 = 3;
     uint32_t value2 = 3;
-    Node<uint32_t, uint32_t> node2(key2, value2, 2);
-    node.SetNext(1, &node2);
-    Node<uint32_t, uint32_t>* node_ptr = node.GetNext(1);
+    Node<uint32_t, uint32_t>* node2 = Node<uint32_t, uint32_t>::Create(key2, value2, 2);
+    ASSERT_TRUE(node->GetNext(0) == NULL);
+    ASSERT_TRUE(node->GetNext(1) == NULL);
+    node->SetNext(1, node2);
+    Node<uint32_t, uint32_t>* node_ptr = node->GetNext(1);
     ASSERT_EQ(3, (signed)node_ptr->GetValue());
     ASSERT_EQ(3, (signed)node_ptr->GetKey());
+    delete node;
+    delete node2;
 }
 
 TEST_F(NodeTest, NodeByteSize) {
@@ -92,6 +96,8 @@ TEST_F(NodeTest, NodeByteSize) {
     ASSERT_EQ(96u, sizeof(node0));
     ASSERT_EQ(32u, sizeof(Node<uint64_t, void*>));
     ASSERT_EQ(40u, sizeof(Node<Slice, void*>));
+    ASSERT_EQ(32u, (Node<uint64_t, void*>::GetByteSize(1)));
+    ASSERT_EQ(120u, (Node<Slice, void*>::GetByteSize(11)));
 }
 
 TEST_F(NodeTest, SliceTest) {
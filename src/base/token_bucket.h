@@ -0,0 +1,106 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SRC_BASE_TOKEN_BUCKET_H_
+#define SRC_BASE_TOKEN_BUCKET_H_
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+
+namespace openmldb {
+namespace base {
+
+// a token bucket shared by threads. rate is the tokens added per second and the
+// bucket holds up to one second of tokens, 0 means no limit. Acquire takes the
+// tokens at once and sleeps for the debt, so the waiters are served in order
+class TokenBucket {
+ public:
+    explicit TokenBucket(uint64_t rate) : rate_(rate), credit_(0), last_time_(Now()) {}
+
+    TokenBucket(const TokenBucket&) = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    void Acquire(uint64_t tokens) {
+        int64_t wait_us = 0;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (rate_ == 0) {
+                return;
+            }
+            Refill();
+            credit_ -= static_cast<int64_t>(tokens) * US_PER_SECOND;
+            if (credit_ < 0) {
+                wait_us = -credit_ / static_cast<int64_t>(rate_) + 1;
+            }
+        }
+        if (wait_us > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(wait_us));
+        }
+    }
+
+    void SetRate(uint64_t rate) {
+        std::lock_guard<std::mutex> lock(mu_);
+        Refill();
+        rate_ = rate;
+        credit_ = std::min(credit_, static_cast<int64_t>(rate_) * US_PER_SECOND);
+    }
+
+    uint64_t GetRate() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return rate_;
+    }
+
+ private:
+    static constexpr int64_t US_PER_SECOND = 1000000;
+
+    static int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void Refill() {
+        int64_t now = Now();
+        int64_t elapsed = now - last_time_;
+        last_time_ = now;
+        int64_t rate = static_cast<int64_t>(rate_);
+        int64_t capacity = rate * US_PER_SECOND;
+        if (rate == 0 || credit_ >= capacity) {
+            return;
+        }
+        // compare with the time to fill up the bucket first, so that the product does not overflow
+        if (elapsed >= (capacity - credit_) / rate) {
+            credit_ = capacity;
+        } else {
+            credit_ += elapsed * rate;
+        }
+    }
+
+    std::mutex mu_;
+    uint64_t rate_;
+    // tokens multiplied by US_PER_SECOND so that no fraction is lost, negative if
+    // the tokens are owed by the sleeping waiters
+    int64_t credit_;
+    int64_t last_time_;
+};
+
+}  // namespace base
+}  // namespace openmldb
+#endif  // SRC_BASE_TOKEN_BUCKET_H_
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "base/token_bucket.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace openmldb {
+namespace base {
+
+class TokenBucketTest : public ::testing::Test {
+ public:
+    TokenBucketTest() {}
+    ~TokenBucketTest() {}
+};
+
+static uint64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+TEST_F(TokenBucketTest, NoLimit) {
+    TokenBucket bucket(0);
+    uint64_t start = NowMs();
+    for (uint32_t i = 0; i < 1000; i++) {
+        bucket.Acquire(1024 * 1024);
+    }
+    ASSERT_LT(NowMs() - start, 500u);
+}
+
+TEST_F(TokenBucketTest, SharedRate) {
+    // 4 threads take 2 seconds of tokens together from an empty bucket
+    uint64_t rate = 4 * 1024 * 1024;
+    TokenBucket bucket(rate);
+    uint64_t start = NowMs();
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < 4; i++) {
+        threads.emplace_back([&bucket] {
+            for (uint32_t j = 0; j < 32; j++) {
+                bucket.Acquire(64 * 1024);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    uint64_t used = NowMs() - start;
+    ASSERT_GE(used, 1900u);
+    ASSERT_LT(used, 4000u);
+}
+
+TEST_F(TokenBucketTest, SetRate) {
+    TokenBucket bucket(1024);
+    bucket.SetRate(0);
+    ASSERT_EQ(0u, bucket.GetRate());
+    uint64_t start = NowMs();
+    bucket.Acquire(1024 * 1024);
+    ASSERT_LT(NowMs() - start, 500u);
+    // the bucket is filled up after idle for one second
+    bucket.SetRate(1024 * 1024);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    start = NowMs();
+    bucket.Acquire(1024 * 1024);
+    ASSERT_LT(NowMs() - start, 500u);
+    bucket.Acquire(512 * 1024);
+    ASSERT_GE(NowMs() - start, 450u);
+}
+
+}  // namespace base
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -16,6 +16,9 @@
 
 #include "catalog/distribute_iterator.h"
 
+#include <cstdlib>
+#include <cstring>
+
 namespace openmldb {
 namespace catalog {
 
@@ -59,8 +62,11 @@ void FullTableIterator::Next() {
 }
 
 const ::hybridse::codec::Row& FullTableIterator::GetValue() {
-    value_ = ::hybridse::codec::Row(
-        ::hybridse::base::RefCountedSlice::Create(it_->GetValue().data(), it_->GetValue().size()));
+    // the traverse iterator reuses its row buffer and the engine may keep the row after Next, so it owns a copy
+    ::openmldb::base::Slice value = it_->GetValue();
+    auto* buf = reinterpret_cast<int8_t*>(malloc(value.size()));
+    memcpy(buf, value.data(), value.size());
+    value_ = ::hybridse::codec::Row(::hybridse::base::RefCountedSlice::CreateManaged(buf, value.size()));
     return value_;
 }
 
@@ -268,6 +268,27 @@ bool TabletClient::Put(uint32_t tid, uint32_t pid, uint64_t time, const std::str
     return false;
 }
 
+bool TabletClient::BatchPut(const ::openmldb::api::BatchPutRequest& request,
+                            ::openmldb::api::BatchPutResponse* response) {
+    bool ok = client_.SendRequest(&::openmldb::api::TabletServer_Stub::BatchPut, &request, response,
+                                  FLAGS_request_timeout_ms, 1);
+    if (ok && response->code() == 0) {
+        return true;
+    }
+    LOG(WARNING) << "fail to batch put for " << response->msg() << " and error code " << response->code();
+    return false;
+}
+
+bool TabletClient::AsyncBatchPut(const ::openmldb::api::BatchPutRequest& request,
+                                 openmldb::RpcCallback<openmldb::api::BatchPutResponse>* callback) {
+    if (callback == nullptr) {
+        return false;
+    }
+    callback->GetController()->set_timeout_ms(FLAGS_request_timeout_ms);
+    return client_.SendRequest(&::openmldb::api::TabletServer_Stub::BatchPut, callback->GetController().get(),
+                               &request, callback->GetResponse().get(), callback);
+}
+
 
 
 bool TabletClient::Put(uint32_t tid, uint32_t pid, const char* pk, uint64_t time, const char* value, uint32_t size,
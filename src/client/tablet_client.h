@@ -90,6 +90,11 @@ class TabletClient : public Client {
     bool Put(uint32_t tid, uint32_t pid, uint64_t time, const std::string& value,
              const std::vector<std::pair<std::string, uint32_t>>& dimensions, uint32_t format_version);
 
+    // put a group of rows of one partition, the result of every row is in response->row_codes
+    bool BatchPut(const ::openmldb::api::BatchPutRequest& request, ::openmldb::api::BatchPutResponse* response);
+
+    bool AsyncBatchPut(const ::openmldb::api::BatchPutRequest& request,
+                       openmldb::RpcCallback<openmldb::api::BatchPutResponse>* callback);
 
 
     bool Get(uint32_t tid, uint32_t pid, const std::string& pk, uint64_t time, std::string& value,  // NOLINT
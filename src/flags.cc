@@ -50,6 +50,10 @@ DEFINE_int32(gc_pool_size, 2, "the size of tablet gc thread pool");
 DEFINE_int32(gc_safe_offset, 1, "the safe offset of tablet gc in minute");
 DEFINE_uint64(gc_on_table_recover_count, 10000000, "make a gc on recover count");
 DEFINE_uint32(gc_deleted_pk_version_delta, 2, "config the gc version delta");
+DEFINE_bool(gc_use_expire_index, false,
+            "index keys by the time of their oldest record so that absolute ttl gc only visits keys holding "
+            "expired records");
+DEFINE_uint32(gc_expire_bucket_interval, 60 * 1000, "the time span in ms of a bucket of gc expire index");
 DEFINE_double(mem_release_rate, 5, "specify memory release rate, which should be in 0 ~ 10");
 DEFINE_int32(task_pool_size, 3, "the size of tablet task thread pool");
 DEFINE_int32(io_pool_size, 2, "the size of tablet io task thread pool");
@@ -57,6 +61,12 @@ DEFINE_bool(use_name, false, "enable or disable use server name");
 DEFINE_string(data_dir, "./data", "the path of data dir");
 DEFINE_bool(enable_distsql, false, "enable or disable distribute sql");
 DEFINE_bool(enable_localtablet, true, "enable or disable local tablet opt when distribute sql circumstance");
+DEFINE_bool(enable_jit_object_cache, false,
+            "persist the jit compiled objects of the sql under the first db root path, "
+            "so the deployments skip the llvm code generation after a restart");
+DEFINE_uint32(jit_object_cache_max_size, 1024,
+              "the max size in MB of the jit compiled objects, the least recently used are removed beyond it. "
+              "0 means unlimited");
 DEFINE_string(mini_window_size, "1d", "the default mini window size in pre-aggr table");
 
 // scan configuration
@@ -67,6 +77,29 @@ DEFINE_uint32(preview_default_limit, 100, "config the default limit of preview")
 // binlog configuration
 DEFINE_int32(binlog_single_file_max_size, 1024 * 4, "the max size of single binlog file");
 DEFINE_int32(binlog_sync_batch_size, 32, "the batch size of sync binlog");
+DEFINE_bool(binlog_sync_raw_record, false,
+            "send binlog records to followers as they are in the attachment instead of parsed entries, "
+            "all the followers must support it");
+DEFINE_uint32(binlog_sync_max_inflight, 1,
+              "the max number of binlog batches sent to a follower without waiting for the acks, "
+              "all the tablets in the cluster must support it before it is set greater than 1");
+DEFINE_uint32(binlog_sync_worker_num, 0,
+              "the number of workers syncing the binlog of all the partitions with one stream per follower "
+              "endpoint, 0 means each partition syncs to each follower in its own thread. a follower without "
+              "BatchAppendEntries is synced with AppendEntries of each partition");
+DEFINE_uint32(binlog_sync_stream_batch_size, 1024,
+              "the max number of binlog records of all the partitions in one request of a stream");
+DEFINE_uint32(binlog_tail_cache_size, 0,
+              "the max size in MB of the recent binlog records kept in memory for followers of each partition, "
+              "0 means disabled");
+DEFINE_bool(binlog_group_commit, false,
+            "write the binlog of the leader in groups by a log writer of each partition "
+            "instead of the request threads");
+DEFINE_uint32(binlog_group_commit_max_size, 256, "the max number of binlog records written in one group");
+DEFINE_bool(binlog_sync_on_commit, false, "sync the binlog to disk before the put returns");
+DEFINE_bool(binlog_read_mmap, false,
+            "read the binlog through a memory mapping for recovery and the followers instead of buffered reads");
+DEFINE_uint32(binlog_read_ahead_size, 4, "the size in MB read ahead of the position when the binlog is mapped");
 DEFINE_bool(binlog_notify_on_put, false, "config the sync log to follower strategy");
 DEFINE_bool(binlog_enable_crc, false, "enable crc");
 DEFINE_int32(binlog_coffee_time, 1000, "config the coffee time");
@@ -103,7 +136,10 @@ DEFINE_int32(send_file_max_try, 3, "the max retry time when send file failed");
 DEFINE_int32(retry_send_file_wait_time_ms, 3000, "conf the wait time when retry send file");
 DEFINE_int32(stream_close_wait_time_ms, 1000, "the wait time before close stream");
 DEFINE_uint32(stream_block_size, 1 * 1204 * 1024, "config the write/read block size in streaming");
-DEFINE_int32(stream_bandwidth_limit, 10 * 1204 * 1024, "the limit bandwidth. Byte/Second");
+DEFINE_int32(stream_bandwidth_limit, 10 * 1204 * 1024,
+             "the limit bandwidth shared by all the files sent by a tablet. Byte/Second");
+DEFINE_uint32(send_file_stream_num, 1,
+              "the number of streams to send a file in parallel, more than 1 needs the receiver to support it");
 
 // if set 23, the task will execute 23:00 every day
 DEFINE_int32(make_snapshot_time, 23, "config the time to make snapshot");
@@ -114,7 +150,21 @@ DEFINE_uint32(make_snapshot_offline_interval, 60 * 60 * 24,
               "config tablet self makesnapshot when how long time do not "
               "makesnapshot from ns. unit is second");
 DEFINE_string(snapshot_compression, "off", "Type of snapshot compression, can be off, snappy, zlib");
+DEFINE_string(mem_table_compression, "off",
+              "Type of compression of the rows stored in memory tables, can be off, snappy");
 DEFINE_int32(snapshot_pool_size, 1, "the size of tablet thread pool for making snapshot");
+DEFINE_uint64(snapshot_chunk_size, 0,
+              "the max size of a single snapshot file, chunks of snapshot are loaded in parallel. 0 means a "
+              "single file. all tablets must support chunked snapshots before it is enabled");
+DEFINE_string(snapshot_format, "logentry",
+              "Format of memtable snapshot, can be logentry, native. native snapshot is loaded without "
+              "parsing LogEntry, hashing keys and decoding ts");
+DEFINE_uint32(snapshot_delta_max_num, 0,
+              "the max number of delta snapshots on top of the base snapshot, a delta snapshot only holds the "
+              "binlog since the last snapshot. 0 means every snapshot rewrites the whole table");
+DEFINE_uint32(snapshot_delta_compact_ratio, 50,
+              "compact the deltas into a new base snapshot once they hold more records than this percent of the "
+              "base snapshot");
 
 DEFINE_uint32(load_index_max_wait_time, 120 * 60 * 1000, "config the max wait time of load index");
 
@@ -126,6 +176,9 @@ DEFINE_uint32(latest_ttl_max, 1000, "the max ttl of latest");
 DEFINE_uint32(absolute_ttl_max, 60 * 24 * 365 * 30, "the max ttl of absolute time");
 DEFINE_uint32(skiplist_max_height, 12, "the max height of skiplist");
 DEFINE_uint32(key_entry_max_height, 8, "the max height of key entry");
+DEFINE_bool(segment_pk_hash_index, false,
+            "index the primary keys of a segment in a hash table as well, so that point lookups need no key compares");
+DEFINE_uint32(segment_pk_hash_bucket_cnt, 1024, "the initial bucket count of the pk hash index of a segment");
 DEFINE_uint32(latest_default_skiplist_height, 1, "the default height of skiplist for latest table");
 DEFINE_uint32(absolute_default_skiplist_height, 4, "the default height of skiplist for absolute table");
 DEFINE_bool(enable_show_tp, false, "enable show tp");
@@ -145,6 +198,8 @@ DEFINE_bool(verify_compression, false, "For debug");
 DEFINE_uint32(load_table_batch, 30, "set laod table batch size");
 DEFINE_uint32(load_table_thread_num, 3, "set load tabale thread pool size");
 DEFINE_uint32(load_table_queue_size, 1000, "set load tabale queue size");
+DEFINE_uint32(load_binlog_thread_num, 1,
+              "set the thread num replaying the binlog of a table on recovery, 1 means replayed by the loading thread");
 
 // multiple data center
 DEFINE_uint32(get_replica_status_interval, 10000, "config the interval to sync replica cluster status time");
@@ -36,6 +36,8 @@
 
 DECLARE_bool(binlog_enable_crc);
 DECLARE_int32(binlog_name_length);
+DECLARE_bool(binlog_read_mmap);
+DECLARE_uint32(binlog_read_ahead_size);
 DECLARE_string(snapshot_compression);
 
 namespace openmldb {
@@ -446,6 +448,30 @@ LogReader::~LogReader() {
 
 void LogReader::SetOffset(uint64_t start_offset) { start_offset_ = start_offset; }
 
+void LogReader::Reset(uint64_t start_offset) {
+    delete reader_;
+    reader_ = NULL;
+    delete sf_;
+    sf_ = NULL;
+    log_part_index_ = -1;
+    start_offset_ = start_offset;
+}
+
+int LogReader::GetLogIndex(uint64_t offset) {
+    int index = -1;
+    LogParts::Iterator* it = logs_->NewIterator();
+    it->SeekToFirst();
+    while (it->Valid()) {
+        if (it->GetValue() <= offset) {
+            index = (int)it->GetKey();  // NOLINT
+            break;
+        }
+        it->Next();
+    }
+    delete it;
+    return index;
+}
+
 void LogReader::GoBackToLastBlock() {
     if (sf_ == NULL || reader_ == NULL) {
         return;
@@ -578,7 +604,12 @@ int LogReader::OpenSeqFile(const std::string& path) {
         sf_ = NULL;
     }
     PDLOG(INFO, "open log file %s", path.c_str());
-    sf_ = ::openmldb::log::NewSeqFile(path, fd);
+    if (FLAGS_binlog_read_mmap) {
+        uint64_t read_ahead_size = static_cast<uint64_t>(FLAGS_binlog_read_ahead_size) * 1024 * 1024;
+        sf_ = ::openmldb::log::NewMmapSeqFile(path, fd, read_ahead_size);
+    } else {
+        sf_ = ::openmldb::log::NewSeqFile(path, fd);
+    }
     return 0;
 }
 
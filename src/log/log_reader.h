@@ -162,6 +162,10 @@ class LogReader {
     int GetEndLogIndex();
     uint64_t GetLastRecordEndOffset();
     void SetOffset(uint64_t start_offset);
+    // close the current log part, the next read starts from the part holding the records after start_offset
+    void Reset(uint64_t start_offset);
+    // the index of the log part holding the records after offset, -1 if not found
+    int GetLogIndex(uint64_t offset);
     LogReader(const LogReader&) = delete;
     LogReader& operator=(const LogReader&) = delete;
 
@@ -388,6 +388,58 @@ TEST_F(LogWRTest, TestGoBack) {
     ASSERT_EQ("hello", value3.ToString());
 }
 
+TEST_F(LogWRTest, TestMmapRead) {
+    std::string log_dir = "/tmp/" + GenRand() + "/";
+    ::openmldb::base::MkdirRecur(log_dir);
+    std::string fname = "test.log";
+    std::string full_path = log_dir + "/" + fname;
+    full_path = GetWritePath(full_path);
+    FILE* fd_w = fopen(full_path.c_str(), "ab+");
+    ASSERT_TRUE(fd_w != NULL);
+    WritableFile* wf = NewWritableFile(fname, fd_w);
+    Writer writer(FLAGS_snapshot_compression, wf);
+    // a fragmented record between two full records
+    std::vector<std::string> values{"hello", std::string(block_size_ * 2, 'a'), "hello1"};
+    for (const auto& value : values) {
+        ASSERT_TRUE(writer.AddRecord(value).ok());
+    }
+    if (FLAGS_snapshot_compression != "off") {
+        writer.EndLog();
+    }
+    FILE* fd_r = fopen(full_path.c_str(), "rb");
+    ASSERT_TRUE(fd_r != NULL);
+    SequentialFile* rf = NewMmapSeqFile(fname, fd_r, 1024 * 1024);
+    Reader reader(rf, NULL, true, 0, compressed_);
+    std::string scratch;
+    Slice value;
+    Status status;
+    for (const auto& expect : values) {
+        status = reader.ReadRecord(&value, &scratch);
+        ASSERT_TRUE(status.ok());
+        ASSERT_EQ(expect, value.ToString());
+    }
+    if (FLAGS_snapshot_compression == "off") {
+        // the record appended after the file is mapped is read too
+        status = reader.ReadRecord(&value, &scratch);
+        ASSERT_TRUE(status.IsWaitRecord());
+        ASSERT_TRUE(writer.AddRecord("hello2").ok());
+        // the reader goes back to the start of the last block after a wait
+        do {
+            status = reader.ReadRecord(&value, &scratch);
+            ASSERT_TRUE(status.ok());
+        } while (value.ToString() != "hello2");
+    } else {
+        status = reader.ReadRecord(&value, &scratch);
+        ASSERT_TRUE(status.IsEof());
+    }
+    reader.GoBackToStart();
+    status = reader.ReadRecord(&value, &scratch);
+    ASSERT_TRUE(status.ok());
+    ASSERT_EQ("hello", value.ToString());
+    delete rf;
+    delete wf;
+}
+
 TEST_F(LogWRTest, TestInit) {
     std::string log_dir = "/tmp/" + GenRand() + "/";
     ::openmldb::base::MkdirRecur(log_dir);
@@ -44,6 +44,7 @@ Writer::Writer(const std::string& compress_type, WritableFile* dest)
       block_offset_(0),
       compress_type_(GetCompressType(compress_type)),
       header_size_(compress_type_ != kNoCompress ? kHeaderSizeForCompress : kHeaderSize),
+      auto_flush_(true),
       buffer_(nullptr),
       compress_buf_(nullptr) {
     InitTypeCrc(type_crc_);
@@ -63,6 +64,7 @@ Writer::Writer(const std::string& compress_type, WritableFile* dest, uint64_t de
     : dest_(dest),
       compress_type_(GetCompressType(compress_type)),
       header_size_(compress_type_ != kNoCompress ? kHeaderSizeForCompress : kHeaderSize),
+      auto_flush_(true),
       buffer_(nullptr),
       compress_buf_(nullptr) {
     InitTypeCrc(type_crc_);
@@ -211,7 +213,7 @@ Status Writer::EmitPhysicalRecord(RecordType t, const char* ptr, size_t n) {
         Status s = dest_->Append(Slice(buf, header_size_));
         if (s.ok()) {
             s = dest_->Append(Slice(ptr, n));
-            if (s.ok()) {
+            if (s.ok() && auto_flush_) {
                 s = dest_->Flush();
             }
         }
@@ -287,7 +289,7 @@ Status Writer::CompressRecord() {
     s = dest_->Append(Slice(head_of_compress, kHeaderSizeOfCompressBlock));
     if (s.ok()) {
         s = dest_->Append(Slice(compress_buf_, compress_len));
-        if (s.ok()) {
+        if (s.ok() && auto_flush_) {
             s = dest_->Flush();
         }
     }
@@ -52,6 +52,11 @@ class Writer {
     Status AddRecord(const Slice& slice);
     Status EndLog();
 
+    // every physical record is flushed to the file by default, a group of records
+    // can be written with one flush by turning it off and calling Flush at the end
+    void SetAutoFlush(bool auto_flush) { auto_flush_ = auto_flush; }
+    Status Flush() { return dest_->Flush(); }
+
     inline CompressType GetCompressType() { return compress_type_; }
 
     inline uint32_t GetBlockSize() { return block_size_; }
@@ -72,6 +77,7 @@ class Writer {
     CompressType compress_type_;
     uint32_t block_size_;
     const uint32_t header_size_;
+    bool auto_flush_;
     // buffer of kCompressBlockSize
     char* buffer_;
     // buffer for compressed block
@@ -100,6 +106,10 @@ struct WriteHandle {
 
     Status Sync() { return wf_->Sync(); }
 
+    void SetAutoFlush(bool auto_flush) { lw_->SetAutoFlush(auto_flush); }
+
+    Status Flush() { return lw_->Flush(); }
+
     Status EndLog() { return lw_->EndLog(); }
 
     uint64_t GetSize() { return wf_->GetSize(); }
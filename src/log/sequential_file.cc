@@ -22,6 +22,11 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
 
 #include "base/glog_wapper.h"  // NOLINT
 #include "base/slice.h"
@@ -91,7 +96,135 @@ class PosixSequentialFile : public SequentialFile {
     }
 };
 
+// the mapping is larger than the file to hold the appended data without remapping,
+// only the bytes below the file size are accessed
+static const uint64_t MMAP_GROW_SIZE = 64 * 1024 * 1024;
+
+class PosixMmapSequentialFile : public SequentialFile {
+ private:
+    std::string filename_;
+    FILE* file_;
+    int fd_;
+    char* base_;
+    uint64_t map_size_;
+    // the file size known so far, the bytes after it are not read
+    uint64_t file_size_;
+    uint64_t pos_;
+    uint64_t readahead_size_;
+    uint64_t advised_end_;
+    uint64_t page_size_;
+
+    Status Remap(uint64_t size) {
+        uint64_t map_size = (size / MMAP_GROW_SIZE + 1) * MMAP_GROW_SIZE;
+        if (base_ != NULL) {
+            munmap(base_, map_size_);
+            base_ = NULL;
+            map_size_ = 0;
+        }
+        void* base = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd_, 0);
+        if (base == MAP_FAILED) {
+            return Status::IOError(filename_, strerror(errno));
+        }
+        base_ = static_cast<char*>(base);
+        map_size_ = map_size;
+        madvise(base_, map_size_, MADV_SEQUENTIAL);
+        advised_end_ = 0;
+        return Status::OK();
+    }
+
+    // refresh the file size if the read goes beyond it
+    Status Refresh(uint64_t end) {
+        if (end <= file_size_ && base_ != NULL) {
+            return Status::OK();
+        }
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            return Status::IOError(filename_, strerror(errno));
+        }
+        uint64_t size = static_cast<uint64_t>(st.st_size);
+        if (size > map_size_ || base_ == NULL) {
+            Status s = Remap(size);
+            if (!s.ok()) {
+                return s;
+            }
+        }
+        file_size_ = size;
+        return Status::OK();
+    }
+
+    void Advise() {
+        if (readahead_size_ == 0 || pos_ + readahead_size_ / 2 < advised_end_) {
+            return;
+        }
+        uint64_t start = pos_ & ~(page_size_ - 1);
+        uint64_t end = std::min(start + readahead_size_, file_size_);
+        if (end > start) {
+            madvise(base_ + start, end - start, MADV_WILLNEED);
+        }
+        advised_end_ = start + readahead_size_;
+    }
+
+ public:
+    PosixMmapSequentialFile(const std::string& fname, FILE* f, uint64_t readahead_size)
+        : filename_(fname),
+          file_(f),
+          fd_(fileno(f)),
+          base_(NULL),
+          map_size_(0),
+          file_size_(0),
+          pos_(0),
+          readahead_size_(readahead_size),
+          advised_end_(0),
+          page_size_(sysconf(_SC_PAGESIZE)) {}
+
+    virtual ~PosixMmapSequentialFile() {
+        if (base_ != NULL) {
+            munmap(base_, map_size_);
+        }
+        fclose(file_);
+    }
+
+    virtual Status Read(size_t n, Slice* result, char* scratch) {
+        Status s = Refresh(pos_ + n);
+        if (!s.ok()) {
+            *result = Slice();
+            return s;
+        }
+        uint64_t r = 0;
+        if (pos_ < file_size_) {
+            r = std::min(static_cast<uint64_t>(n), file_size_ - pos_);
+        }
+        *result = Slice(base_ + pos_, r);
+        pos_ += r;
+        Advise();
+        return s;
+    }
+
+    virtual Status Skip(uint64_t n) {
+        pos_ += n;
+        return Status::OK();
+    }
+
+    virtual Status Tell(uint64_t* pos) {
+        if (pos == NULL) {
+            return Status::InvalidArgument("invalid pos arg");
+        }
+        *pos = pos_;
+        return Status::OK();
+    }
+
+    virtual Status Seek(uint64_t pos) {
+        pos_ = pos;
+        advised_end_ = 0;
+        return Status::OK();
+    }
+};
+
 SequentialFile* NewSeqFile(const std::string& fname, FILE* f) { return new PosixSequentialFile(fname, f); }
 
+SequentialFile* NewMmapSeqFile(const std::string& fname, FILE* f, uint64_t readahead_size) {
+    return new PosixMmapSequentialFile(fname, f, readahead_size);
+}
+
 }  // namespace log
 }  // namespace openmldb
@@ -66,6 +66,13 @@ class SequentialFile {
 
 SequentialFile* NewSeqFile(const std::string& fname, FILE* f);
 
+// a SequentialFile over a read only mapping of the file, Read points the result into
+// the mapping instead of copying to scratch. the data appended after open is visible
+// too, so it can follow a binlog being written. readahead_size is the size of the
+// window asked to the kernel ahead of the read position, 0 means no hint. the result
+// is valid until the next Read, Skip or Seek
+SequentialFile* NewMmapSeqFile(const std::string& fname, FILE* f, uint64_t readahead_size);
+
 }  // namespace log
 }  // namespace openmldb
 #endif  // SRC_LOG_SEQUENTIAL_FILE_H_
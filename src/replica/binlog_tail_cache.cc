@@ -0,0 +1,73 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "replica/binlog_tail_cache.h"
+
+#include <algorithm>
+
+namespace openmldb {
+namespace replica {
+
+BinlogTailCache::BinlogTailCache(uint64_t capacity) : mu_(), capacity_(capacity), byte_size_(0), start_index_(0) {}
+
+void BinlogTailCache::Append(uint64_t log_index, const ::openmldb::base::Slice& record) {
+    auto value = std::make_shared<std::string>(record.data(), record.size());
+    std::lock_guard<std::mutex> lock(mu_);
+    if (records_.empty() || start_index_ + records_.size() != log_index) {
+        records_.clear();
+        byte_size_ = 0;
+        start_index_ = log_index;
+    }
+    records_.push_back(value);
+    byte_size_ += value->size();
+    // keep the last record even if it is larger than the capacity
+    while (byte_size_ > capacity_ && records_.size() > 1) {
+        byte_size_ -= records_.front()->size();
+        records_.pop_front();
+        start_index_++;
+    }
+}
+
+bool BinlogTailCache::Get(uint64_t start_index, uint32_t max_cnt,
+                          std::vector<std::shared_ptr<std::string>>* records) {
+    records->clear();
+    std::lock_guard<std::mutex> lock(mu_);
+    if (records_.empty() || start_index < start_index_ || start_index >= start_index_ + records_.size()) {
+        return false;
+    }
+    uint64_t pos = start_index - start_index_;
+    uint64_t end = std::min(pos + max_cnt, static_cast<uint64_t>(records_.size()));
+    records->reserve(end - pos);
+    for (; pos < end; pos++) {
+        records->push_back(records_[pos]);
+    }
+    return true;
+}
+
+void BinlogTailCache::Clear() {
+    std::lock_guard<std::mutex> lock(mu_);
+    records_.clear();
+    byte_size_ = 0;
+    start_index_ = 0;
+}
+
+uint64_t BinlogTailCache::GetByteSize() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return byte_size_;
+}
+
+}  // namespace replica
+}  // namespace openmldb
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_REPLICA_BINLOG_TAIL_CACHE_H_
+#define SRC_REPLICA_BINLOG_TAIL_CACHE_H_
+
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "base/slice.h"
+
+namespace openmldb {
+namespace replica {
+
+// the most recent binlog records appended by the leader, shared by all the replicate nodes of a partition.
+// the nodes close to the leader read from it instead of the binlog files
+class BinlogTailCache {
+ public:
+    explicit BinlogTailCache(uint64_t capacity);
+
+    BinlogTailCache(const BinlogTailCache&) = delete;
+    BinlogTailCache& operator=(const BinlogTailCache&) = delete;
+
+    // the record of log_index should follow the last one, or the cache starts over from it
+    void Append(uint64_t log_index, const ::openmldb::base::Slice& record);
+
+    // get at most max_cnt records from start_index in order. return false if start_index is not cached
+    bool Get(uint64_t start_index, uint32_t max_cnt, std::vector<std::shared_ptr<std::string>>* records);
+
+    void Clear();
+
+    uint64_t GetByteSize();
+
+ private:
+    std::mutex mu_;
+    uint64_t capacity_;
+    uint64_t byte_size_;
+    // the log index of the first record
+    uint64_t start_index_;
+    std::deque<std::shared_ptr<std::string>> records_;
+};
+
+}  // namespace replica
+}  // namespace openmldb
+
+#endif  // SRC_REPLICA_BINLOG_TAIL_CACHE_H_
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "replica/binlog_tail_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace openmldb {
+namespace replica {
+
+class BinlogTailCacheTest : public ::testing::Test {
+ public:
+    BinlogTailCacheTest() {}
+    ~BinlogTailCacheTest() {}
+};
+
+TEST_F(BinlogTailCacheTest, Get) {
+    BinlogTailCache cache(1024);
+    std::vector<std::shared_ptr<std::string>> records;
+    ASSERT_FALSE(cache.Get(1, 10, &records));
+    for (uint64_t i = 1; i <= 10; i++) {
+        cache.Append(i, ::openmldb::base::Slice("record" + std::to_string(i)));
+    }
+    ASSERT_TRUE(cache.Get(3, 4, &records));
+    ASSERT_EQ(4u, records.size());
+    ASSERT_EQ("record3", *records[0]);
+    ASSERT_EQ("record6", *records[3]);
+    ASSERT_TRUE(cache.Get(9, 4, &records));
+    ASSERT_EQ(2u, records.size());
+    ASSERT_EQ("record10", *records[1]);
+    ASSERT_FALSE(cache.Get(11, 4, &records));
+    ASSERT_TRUE(records.empty());
+    ASSERT_FALSE(cache.Get(0, 4, &records));
+}
+
+TEST_F(BinlogTailCacheTest, Evict) {
+    BinlogTailCache cache(100);
+    std::string value(10, 'a');
+    for (uint64_t i = 1; i <= 20; i++) {
+        cache.Append(i, ::openmldb::base::Slice(value));
+    }
+    ASSERT_EQ(100u, cache.GetByteSize());
+    std::vector<std::shared_ptr<std::string>> records;
+    ASSERT_FALSE(cache.Get(10, 1, &records));
+    ASSERT_TRUE(cache.Get(11, 100, &records));
+    ASSERT_EQ(10u, records.size());
+    // the record larger than the capacity is kept alone
+    cache.Append(21, ::openmldb::base::Slice(std::string(200, 'b')));
+    ASSERT_EQ(200u, cache.GetByteSize());
+    ASSERT_FALSE(cache.Get(20, 1, &records));
+    ASSERT_TRUE(cache.Get(21, 1, &records));
+    ASSERT_EQ(200u, records[0]->size());
+}
+
+TEST_F(BinlogTailCacheTest, Restart) {
+    BinlogTailCache cache(1024);
+    std::vector<std::shared_ptr<std::string>> records;
+    cache.Append(1, ::openmldb::base::Slice("record1"));
+    cache.Append(2, ::openmldb::base::Slice("record2"));
+    // a gap of log index starts the cache over
+    cache.Append(5, ::openmldb::base::Slice("record5"));
+    ASSERT_FALSE(cache.Get(1, 1, &records));
+    ASSERT_TRUE(cache.Get(5, 10, &records));
+    ASSERT_EQ(1u, records.size());
+    cache.Clear();
+    ASSERT_EQ(0u, cache.GetByteSize());
+    ASSERT_FALSE(cache.Get(5, 10, &records));
+}
+
+}  // namespace replica
+}  // namespace openmldb
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -35,6 +35,11 @@
 
 DECLARE_int32(binlog_single_file_max_size);
 DECLARE_int32(binlog_name_length);
+DECLARE_uint32(binlog_tail_cache_size);
+DECLARE_bool(binlog_group_commit);
+DECLARE_uint32(binlog_group_commit_max_size);
+DECLARE_bool(binlog_sync_on_commit);
+DECLARE_int32(binlog_coffee_time);
 DECLARE_string(zk_cluster);
 
 namespace openmldb {
@@ -42,6 +47,16 @@ namespace replica {
 
 static const ::openmldb::base::DefaultComparator scmp;
 
+static void* RunLogWriterTask(void* args) {
+    if (args == NULL) {
+        PDLOG(WARNING, "input args is null");
+        return NULL;
+    }
+    LogReplicator* replicator = static_cast<LogReplicator*>(args);
+    replicator->RunLogWriter();
+    return NULL;
+}
+
 LogReplicator::LogReplicator(uint32_t tid, uint32_t pid, const std::string& path,
                              const std::map<std::string, std::string>& real_ep_map,
                              const ReplicatorRole& role)
@@ -52,6 +67,7 @@ LogReplicator::LogReplicator(uint32_t tid, uint32_t pid, const std::string& path
       log_offset_(0),
       logs_(NULL),
       wh_(NULL),
+      wh_failed_(false),
       role_(role),
       real_ep_map_(real_ep_map),
       nodes_(),
@@ -59,14 +75,30 @@ LogReplicator::LogReplicator(uint32_t tid, uint32_t pid, const std::string& path
       term_(0),
       mu_(),
       cv_(),
-      wmu_() {
+      wmu_(),
+      offset_mu_(),
+      offset_cv_(),
+      offset_waiter_cnt_(0),
+      tail_cache_(),
+      transport_(NULL),
+      commit_queue_(),
+      writer_running_(false),
+      writer_waiting_(false),
+      writer_users_(0),
+      writer_mu_(),
+      writer_cv_(),
+      writer_tid_(0) {
     binlog_index_ = 0;
+    if (FLAGS_binlog_tail_cache_size > 0) {
+        tail_cache_.reset(new BinlogTailCache(static_cast<uint64_t>(FLAGS_binlog_tail_cache_size) * 1024 * 1024));
+    }
     snapshot_log_part_index_.store(-1, std::memory_order_relaxed);
     snapshot_last_offset_.store(0, std::memory_order_relaxed);
     follower_offset_.store(0);
 }
 
 LogReplicator::~LogReplicator() {
+    StopLogWriter();
     DelAllReplicateNode();
     if (logs_ != NULL) {
         logs_->Clear();
@@ -81,6 +113,9 @@ LogReplicator::~LogReplicator() {
 void LogReplicator::SetRole(const ReplicatorRole& role) {
     std::lock_guard<bthread::Mutex> lock(mu_);
     role_ = role;
+    if (tail_cache_) {
+        tail_cache_->Clear();
+    }
 }
 
 void LogReplicator::SyncToDisk() {
@@ -109,7 +144,8 @@ bool LogReplicator::Init() {
         for (const auto& kv : real_ep_map_) {
             std::shared_ptr<ReplicateNode> replicate_node =
                 std::make_shared<ReplicateNode>(kv.first, logs_, log_path_, tid_, pid_, &term_,
-                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, kv.second);
+                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, tail_cache_.get(),
+                                                kv.second);
             if (replicate_node->Init() < 0) {
                 PDLOG(WARNING, "init replicate node %s error", kv.first.c_str());
                 return false;
@@ -123,15 +159,93 @@ bool LogReplicator::Init() {
     if (!Recover()) {
         return false;
     }
+    if (FLAGS_binlog_group_commit) {
+        StartLogWriter();
+    }
     return true;
 }
 
+void LogReplicator::StartLogWriter() {
+    writer_running_.store(true, std::memory_order_release);
+    int ret = bthread_start_background(&writer_tid_, NULL, RunLogWriterTask, this);
+    if (ret != 0) {
+        // fall back to writing in the request threads
+        writer_running_.store(false, std::memory_order_release);
+        PDLOG(WARNING, "fail to start log writer for path %s with errno %d", path_.c_str(), ret);
+        return;
+    }
+    PDLOG(INFO, "start log writer for table #tid %u, #pid %u done", tid_, pid_);
+}
+
+void LogReplicator::StopLogWriter() {
+    if (!writer_running_.exchange(false, std::memory_order_seq_cst)) {
+        return;
+    }
+    {
+        std::lock_guard<bthread::Mutex> lock(writer_mu_);
+        writer_cv_.notify_one();
+    }
+    bthread_join(writer_tid_, NULL);
+    // an AppendEntry may see the writer running and queue its entry after the writer exits. once there is no
+    // such caller, the later ones see the writer stopped and the queued requests are failed here
+    while (writer_users_.load(std::memory_order_seq_cst) > 0) {
+        bthread_yield();
+    }
+    CommitRequest* request = NULL;
+    while (commit_queue_.Pop(&request)) {
+        request->ok = false;
+        request->done.signal();
+    }
+}
+
+void LogReplicator::RunLogWriter() {
+    std::vector<CommitRequest*> group;
+    std::vector<LogEntry*> entries;
+    uint32_t max_size = std::max(FLAGS_binlog_group_commit_max_size, 1u);
+    while (true) {
+        CommitRequest* request = NULL;
+        while (group.size() < max_size && commit_queue_.Pop(&request)) {
+            group.push_back(request);
+        }
+        if (group.empty()) {
+            // the queued entries are drained before exit
+            if (!writer_running_.load(std::memory_order_acquire)) {
+                break;
+            }
+            std::unique_lock<bthread::Mutex> lock(writer_mu_);
+            writer_waiting_.store(true, std::memory_order_relaxed);
+            // pairs with the fence in AppendEntry, either the entry is seen here or the writer is notified
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (commit_queue_.Empty() && writer_running_.load(std::memory_order_acquire)) {
+                writer_cv_.wait_for(lock, FLAGS_binlog_coffee_time * 1000);
+            }
+            writer_waiting_.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        entries.clear();
+        for (CommitRequest* req : group) {
+            entries.push_back(req->entry);
+        }
+        uint32_t written = 0;
+        {
+            std::lock_guard<std::mutex> lock(wmu_);
+            written = WriteEntries(entries.data(), entries.size());
+        }
+        for (uint32_t i = 0; i < group.size(); i++) {
+            group[i]->ok = i < written;
+            // the request may be gone once it is signaled
+            group[i]->done.signal();
+        }
+        group.clear();
+    }
+}
+
 bool LogReplicator::StartSyncing() {
     std::lock_guard<bthread::Mutex> lock(mu_);
     std::vector<std::shared_ptr<ReplicateNode>>::iterator it = nodes_.begin();
     for (; it != nodes_.end(); ++it) {
         std::shared_ptr<ReplicateNode> node = *it;
-        int ok = node->Start();
+        int ok = StartNode(node);
         if (ok != 0) {
             return false;
         }
@@ -229,10 +343,39 @@ bool LogReplicator::Recover() {
 
 LogParts* LogReplicator::GetLogPart() { return logs_; }
 
-void LogReplicator::SetOffset(uint64_t offset) { log_offset_.store(offset, std::memory_order_relaxed); }
+void LogReplicator::SetOffset(uint64_t offset) {
+    log_offset_.store(offset, std::memory_order_relaxed);
+    NotifyOffset();
+}
 
 uint64_t LogReplicator::GetOffset() { return log_offset_.load(std::memory_order_relaxed); }
 
+bool LogReplicator::WaitOffset(uint64_t offset, uint32_t timeout_ms) {
+    uint64_t deadline = ::baidu::common::timer::get_micros() + timeout_ms * 1000;
+    offset_waiter_cnt_.fetch_add(1, std::memory_order_seq_cst);
+    {
+        std::unique_lock<bthread::Mutex> lock(offset_mu_);
+        while (GetOffset() < offset) {
+            uint64_t now = ::baidu::common::timer::get_micros();
+            if (now >= deadline) {
+                break;
+            }
+            offset_cv_.wait_for(lock, deadline - now);
+        }
+    }
+    offset_waiter_cnt_.fetch_sub(1, std::memory_order_relaxed);
+    return GetOffset() >= offset;
+}
+
+void LogReplicator::NotifyOffset() {
+    // pairs with the increment in WaitOffset so that either the waiter sees the offset or it is woken up
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (offset_waiter_cnt_.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<bthread::Mutex> lock(offset_mu_);
+        offset_cv_.notify_all();
+    }
+}
+
 void LogReplicator::SetSnapshotLogPartIndex(uint64_t offset) {
     snapshot_last_offset_.store(offset, std::memory_order_relaxed);
     ::openmldb::log::LogReader log_reader(logs_, log_path_, false);
@@ -287,6 +430,12 @@ uint64_t LogReplicator::GetLeaderTerm() { return term_.load(std::memory_order_re
 void LogReplicator::SetLeaderTerm(uint64_t term) { term_.store(term, std::memory_order_relaxed); }
 
 bool LogReplicator::ApplyEntry(const LogEntry& entry) {
+    std::string buffer;
+    entry.SerializeToString(&buffer);
+    return ApplyEntry(entry.log_index(), ::openmldb::base::Slice(buffer.c_str(), buffer.size()));
+}
+
+bool LogReplicator::ApplyEntry(uint64_t log_index, const ::openmldb::base::Slice& record) {
     std::lock_guard<std::mutex> lock(wmu_);
     uint64_t last_log_offset = GetOffset();
     if (wh_ == NULL || (wh_->GetSize() / (1024 * 1024)) > (uint32_t)FLAGS_binlog_single_file_max_size) {
@@ -295,24 +444,45 @@ bool LogReplicator::ApplyEntry(const LogEntry& entry) {
             return false;
         }
     }
-    if (entry.log_index() <= last_log_offset) {
+    if (log_index <= last_log_offset) {
         PDLOG(WARNING, "entry log_index %lu cur log_offset %lu tid %u pid %u",
-                entry.log_index(), last_log_offset, tid_, pid_);
+                log_index, last_log_offset, tid_, pid_);
         return true;
     }
-    std::string buffer;
-    entry.SerializeToString(&buffer);
-    ::openmldb::base::Slice slice(buffer.c_str(), buffer.size());
-    ::openmldb::log::Status status = wh_->Write(slice);
+    ::openmldb::log::Status status = wh_->Write(record);
     if (!status.ok()) {
         PDLOG(WARNING, "fail to write replication log in dir %s for %s", path_.c_str(), status.ToString().c_str());
         return false;
     }
-    log_offset_.store(entry.log_index(), std::memory_order_relaxed);
+    log_offset_.store(log_index, std::memory_order_relaxed);
+    NotifyOffset();
     DEBUGLOG("sync log entry to offset %lu for %s", GetOffset(), path_.c_str());
     return true;
 }
 
+bool LogReplicator::SplitRawRecords(const ::openmldb::api::AppendEntriesRequest& request,
+                                    const butil::IOBuf& attachment, std::string* buffer,
+                                    std::vector<::openmldb::base::Slice>* records) {
+    uint64_t total_size = 0;
+    for (auto size : request.record_size()) {
+        total_size += size;
+    }
+    if (total_size != attachment.size()) {
+        PDLOG(WARNING, "raw records size %lu mismatch attachment size %lu. tid %u pid %u", total_size,
+              attachment.size(), request.tid(), request.pid());
+        return false;
+    }
+    attachment.copy_to(buffer);
+    records->clear();
+    records->reserve(request.record_size_size());
+    const char* cur = buffer->data();
+    for (auto size : request.record_size()) {
+        records->emplace_back(cur, size);
+        cur += size;
+    }
+    return true;
+}
+
 int LogReplicator::AddReplicateNode(const std::map<std::string, std::string>& real_ep_map) {
     return AddReplicateNode(real_ep_map, UINT32_MAX);
 }
@@ -340,17 +510,18 @@ int LogReplicator::AddReplicateNode(const std::map<std::string, std::string>& re
         if (tid == UINT32_MAX) {
             replicate_node =
                 std::make_shared<ReplicateNode>(endpoint, logs_, log_path_, tid_, pid_, &term_,
-                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, kv.second);
+                                                &log_offset_, &mu_, &cv_, false, &follower_offset_, tail_cache_.get(),
+                                                kv.second);
         } else {
             replicate_node =
                 std::make_shared<ReplicateNode>(endpoint, logs_, log_path_, tid, pid_, &term_, &log_offset_,
-                                                &mu_, &cv_, true, &follower_offset_, kv.second);
+                                                &mu_, &cv_, true, &follower_offset_, tail_cache_.get(), kv.second);
         }
         if (replicate_node->Init() < 0) {
             PDLOG(WARNING, "init replicate node %s error", endpoint.c_str());
             return -1;
         }
-        if (replicate_node->Start() != 0) {
+        if (StartNode(replicate_node) != 0) {
             PDLOG(WARNING, "fail to start sync thread for table #tid %u, #pid %u", tid_, pid_);
             return -1;
         }
@@ -390,7 +561,7 @@ int LogReplicator::DelReplicateNode(const std::string& endpoint) {
         PDLOG(INFO, "delete replica. endpoint[%s] tid[%u] pid[%u]", endpoint.c_str(), tid_, pid_);
     }
     if (node) {
-        node->Stop();
+        StopNode(node);
     }
     return 0;
 }
@@ -425,35 +596,125 @@ bool LogReplicator::DelAllReplicateNode() {
     for (; it != copied_nodes.end(); ++it) {
         DEBUGLOG("stop replicator node");
         std::shared_ptr<ReplicateNode> node = *it;
-        node->Stop();
+        StopNode(node);
     }
     return true;
 }
 
+int LogReplicator::StartNode(const std::shared_ptr<ReplicateNode>& node) {
+    if (transport_ != NULL) {
+        return transport_->AddNode(node);
+    }
+    return node->Start();
+}
+
+void LogReplicator::StopNode(const std::shared_ptr<ReplicateNode>& node) {
+    if (transport_ != NULL) {
+        transport_->DelNode(node.get());
+    }
+    node->Stop();
+}
+
 bool LogReplicator::AppendEntry(LogEntry& entry) {
-    std::lock_guard<std::mutex> lock(wmu_);
-    if (wh_ == NULL || wh_->GetSize() / (1024 * 1024) > (uint32_t)FLAGS_binlog_single_file_max_size) {
-        bool ok = RollWLogFile();
-        if (!ok) {
-            return false;
+    writer_users_.fetch_add(1, std::memory_order_seq_cst);
+    if (writer_running_.load(std::memory_order_seq_cst)) {
+        CommitRequest request(&entry);
+        commit_queue_.Push(&request);
+        writer_users_.fetch_sub(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (writer_waiting_.load(std::memory_order_relaxed)) {
+            std::lock_guard<bthread::Mutex> lock(writer_mu_);
+            writer_cv_.notify_one();
         }
+        request.done.wait();
+        return request.ok;
+    }
+    writer_users_.fetch_sub(1, std::memory_order_relaxed);
+    LogEntry* entries[] = {&entry};
+    std::lock_guard<std::mutex> lock(wmu_);
+    return WriteEntries(entries, 1) == 1;
+}
+
+uint32_t LogReplicator::BatchAppendEntry(std::vector<LogEntry>* entries) {
+    if (entries == NULL || entries->empty()) {
+        return 0;
     }
-    uint64_t cur_offset = log_offset_.load(std::memory_order_relaxed);
-    entry.set_log_index(1 + cur_offset);
+    std::vector<LogEntry*> ptrs;
+    ptrs.reserve(entries->size());
+    for (auto& entry : *entries) {
+        ptrs.push_back(&entry);
+    }
+    std::lock_guard<std::mutex> lock(wmu_);
+    return WriteEntries(ptrs.data(), ptrs.size());
+}
+
+uint32_t LogReplicator::WriteEntries(LogEntry* const* entries, uint32_t cnt) {
+    if (wh_failed_) {
+        PDLOG(WARNING, "binlog writer failed before, reject %u entries. tid %u pid %u", cnt, tid_, pid_);
+        return 0;
+    }
+    uint64_t start_offset = log_offset_.load(std::memory_order_relaxed);
+    uint64_t cur_offset = start_offset;
+    uint32_t written = 0;
+    // the entries in the binlog parts closed by rolling
+    uint32_t rolled = 0;
     std::string buffer;
-    entry.SerializeToString(&buffer);
-    ::openmldb::base::Slice slice(buffer);
-    ::openmldb::log::Status status = wh_->Write(slice);
-    if (!status.ok()) {
-        PDLOG(WARNING, "fail to write replication log in dir %s for %s", path_.c_str(), status.ToString().c_str());
-        return false;
+    for (; written < cnt; written++) {
+        if (wh_ == NULL || wh_->GetSize() / (1024 * 1024) > (uint32_t)FLAGS_binlog_single_file_max_size) {
+            if (wh_ != NULL && FLAGS_binlog_sync_on_commit) {
+                wh_->Sync();
+            }
+            // the new binlog part must start from the entries written so far
+            log_offset_.store(cur_offset, std::memory_order_relaxed);
+            rolled = written;
+            if (!RollWLogFile()) {
+                break;
+            }
+        }
+        // the records are flushed to the file once for the whole group
+        wh_->SetAutoFlush(false);
+        LogEntry* entry = entries[written];
+        entry->set_log_index(1 + cur_offset);
+        buffer.clear();
+        entry->SerializeToString(&buffer);
+        ::openmldb::base::Slice slice(buffer);
+        ::openmldb::log::Status status = wh_->Write(slice);
+        if (!status.ok()) {
+            PDLOG(WARNING, "fail to write replication log in dir %s for %s", path_.c_str(),
+                  status.ToString().c_str());
+            break;
+        }
+        if (tail_cache_) {
+            tail_cache_->Append(cur_offset + 1, slice);
+        }
+        cur_offset++;
     }
-    log_offset_.fetch_add(1, std::memory_order_relaxed);
-    if (local_endpoints_.empty()) {  // if local replica are dead, leader direct
-                                     // sync to remote replica
-        follower_offset_.store(cur_offset + 1, std::memory_order_relaxed);
+    if (wh_ != NULL) {
+        ::openmldb::log::Status status = wh_->Flush();
+        if (status.ok() && FLAGS_binlog_sync_on_commit) {
+            status = wh_->Sync();
+        }
+        wh_->SetAutoFlush(true);
+        if (!status.ok()) {
+            // the unflushed records may be partly in the file, so their log indexes can not be given to other
+            // entries. keep the offset before them and reject the later writes
+            PDLOG(WARNING, "fail to flush replication log in dir %s for %s, stop writing binlog", path_.c_str(),
+                  status.ToString().c_str());
+            wh_failed_ = true;
+            if (tail_cache_) {
+                tail_cache_->Clear();
+            }
+            cur_offset = log_offset_.load(std::memory_order_relaxed);
+            written = rolled;
+        }
     }
-    return true;
+    // the entries are visible to the followers only after they are flushed
+    log_offset_.store(cur_offset, std::memory_order_relaxed);
+    if (cur_offset > start_offset && local_endpoints_.empty()) {  // if local replica are dead, leader direct
+                                                                  // sync to remote replica
+        follower_offset_.store(cur_offset, std::memory_order_relaxed);
+    }
+    return written;
 }
 
 bool LogReplicator::RollWLogFile() {
@@ -479,7 +740,12 @@ bool LogReplicator::RollWLogFile() {
     return true;
 }
 
-void LogReplicator::Notify() { cv_.notify_all(); }
+void LogReplicator::Notify() {
+    cv_.notify_all();
+    if (transport_ != NULL) {
+        transport_->Notify();
+    }
+}
 
 }  // namespace replica
 }  // namespace openmldb
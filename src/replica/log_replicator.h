@@ -25,15 +25,19 @@
 #include <string>
 #include <vector>
 
+#include "base/mpsc_queue.h"
 #include "base/skiplist.h"
 #include "bthread/bthread.h"
 #include "bthread/condition_variable.h"
+#include "bthread/countdown_event.h"
 #include "common/thread_pool.h"
 #include "log/log_reader.h"
 #include "log/log_writer.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "replica/binlog_tail_cache.h"
 #include "replica/replicate_node.h"
+#include "replica/replicate_transport.h"
 #include "storage/table.h"
 
 namespace openmldb {
@@ -56,6 +60,9 @@ class LogReplicator {
 
     ~LogReplicator();
 
+    // sync the replicate nodes with the shared transport instead of their own threads, it must be set before Init
+    void SetTransport(ReplicateTransport* transport) { transport_ = transport; }
+
     bool Init();
 
     bool StartSyncing();
@@ -63,9 +70,23 @@ class LogReplicator {
     // the slave node receives master log entries
     bool ApplyEntry(const ::openmldb::api::LogEntry& entry);
 
-    // the master node append entry
+    // the slave node receives a raw binlog record of the entry with log_index, it is written verbatim
+    bool ApplyEntry(uint64_t log_index, const ::openmldb::base::Slice& record);
+
+    // split the attachment of an AppendEntriesRequest with record_size into the raw binlog records,
+    // the records point into buffer
+    static bool SplitRawRecords(const ::openmldb::api::AppendEntriesRequest& request, const butil::IOBuf& attachment,
+                                std::string* buffer, std::vector<::openmldb::base::Slice>* records);
+
+    // the master node append entry, it is handed to the log writer and waits for
+    // the group it is written with if binlog_group_commit is enabled
     bool AppendEntry(::openmldb::api::LogEntry& entry);  // NOLINT
 
+    // the master node append a group of entries with one lock acquisition,
+    // the log index of every entry is assigned in order. it stops at the first
+    // failure and returns the count of the entries appended
+    uint32_t BatchAppendEntry(std::vector<::openmldb::api::LogEntry>* entries);
+
     //  data to slave nodes
     void Notify();
     // recover logs meta
@@ -94,6 +115,9 @@ class LogReplicator {
 
     uint64_t GetOffset();
 
+    // wait until the offset reaches offset, return false on timeout
+    bool WaitOffset(uint64_t offset, uint32_t timeout_ms);
+
     LogParts* GetLogPart();
 
     inline uint64_t GetLogOffset() { return log_offset_.load(std::memory_order_relaxed); }
@@ -108,9 +132,35 @@ class LogReplicator {
 
     bool DelAllReplicateNode();
 
+    // the loop of the log writer, it writes the queued entries in groups
+    void RunLogWriter();
+
  private:
+    // an entry queued for the log writer
+    struct CommitRequest {
+        explicit CommitRequest(LogEntry* e) : entry(e), ok(false), done() {}
+        LogEntry* entry;
+        bool ok;
+        bthread::CountdownEvent done;
+    };
+
     bool OpenSeqFile(const std::string& path, SequentialFile** sf);
 
+    // wake up the WaitOffset callers after log_offset_ goes forward
+    void NotifyOffset();
+
+    int StartNode(const std::shared_ptr<ReplicateNode>& node);
+
+    void StopNode(const std::shared_ptr<ReplicateNode>& node);
+
+    // write the entries with one flush and assign their log index in order, wmu_ must be held.
+    // return the number of entries written, the ones after a failure are not written
+    uint32_t WriteEntries(LogEntry* const* entries, uint32_t cnt);
+
+    void StartLogWriter();
+
+    void StopLogWriter();
+
  private:
     // the replicator root data path
     uint32_t tid_;
@@ -123,6 +173,8 @@ class LogReplicator {
     std::atomic<uint32_t> binlog_index_;
     LogParts* logs_;
     WriteHandle* wh_;
+    // set if a flush of wh_ fails, WriteEntries rejects the entries then. guarded by wmu_
+    bool wh_failed_;
     ReplicatorRole role_;
     std::map<std::string, std::string> real_ep_map_;
     std::vector<std::shared_ptr<ReplicateNode> > nodes_;
@@ -137,6 +189,22 @@ class LogReplicator {
     std::atomic<uint64_t> snapshot_last_offset_;
 
     std::mutex wmu_;
+    // WaitOffset waits on offset_cv_ for the entries applied by the other AppendEntries
+    bthread::Mutex offset_mu_;
+    bthread::ConditionVariable offset_cv_;
+    std::atomic<uint32_t> offset_waiter_cnt_;
+    // the recent records appended by the leader, null if binlog_tail_cache_size is 0
+    std::unique_ptr<BinlogTailCache> tail_cache_;
+    ReplicateTransport* transport_;
+    // group commit, the writer is started only if binlog_group_commit is enabled
+    ::openmldb::base::MPSCQueue<CommitRequest*> commit_queue_;
+    std::atomic<bool> writer_running_;
+    std::atomic<bool> writer_waiting_;
+    // the AppendEntry callers between checking writer_running_ and queueing the entry
+    std::atomic<uint32_t> writer_users_;
+    bthread::Mutex writer_mu_;
+    bthread::ConditionVariable writer_cv_;
+    bthread_t writer_tid_;
 };
 
 }  // namespace replica
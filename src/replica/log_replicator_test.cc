@@ -17,6 +17,7 @@
 #include "replica/log_replicator.h"
 
 #include <brpc/server.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <sched.h>
 #include <stdio.h>
@@ -24,6 +25,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <set>
+#include <thread>  // NOLINT
 #include <utility>
 
 #include "base/glog_wapper.h"
@@ -46,6 +49,13 @@ using ::openmldb::storage::Table;
 using ::openmldb::storage::TableIterator;
 using ::openmldb::storage::Ticket;
 
+DECLARE_bool(binlog_sync_raw_record);
+DECLARE_uint32(binlog_tail_cache_size);
+DECLARE_uint32(binlog_sync_max_inflight);
+DECLARE_int32(binlog_sync_batch_size);
+DECLARE_bool(binlog_group_commit);
+DECLARE_bool(binlog_sync_on_commit);
+
 namespace openmldb {
 namespace replica {
 
@@ -82,13 +92,65 @@ class MockTabletImpl : public ::openmldb::api::TabletServer {
 
     void AppendEntries(RpcController* controller, const ::openmldb::api::AppendEntriesRequest* request,
                        ::openmldb::api::AppendEntriesResponse* response, Closure* done) {
+        Append(*request, static_cast<brpc::Controller*>(controller)->request_attachment(), response);
+        done->Run();
+        replicator_.Notify();
+    }
+
+    void BatchAppendEntries(RpcController* controller, const ::openmldb::api::BatchAppendEntriesRequest* request,
+                            ::openmldb::api::BatchAppendEntriesResponse* response, Closure* done) {
+        if (!batch_supported_) {
+            // a tablet of an older version
+            static_cast<brpc::Controller*>(controller)->SetFailed(brpc::ENOMETHOD, "method not found");
+            done->Run();
+            return;
+        }
+        butil::IOBuf attachment = static_cast<brpc::Controller*>(controller)->request_attachment();
+        butil::IOBuf sub_attachment;
+        for (const auto& sub_request : request->requests()) {
+            uint64_t size = 0;
+            for (auto record_size : sub_request.record_size()) {
+                size += record_size;
+            }
+            sub_attachment.clear();
+            attachment.cutn(&sub_attachment, size);
+            Append(sub_request, sub_attachment, response->add_responses());
+        }
+        response->set_code(::openmldb::base::ReturnCode::kOk);
+        done->Run();
+        replicator_.Notify();
+    }
+
+    void Append(const ::openmldb::api::AppendEntriesRequest& request, const butil::IOBuf& attachment,
+                ::openmldb::api::AppendEntriesResponse* response) {
+        if (request.pre_log_index() > replicator_.GetOffset() &&
+            !replicator_.WaitOffset(request.pre_log_index(), 1000)) {
+            response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+            response->set_msg("fail to append entries to replicator");
+            return;
+        }
         uint64_t last_log_offset = replicator_.GetOffset();
-        for (int32_t i = 0; i < request->entries_size(); i++) {
-            if (request->entries(i).log_index() <= last_log_offset) {
+        bool raw_record = request.record_size_size() > 0;
+        std::string raw_buffer;
+        std::vector<::openmldb::base::Slice> raw_records;
+        if (raw_record && !LogReplicator::SplitRawRecords(request, attachment, &raw_buffer, &raw_records)) {
+            response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+            response->set_msg("fail to append entries to replicator");
+            return;
+        }
+        int32_t entry_cnt = raw_record ? raw_records.size() : request.entries_size();
+        ::openmldb::api::LogEntry raw_entry;
+        for (int32_t i = 0; i < entry_cnt; i++) {
+            if (raw_record) {
+                raw_entry.ParseFromArray(raw_records[i].data(), raw_records[i].size());
+            }
+            const auto& entry = raw_record ? raw_entry : request.entries(i);
+            if (entry.log_index() <= last_log_offset) {
                 continue;
             }
-            const auto& entry = request->entries(i);
-            if (!replicator_.ApplyEntry(entry)) {
+            bool ok = raw_record ? replicator_.ApplyEntry(entry.log_index(), raw_records[i])
+                                 : replicator_.ApplyEntry(entry);
+            if (!ok) {
                 response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
                 response->set_msg("fail to append entries to replicator");
                 return;
@@ -96,14 +158,14 @@ class MockTabletImpl : public ::openmldb::api::TabletServer {
             table_->Put(entry);
         }
         response->set_log_offset(replicator_.GetOffset());
-        done->Run();
-        replicator_.Notify();
     }
 
     void SetMode(bool follower) { follower_.store(follower); }
 
     bool GetMode() { return follower_.load(std::memory_order_relaxed); }
 
+    void SetBatchSupported(bool supported) { batch_supported_ = supported; }
+
  private:
     std::shared_ptr<Table> table_;
     ReplicatorRole role_;
@@ -111,6 +173,7 @@ class MockTabletImpl : public ::openmldb::api::TabletServer {
     std::map<std::string, std::string> real_ep_map_;
     LogReplicator replicator_;
     std::atomic<bool> follower_;
+    bool batch_supported_ = true;
 };
 
 bool ReceiveEntry(const ::openmldb::api::LogEntry& entry) { return true; }
@@ -656,6 +719,235 @@ TEST_F(LogReplicatorTest, Leader_Remove_local_follower) {
     }
 }
 
+TEST_F(LogReplicatorTest, LeaderAndFollowerRawRecord) {
+    FLAGS_binlog_sync_raw_record = true;
+    brpc::ServerOptions options;
+    brpc::Server server0;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx", 0));
+    std::shared_ptr<MemTable> t7 =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    t7->Init();
+    std::string follower_folder = "/tmp/" + GenRand() + "/";
+    MockTabletImpl* follower = new MockTabletImpl(kFollowerNode, follower_folder, g_endpoints, t7);
+    ASSERT_TRUE(follower->Init());
+    ASSERT_EQ(0, server0.AddService(follower, brpc::SERVER_OWNS_SERVICE));
+    ASSERT_EQ(0, server0.Start("127.0.0.1:16527", &options));
+
+    std::string folder = "/tmp/" + GenRand() + "/";
+    // the records are read from the tail cache
+    FLAGS_binlog_tail_cache_size = 1;
+    LogReplicator leader(1, 1, folder, g_endpoints, kLeaderNode);
+    FLAGS_binlog_tail_cache_size = 0;
+    ASSERT_TRUE(leader.Init());
+    std::map<std::string, std::string> map;
+    map.insert(std::make_pair("127.0.0.1:16527", ""));
+    ASSERT_EQ(0, leader.AddReplicateNode(map));
+    ::openmldb::api::LogEntry entry;
+    ::openmldb::test::AddDimension(0, "test_pk", &entry);
+    entry.set_value(::openmldb::test::EncodeKV("test_pk", "value1"));
+    entry.set_ts(9527);
+    ASSERT_TRUE(leader.AppendEntry(entry));
+    entry.set_value(::openmldb::test::EncodeKV("test_pk", "value2"));
+    entry.set_ts(9526);
+    ASSERT_TRUE(leader.AppendEntry(entry));
+    leader.Notify();
+    sleep(2);
+    leader.DelAllReplicateNode();
+    FLAGS_binlog_sync_raw_record = false;
+    ASSERT_EQ(2, (signed)t7->GetRecordCnt());
+    Ticket ticket;
+    TableIterator* it = t7->NewIterator("test_pk", ticket);
+    it->Seek(9527);
+    ASSERT_TRUE(it->Valid());
+    ::openmldb::base::Slice value = it->GetValue();
+    ASSERT_EQ("value1", ::openmldb::test::DecodeV(std::string(value.data(), value.size())));
+    it->Next();
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ(9526, (signed)it->GetKey());
+    delete it;
+}
+
+TEST_F(LogReplicatorTest, LeaderAndFollowerPipelined) {
+    brpc::ServerOptions options;
+    brpc::Server server0;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx", 0));
+    std::shared_ptr<MemTable> t7 =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    t7->Init();
+    std::string follower_folder = "/tmp/" + GenRand() + "/";
+    MockTabletImpl* follower = new MockTabletImpl(kFollowerNode, follower_folder, g_endpoints, t7);
+    ASSERT_TRUE(follower->Init());
+    ASSERT_EQ(0, server0.AddService(follower, brpc::SERVER_OWNS_SERVICE));
+    ASSERT_EQ(0, server0.Start("127.0.0.1:16528", &options));
+
+    std::string folder = "/tmp/" + GenRand() + "/";
+    LogReplicator leader(1, 1, folder, g_endpoints, kLeaderNode);
+    ASSERT_TRUE(leader.Init());
+    // small batches so that several of them are in flight
+    FLAGS_binlog_sync_max_inflight = 4;
+    FLAGS_binlog_sync_batch_size = 3;
+    std::map<std::string, std::string> map;
+    map.insert(std::make_pair("127.0.0.1:16528", ""));
+    ASSERT_EQ(0, leader.AddReplicateNode(map));
+    FLAGS_binlog_sync_max_inflight = 1;
+    ::openmldb::api::LogEntry entry;
+    ::openmldb::test::AddDimension(0, "test_pk", &entry);
+    for (int i = 0; i < 50; i++) {
+        entry.set_value(::openmldb::test::EncodeKV("test_pk", "value" + std::to_string(i)));
+        entry.set_ts(9000 + i);
+        ASSERT_TRUE(leader.AppendEntry(entry));
+        leader.Notify();
+    }
+    sleep(3);
+    leader.DelAllReplicateNode();
+    FLAGS_binlog_sync_batch_size = 32;
+    ASSERT_EQ(50, (signed)t7->GetRecordCnt());
+    Ticket ticket;
+    TableIterator* it = t7->NewIterator("test_pk", ticket);
+    it->SeekToFirst();
+    for (int i = 49; i >= 0; i--) {
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(9000 + i, (signed)it->GetKey());
+        it->Next();
+    }
+    delete it;
+}
+
+TEST_F(LogReplicatorTest, LeaderAndFollowerTransport) {
+    brpc::ServerOptions options;
+    brpc::Server server0;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx", 0));
+    std::shared_ptr<MemTable> t7 =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    t7->Init();
+    std::string follower_folder = "/tmp/" + GenRand() + "/";
+    MockTabletImpl* follower = new MockTabletImpl(kFollowerNode, follower_folder, g_endpoints, t7);
+    ASSERT_TRUE(follower->Init());
+    ASSERT_EQ(0, server0.AddService(follower, brpc::SERVER_OWNS_SERVICE));
+    ASSERT_EQ(0, server0.Start("127.0.0.1:16529", &options));
+
+    ReplicateTransport transport(2);
+    ASSERT_EQ(0, transport.Start());
+    std::string folder = "/tmp/" + GenRand() + "/";
+    LogReplicator leader(1, 1, folder, g_endpoints, kLeaderNode);
+    leader.SetTransport(&transport);
+    ASSERT_TRUE(leader.Init());
+    std::map<std::string, std::string> map;
+    map.insert(std::make_pair("127.0.0.1:16529", ""));
+    ASSERT_EQ(0, leader.AddReplicateNode(map));
+    ::openmldb::api::LogEntry entry;
+    ::openmldb::test::AddDimension(0, "test_pk", &entry);
+    for (int i = 0; i < 10; i++) {
+        entry.set_value(::openmldb::test::EncodeKV("test_pk", "value" + std::to_string(i)));
+        entry.set_ts(9000 + i);
+        ASSERT_TRUE(leader.AppendEntry(entry));
+        leader.Notify();
+    }
+    sleep(2);
+    leader.DelAllReplicateNode();
+    transport.Stop();
+    ASSERT_EQ(10, (signed)t7->GetRecordCnt());
+}
+
+TEST_F(LogReplicatorTest, LeaderAndFollowerTransportFallback) {
+    brpc::ServerOptions options;
+    brpc::Server server0;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx", 0));
+    std::shared_ptr<MemTable> t9 =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    t9->Init();
+    std::string follower_folder = "/tmp/" + GenRand() + "/";
+    MockTabletImpl* follower = new MockTabletImpl(kFollowerNode, follower_folder, g_endpoints, t9);
+    ASSERT_TRUE(follower->Init());
+    follower->SetBatchSupported(false);
+    ASSERT_EQ(0, server0.AddService(follower, brpc::SERVER_OWNS_SERVICE));
+    ASSERT_EQ(0, server0.Start("127.0.0.1:16531", &options));
+
+    ReplicateTransport transport(2);
+    ASSERT_EQ(0, transport.Start());
+    std::string folder = "/tmp/" + GenRand() + "/";
+    LogReplicator leader(1, 1, folder, g_endpoints, kLeaderNode);
+    leader.SetTransport(&transport);
+    ASSERT_TRUE(leader.Init());
+    std::map<std::string, std::string> map;
+    map.insert(std::make_pair("127.0.0.1:16531", ""));
+    ASSERT_EQ(0, leader.AddReplicateNode(map));
+    ::openmldb::api::LogEntry entry;
+    ::openmldb::test::AddDimension(0, "test_pk", &entry);
+    for (int i = 0; i < 10; i++) {
+        entry.set_value(::openmldb::test::EncodeKV("test_pk", "value" + std::to_string(i)));
+        entry.set_ts(9000 + i);
+        ASSERT_TRUE(leader.AppendEntry(entry));
+        leader.Notify();
+    }
+    // the records are resent with AppendEntries after BatchAppendEntries is not found
+    sleep(4);
+    leader.DelAllReplicateNode();
+    transport.Stop();
+    ASSERT_EQ(10, (signed)t9->GetRecordCnt());
+}
+
+TEST_F(LogReplicatorTest, LeaderAndFollowerGroupCommit) {
+    brpc::ServerOptions options;
+    brpc::Server server0;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx", 0));
+    std::shared_ptr<MemTable> t8 =
+        std::make_shared<MemTable>("test", 1, 1, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    t8->Init();
+    std::string follower_folder = "/tmp/" + GenRand() + "/";
+    MockTabletImpl* follower = new MockTabletImpl(kFollowerNode, follower_folder, g_endpoints, t8);
+    ASSERT_TRUE(follower->Init());
+    ASSERT_EQ(0, server0.AddService(follower, brpc::SERVER_OWNS_SERVICE));
+    ASSERT_EQ(0, server0.Start("127.0.0.1:16530", &options));
+
+    FLAGS_binlog_group_commit = true;
+    FLAGS_binlog_sync_on_commit = true;
+    std::string folder = "/tmp/" + GenRand() + "/";
+    LogReplicator leader(1, 1, folder, g_endpoints, kLeaderNode);
+    ASSERT_TRUE(leader.Init());
+    std::map<std::string, std::string> map;
+    map.insert(std::make_pair("127.0.0.1:16530", ""));
+    ASSERT_EQ(0, leader.AddReplicateNode(map));
+    const int thread_num = 4;
+    const int entry_cnt = 50;
+    std::mutex mu;
+    std::set<uint64_t> log_indexes;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_num; i++) {
+        threads.emplace_back([&, i] {
+            ::openmldb::api::LogEntry entry;
+            ::openmldb::test::AddDimension(0, "test_pk", &entry);
+            for (int j = 0; j < entry_cnt; j++) {
+                entry.set_value(::openmldb::test::EncodeKV("test_pk", "value" + std::to_string(j)));
+                entry.set_ts(9000 + i * entry_cnt + j);
+                if (leader.AppendEntry(entry)) {
+                    std::lock_guard<std::mutex> lock(mu);
+                    log_indexes.insert(entry.log_index());
+                }
+                leader.Notify();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // every entry gets its own log index in the order of the binlog
+    ASSERT_EQ(thread_num * entry_cnt, (signed)log_indexes.size());
+    ASSERT_EQ(1u, *log_indexes.begin());
+    ASSERT_EQ((uint64_t)thread_num * entry_cnt, *log_indexes.rbegin());
+    ASSERT_EQ((uint64_t)thread_num * entry_cnt, leader.GetLogOffset());
+    sleep(2);
+    leader.DelAllReplicateNode();
+    FLAGS_binlog_group_commit = false;
+    FLAGS_binlog_sync_on_commit = false;
+    ASSERT_EQ(thread_num * entry_cnt, (signed)t8->GetRecordCnt());
+}
+
 }  // namespace replica
 }  // namespace openmldb
 
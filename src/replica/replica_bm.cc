@@ -0,0 +1,323 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <brpc/server.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/file_util.h"
+#include "benchmark/benchmark.h"
+#include "common/timer.h"
+#include "gflags/gflags.h"
+#include "proto/tablet.pb.h"
+#include "replica/log_replicator.h"
+#include "replica/replicate_transport.h"
+
+DECLARE_uint32(binlog_sync_max_inflight);
+DECLARE_bool(binlog_group_commit);
+DECLARE_bool(binlog_sync_on_commit);
+
+namespace openmldb {
+namespace replica {
+
+// a follower that stands for a remote rack, every AppendEntries takes delay_us before it is applied.
+// it holds the binlog of partition 0 to partition_num - 1
+class DelayedFollower : public ::openmldb::api::TabletServer {
+ public:
+    DelayedFollower(const std::string& path, uint32_t partition_num, uint64_t delay_us,
+                    const std::vector<std::vector<uint64_t>>* append_us)
+        : path_(path), delay_us_(delay_us), append_us_(append_us), rpc_cnt_(0) {
+        for (uint32_t pid = 0; pid < partition_num; pid++) {
+            replicators_.emplace_back(new LogReplicator(1, pid, path_ + "/" + std::to_string(pid),
+                                                        std::map<std::string, std::string>(), kFollowerNode));
+        }
+    }
+
+    bool Init() {
+        for (auto& replicator : replicators_) {
+            if (!replicator->Init()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void AppendEntries(google::protobuf::RpcController* controller,
+                       const ::openmldb::api::AppendEntriesRequest* request,
+                       ::openmldb::api::AppendEntriesResponse* response, google::protobuf::Closure* done) override {
+        brpc::ClosureGuard done_guard(done);
+        rpc_cnt_.fetch_add(1, std::memory_order_relaxed);
+        bthread_usleep(delay_us_);
+        Apply(*request, response);
+    }
+
+    void BatchAppendEntries(google::protobuf::RpcController* controller,
+                            const ::openmldb::api::BatchAppendEntriesRequest* request,
+                            ::openmldb::api::BatchAppendEntriesResponse* response,
+                            google::protobuf::Closure* done) override {
+        brpc::ClosureGuard done_guard(done);
+        rpc_cnt_.fetch_add(1, std::memory_order_relaxed);
+        bthread_usleep(delay_us_);
+        for (const auto& sub_request : request->requests()) {
+            Apply(sub_request, response->add_responses());
+        }
+        response->set_code(::openmldb::base::ReturnCode::kOk);
+    }
+
+    uint64_t GetOffset(uint32_t pid) { return replicators_[pid]->GetOffset(); }
+
+    uint64_t GetRpcCount() { return rpc_cnt_.load(std::memory_order_relaxed); }
+
+    std::vector<uint64_t> GetLag() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return lag_us_;
+    }
+
+ private:
+    void Apply(const ::openmldb::api::AppendEntriesRequest& request,
+               ::openmldb::api::AppendEntriesResponse* response) {
+        LogReplicator* replicator = replicators_[request.pid()].get();
+        response->set_code(::openmldb::base::ReturnCode::kOk);
+        if (request.pre_log_index() == 0 && request.entries_size() == 0) {
+            response->set_log_offset(replicator->GetOffset());
+            return;
+        }
+        if (request.pre_log_index() > replicator->GetOffset() &&
+            !replicator->WaitOffset(request.pre_log_index(), 1000)) {
+            response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+            return;
+        }
+        uint64_t now = ::baidu::common::timer::get_micros();
+        for (const auto& entry : request.entries()) {
+            if (entry.log_index() <= replicator->GetOffset()) {
+                continue;
+            }
+            if (!replicator->ApplyEntry(entry)) {
+                response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mu_);
+            lag_us_.push_back(now - (*append_us_)[request.pid()][entry.log_index()]);
+        }
+        response->set_log_offset(replicator->GetOffset());
+    }
+
+    std::string path_;
+    std::vector<std::unique_ptr<LogReplicator>> replicators_;
+    uint64_t delay_us_;
+    const std::vector<std::vector<uint64_t>>* append_us_;
+    std::atomic<uint64_t> rpc_cnt_;
+    std::mutex mu_;
+    std::vector<uint64_t> lag_us_;
+};
+
+static uint64_t GetCpuMicros() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_sec * 1000000 +
+           usage.ru_stime.tv_usec;
+}
+
+// replicate entry_cnt entries of each of partition_num partitions to a follower behind a link of rtt_us.
+// inflight is binlog_sync_max_inflight, and worker_num is binlog_sync_worker_num
+static void ReplicatePartitions(benchmark::State& state, uint64_t rtt_us, uint32_t partition_num,
+                                uint64_t entry_cnt, uint32_t inflight, uint32_t worker_num) {
+    static int port = 19600;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::string folder = "/tmp/replica_bm/" + std::to_string(::baidu::common::timer::get_micros()) + "/";
+        std::vector<std::vector<uint64_t>> append_us(partition_num, std::vector<uint64_t>(entry_cnt + 1, 0));
+        std::string endpoint = "127.0.0.1:" + std::to_string(port++);
+        auto* follower = new DelayedFollower(folder + "follower", partition_num, rtt_us, &append_us);
+        follower->Init();
+        brpc::Server server;
+        brpc::ServerOptions options;
+        server.AddService(follower, brpc::SERVER_OWNS_SERVICE);
+        server.Start(endpoint.c_str(), &options);
+        std::unique_ptr<ReplicateTransport> transport;
+        if (worker_num > 0) {
+            transport.reset(new ReplicateTransport(worker_num));
+            transport->Start();
+        }
+        uint32_t max_inflight = FLAGS_binlog_sync_max_inflight;
+        FLAGS_binlog_sync_max_inflight = inflight;
+        std::vector<std::unique_ptr<LogReplicator>> leaders;
+        std::map<std::string, std::string> map;
+        map.insert(std::make_pair(endpoint, ""));
+        for (uint32_t pid = 0; pid < partition_num; pid++) {
+            leaders.emplace_back(new LogReplicator(1, pid, folder + "leader/" + std::to_string(pid),
+                                                   std::map<std::string, std::string>(), kLeaderNode));
+            leaders.back()->SetTransport(transport.get());
+            leaders.back()->Init();
+            leaders.back()->AddReplicateNode(map);
+        }
+        FLAGS_binlog_sync_max_inflight = max_inflight;
+        // wait for the log offset matched
+        sleep(1);
+        ::openmldb::api::LogEntry entry;
+        entry.set_pk("key");
+        entry.set_value(std::string(128, 'v'));
+        uint64_t rpc_cnt = follower->GetRpcCount();
+        uint64_t cpu_us = GetCpuMicros();
+        state.ResumeTiming();
+        uint64_t start = ::baidu::common::timer::get_micros();
+        for (uint64_t i = 1; i <= entry_cnt; i++) {
+            for (uint32_t pid = 0; pid < partition_num; pid++) {
+                append_us[pid][i] = ::baidu::common::timer::get_micros();
+                entry.set_ts(i);
+                leaders[pid]->AppendEntry(entry);
+                leaders[pid]->Notify();
+            }
+        }
+        for (uint32_t pid = 0; pid < partition_num; pid++) {
+            while (follower->GetOffset(pid) < entry_cnt) {
+                bthread_usleep(100);
+            }
+        }
+        uint64_t used_us = ::baidu::common::timer::get_micros() - start;
+        state.PauseTiming();
+        state.counters["entries_per_s"] = partition_num * entry_cnt * 1000000.0 / used_us;
+        state.counters["rpc_cnt"] = follower->GetRpcCount() - rpc_cnt;
+        state.counters["cpu_ms"] = (GetCpuMicros() - cpu_us) / 1000.0;
+        std::vector<uint64_t> lag = follower->GetLag();
+        if (!lag.empty()) {
+            std::sort(lag.begin(), lag.end());
+            state.counters["lag_p50_us"] = lag[lag.size() / 2];
+            state.counters["lag_p99_us"] = lag[lag.size() * 99 / 100];
+        }
+        for (auto& leader : leaders) {
+            leader->DelAllReplicateNode();
+        }
+        leaders.clear();
+        if (transport) {
+            transport->Stop();
+        }
+        server.Stop(0);
+        server.Join();
+        ::openmldb::base::RemoveDirRecursive(folder);
+        state.ResumeTiming();
+    }
+}
+
+static void BM_Replicate(benchmark::State& state) {  // NOLINT
+    ReplicatePartitions(state, state.range(0), 1, 20000, state.range(1), 0);
+}
+
+static void BM_ReplicateStream(benchmark::State& state) {  // NOLINT
+    ReplicatePartitions(state, 1000, state.range(0), 20, 1, state.range(1));
+}
+
+// thread_num request threads put into one partition, every entry is synced to disk before it returns
+// if sync_on_commit is set
+static void BM_AppendEntry(benchmark::State& state) {  // NOLINT
+    uint32_t thread_num = state.range(0);
+    bool group_commit = FLAGS_binlog_group_commit;
+    bool sync_on_commit = FLAGS_binlog_sync_on_commit;
+    FLAGS_binlog_group_commit = state.range(1);
+    FLAGS_binlog_sync_on_commit = state.range(2);
+    const uint64_t entry_cnt = 2000;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::string folder = "/tmp/replica_bm/" + std::to_string(::baidu::common::timer::get_micros()) + "/";
+        auto leader = std::make_shared<LogReplicator>(1, 1, folder, std::map<std::string, std::string>(),
+                                                      kLeaderNode);
+        leader->Init();
+        std::vector<std::vector<uint64_t>> latency_us(thread_num);
+        state.ResumeTiming();
+        uint64_t start = ::baidu::common::timer::get_micros();
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < thread_num; i++) {
+            threads.emplace_back([&leader, &latency_us, i, entry_cnt] {
+                ::openmldb::api::LogEntry entry;
+                entry.set_pk("key" + std::to_string(i));
+                entry.set_value(std::string(128, 'v'));
+                for (uint64_t j = 0; j < entry_cnt; j++) {
+                    entry.set_ts(j);
+                    uint64_t begin = ::baidu::common::timer::get_micros();
+                    leader->AppendEntry(entry);
+                    latency_us[i].push_back(::baidu::common::timer::get_micros() - begin);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        uint64_t used_us = ::baidu::common::timer::get_micros() - start;
+        state.PauseTiming();
+        std::vector<uint64_t> latency;
+        for (const auto& cur : latency_us) {
+            latency.insert(latency.end(), cur.begin(), cur.end());
+        }
+        std::sort(latency.begin(), latency.end());
+        state.counters["entries_per_s"] = thread_num * entry_cnt * 1000000.0 / used_us;
+        state.counters["latency_p50_us"] = latency[latency.size() / 2];
+        state.counters["latency_p99_us"] = latency[latency.size() * 99 / 100];
+        leader.reset();
+        ::openmldb::base::RemoveDirRecursive(folder);
+        state.ResumeTiming();
+    }
+    FLAGS_binlog_group_commit = group_commit;
+    FLAGS_binlog_sync_on_commit = sync_on_commit;
+}
+
+// rtt in us of the same rack and across racks, the batch size is binlog_sync_batch_size
+BENCHMARK(BM_Replicate)
+    ->ArgNames({"rtt_us", "inflight"})
+    ->Args({100, 1})
+    ->Args({100, 4})
+    ->Args({1000, 1})
+    ->Args({1000, 4})
+    ->Args({1000, 16})
+    ->Args({5000, 1})
+    ->Args({5000, 16})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+// many partitions replicated to one endpoint, each with its own sync thread (workers 0) or with shared streams
+BENCHMARK(BM_ReplicateStream)
+    ->ArgNames({"partitions", "workers"})
+    ->Args({100, 0})
+    ->Args({100, 4})
+    ->Args({1000, 0})
+    ->Args({1000, 4})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_AppendEntry)
+    ->ArgNames({"threads", "group_commit", "sync_on_commit"})
+    ->Args({1, 0, 0})
+    ->Args({16, 0, 0})
+    ->Args({16, 1, 0})
+    ->Args({1, 0, 1})
+    ->Args({16, 0, 1})
+    ->Args({16, 1, 1})
+    ->Iterations(1)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace replica
+}  // namespace openmldb
+
+BENCHMARK_MAIN();
@@ -17,13 +17,18 @@
 #include "replica/replicate_node.h"
 
 #include <gflags/gflags.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
 
 #include <algorithm>
+#include <memory>
 
 #include "base/glog_wapper.h"  // NOLINT
 #include "base/strings.h"
 
 DECLARE_int32(binlog_sync_batch_size);
+DECLARE_bool(binlog_sync_raw_record);
+DECLARE_uint32(binlog_sync_max_inflight);
 DECLARE_int32(binlog_sync_wait_time);
 DECLARE_int32(binlog_coffee_time);
 DECLARE_int32(binlog_match_logoffset_interval);
@@ -35,6 +40,47 @@ DECLARE_uint32(go_back_max_try_cnt);
 namespace openmldb {
 namespace replica {
 
+// read the log index of a serialized LogEntry without parsing the whole message
+static bool ParseLogIndex(const ::openmldb::base::Slice& record, uint64_t* log_index) {
+    using ::google::protobuf::internal::WireFormatLite;
+    ::google::protobuf::io::CodedInputStream input(reinterpret_cast<const uint8_t*>(record.data()), record.size());
+    uint32_t tag = 0;
+    while ((tag = input.ReadTag()) != 0) {
+        if (WireFormatLite::GetTagFieldNumber(tag) == ::openmldb::api::LogEntry::kLogIndexFieldNumber &&
+            WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_VARINT) {
+            return input.ReadVarint64(log_index);
+        }
+        if (!WireFormatLite::SkipField(&input, tag)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// the done of an async AppendEntries in pipelined replication
+class AppendEntriesClosure : public google::protobuf::Closure {
+ public:
+    AppendEntriesClosure(ReplicateNode* node, uint64_t end_offset) : node_(node), end_offset_(end_offset) {}
+
+    void Run() override {
+        node_->OnAppendEntriesDone(cntl_, response_, end_offset_);
+        delete this;
+    }
+
+    brpc::Controller* GetController() { return &cntl_; }
+
+    ::openmldb::api::AppendEntriesRequest* GetRequest() { return &request_; }
+
+    ::openmldb::api::AppendEntriesResponse* GetResponse() { return &response_; }
+
+ private:
+    ReplicateNode* node_;
+    uint64_t end_offset_;
+    brpc::Controller cntl_;
+    ::openmldb::api::AppendEntriesRequest request_;
+    ::openmldb::api::AppendEntriesResponse response_;
+};
+
 static void* RunSyncTask(void* args) {
     if (args == NULL) {
         PDLOG(WARNING, "input args is null");
@@ -49,10 +95,12 @@ static void* RunSyncTask(void* args) {
 ReplicateNode::ReplicateNode(const std::string& point, LogParts* logs, const std::string& log_path, uint32_t tid,
                              uint32_t pid, std::atomic<uint64_t>* term, std::atomic<uint64_t>* leader_log_offset,
                              bthread::Mutex* mu, bthread::ConditionVariable* cv, bool rep_follower,
-                             std::atomic<uint64_t>* follower_offset, const std::string& real_point)
+                             std::atomic<uint64_t>* follower_offset, BinlogTailCache* tail_cache,
+                             const std::string& real_point)
     : log_reader_(logs, log_path, false),
       cache_(),
       endpoint_(point),
+      real_endpoint_(real_point.empty() ? point : real_point),
       last_sync_offset_(0),
       log_matched_(false),
       tid_(tid),
@@ -66,7 +114,15 @@ ReplicateNode::ReplicateNode(const std::string& point, LogParts* logs, const std
       cv_(cv),
       go_back_cnt_(0),
       rep_node_(rep_follower),
-      follower_offset_(follower_offset) {
+      follower_offset_(follower_offset),
+      tail_cache_(tail_cache),
+      reader_behind_(false),
+      max_inflight_(FLAGS_binlog_sync_max_inflight),
+      inflight_mu_(),
+      inflight_cv_(),
+      inflight_cnt_(0),
+      send_offset_(0),
+      send_failed_(false) {
     if (!real_point.empty()) {
         rpc_client_ = openmldb::RpcClient<::openmldb::api::TabletServer_Stub>(real_point);
     }
@@ -117,7 +173,8 @@ void ReplicateNode::SyncData() {
         {
             std::unique_lock<bthread::Mutex> lock(*mu_);
             // no new data append and wait
-            while (last_sync_offset_ >= leader_log_offset_->load(std::memory_order_relaxed)) {
+            while (last_sync_offset_.load(std::memory_order_acquire) >=
+                   leader_log_offset_->load(std::memory_order_relaxed)) {
                 cv_->wait_for(lock, FLAGS_binlog_sync_wait_time * 1000);
                 if (!is_running_.load(std::memory_order_relaxed)) {
                     PDLOG(INFO,
@@ -128,12 +185,7 @@ void ReplicateNode::SyncData() {
                 }
             }
         }
-        int ret;
-        if (rep_node_.load(std::memory_order_relaxed)) {
-            ret = SyncData(follower_offset_->load(std::memory_order_relaxed));
-        } else {
-            ret = SyncData(leader_log_offset_->load(std::memory_order_relaxed));
-        }
+        int ret = SyncData(GetSyncEndOffset());
         if (ret == 1) {
             coffee_time = FLAGS_binlog_coffee_time;
         }
@@ -141,15 +193,27 @@ void ReplicateNode::SyncData() {
     PDLOG(INFO, "replicate log to endpoint %s for table #tid %u #pid %u exist", endpoint_.c_str(), tid_, pid_);
 }
 
-int ReplicateNode::GetLogIndex() { return log_reader_.GetLogIndex(); }
+uint64_t ReplicateNode::GetSyncEndOffset() {
+    if (rep_node_.load(std::memory_order_relaxed)) {
+        return follower_offset_->load(std::memory_order_relaxed);
+    }
+    return leader_log_offset_->load(std::memory_order_relaxed);
+}
+
+int ReplicateNode::GetLogIndex() {
+    if (reader_behind_.load(std::memory_order_relaxed)) {
+        return log_reader_.GetLogIndex(last_sync_offset_.load(std::memory_order_acquire));
+    }
+    return log_reader_.GetLogIndex();
+}
 
 bool ReplicateNode::IsLogMatched() { return log_matched_; }
 
 std::string ReplicateNode::GetEndPoint() { return endpoint_; }
 
-uint64_t ReplicateNode::GetLastSyncOffset() { return last_sync_offset_; }
+uint64_t ReplicateNode::GetLastSyncOffset() { return last_sync_offset_.load(std::memory_order_acquire); }
 
-void ReplicateNode::SetLastSyncOffset(uint64_t offset) { last_sync_offset_ = offset; }
+void ReplicateNode::SetLastSyncOffset(uint64_t offset) { last_sync_offset_.store(offset, std::memory_order_release); }
 
 int ReplicateNode::MatchLogOffsetFromNode() {
     ::openmldb::api::AppendEntriesRequest request;
@@ -161,96 +225,84 @@ int ReplicateNode::MatchLogOffsetFromNode() {
     bool ret = rpc_client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, &request, &response,
                                        FLAGS_request_timeout_ms, FLAGS_request_max_retry);
     if (ret && response.code() == 0) {
-        last_sync_offset_ = response.log_offset();
+        uint64_t log_offset = response.log_offset();
+        last_sync_offset_.store(log_offset, std::memory_order_release);
+        send_offset_ = log_offset;
         log_matched_ = true;
-        log_reader_.SetOffset(last_sync_offset_);
-        PDLOG(INFO, "match node %s log offset %lu for table tid %u pid %u", endpoint_.c_str(), last_sync_offset_, tid_,
-              pid_);
+        log_reader_.SetOffset(log_offset);
+        PDLOG(INFO, "match node %s log offset %lu for table tid %u pid %u", endpoint_.c_str(), log_offset, tid_, pid_);
         return 0;
     }
     PDLOG(WARNING, "match node %s log offset failed. tid %u pid %u", endpoint_.c_str(), tid_, pid_);
     return -1;
 }
 
-int ReplicateNode::SyncData(uint64_t log_offset) {
-    DEBUGLOG("node[%s] offset[%lu] log offset[%lu]", endpoint_.c_str(), last_sync_offset_, log_offset);
-    if (log_offset <= last_sync_offset_) {
-        PDLOG(WARNING, "log offset [%lu] le last sync offset [%lu], do nothing", log_offset, last_sync_offset_);
-        return 1;
-    }
-    ::openmldb::api::AppendEntriesRequest request;
-    ::openmldb::api::AppendEntriesResponse response;
-    uint64_t sync_log_offset = last_sync_offset_;
-    bool request_from_cache = false;
+bool ReplicateNode::ReadRecords(uint64_t log_offset, bool raw_record, uint64_t* sync_log_offset,
+                                ::openmldb::api::AppendEntriesRequest* request, butil::IOBuf* attachment) {
     bool need_wait = false;
-    if (cache_.size() > 0) {
-        request_from_cache = true;
-        request = cache_[0];
-        if (request.entries_size() <= 0) {
-            cache_.clear();
-            PDLOG(WARNING, "empty append entry request from node %s cache", endpoint_.c_str());
-            return -1;
-        }
-        const ::openmldb::api::LogEntry& entry = request.entries(request.entries_size() - 1);
-        if (entry.log_index() <= last_sync_offset_) {
-            DEBUGLOG("duplicate log index from node %s cache", endpoint_.c_str());
-            cache_.clear();
-            return -1;
-        }
-        PDLOG(INFO, "use cached request to send last index %lu. tid %u pid %u", entry.log_index(), tid_, pid_);
-        sync_log_offset = entry.log_index();
-    } else {
-        request.set_tid(tid_);
-        request.set_pid(pid_);
-        request.set_pre_log_index(last_sync_offset_);
-        if (!FLAGS_zk_cluster.empty()) {
-            request.set_term(term_->load(std::memory_order_relaxed));
+    uint32_t batchSize = log_offset - *sync_log_offset;
+    batchSize = std::min(batchSize, (uint32_t)FLAGS_binlog_sync_batch_size);
+    // the node close to the leader reads the records from memory
+    std::vector<std::shared_ptr<std::string>> records;
+    if (tail_cache_ != NULL && tail_cache_->Get(*sync_log_offset + 1, batchSize, &records)) {
+        reader_behind_.store(true, std::memory_order_relaxed);
+        for (const auto& record : records) {
+            if (raw_record) {
+                attachment->append(record->data(), record->size());
+                request->add_record_size(record->size());
+            } else if (!request->add_entries()->ParseFromString(*record)) {
+                PDLOG(WARNING, "bad protobuf format of cached record %lu. tid %u pid %u", *sync_log_offset + 1,
+                      tid_, pid_);
+                request->mutable_entries()->RemoveLast();
+                break;
+            }
+            (*sync_log_offset)++;
         }
-        uint32_t batchSize = log_offset - last_sync_offset_;
-        batchSize = std::min(batchSize, (uint32_t)FLAGS_binlog_sync_batch_size);
-        for (uint64_t i = 0; i < batchSize;) {
-            std::string buffer;
-            ::openmldb::base::Slice record;
-            ::openmldb::log::Status status = log_reader_.ReadNextRecord(&record, &buffer);
-            if (status.ok()) {
-                ::openmldb::api::LogEntry* entry = request.add_entries();
+        batchSize = 0;
+    } else if (reader_behind_.load(std::memory_order_relaxed)) {
+        // the node falls out of the cache, go on reading from the log part of the next record
+        log_reader_.Reset(*sync_log_offset);
+        reader_behind_.store(false, std::memory_order_relaxed);
+    }
+    for (uint64_t i = 0; i < batchSize;) {
+        std::string buffer;
+        ::openmldb::base::Slice record;
+        ::openmldb::log::Status status = log_reader_.ReadNextRecord(&record, &buffer);
+        if (status.ok()) {
+            uint64_t log_index = 0;
+            if (raw_record) {
+                // only the log index is decoded, the record is sent as it is
+                if (!ParseLogIndex(record, &log_index)) {
+                    PDLOG(WARNING, "bad protobuf format %s size %ld. tid %u pid %u",
+                          ::openmldb::base::DebugString(record.ToString()).c_str(), record.size(), tid_, pid_);
+                    break;
+                }
+            } else {
+                ::openmldb::api::LogEntry* entry = request->add_entries();
                 if (!entry->ParseFromString(record.ToString())) {
                     PDLOG(WARNING, "bad protobuf format %s size %ld. tid %u pid %u",
-                          ::openmldb::base::DebugString(record.ToString()).c_str(), record.ToString().size(), tid_,
-                          pid_);
-                    request.mutable_entries()->RemoveLast();
+                          ::openmldb::base::DebugString(record.ToString()).c_str(), record.ToString().size(),
+                          tid_, pid_);
+                    request->mutable_entries()->RemoveLast();
                     break;
                 }
                 DEBUGLOG("entry val %s log index %lld", entry->value().c_str(), entry->log_index());
-                if (entry->log_index() <= sync_log_offset) {
-                    DEBUGLOG("skip duplicate log offset %lld", entry->log_index());
-                    request.mutable_entries()->RemoveLast();
-                    continue;
+                log_index = entry->log_index();
+            }
+            if (log_index <= *sync_log_offset) {
+                DEBUGLOG("skip duplicate log offset %lld", log_index);
+                if (!raw_record) {
+                    request->mutable_entries()->RemoveLast();
                 }
-                // the log index should incr by 1
-                if ((sync_log_offset + 1) != entry->log_index()) {
-                    PDLOG(WARNING, "log missing expect offset %lu but %ld. tid %u pid %u", sync_log_offset + 1,
-                          entry->log_index(), tid_, pid_);
-                    request.mutable_entries()->RemoveLast();
-                    if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
-                        log_reader_.GoBackToStart();
-                        go_back_cnt_ = 0;
-                        PDLOG(WARNING, "go back to start. tid %u pid %u endpoint %s", tid_, pid_, endpoint_.c_str());
-                    } else {
-                        log_reader_.GoBackToLastBlock();
-                        go_back_cnt_++;
-                    }
-                    need_wait = true;
-                    break;
+                continue;
+            }
+            // the log index should incr by 1
+            if ((*sync_log_offset + 1) != log_index) {
+                PDLOG(WARNING, "log missing expect offset %lu but %ld. tid %u pid %u", *sync_log_offset + 1,
+                      log_index, tid_, pid_);
+                if (!raw_record) {
+                    request->mutable_entries()->RemoveLast();
                 }
-                sync_log_offset = entry->log_index();
-            } else if (status.IsWaitRecord()) {
-                DEBUGLOG("got a coffee time for[%s]", endpoint_.c_str());
-                need_wait = true;
-                break;
-            } else if (status.IsInvalidRecord()) {
-                DEBUGLOG("fail to get record. %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
-                need_wait = true;
                 if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
                     log_reader_.GoBackToStart();
                     go_back_cnt_ = 0;
@@ -259,35 +311,74 @@ int ReplicateNode::SyncData(uint64_t log_offset) {
                     log_reader_.GoBackToLastBlock();
                     go_back_cnt_++;
                 }
-                break;
-            } else {
-                PDLOG(WARNING, "fail to get record: %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
                 need_wait = true;
                 break;
             }
-            i++;
-            go_back_cnt_ = 0;
-        }
-    }
-    if (request.entries_size() > 0) {
-        bool ret = rpc_client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, &request, &response,
-                                           FLAGS_request_timeout_ms, FLAGS_request_max_retry);
-        if (ret && response.code() == 0) {
-            DEBUGLOG("sync log to node[%s] to offset %lld", endpoint_.c_str(), sync_log_offset);
-            last_sync_offset_ = sync_log_offset;
-            if (!rep_node_.load(std::memory_order_relaxed) &&
-                (last_sync_offset_ > follower_offset_->load(std::memory_order_relaxed))) {
-                follower_offset_->store(last_sync_offset_, std::memory_order_relaxed);
+            if (raw_record) {
+                attachment->append(record.data(), record.size());
+                request->add_record_size(record.size());
             }
-            if (request_from_cache) {
-                cache_.clear();
+            *sync_log_offset = log_index;
+        } else if (status.IsWaitRecord()) {
+            DEBUGLOG("got a coffee time for[%s]", endpoint_.c_str());
+            need_wait = true;
+            break;
+        } else if (status.IsInvalidRecord()) {
+            DEBUGLOG("fail to get record. %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
+            need_wait = true;
+            if (go_back_cnt_ > FLAGS_go_back_max_try_cnt) {
+                log_reader_.GoBackToStart();
+                go_back_cnt_ = 0;
+                PDLOG(WARNING, "go back to start. tid %u pid %u endpoint %s", tid_, pid_, endpoint_.c_str());
+            } else {
+                log_reader_.GoBackToLastBlock();
+                go_back_cnt_++;
             }
+            break;
         } else {
-            if (!request_from_cache) {
-                cache_.push_back(request);
-            }
+            PDLOG(WARNING, "fail to get record: %s. tid %u pid %u", status.ToString().c_str(), tid_, pid_);
+            need_wait = true;
+            break;
+        }
+        i++;
+        go_back_cnt_ = 0;
+    }
+    return need_wait;
+}
+
+int ReplicateNode::SyncData(uint64_t log_offset) {
+    if (max_inflight_ > 1) {
+        return SyncDataPipelined(log_offset);
+    }
+    uint64_t last_sync_offset = last_sync_offset_.load(std::memory_order_acquire);
+    DEBUGLOG("node[%s] offset[%lu] log offset[%lu]", endpoint_.c_str(), last_sync_offset, log_offset);
+    if (log_offset <= last_sync_offset) {
+        PDLOG(WARNING, "log offset [%lu] le last sync offset [%lu], do nothing", log_offset, last_sync_offset);
+        return 1;
+    }
+    ::openmldb::api::AppendEntriesRequest request;
+    ::openmldb::api::AppendEntriesResponse response;
+    // the raw records of request if they are sent as they are in binlog
+    butil::IOBuf attachment;
+    uint64_t sync_log_offset = 0;
+    bool request_from_cache = false;
+    int ret = BuildSyncRequest(log_offset, &request, &attachment, &sync_log_offset, &request_from_cache);
+    if (ret < 0) {
+        return -1;
+    }
+    bool need_wait = ret > 0;
+    if (request.entries_size() > 0 || request.record_size_size() > 0) {
+        bool ok = false;
+        if (request.record_size_size() > 0) {
+            ok = rpc_client_.SendRequestWithAttachment(&::openmldb::api::TabletServer_Stub::AppendEntries, &request,
+                                                       &response, FLAGS_request_timeout_ms, FLAGS_request_max_retry,
+                                                       attachment);
+        } else {
+            ok = rpc_client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, &request, &response,
+                                         FLAGS_request_timeout_ms, FLAGS_request_max_retry);
+        }
+        if (!OnSyncDone(ok && response.code() == 0, request, attachment, sync_log_offset, request_from_cache)) {
             need_wait = true;
-            PDLOG(WARNING, "fail to sync log to node %s. tid %u pid %u", endpoint_.c_str(), tid_, pid_);
         }
     }
     if (need_wait) {
@@ -296,20 +387,180 @@ int ReplicateNode::SyncData(uint64_t log_offset) {
     return 0;
 }
 
-void ReplicateNode::Stop() {
-    is_running_.store(false, std::memory_order_relaxed);
-    if (worker_ == 0) {
-        return;
+int ReplicateNode::BuildSyncRequest(uint64_t log_offset, ::openmldb::api::AppendEntriesRequest* request,
+                                    butil::IOBuf* attachment, uint64_t* sync_log_offset, bool* from_cache) {
+    uint64_t last_sync_offset = last_sync_offset_.load(std::memory_order_acquire);
+    *sync_log_offset = last_sync_offset;
+    *from_cache = false;
+    bool raw_record = FLAGS_binlog_sync_raw_record;
+    if (cache_.size() > 0) {
+        *from_cache = true;
+        *request = cache_[0];
+        raw_record = request->record_size_size() > 0;
+        if (request->entries_size() <= 0 && !raw_record) {
+            cache_.clear();
+            PDLOG(WARNING, "empty append entry request from node %s cache", endpoint_.c_str());
+            return -1;
+        }
+        uint64_t last_log_index = 0;
+        if (raw_record) {
+            *attachment = cache_attachment_;
+            last_log_index = request->last_log_index();
+        } else {
+            last_log_index = request->entries(request->entries_size() - 1).log_index();
+        }
+        if (last_log_index <= last_sync_offset) {
+            DEBUGLOG("duplicate log index from node %s cache", endpoint_.c_str());
+            cache_.clear();
+            cache_attachment_.clear();
+            return -1;
+        }
+        PDLOG(INFO, "use cached request to send last index %lu. tid %u pid %u", last_log_index, tid_, pid_);
+        *sync_log_offset = last_log_index;
+        return 0;
+    }
+    request->set_tid(tid_);
+    request->set_pid(pid_);
+    request->set_pre_log_index(last_sync_offset);
+    if (!FLAGS_zk_cluster.empty()) {
+        request->set_term(term_->load(std::memory_order_relaxed));
+    }
+    bool need_wait = ReadRecords(log_offset, raw_record, sync_log_offset, request, attachment);
+    if (raw_record) {
+        request->set_last_log_index(*sync_log_offset);
+    }
+    return need_wait ? 1 : 0;
+}
+
+bool ReplicateNode::OnSyncDone(bool ok, const ::openmldb::api::AppendEntriesRequest& request,
+                               const butil::IOBuf& attachment, uint64_t sync_log_offset, bool from_cache) {
+    if (ok) {
+        DEBUGLOG("sync log to node[%s] to offset %lld", endpoint_.c_str(), sync_log_offset);
+        last_sync_offset_.store(sync_log_offset, std::memory_order_release);
+        if (!rep_node_.load(std::memory_order_relaxed) &&
+            (sync_log_offset > follower_offset_->load(std::memory_order_relaxed))) {
+            follower_offset_->store(sync_log_offset, std::memory_order_relaxed);
+        }
+        if (from_cache) {
+            cache_.clear();
+            cache_attachment_.clear();
+        }
+        return true;
+    }
+    if (!from_cache) {
+        cache_.push_back(request);
+        cache_attachment_ = attachment;
+    }
+    PDLOG(WARNING, "fail to sync log to node %s. tid %u pid %u", endpoint_.c_str(), tid_, pid_);
+    return false;
+}
+
+// at most max_inflight_ batches are sent without waiting for the acks. the follower applies a batch only after
+// the one before it, so an ack covers all the batches sent before and last_sync_offset_ only goes forward
+int ReplicateNode::SyncDataPipelined(uint64_t log_offset) {
+    uint64_t sync_log_offset = 0;
+    {
+        std::unique_lock<bthread::Mutex> lock(inflight_mu_);
+        uint64_t last_sync_offset = last_sync_offset_.load(std::memory_order_acquire);
+        if (log_offset <= last_sync_offset) {
+            PDLOG(WARNING, "log offset [%lu] le last sync offset [%lu], do nothing", log_offset, last_sync_offset);
+            return 1;
+        }
+        if (send_failed_) {
+            // the follower drops the batches after the failed one, resend from the first unacked offset
+            // after all of them come back
+            if (inflight_cnt_ > 0) {
+                inflight_cv_.wait_for(lock, FLAGS_binlog_sync_wait_time * 1000);
+                return 0;
+            }
+            PDLOG(INFO, "resend from offset %lu to node %s. tid %u pid %u", last_sync_offset, endpoint_.c_str(),
+                  tid_, pid_);
+            send_failed_ = false;
+            send_offset_ = last_sync_offset;
+            log_reader_.Reset(send_offset_);
+            reader_behind_.store(false, std::memory_order_relaxed);
+            return 1;
+        }
+        if (inflight_cnt_ >= max_inflight_ || send_offset_ >= log_offset) {
+            inflight_cv_.wait_for(lock, FLAGS_binlog_sync_wait_time * 1000);
+            return 0;
+        }
+        sync_log_offset = send_offset_;
+    }
+    bool raw_record = FLAGS_binlog_sync_raw_record;
+    butil::IOBuf attachment;
+    ::openmldb::api::AppendEntriesRequest request;
+    request.set_tid(tid_);
+    request.set_pid(pid_);
+    request.set_pre_log_index(sync_log_offset);
+    request.set_pipelined(true);
+    if (!FLAGS_zk_cluster.empty()) {
+        request.set_term(term_->load(std::memory_order_relaxed));
     }
+    bool need_wait = ReadRecords(log_offset, raw_record, &sync_log_offset, &request, &attachment);
+    if (request.entries_size() == 0 && request.record_size_size() == 0) {
+        return need_wait ? 1 : 0;
+    }
+    auto* closure = new AppendEntriesClosure(this, sync_log_offset);
+    closure->GetRequest()->Swap(&request);
+    brpc::Controller* cntl = closure->GetController();
+    cntl->set_timeout_ms(FLAGS_request_timeout_ms);
+    cntl->set_max_retry(FLAGS_request_max_retry);
+    if (raw_record) {
+        closure->GetRequest()->set_last_log_index(sync_log_offset);
+        cntl->request_attachment().swap(attachment);
+    }
+    {
+        std::lock_guard<bthread::Mutex> lock(inflight_mu_);
+        inflight_cnt_++;
+        send_offset_ = sync_log_offset;
+    }
+    if (!rpc_client_.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, cntl, closure->GetRequest(),
+                                 closure->GetResponse(), closure)) {
+        cntl->SetFailed("stub is null");
+        closure->Run();
+    }
+    return need_wait ? 1 : 0;
+}
 
-    if (bthread_stopped(worker_) == 1) {
-        PDLOG(INFO, "sync thread for table #tid %u #pid %u has been stoped", tid_, pid_);
-        return;
+void ReplicateNode::OnAppendEntriesDone(const brpc::Controller& cntl,
+                                        const ::openmldb::api::AppendEntriesResponse& response, uint64_t end_offset) {
+    std::lock_guard<bthread::Mutex> lock(inflight_mu_);
+    inflight_cnt_--;
+    uint64_t last_sync_offset = last_sync_offset_.load(std::memory_order_acquire);
+    if (!cntl.Failed() && response.code() == 0) {
+        if (end_offset > last_sync_offset) {
+            DEBUGLOG("sync log to node[%s] to offset %lu", endpoint_.c_str(), end_offset);
+            last_sync_offset_.store(end_offset, std::memory_order_release);
+            if (!rep_node_.load(std::memory_order_relaxed) &&
+                end_offset > follower_offset_->load(std::memory_order_relaxed)) {
+                follower_offset_->store(end_offset, std::memory_order_relaxed);
+            }
+        }
+    } else if (end_offset > last_sync_offset) {
+        send_failed_ = true;
+        PDLOG(WARNING, "fail to sync log to node %s to offset %lu: %s. tid %u pid %u", endpoint_.c_str(), end_offset,
+              cntl.Failed() ? cntl.ErrorText().c_str() : response.msg().c_str(), tid_, pid_);
     }
+    inflight_cv_.notify_all();
+}
 
-    bthread_stop(worker_);
-    bthread_join(worker_, NULL);
-    worker_ = 0;
+void ReplicateNode::Stop() {
+    is_running_.store(false, std::memory_order_relaxed);
+    if (worker_ != 0) {
+        if (bthread_stopped(worker_) == 1) {
+            PDLOG(INFO, "sync thread for table #tid %u #pid %u has been stoped", tid_, pid_);
+        } else {
+            bthread_stop(worker_);
+            bthread_join(worker_, NULL);
+            worker_ = 0;
+        }
+    }
+    // the async AppendEntries refer to this node, wait for them whether the worker is running or not
+    std::unique_lock<bthread::Mutex> lock(inflight_mu_);
+    while (inflight_cnt_ > 0) {
+        inflight_cv_.wait(lock);
+    }
 }
 
 }  // namespace replica
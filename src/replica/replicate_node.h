@@ -28,6 +28,7 @@
 #include "log/log_writer.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "replica/binlog_tail_cache.h"
 #include "rpc/rpc_client.h"
 
 namespace openmldb {
@@ -41,7 +42,7 @@ class ReplicateNode {
     ReplicateNode(const std::string& point, LogParts* logs, const std::string& log_path, uint32_t tid, uint32_t pid,
                   std::atomic<uint64_t>* term, std::atomic<uint64_t>* leader_log_offset, bthread::Mutex* mu,
                   bthread::ConditionVariable* cv, bool rep_follower, std::atomic<uint64_t>* follower_offset,
-                  const std::string& real_point);
+                  BinlogTailCache* tail_cache, const std::string& real_point);
     int Init();
 
     int Start();
@@ -65,18 +66,49 @@ class ReplicateNode {
 
     void Stop();
 
+    // match the log offset with one rpc, return 0 if matched
+    int MatchLogOffsetFromNode();
+
+    // the log offset the node syncs to
+    uint64_t GetSyncEndOffset();
+
+    // build the request of the records up to log_offset, the failed request is built again first.
+    // return -1 if the failed request is dropped, 1 if the node should wait for the coming records
+    int BuildSyncRequest(uint64_t log_offset, ::openmldb::api::AppendEntriesRequest* request,
+                         butil::IOBuf* attachment, uint64_t* sync_log_offset, bool* from_cache);
+
+    // the result of the request built by BuildSyncRequest, return ok
+    bool OnSyncDone(bool ok, const ::openmldb::api::AppendEntriesRequest& request, const butil::IOBuf& attachment,
+                    uint64_t sync_log_offset, bool from_cache);
+
+    const std::string& GetRealEndPoint() const { return real_endpoint_; }
+
+    // the done of an async AppendEntries covering the records up to end_offset
+    void OnAppendEntriesDone(const brpc::Controller& cntl, const ::openmldb::api::AppendEntriesResponse& response,
+                             uint64_t end_offset);
+
     ReplicateNode(const ReplicateNode&) = delete;
 
     ReplicateNode& operator=(const ReplicateNode&) = delete;
 
  private:
-    int MatchLogOffsetFromNode();
+    // read the records after sync_log_offset into request and move sync_log_offset to the last one,
+    // return true if the node should wait for the coming records
+    bool ReadRecords(uint64_t log_offset, bool raw_record, uint64_t* sync_log_offset,
+                     ::openmldb::api::AppendEntriesRequest* request, butil::IOBuf* attachment);
+
+    int SyncDataPipelined(uint64_t log_offset);
 
  private:
     LogReader log_reader_;
     std::vector<::openmldb::api::AppendEntriesRequest> cache_;
+    // the raw records of the cached request if it is sent with binlog_sync_raw_record
+    butil::IOBuf cache_attachment_;
     std::string endpoint_;
-    uint64_t last_sync_offset_;
+    // the endpoint to connect, it is endpoint_ if no real endpoint is given
+    std::string real_endpoint_;
+    // written by the sync worker and the rpc callbacks, read by GetLogIndex on other threads
+    std::atomic<uint64_t> last_sync_offset_;
     bool log_matched_;
     uint32_t tid_;
     uint32_t pid_;
@@ -90,6 +122,17 @@ class ReplicateNode {
     uint32_t go_back_cnt_;
     std::atomic<bool> rep_node_;
     std::atomic<uint64_t>* follower_offset_;  // max local cluster follower offset
+    BinlogTailCache* tail_cache_;
+    // log_reader_ is left behind while the records are read from tail_cache_
+    std::atomic<bool> reader_behind_;
+    // the pipelined replication if max_inflight_ > 1
+    uint32_t max_inflight_;
+    bthread::Mutex inflight_mu_;
+    bthread::ConditionVariable inflight_cv_;
+    uint32_t inflight_cnt_;
+    // the last log index sent
+    uint64_t send_offset_;
+    bool send_failed_;
 };
 
 }  // namespace replica
@@ -0,0 +1,383 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "replica/replicate_transport.h"
+
+#include <gflags/gflags.h>
+
+#include <functional>
+#include <utility>
+
+#include "base/glog_wapper.h"
+#include "common/timer.h"
+
+DECLARE_int32(binlog_coffee_time);
+DECLARE_int32(binlog_sync_wait_time);
+DECLARE_int32(binlog_match_logoffset_interval);
+DECLARE_uint32(binlog_sync_stream_batch_size);
+DECLARE_int32(request_max_retry);
+DECLARE_int32(request_timeout_ms);
+
+namespace openmldb {
+namespace replica {
+
+struct TransportTask {
+    ReplicateTransport* transport;
+    uint32_t worker_id;
+};
+
+static void* RunTransportTask(void* args) {
+    auto* task = static_cast<TransportTask*>(args);
+    task->transport->Run(task->worker_id);
+    delete task;
+    return NULL;
+}
+
+class ReplicateTransport::StreamClosure : public google::protobuf::Closure {
+ public:
+    StreamClosure(ReplicateTransport* transport, const std::shared_ptr<Stream>& stream, bool batch)
+        : transport_(transport), stream_(stream), batch_(batch) {}
+
+    void Run() override {
+        transport_->OnStreamDone(this);
+        delete this;
+    }
+
+    brpc::Controller* GetController() { return &cntl_; }
+
+    ::openmldb::api::BatchAppendEntriesRequest* GetRequest() { return &request_; }
+
+    ::openmldb::api::BatchAppendEntriesResponse* GetResponse() { return &response_; }
+
+    // the response of a request sent with AppendEntries
+    ::openmldb::api::AppendEntriesResponse* GetEntryResponse() { return &entry_response_; }
+
+    std::vector<Pending>* GetPendings() { return &pendings_; }
+
+    const std::shared_ptr<Stream>& GetStream() const { return stream_; }
+
+    bool IsBatch() const { return batch_; }
+
+ private:
+    ReplicateTransport* transport_;
+    std::shared_ptr<Stream> stream_;
+    bool batch_;
+    brpc::Controller cntl_;
+    ::openmldb::api::BatchAppendEntriesRequest request_;
+    ::openmldb::api::BatchAppendEntriesResponse response_;
+    ::openmldb::api::AppendEntriesResponse entry_response_;
+    std::vector<Pending> pendings_;
+};
+
+ReplicateTransport::ReplicateTransport(uint32_t worker_num)
+    : worker_num_(worker_num),
+      is_running_(false),
+      mu_(),
+      cv_(),
+      notify_seq_(0),
+      waiter_cnt_(0),
+      wakeup_pending_(false),
+      inflight_cnt_(0),
+      streams_(worker_num),
+      workers_() {}
+
+ReplicateTransport::~ReplicateTransport() { Stop(); }
+
+int ReplicateTransport::Start() {
+    if (is_running_.exchange(true)) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < worker_num_; i++) {
+        bthread_t tid;
+        auto* task = new TransportTask{this, i};
+        int ret = bthread_start_background(&tid, NULL, RunTransportTask, task);
+        if (ret != 0) {
+            delete task;
+            PDLOG(WARNING, "fail to start replicate transport worker with errno %d", ret);
+            return ret;
+        }
+        workers_.push_back(tid);
+    }
+    PDLOG(INFO, "start replicate transport with %u workers", worker_num_);
+    return 0;
+}
+
+void ReplicateTransport::Stop() {
+    if (!is_running_.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<bthread::Mutex> lock(mu_);
+        cv_.notify_all();
+    }
+    for (auto tid : workers_) {
+        bthread_join(tid, NULL);
+    }
+    workers_.clear();
+    std::unique_lock<bthread::Mutex> lock(mu_);
+    while (inflight_cnt_ > 0) {
+        cv_.wait(lock);
+    }
+}
+
+int ReplicateTransport::AddNode(const std::shared_ptr<ReplicateNode>& node) {
+    const std::string& endpoint = node->GetRealEndPoint();
+    uint32_t worker_id = std::hash<std::string>()(endpoint) % worker_num_;
+    std::shared_ptr<Stream> stream;
+    {
+        std::lock_guard<bthread::Mutex> lock(mu_);
+        auto& streams = streams_[worker_id];
+        auto it = streams.find(endpoint);
+        if (it == streams.end()) {
+            stream = std::make_shared<Stream>(endpoint);
+            if (stream->client.Init() != 0) {
+                PDLOG(WARNING, "fail to init rpc client for endpoint %s", endpoint.c_str());
+                return -1;
+            }
+            streams.emplace(endpoint, stream);
+        } else {
+            stream = it->second;
+        }
+    }
+    {
+        std::lock_guard<bthread::Mutex> lock(stream->mu);
+        auto state = std::make_shared<NodeState>();
+        state->node = node;
+        stream->nodes.push_back(state);
+    }
+    Notify();
+    return 0;
+}
+
+void ReplicateTransport::DelNode(const ReplicateNode* node) {
+    const std::string& endpoint = node->GetRealEndPoint();
+    uint32_t worker_id = std::hash<std::string>()(endpoint) % worker_num_;
+    std::shared_ptr<Stream> stream;
+    {
+        std::lock_guard<bthread::Mutex> lock(mu_);
+        auto it = streams_[worker_id].find(endpoint);
+        if (it == streams_[worker_id].end()) {
+            return;
+        }
+        stream = it->second;
+    }
+    std::unique_lock<bthread::Mutex> lock(stream->mu);
+    // wait for the requests in progress
+    while (stream->busy_cnt > 0) {
+        stream->cv.wait(lock);
+    }
+    for (auto it = stream->nodes.begin(); it != stream->nodes.end(); ++it) {
+        if ((*it)->node.get() == node) {
+            stream->nodes.erase(it);
+            break;
+        }
+    }
+}
+
+void ReplicateTransport::Notify() {
+    notify_seq_.fetch_add(1, std::memory_order_seq_cst);
+    // the workers are busy and will see the new seq, or another put is waking them up
+    if (waiter_cnt_.load(std::memory_order_seq_cst) == 0 || wakeup_pending_.exchange(true)) {
+        return;
+    }
+    std::lock_guard<bthread::Mutex> lock(mu_);
+    wakeup_pending_.store(false, std::memory_order_seq_cst);
+    cv_.notify_all();
+}
+
+void ReplicateTransport::Run(uint32_t worker_id) {
+    while (is_running_.load(std::memory_order_relaxed)) {
+        uint64_t seq = notify_seq_.load(std::memory_order_seq_cst);
+        std::vector<std::shared_ptr<Stream>> streams;
+        {
+            std::lock_guard<bthread::Mutex> lock(mu_);
+            for (const auto& kv : streams_[worker_id]) {
+                streams.push_back(kv.second);
+            }
+        }
+        bool sent = false;
+        for (const auto& stream : streams) {
+            sent = SyncStream(stream) || sent;
+        }
+        if (!sent) {
+            std::unique_lock<bthread::Mutex> lock(mu_);
+            waiter_cnt_.fetch_add(1, std::memory_order_seq_cst);
+            if (seq == notify_seq_.load(std::memory_order_seq_cst) && is_running_.load(std::memory_order_relaxed)) {
+                cv_.wait_for(lock, FLAGS_binlog_sync_wait_time * 1000);
+            }
+            waiter_cnt_.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+    PDLOG(INFO, "replicate transport worker %u exits", worker_id);
+}
+
+bool ReplicateTransport::SyncStream(const std::shared_ptr<Stream>& stream) {
+    std::vector<std::shared_ptr<NodeState>> nodes;
+    uint32_t start = 0;
+    bool batch = true;
+    {
+        std::lock_guard<bthread::Mutex> lock(stream->mu);
+        // the last request is in flight, the stream is synced again after it is done
+        if (stream->busy_cnt > 0 || stream->nodes.empty()) {
+            return false;
+        }
+        stream->busy_cnt = 1;
+        nodes = stream->nodes;
+        start = stream->next;
+        batch = stream->batch;
+    }
+    // the lock is not held while the nodes read the binlog and match the log offsets, so AddNode and
+    // DelNode of the other partitions don't wait for the rpc
+    uint32_t node_cnt = nodes.size();
+    auto* closure = new StreamClosure(this, stream, batch);
+    auto* request = closure->GetRequest();
+    auto* pendings = closure->GetPendings();
+    butil::IOBuf attachment;
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    uint32_t record_cnt = 0;
+    uint32_t i = 0;
+    for (; i < node_cnt && record_cnt < FLAGS_binlog_sync_stream_batch_size; i++) {
+        const std::shared_ptr<NodeState>& state = nodes[(start + i) % node_cnt];
+        ReplicateNode* node = state->node.get();
+        if (state->next_time > now) {
+            continue;
+        }
+        if (!node->IsLogMatched()) {
+            if (node->MatchLogOffsetFromNode() != 0) {
+                state->next_time = now + FLAGS_binlog_match_logoffset_interval;
+            }
+            continue;
+        }
+        uint64_t log_offset = node->GetSyncEndOffset();
+        if (log_offset <= node->GetLastSyncOffset()) {
+            continue;
+        }
+        Pending pending;
+        pending.state = state;
+        auto* sub_request = request->add_requests();
+        int ret = node->BuildSyncRequest(log_offset, sub_request, &pending.attachment, &pending.sync_log_offset,
+                                         &pending.from_cache);
+        if (ret > 0) {
+            state->next_time = now + FLAGS_binlog_coffee_time;
+        }
+        if (ret < 0 || (sub_request->entries_size() == 0 && sub_request->record_size_size() == 0)) {
+            request->mutable_requests()->RemoveLast();
+            continue;
+        }
+        record_cnt += sub_request->entries_size() + sub_request->record_size_size();
+        attachment.append(pending.attachment);
+        pendings->push_back(std::move(pending));
+    }
+    std::vector<StreamClosure*> closures;
+    if (pendings->empty()) {
+        delete closure;
+    } else if (batch) {
+        closures.push_back(closure);
+    } else {
+        // the follower doesn't support BatchAppendEntries, send each node with its own AppendEntries
+        for (uint32_t k = 0; k < pendings->size(); k++) {
+            auto* entry_closure = new StreamClosure(this, stream, false);
+            entry_closure->GetRequest()->add_requests()->Swap(request->mutable_requests(k));
+            entry_closure->GetPendings()->push_back(std::move((*pendings)[k]));
+            closures.push_back(entry_closure);
+        }
+        delete closure;
+    }
+    {
+        std::lock_guard<bthread::Mutex> lock(stream->mu);
+        stream->next = (start + i) % stream->nodes.size();
+        stream->busy_cnt = closures.size();
+        if (closures.empty()) {
+            stream->cv.notify_all();
+            return false;
+        }
+    }
+    {
+        std::lock_guard<bthread::Mutex> lock(mu_);
+        inflight_cnt_ += closures.size();
+    }
+    for (auto* cur : closures) {
+        brpc::Controller* cntl = cur->GetController();
+        cntl->set_timeout_ms(FLAGS_request_timeout_ms);
+        cntl->set_max_retry(FLAGS_request_max_retry);
+        bool ok = false;
+        if (cur->IsBatch()) {
+            cntl->request_attachment().swap(attachment);
+            ok = stream->client.SendRequest(&::openmldb::api::TabletServer_Stub::BatchAppendEntries, cntl,
+                                            cur->GetRequest(), cur->GetResponse(), cur);
+        } else {
+            cntl->request_attachment().append(cur->GetPendings()->front().attachment);
+            ok = stream->client.SendRequest(&::openmldb::api::TabletServer_Stub::AppendEntries, cntl,
+                                            cur->GetRequest()->mutable_requests(0), cur->GetEntryResponse(), cur);
+        }
+        if (!ok) {
+            cntl->SetFailed("stub is null");
+            cur->Run();
+        }
+    }
+    return true;
+}
+
+void ReplicateTransport::OnStreamDone(StreamClosure* closure) {
+    const auto& stream = closure->GetStream();
+    brpc::Controller* cntl = closure->GetController();
+    auto* request = closure->GetRequest();
+    auto* pendings = closure->GetPendings();
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    bool unsupported = false;
+    for (uint32_t k = 0; k < pendings->size(); k++) {
+        Pending& pending = (*pendings)[k];
+        bool ok = !cntl->Failed();
+        if (closure->IsBatch()) {
+            const auto* response = closure->GetResponse();
+            ok = ok && response->code() == 0 && response->responses_size() == request->requests_size() &&
+                 response->responses(k).code() == 0;
+        } else {
+            ok = ok && closure->GetEntryResponse()->code() == 0;
+        }
+        // the records are cached by the node and resent with the next request
+        if (!pending.state->node->OnSyncDone(ok, request->requests(k), pending.attachment,
+                                             pending.sync_log_offset, pending.from_cache)) {
+            pending.state->next_time = now + FLAGS_binlog_coffee_time;
+        }
+    }
+    if (cntl->Failed()) {
+        unsupported = closure->IsBatch() && cntl->ErrorCode() == brpc::ENOMETHOD;
+        PDLOG(WARNING, "fail to sync stream to node %s: %s", stream->endpoint.c_str(),
+              cntl->ErrorText().c_str());
+    }
+    {
+        std::lock_guard<bthread::Mutex> lock(stream->mu);
+        if (unsupported && stream->batch) {
+            PDLOG(WARNING, "node %s doesn't support BatchAppendEntries, sync each partition with AppendEntries",
+                  stream->endpoint.c_str());
+            stream->batch = false;
+        }
+        stream->busy_cnt--;
+        if (stream->busy_cnt == 0) {
+            stream->cv.notify_all();
+        }
+    }
+    // wake up the worker to send the next request of the stream. nothing of the transport is used after
+    // inflight_cnt_ is decreased, Stop may return then
+    notify_seq_.fetch_add(1, std::memory_order_seq_cst);
+    std::lock_guard<bthread::Mutex> lock(mu_);
+    inflight_cnt_--;
+    cv_.notify_all();
+}
+
+}  // namespace replica
+}  // namespace openmldb
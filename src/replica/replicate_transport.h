@@ -0,0 +1,119 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_REPLICA_REPLICATE_TRANSPORT_H_
+#define SRC_REPLICA_REPLICATE_TRANSPORT_H_
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bthread/bthread.h"
+#include "bthread/condition_variable.h"
+#include "proto/tablet.pb.h"
+#include "replica/replicate_node.h"
+#include "rpc/rpc_client.h"
+
+namespace openmldb {
+namespace replica {
+
+// syncs the replicate nodes of all the partitions with a fixed number of workers. the pending records of the
+// nodes of the same endpoint are coalesced into one BatchAppendEntries, and each request starts from the node
+// after the last one served, so that all the partitions go forward
+class ReplicateTransport {
+ public:
+    explicit ReplicateTransport(uint32_t worker_num);
+    ~ReplicateTransport();
+
+    ReplicateTransport(const ReplicateTransport&) = delete;
+    ReplicateTransport& operator=(const ReplicateTransport&) = delete;
+
+    int Start();
+
+    void Stop();
+
+    // the node is synced by the stream of its endpoint instead of its own sync thread
+    int AddNode(const std::shared_ptr<ReplicateNode>& node);
+
+    // return after no worker or request in flight uses the node
+    void DelNode(const ReplicateNode* node);
+
+    // new records are appended
+    void Notify();
+
+    void Run(uint32_t worker_id);
+
+ private:
+    struct NodeState {
+        std::shared_ptr<ReplicateNode> node;
+        // the node is skipped until then, in ms
+        uint64_t next_time = 0;
+    };
+
+    struct Stream {
+        explicit Stream(const std::string& endpoint)
+            : endpoint(endpoint), client(endpoint), next(0), busy_cnt(0), batch(true) {}
+        std::string endpoint;
+        bthread::Mutex mu;
+        bthread::ConditionVariable cv;
+        ::openmldb::RpcClient<::openmldb::api::TabletServer_Stub> client;
+        std::vector<std::shared_ptr<NodeState>> nodes;
+        // the node the next request starts from
+        uint32_t next;
+        // the worker building the requests and the requests in flight. the nodes are used without the lock
+        // and no new request is built until it is 0
+        uint32_t busy_cnt;
+        // false if the follower doesn't support BatchAppendEntries, each node is sent with AppendEntries
+        bool batch;
+    };
+
+    // the sub request of a node in a stream request
+    struct Pending {
+        std::shared_ptr<NodeState> state;
+        butil::IOBuf attachment;
+        uint64_t sync_log_offset = 0;
+        bool from_cache = false;
+    };
+
+    class StreamClosure;
+
+    // send the pending records of the stream without waiting for the response, return true if any is sent
+    bool SyncStream(const std::shared_ptr<Stream>& stream);
+
+    void OnStreamDone(StreamClosure* closure);
+
+ private:
+    uint32_t worker_num_;
+    std::atomic<bool> is_running_;
+    bthread::Mutex mu_;
+    bthread::ConditionVariable cv_;
+    // the puts only bump the seq, the lock is taken only if a worker waits and no wakeup is pending
+    std::atomic<uint64_t> notify_seq_;
+    std::atomic<uint32_t> waiter_cnt_;
+    std::atomic<bool> wakeup_pending_;
+    // the requests in flight, Stop waits for them
+    uint32_t inflight_cnt_;
+    // the streams of each worker, keyed by the real endpoint
+    std::vector<std::map<std::string, std::shared_ptr<Stream>>> streams_;
+    std::vector<bthread_t> workers_;
+};
+
+}  // namespace replica
+}  // namespace openmldb
+
+#endif  // SRC_REPLICA_REPLICATE_TRANSPORT_H_
@@ -17,8 +17,10 @@
 #include "sdk/sql_cluster_router.h"
 
 #include <algorithm>
+#include <deque>
 #include <fstream>
 #include <memory>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -49,6 +51,8 @@
 DECLARE_int32(request_timeout_ms);
 DECLARE_string(mini_window_size);
 DEFINE_string(spark_conf, "", "The config file of Spark job");
+DEFINE_uint32(insert_batch_rows, 1000, "the max number of rows in one batch put request of insert");
+DEFINE_uint32(insert_max_inflight, 16, "the max number of in-flight batch put requests of one insert");
 
 namespace openmldb {
 namespace sdk {
@@ -1169,7 +1173,8 @@ bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& s
         LOG(WARNING) << status->msg;
         return false;
     }
-    size_t cnt = 0;
+    std::vector<std::shared_ptr<SQLInsertRow>> rows;
+    rows.reserve(default_maps.size());
     for (size_t i = 0; i < default_maps.size(); i++) {
         auto row = std::make_shared<SQLInsertRow>(table_info, schema, default_maps[i], str_lengths[i]);
         if (!row) {
@@ -1184,12 +1189,11 @@ bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& s
             LOG(WARNING) << "fail to build row[" << i << "]";
             continue;
         }
-        if (!PutRow(table_info->tid(), row, tablets, status)) {
-            LOG(WARNING) << "fail to put row[" << i << "] due to: " << status->msg;
-            continue;
-        }
-        cnt++;
+        rows.push_back(row);
     }
+    std::vector<bool> failed;
+    PutRows(table_info->tid(), rows, tablets, &failed, status);
+    size_t cnt = std::count(failed.begin(), failed.end(), false);
     if (cnt < default_maps.size()) {
         status->msg = "Error occur when execute insert, success/total: " + std::to_string(cnt) + "/" +
                       std::to_string(default_maps.size());
@@ -1233,8 +1237,175 @@ bool SQLClusterRouter::PutRow(uint32_t tid, const std::shared_ptr<SQLInsertRow>&
     return true;
 }
 
+namespace {
+
+struct BatchPutTask {
+    uint32_t pid;
+    std::shared_ptr<::openmldb::client::TabletClient> client;
+    ::openmldb::api::BatchPutRequest request;
+    // the index in the insert rows of every request row
+    std::vector<size_t> row_idx;
+    openmldb::RpcCallback<openmldb::api::BatchPutResponse>* callback = nullptr;
+};
+
+// fallback for the tablets which do not support BatchPut
+void PutOneByOne(BatchPutTask* task, std::vector<bool>* failed) {
+    std::vector<std::pair<std::string, uint32_t>> dimensions;
+    for (int i = 0; i < task->request.rows_size(); i++) {
+        const auto& row = task->request.rows(i);
+        dimensions.clear();
+        for (const auto& dimension : row.dimensions()) {
+            dimensions.emplace_back(dimension.key(), dimension.idx());
+        }
+        if (!task->client->Put(task->request.tid(), task->pid, row.time(), row.value(), dimensions, 1)) {
+            (*failed)[task->row_idx[i]] = true;
+        }
+    }
+}
+
+void WaitBatchPut(BatchPutTask* task, std::vector<bool>* failed) {
+    auto callback = task->callback;
+    const auto& cntl = callback->GetController();
+    const auto& response = callback->GetResponse();
+    brpc::Join(cntl->call_id());
+    if (cntl->Failed()) {
+        if (cntl->ErrorCode() == brpc::ENOMETHOD) {
+            PutOneByOne(task, failed);
+        } else {
+            LOG(WARNING) << "fail to batch put to " << task->client->GetEndpoint() << " tid "
+                         << task->request.tid() << " pid " << task->pid << ": " << cntl->ErrorText();
+            for (auto idx : task->row_idx) {
+                (*failed)[idx] = true;
+            }
+        }
+    } else if (response->row_codes_size() != task->request.rows_size()) {
+        LOG(WARNING) << "fail to batch put to " << task->client->GetEndpoint() << " tid " << task->request.tid()
+                     << " pid " << task->pid << ": " << response->msg();
+        for (auto idx : task->row_idx) {
+            (*failed)[idx] = true;
+        }
+    } else {
+        for (int i = 0; i < response->row_codes_size(); i++) {
+            if (response->row_codes(i) != ::openmldb::base::kOk) {
+                (*failed)[task->row_idx[i]] = true;
+            }
+        }
+    }
+    callback->UnRef();
+    task->callback = nullptr;
+}
+
+void AddAllRows(uint32_t cnt, std::vector<uint32_t>* failed_rows) {
+    if (failed_rows == nullptr) {
+        return;
+    }
+    for (uint32_t i = 0; i < cnt; i++) {
+        failed_rows->push_back(i);
+    }
+}
+
+}  // namespace
+
+bool SQLClusterRouter::PutRows(uint32_t tid, const std::vector<std::shared_ptr<SQLInsertRow>>& rows,
+                               const std::vector<std::shared_ptr<::openmldb::catalog::TabletAccessor>>& tablets,
+                               std::vector<bool>* failed, ::hybridse::sdk::Status* status) {
+    if (failed == nullptr || status == nullptr) {
+        return false;
+    }
+    failed->assign(rows.size(), false);
+    uint32_t batch_rows = std::max(FLAGS_insert_batch_rows, 1u);
+    // group the rows by partition, one row may be put to several partitions
+    std::vector<std::unique_ptr<BatchPutTask>> tasks;
+    std::map<uint32_t, BatchPutTask*> cur_tasks;
+    for (size_t i = 0; i < rows.size(); i++) {
+        uint64_t cur_ts = ::baidu::common::timer::get_micros() / 1000;
+        for (const auto& kv : rows[i]->GetDimensions()) {
+            uint32_t pid = kv.first;
+            auto iter = cur_tasks.find(pid);
+            if (iter == cur_tasks.end() || iter->second->request.rows_size() >= static_cast<int>(batch_rows)) {
+                std::shared_ptr<::openmldb::client::TabletClient> client;
+                if (pid < tablets.size() && tablets[pid]) {
+                    client = tablets[pid]->GetClient();
+                }
+                if (!client) {
+                    status->msg = "fail to get tablet client. pid " + std::to_string(pid);
+                    LOG(WARNING) << status->msg;
+                    (*failed)[i] = true;
+                    continue;
+                }
+                auto task = std::make_unique<BatchPutTask>();
+                task->pid = pid;
+                task->client = client;
+                task->request.set_tid(tid);
+                task->request.set_pid(pid);
+                cur_tasks[pid] = task.get();
+                iter = cur_tasks.find(pid);
+                tasks.push_back(std::move(task));
+            }
+            BatchPutTask* task = iter->second;
+            auto put_row = task->request.add_rows();
+            put_row->set_time(cur_ts);
+            put_row->set_value(rows[i]->GetRow());
+            for (const auto& dimension : kv.second) {
+                auto dim = put_row->add_dimensions();
+                dim->set_key(dimension.first);
+                dim->set_idx(dimension.second);
+            }
+            task->row_idx.push_back(i);
+        }
+    }
+    // send the requests of all partitions concurrently with a bounded in-flight window. a partition has at most
+    // one request in flight, so its rows are put in the order of the insert
+    uint32_t max_inflight = std::max(FLAGS_insert_max_inflight, 1u);
+    std::deque<BatchPutTask*> inflight;
+    std::set<uint32_t> inflight_pids;
+    for (auto& task : tasks) {
+        while (inflight.size() >= max_inflight || inflight_pids.count(task->pid) > 0) {
+            WaitBatchPut(inflight.front(), failed);
+            inflight_pids.erase(inflight.front()->pid);
+            inflight.pop_front();
+        }
+        DLOG(INFO) << "batch put " << task->request.rows_size() << " rows to endpoint "
+                   << task->client->GetEndpoint() << " tid " << tid << " pid " << task->pid;
+        auto response = std::make_shared<::openmldb::api::BatchPutResponse>();
+        auto cntl = std::make_shared<::brpc::Controller>();
+        task->callback = new openmldb::RpcCallback<openmldb::api::BatchPutResponse>(response, cntl);
+        task->callback->Ref();
+        if (!task->client->AsyncBatchPut(task->request, task->callback)) {
+            LOG(WARNING) << "fail to send batch put request to " << task->client->GetEndpoint();
+            for (auto idx : task->row_idx) {
+                (*failed)[idx] = true;
+            }
+            // the callback never runs, so the reference it holds is dropped as well
+            task->callback->UnRef();
+            task->callback->UnRef();
+            task->callback = nullptr;
+            continue;
+        }
+        inflight.push_back(task.get());
+        inflight_pids.insert(task->pid);
+    }
+    while (!inflight.empty()) {
+        WaitBatchPut(inflight.front(), failed);
+        inflight.pop_front();
+    }
+    size_t failed_cnt = std::count(failed->begin(), failed->end(), true);
+    if (failed_cnt > 0) {
+        status->code = 1;
+        status->msg = "fail to put " + std::to_string(failed_cnt) + " rows to table. tid " + std::to_string(tid);
+        LOG(WARNING) << status->msg;
+        return false;
+    }
+    return true;
+}
+
 bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& sql, std::shared_ptr<SQLInsertRows> rows,
                                      hybridse::sdk::Status* status) {
+    return ExecuteInsert(db, sql, rows, nullptr, status);
+}
+
+bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& sql, std::shared_ptr<SQLInsertRows> rows,
+                                     std::vector<uint32_t>* failed_rows, hybridse::sdk::Status* status) {
     if (!rows || !status) {
         LOG(WARNING) << "input is invalid";
         return false;
@@ -1246,17 +1417,27 @@ bool SQLClusterRouter::ExecuteInsert(const std::string& db, const std::string& s
         bool ret = cluster_sdk_->GetTablet(db, table_info->name(), &tablets);
         if (!ret || tablets.empty()) {
             status->msg = "fail to get table " + table_info->name() + " tablet";
+            AddAllRows(rows->GetCnt(), failed_rows);
             return false;
         }
+        std::vector<std::shared_ptr<SQLInsertRow>> insert_rows;
+        insert_rows.reserve(rows->GetCnt());
         for (uint32_t i = 0; i < rows->GetCnt(); ++i) {
-            std::shared_ptr<SQLInsertRow> row = rows->GetRow(i);
-            if (!PutRow(table_info->tid(), row, tablets, status)) {
-                return false;
+            insert_rows.push_back(rows->GetRow(i));
+        }
+        std::vector<bool> failed;
+        bool ok = PutRows(table_info->tid(), insert_rows, tablets, &failed, status);
+        if (failed_rows != nullptr) {
+            for (uint32_t i = 0; i < failed.size(); i++) {
+                if (failed[i]) {
+                    failed_rows->push_back(i);
+                }
             }
         }
-        return true;
+        return ok;
     } else {
         status->msg = "please use getInsertRow with " + sql + " first";
+        AddAllRows(rows->GetCnt(), failed_rows);
         return false;
     }
 }
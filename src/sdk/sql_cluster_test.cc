@@ -306,6 +306,61 @@ TEST_F(SQLClusterTest, ClusterInsert) {
     ASSERT_TRUE(ok);
 }
 
+TEST_F(SQLClusterTest, ClusterInsertMultiRows) {
+    SQLRouterOptions sql_opt;
+    sql_opt.zk_cluster = mc_->GetZkCluster();
+    sql_opt.zk_path = mc_->GetZkPath();
+    auto router = NewClusterSQLRouter(sql_opt);
+    ASSERT_TRUE(router != nullptr);
+    SetOnlineMode(router);
+    std::string name = "test" + GenRand();
+    std::string db = "db" + GenRand();
+    ::hybridse::sdk::Status status;
+    bool ok = router->CreateDB(db, &status);
+    ASSERT_TRUE(ok);
+    std::string ddl = "create table " + name +
+                      "("
+                      "col1 string, col2 bigint,"
+                      "index(key=col1, ts=col2)) options(partitionnum=8);";
+    ok = router->ExecuteDDL(db, ddl, &status);
+    ASSERT_TRUE(ok);
+    ASSERT_TRUE(router->RefreshCatalog());
+    // one insert statement with rows of all partitions
+    std::string insert = "insert into " + name + " values";
+    for (int i = 0; i < 100; i++) {
+        if (i > 0) {
+            insert.append(",");
+        }
+        insert.append("('hello" + std::to_string(i) + "', 1590)");
+    }
+    insert.append(";");
+    ok = router->ExecuteInsert(db, insert, &status);
+    ASSERT_TRUE(ok) << status.msg;
+    std::vector<::openmldb::nameserver::TableInfo> tables;
+    auto ns = mc_->GetNsClient();
+    auto ret = ns->ShowDBTable(db, &tables);
+    ASSERT_TRUE(ret.OK());
+    ASSERT_EQ(tables.size(), 1);
+    auto tid = tables[0].tid();
+    uint32_t count = 0;
+    for (const auto& endpoint : mc_->GetTbEndpoint()) {
+        ::openmldb::tablet::TabletImpl* tb1 = mc_->GetTablet(endpoint);
+        ::openmldb::api::GetTableStatusRequest request;
+        ::openmldb::api::GetTableStatusResponse response;
+        request.set_tid(tid);
+        MockClosure closure;
+        tb1->GetTableStatus(NULL, &request, &response, &closure);
+        for (const auto& table_status : response.all_table_status()) {
+            count += table_status.record_cnt();
+        }
+    }
+    ASSERT_EQ(100u, count);
+    ok = router->ExecuteDDL(db, "drop table " + name + ";", &status);
+    ASSERT_TRUE(ok);
+    ok = router->DropDB(db, &status);
+    ASSERT_TRUE(ok);
+}
+
 TEST_F(SQLClusterTest, ClusterInsertWithColumnDefaultValue) {
     SQLRouterOptions sql_opt;
     sql_opt.zk_cluster = mc_->GetZkCluster();
@@ -32,6 +32,7 @@
 #include "gflags/gflags.h"
 #include "gtest/gtest.h"
 #include "sdk/mini_cluster.h"
+#include "sdk/sql_cluster_router.h"
 #include "vm/catalog.h"
 
 namespace openmldb {
@@ -322,6 +323,54 @@ TEST_F(SQLRouterTest, test_sql_insert_placeholder) {
     ASSERT_TRUE(ok);
 }
 
+TEST_F(SQLRouterTest, test_sql_insert_failed_rows) {
+    SQLRouterOptions sql_opt;
+    sql_opt.zk_cluster = mc_->GetZkCluster();
+    sql_opt.zk_path = mc_->GetZkPath();
+    auto router = std::dynamic_pointer_cast<SQLClusterRouter>(NewClusterSQLRouter(sql_opt));
+    ASSERT_TRUE(router != nullptr);
+    std::string name = "test" + GenRand();
+    std::string db = "db" + GenRand();
+    ::hybridse::sdk::Status status;
+    bool ok = router->CreateDB(db, &status);
+    ASSERT_TRUE(ok);
+    std::string ddl = "create table " + name +
+                      "("
+                      "col1 string, col2 bigint,"
+                      "index(key=col1, ts=col2));";
+    ok = router->ExecuteDDL(db, ddl, &status);
+    ASSERT_TRUE(ok);
+    ASSERT_TRUE(router->RefreshCatalog());
+
+    std::string insert_placeholder = "insert into " + name + " values(?, ?);";
+    auto build_rows = [&]() {
+        std::shared_ptr<SQLInsertRows> insert_rows = router->GetInsertRows(db, insert_placeholder, &status);
+        EXPECT_EQ(status.code, 0);
+        for (int i = 0; i < 2; i++) {
+            std::shared_ptr<SQLInsertRow> row = insert_rows->NewRow();
+            EXPECT_TRUE(row->Init(4));
+            EXPECT_TRUE(row->AppendString("key" + std::to_string(i)));
+            EXPECT_TRUE(row->AppendInt64(1590 + i));
+            EXPECT_TRUE(row->Build());
+        }
+        return insert_rows;
+    };
+    std::vector<uint32_t> failed_rows;
+    ok = router->ExecuteInsert(db, insert_placeholder, build_rows(), &failed_rows, &status);
+    ASSERT_TRUE(ok);
+    ASSERT_TRUE(failed_rows.empty());
+
+    auto insert_rows = build_rows();
+    ok = router->ExecuteDDL(db, "drop table " + name + ";", &status);
+    ASSERT_TRUE(ok);
+    ok = router->ExecuteInsert(db, insert_placeholder, insert_rows, &failed_rows, &status);
+    ASSERT_FALSE(ok);
+    ASSERT_EQ(std::vector<uint32_t>({0, 1}), failed_rows);
+
+    ok = router->DropDB(db, &status);
+    ASSERT_TRUE(ok);
+}
+
 TEST_F(SQLRouterTest, test_sql_insert_with_column_list) {
     SQLRouterOptions sql_opt;
     sql_opt.zk_cluster = mc_->GetZkCluster();
@@ -16,27 +16,133 @@
 
 #include "storage/binlog.h"
 
+#include <algorithm>
 #include <map>
+#include <memory>
 #include <set>
 #include <utility>
 #include <vector>
 
+#include "base/count_down_latch.h"
 #include "base/glog_wapper.h"
 #include "base/hash.h"
 #include "base/kv_iterator.h"
 #include "base/strings.h"
+#include "base/taskpool.hpp"
+#include "boost/bind.hpp"
 #include "codec/schema_codec.h"
 #include "common/timer.h"
 #include "gflags/gflags.h"
 #include "log/log_writer.h"
 #include "log/status.h"
+#include "storage/mem_table.h"
 
 DECLARE_uint64(gc_on_table_recover_count);
 DECLARE_int32(binlog_name_length);
+DECLARE_uint32(load_binlog_thread_num);
+DECLARE_uint32(load_table_batch);
+DECLARE_uint32(load_table_queue_size);
 
 namespace openmldb {
 namespace storage {
 
+// the same seed as the segments of the memtable
+static const uint32_t SEED = 0xe17a1465;
+
+static void ApplyEntry(Table* table, const ::openmldb::api::LogEntry& entry) {
+    if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+        if (entry.dimensions_size() == 0) {
+            PDLOG(WARNING, "no dimesion. tid %u pid %u offset %lu", table->GetId(), table->GetPid(),
+                  entry.log_index());
+        } else {
+            table->Delete(entry.dimensions(0).key(), entry.dimensions(0).idx());
+        }
+    } else {
+        table->Put(entry);
+    }
+}
+
+// replay the entries on several threads. the entries go to the threads by the segment of
+// their pk, so the entries of one pk are applied in order and the threads seldom share a
+// segment lock. a delete is applied after all the entries before it are applied
+class ParallelReplayer {
+ public:
+    ParallelReplayer(std::shared_ptr<Table> table, uint32_t thread_num)
+        : table_(table), seg_cnt_(0), pools_(), batches_() {
+        auto mem_table = std::dynamic_pointer_cast<MemTable>(table);
+        if (mem_table && mem_table->GetSegCnt() >= thread_num) {
+            seg_cnt_ = mem_table->GetSegCnt();
+        }
+        for (uint32_t i = 0; i < thread_num; i++) {
+            // one thread a pool keeps the order of the batches
+            pools_.emplace_back(new ::openmldb::base::TaskPool(1, std::max(FLAGS_load_table_queue_size, 1u)));
+            batches_.emplace_back(new std::vector<::openmldb::api::LogEntry>());
+        }
+    }
+
+    ~ParallelReplayer() {
+        for (auto& pool : pools_) {
+            pool->Stop();
+        }
+    }
+
+    // the entry is moved into the replayer
+    void Apply(::openmldb::api::LogEntry* entry) {
+        if (entry->has_method_type() && entry->method_type() == ::openmldb::api::MethodType::kDelete) {
+            Wait();
+            ApplyEntry(table_.get(), *entry);
+            return;
+        }
+        const std::string& pk = entry->dimensions_size() > 0 ? entry->dimensions(0).key() : entry->pk();
+        uint32_t idx = ::openmldb::base::hash(pk.c_str(), pk.length(), SEED);
+        if (seg_cnt_ > 0) {
+            idx %= seg_cnt_;
+        }
+        idx %= pools_.size();
+        auto& batch = batches_[idx];
+        batch->emplace_back();
+        batch->back().Swap(entry);
+        if (batch->size() >= std::max(FLAGS_load_table_batch, 1u)) {
+            Flush(idx);
+        }
+    }
+
+    // wait until all the entries are applied
+    void Wait() {
+        for (uint32_t idx = 0; idx < pools_.size(); idx++) {
+            Flush(idx);
+        }
+        ::openmldb::base::CountDownLatch latch(pools_.size());
+        for (auto& pool : pools_) {
+            pool->AddTask(boost::bind(&::openmldb::base::CountDownLatch::CountDown, &latch));
+        }
+        latch.Wait();
+    }
+
+ private:
+    void Flush(uint32_t idx) {
+        if (batches_[idx]->empty()) {
+            return;
+        }
+        pools_[idx]->AddTask(boost::bind(&ParallelReplayer::ApplyBatch, table_, batches_[idx]));
+        batches_[idx].reset(new std::vector<::openmldb::api::LogEntry>());
+        batches_[idx]->reserve(FLAGS_load_table_batch);
+    }
+
+    static void ApplyBatch(std::shared_ptr<Table> table,
+                           std::shared_ptr<std::vector<::openmldb::api::LogEntry>> batch) {
+        for (const auto& entry : *batch) {
+            table->Put(entry);
+        }
+    }
+
+    std::shared_ptr<Table> table_;
+    // shard by segment if there are enough segments, otherwise by the hash of pk
+    uint32_t seg_cnt_;
+    std::vector<std::unique_ptr<::openmldb::base::TaskPool>> pools_;
+    std::vector<std::shared_ptr<std::vector<::openmldb::api::LogEntry>>> batches_;
+};
+
 Binlog::Binlog(LogParts* log_part, const std::string& binlog_path) : log_part_(log_part), log_path_(binlog_path) {}
 
 bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, uint64_t& latest_offset) {
@@ -53,6 +159,10 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
     uint64_t consumed = ::baidu::common::timer::now_time();
     int last_log_index = log_reader.GetLogIndex();
     bool reach_end_log = true;
+    std::unique_ptr<ParallelReplayer> replayer;
+    if (FLAGS_load_binlog_thread_num > 1) {
+        replayer.reset(new ParallelReplayer(table, FLAGS_load_binlog_thread_num));
+    }
     while (true) {
         buffer.clear();
         ::openmldb::base::Slice record;
@@ -108,16 +218,12 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
                   cur_offset, entry.log_index(), tid, pid);
         }
 
-        if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
-            if (entry.dimensions_size() == 0) {
-                PDLOG(WARNING, "no dimesion. tid %u pid %u offset %lu", tid, pid, entry.log_index());
-            } else {
-                table->Delete(entry.dimensions(0).key(), entry.dimensions(0).idx());
-            }
+        cur_offset = entry.log_index();
+        if (replayer) {
+            replayer->Apply(&entry);
         } else {
-            table->Put(entry);
+            ApplyEntry(table.get(), entry);
         }
-        cur_offset = entry.log_index();
         succ_cnt++;
         if (succ_cnt % 100000 == 0) {
             PDLOG(INFO,
@@ -129,6 +235,9 @@ bool Binlog::RecoverFromBinlog(std::shared_ptr<Table> table, uint64_t offset, ui
             table->SchedGc();
         }
     }
+    if (replayer) {
+        replayer->Wait();
+    }
     latest_offset = cur_offset;
     if (!reach_end_log) {
         int log_index = log_reader.GetLogIndex();
@@ -542,6 +542,27 @@ TableIterator* DiskTable::NewTraverseIterator(uint32_t index) {
     return new DiskTableTraverseIterator(db_, it, snapshot, ttl->ttl_type, expire_time, expire_cnt);
 }
 
+::hybridse::vm::WindowIterator* DiskTable::NewWindowIterator(uint32_t idx) {
+    std::shared_ptr<IndexDef> index_def = table_index_.GetIndex(idx);
+    if (!index_def || !index_def->IsReady()) {
+        PDLOG(WARNING, "index %u not found in table, tid %u pid %u", idx, id_, pid_);
+        return NULL;
+    }
+    uint32_t inner_pos = index_def->GetInnerPos();
+    auto inner_index = table_index_.GetInnerIndex(inner_pos);
+    auto ttl = index_def->GetTTL();
+    uint64_t expire_time = GetExpireTime(*ttl);
+    uint64_t expire_cnt = ttl->lat_ttl;
+    if (inner_index && inner_index->GetIndex().size() > 1) {
+        auto ts_col = index_def->GetTsColumn();
+        if (ts_col) {
+            return new DiskTableKeyIterator(db_, cf_hs_[inner_pos + 1], ttl->ttl_type, expire_time, expire_cnt,
+                                            ts_col->GetId());
+        }
+    }
+    return new DiskTableKeyIterator(db_, cf_hs_[inner_pos + 1], ttl->ttl_type, expire_time, expire_cnt);
+}
+
 DiskTableIterator::DiskTableIterator(rocksdb::DB* db, rocksdb::Iterator* it, const rocksdb::Snapshot* snapshot,
                                      const std::string& pk)
     : db_(db), it_(it), snapshot_(snapshot), pk_(pk), ts_(0) {}
@@ -850,6 +871,173 @@ void DiskTableTraverseIterator::NextPK() {
     }
 }
 
+DiskTableRowIterator::DiskTableRowIterator(rocksdb::Iterator* it,
+                                           const std::shared_ptr<const rocksdb::Snapshot>& snapshot,
+                                           ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
+                                           uint64_t expire_cnt, const std::string& pk, bool has_ts_idx,
+                                           uint32_t ts_idx)
+    : it_(it),
+      snapshot_(snapshot),
+      prefix_(),
+      pk_(pk),
+      has_ts_idx_(has_ts_idx),
+      ts_idx_(ts_idx),
+      record_idx_(1),
+      expire_value_(expire_time, expire_cnt, ttl_type),
+      valid_(false),
+      ts_(0),
+      row_() {
+    std::string combine_key = has_ts_idx_ ? CombineKeyTs(pk_, 0, ts_idx_) : CombineKeyTs(pk_, 0);
+    prefix_.assign(combine_key.data(), combine_key.size() - TS_LEN);
+}
+
+DiskTableRowIterator::~DiskTableRowIterator() { delete it_; }
+
+void DiskTableRowIterator::ParseCurrent() {
+    valid_ = false;
+    if (!it_->Valid()) {
+        return;
+    }
+    rocksdb::Slice key;
+    SplitKeyAndTs(it_->key(), &key, &ts_);
+    valid_ = key == rocksdb::Slice(prefix_);
+}
+
+bool DiskTableRowIterator::Valid() const { return valid_ && !expire_value_.IsExpired(ts_, record_idx_); }
+
+void DiskTableRowIterator::Next() {
+    it_->Next();
+    record_idx_++;
+    ParseCurrent();
+}
+
+const uint64_t& DiskTableRowIterator::GetKey() const { return ts_; }
+
+const ::hybridse::codec::Row& DiskTableRowIterator::GetValue() {
+    // the engine may keep the row after the iterator is destroyed, so it owns a copy of the value
+    rocksdb::Slice value = it_->value();
+    auto* buf = reinterpret_cast<int8_t*>(malloc(value.size()));
+    memcpy(buf, value.data(), value.size());
+    row_ = ::hybridse::codec::Row(::hybridse::base::RefCountedSlice::CreateManaged(buf, value.size()));
+    return row_;
+}
+
+void DiskTableRowIterator::Seek(const uint64_t& key) {
+    std::string combine_key = has_ts_idx_ ? CombineKeyTs(pk_, key, ts_idx_) : CombineKeyTs(pk_, key);
+    it_->Seek(rocksdb::Slice(combine_key));
+    ParseCurrent();
+}
+
+void DiskTableRowIterator::SeekToFirst() {
+    record_idx_ = 1;
+    Seek(UINT64_MAX);
+}
+
+DiskTableKeyIterator::DiskTableKeyIterator(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* handle,
+                                           ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
+                                           uint64_t expire_cnt)
+    : DiskTableKeyIterator(db, handle, ttl_type, expire_time, expire_cnt, 0) {
+    has_ts_idx_ = false;
+}
+
+DiskTableKeyIterator::DiskTableKeyIterator(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* handle,
+                                           ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
+                                           uint64_t expire_cnt, uint32_t ts_idx)
+    : db_(db),
+      handle_(handle),
+      snapshot_(db->GetSnapshot(), [db](const rocksdb::Snapshot* snapshot) { db->ReleaseSnapshot(snapshot); }),
+      it_(NULL),
+      ttl_type_(ttl_type),
+      expire_time_(expire_time),
+      expire_cnt_(expire_cnt),
+      has_ts_idx_(true),
+      ts_idx_(ts_idx),
+      pk_(),
+      cmp_() {
+    rocksdb::ReadOptions ro = rocksdb::ReadOptions();
+    ro.snapshot = snapshot_.get();
+    // walk through all keys, so the prefix bloom filter can not be used here
+    ro.total_order_seek = true;
+    it_ = db_->NewIterator(ro, handle_);
+}
+
+DiskTableKeyIterator::~DiskTableKeyIterator() { delete it_; }
+
+void DiskTableKeyIterator::SeekToFirst() {
+    it_->SeekToFirst();
+    SkipOtherTsIdx();
+}
+
+void DiskTableKeyIterator::Seek(const std::string& key) {
+    std::string combine_key = has_ts_idx_ ? CombineKeyTs(key, UINT64_MAX, ts_idx_) : CombineKeyTs(key, UINT64_MAX);
+    it_->Seek(rocksdb::Slice(combine_key));
+    SkipOtherTsIdx();
+}
+
+void DiskTableKeyIterator::Next() { NextPK(); }
+
+bool DiskTableKeyIterator::Valid() { return it_->Valid(); }
+
+void DiskTableKeyIterator::SkipOtherTsIdx() {
+    while (it_->Valid()) {
+        uint64_t ts = 0;
+        uint32_t cur_ts_idx = UINT32_MAX;
+        if (ParseKeyAndTs(has_ts_idx_, it_->key(), pk_, ts, cur_ts_idx) != 0) {
+            it_->Next();
+            continue;
+        }
+        if (!has_ts_idx_ || cur_ts_idx == ts_idx_) {
+            return;
+        }
+        // the records of the other ts column, jump to the ts column of this pk if it is behind,
+        // or else skip all the records of the current ts column
+        std::string target = CombineKeyTs(pk_, UINT64_MAX, ts_idx_);
+        if (cmp_.Compare(rocksdb::Slice(target), it_->key()) > 0) {
+            it_->Seek(rocksdb::Slice(target));
+        } else {
+            std::string last_key = CombineKeyTs(pk_, 0, cur_ts_idx);
+            it_->Seek(rocksdb::Slice(last_key));
+            if (it_->Valid() && it_->key() == rocksdb::Slice(last_key)) {
+                it_->Next();
+            }
+        }
+    }
+}
+
+void DiskTableKeyIterator::NextPK() {
+    if (!it_->Valid()) {
+        return;
+    }
+    // the record with ts 0 is the last one of the pk
+    std::string last_key = has_ts_idx_ ? CombineKeyTs(pk_, 0, ts_idx_) : CombineKeyTs(pk_, 0);
+    it_->Seek(rocksdb::Slice(last_key));
+    if (it_->Valid() && it_->key() == rocksdb::Slice(last_key)) {
+        it_->Next();
+    }
+    SkipOtherTsIdx();
+}
+
+::hybridse::vm::RowIterator* DiskTableKeyIterator::GetRawValue() {
+    rocksdb::ReadOptions ro = rocksdb::ReadOptions();
+    ro.snapshot = snapshot_.get();
+    ro.prefix_same_as_start = true;
+    ro.pin_data = true;
+    rocksdb::Iterator* it = db_->NewIterator(ro, handle_);
+    auto row_it = new DiskTableRowIterator(it, snapshot_, ttl_type_, expire_time_, expire_cnt_, pk_, has_ts_idx_,
+                                           ts_idx_);
+    row_it->SeekToFirst();
+    return row_it;
+}
+
+std::unique_ptr<::hybridse::vm::RowIterator> DiskTableKeyIterator::GetValue() {
+    return std::unique_ptr<::hybridse::vm::RowIterator>(GetRawValue());
+}
+
+const hybridse::codec::Row DiskTableKeyIterator::GetKey() {
+    hybridse::codec::Row row(::hybridse::base::RefCountedSlice::Create(pk_.data(), pk_.size()));
+    return row;
+}
+
 bool DiskTable::DeleteIndex(const std::string& idx_name) {
     // TODO(litongxin)
     return true;
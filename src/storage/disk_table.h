@@ -102,16 +102,30 @@ static inline std::string CombineKeyTs(const std::string& key, uint64_t ts, uint
     return result;
 }
 
+// split the combined key into the pk prefix and the ts suffix without copying the pk
+static inline void SplitKeyAndTs(const rocksdb::Slice& s, rocksdb::Slice* key, uint64_t* ts) {
+    if (s.size() < TS_LEN) {
+        *key = rocksdb::Slice();
+        *ts = 0;
+        return;
+    }
+    *key = rocksdb::Slice(s.data(), s.size() - TS_LEN);
+    memcpy(static_cast<void*>(ts), s.data() + s.size() - TS_LEN, TS_LEN);
+    memrev64ifbe(static_cast<void*>(ts));
+}
+
+// keys are ordered by pk ascending and then by ts descending. the name and the order
+// must keep the same with the data on disk, so do not change them
 class KeyTSComparator : public rocksdb::Comparator {
  public:
     KeyTSComparator() {}
     const char* Name() const override { return "KeyTSComparator"; }
 
     int Compare(const rocksdb::Slice& a, const rocksdb::Slice& b) const override {
-        std::string key1, key2;
+        rocksdb::Slice key1, key2;
         uint64_t ts1 = 0, ts2 = 0;
-        ParseKeyAndTs(a, key1, ts1);
-        ParseKeyAndTs(b, key2, ts2);
+        SplitKeyAndTs(a, &key1, &ts1);
+        SplitKeyAndTs(b, &key2, &ts2);
 
         int ret = key1.compare(key2);
         if (ret != 0) {
@@ -122,6 +136,15 @@ class KeyTSComparator : public rocksdb::Comparator {
             return 0;
         }
     }
+
+    bool Equal(const rocksdb::Slice& a, const rocksdb::Slice& b) const override {
+        if (a.size() < TS_LEN || b.size() < TS_LEN) {
+            return Compare(a, b) == 0;
+        }
+        // same pk and same ts means the same bytes
+        return a == b;
+    }
+
     void FindShortestSeparator(std::string* /*start*/, const rocksdb::Slice& /*limit*/) const override {}
     void FindShortSuccessor(std::string* /*key*/) const override {}
 };
@@ -270,6 +293,72 @@ class DiskTableTraverseIterator : public TableIterator {
     uint64_t traverse_cnt_;
 };
 
+class DiskTableRowIterator : public ::hybridse::vm::RowIterator {
+ public:
+    DiskTableRowIterator(rocksdb::Iterator* it, const std::shared_ptr<const rocksdb::Snapshot>& snapshot,
+                         ::openmldb::storage::TTLType ttl_type, uint64_t expire_time, uint64_t expire_cnt,
+                         const std::string& pk, bool has_ts_idx, uint32_t ts_idx);
+    ~DiskTableRowIterator() override;
+    bool Valid() const override;
+    void Next() override;
+    const uint64_t& GetKey() const override;
+    const ::hybridse::codec::Row& GetValue() override;
+    void Seek(const uint64_t& key) override;
+    void SeekToFirst() override;
+    bool IsSeekable() const override { return true; }
+
+ private:
+    void ParseCurrent();
+
+ private:
+    rocksdb::Iterator* it_;
+    std::shared_ptr<const rocksdb::Snapshot> snapshot_;
+    // pk and ts_idx, the same as the key of prefix transform
+    std::string prefix_;
+    std::string pk_;
+    bool has_ts_idx_;
+    uint32_t ts_idx_;
+    uint32_t record_idx_;
+    TTLSt expire_value_;
+    bool valid_;
+    uint64_t ts_;
+    ::hybridse::codec::Row row_;
+};
+
+class DiskTableKeyIterator : public ::hybridse::vm::WindowIterator {
+ public:
+    DiskTableKeyIterator(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* handle, ::openmldb::storage::TTLType ttl_type,
+                         uint64_t expire_time, uint64_t expire_cnt);
+    DiskTableKeyIterator(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* handle, ::openmldb::storage::TTLType ttl_type,
+                         uint64_t expire_time, uint64_t expire_cnt, uint32_t ts_idx);
+    ~DiskTableKeyIterator() override;
+    void Seek(const std::string& key) override;
+    void SeekToFirst() override;
+    void Next() override;
+    bool Valid() override;
+    std::unique_ptr<::hybridse::vm::RowIterator> GetValue() override;
+    ::hybridse::vm::RowIterator* GetRawValue() override;
+    const hybridse::codec::Row GetKey() override;
+
+ private:
+    // move to the first record which has the same ts_idx from the current position
+    void SkipOtherTsIdx();
+    void NextPK();
+
+ private:
+    rocksdb::DB* db_;
+    rocksdb::ColumnFamilyHandle* handle_;
+    std::shared_ptr<const rocksdb::Snapshot> snapshot_;
+    rocksdb::Iterator* it_;
+    ::openmldb::storage::TTLType ttl_type_;
+    uint64_t expire_time_;
+    uint64_t expire_cnt_;
+    bool has_ts_idx_;
+    uint32_t ts_idx_;
+    std::string pk_;
+    KeyTSComparator cmp_;
+};
+
 class DiskTable : public Table {
  public:
     DiskTable(const std::string& name, uint32_t id, uint32_t pid, const std::map<std::string, uint32_t>& mapping,
@@ -323,9 +412,7 @@ class DiskTable : public Table {
 
     TableIterator* NewTraverseIterator(uint32_t idx) override;
 
-    ::hybridse::vm::WindowIterator* NewWindowIterator(uint32_t idx) { return NULL; }
-
-    ::hybridse::vm::WindowIterator* NewWindowIterator(uint32_t idx, uint32_t ts_idx) { return NULL; }
+    ::hybridse::vm::WindowIterator* NewWindowIterator(uint32_t idx) override;
 
     void SchedGc() override;
 
@@ -18,6 +18,7 @@
 #include <gflags/gflags.h>
 #include <iostream>
 #include <utility>
+#include <vector>
 #include "base/file_util.h"
 #include "base/glog_wapper.h"  // NOLINT
 #include "codec/schema_codec.h"
@@ -77,6 +78,40 @@ TEST_F(DiskTableTest, ParseKeyAndTs) {
     ASSERT_EQ(1122, (int64_t)ts);
 }
 
+TEST_F(DiskTableTest, KeyTSComparator) {
+    // the order must be the same as comparing the parsed pk and ts
+    auto legacy_compare = [](const rocksdb::Slice& a, const rocksdb::Slice& b) {
+        std::string key1, key2;
+        uint64_t ts1 = 0, ts2 = 0;
+        ParseKeyAndTs(a, key1, ts1);
+        ParseKeyAndTs(b, key2, ts2);
+        int ret = key1.compare(key2);
+        if (ret != 0) {
+            return ret < 0 ? -1 : 1;
+        }
+        if (ts1 > ts2) return -1;
+        if (ts1 < ts2) return 1;
+        return 0;
+    };
+    auto sign = [](int ret) { return ret < 0 ? -1 : (ret > 0 ? 1 : 0); };
+    std::vector<std::string> keys = {"", "abc", "abcd", "abcdefgh"};
+    std::vector<std::string> pks = {"", "a", "ab", "abc", "b", "key1", "key10", "key2", std::string("a\0b", 3)};
+    std::vector<uint64_t> ts_vec = {0, 1, 255, 256, 1552619498000, UINT64_MAX};
+    for (const auto& pk : pks) {
+        for (auto ts : ts_vec) {
+            keys.push_back(CombineKeyTs(pk, ts));
+            keys.push_back(CombineKeyTs(pk, ts, 1));
+        }
+    }
+    KeyTSComparator cmp;
+    for (const auto& a : keys) {
+        for (const auto& b : keys) {
+            ASSERT_EQ(legacy_compare(a, b), sign(cmp.Compare(a, b)));
+            ASSERT_EQ(legacy_compare(a, b) == 0, cmp.Equal(a, b));
+        }
+    }
+}
+
 TEST_F(DiskTableTest, Put) {
     std::map<std::string, uint32_t> mapping;
     mapping.insert(std::make_pair("idx0", 0));
@@ -680,6 +715,120 @@ TEST_F(DiskTableTest, TraverseIteratorLatest) {
     RemoveData(table_path);
 }
 
+TEST_F(DiskTableTest, WindowIterator) {
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_tid(15);
+    table_meta.set_pid(1);
+    table_meta.set_storage_mode(::openmldb::common::kHDD);
+    table_meta.set_format_version(1);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "mcc", ::openmldb::type::kString);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts1", ::openmldb::type::kBigInt);
+    SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts2", ::openmldb::type::kBigInt);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts1", ::openmldb::type::kLatestTime, 0, 3);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "card1", "card", "ts2", ::openmldb::type::kAbsoluteTime, 0, 0);
+    SchemaCodec::SetIndex(table_meta.add_column_key(), "mcc", "mcc", "ts2", ::openmldb::type::kAbsoluteTime, 0, 0);
+
+    std::string table_path = FLAGS_hdd_root_path + "/15_1";
+    DiskTable* table = new DiskTable(table_meta, table_path);
+    ASSERT_TRUE(table->Init());
+
+    codec::SDKCodec codec(table_meta);
+    for (int idx = 0; idx < 10; idx++) {
+        Dimensions dims;
+        ::openmldb::api::Dimension* dim = dims.Add();
+        dim->set_key("card" + std::to_string(idx));
+        dim->set_idx(0);
+        ::openmldb::api::Dimension* dim1 = dims.Add();
+        dim1->set_key("card" + std::to_string(idx));
+        dim1->set_idx(1);
+        ::openmldb::api::Dimension* dim2 = dims.Add();
+        dim2->set_key("mcc" + std::to_string(idx));
+        dim2->set_idx(2);
+        for (int i = 0; i < 5; i++) {
+            std::vector<std::string> row = {"card" + std::to_string(idx), "mcc" + std::to_string(idx),
+                                            std::to_string(1000 + i), std::to_string(2000 + i)};
+            std::string value;
+            ASSERT_EQ(0, codec.EncodeRow(row, &value));
+            ASSERT_TRUE(table->Put(0, value, dims));
+        }
+    }
+    // the latest ttl is respected in every window
+    std::unique_ptr<::hybridse::vm::WindowIterator> it(table->NewWindowIterator(0));
+    ASSERT_TRUE(it);
+    it->SeekToFirst();
+    int pk_cnt = 0;
+    while (it->Valid()) {
+        auto row_it = it->GetValue();
+        row_it->SeekToFirst();
+        int row_cnt = 0;
+        uint64_t last_ts = UINT64_MAX;
+        while (row_it->Valid()) {
+            ASSERT_LT(row_it->GetKey(), last_ts);
+            last_ts = row_it->GetKey();
+            ASSERT_EQ(1004u - row_cnt, last_ts);
+            row_cnt++;
+            row_it->Next();
+        }
+        ASSERT_EQ(3, row_cnt);
+        pk_cnt++;
+        it->Next();
+    }
+    ASSERT_EQ(10, pk_cnt);
+
+    // the other ts column of the same pk
+    it.reset(table->NewWindowIterator(1));
+    ASSERT_TRUE(it);
+    it->Seek("card5");
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ("card5", it->GetKey().ToString());
+    auto row_it = it->GetValue();
+    row_it->Seek(2002);
+    int row_cnt = 0;
+    while (row_it->Valid()) {
+        ASSERT_EQ(2002u - row_cnt, row_it->GetKey());
+        row_cnt++;
+        row_it->Next();
+    }
+    ASSERT_EQ(3, row_cnt);
+
+    // the rows are still valid after their iterators are destroyed
+    std::vector<::hybridse::codec::Row> rows;
+    row_it->SeekToFirst();
+    while (row_it->Valid()) {
+        rows.push_back(row_it->GetValue());
+        row_it->Next();
+    }
+    row_it.reset();
+    it.reset(table->NewWindowIterator(1));
+    ASSERT_EQ(5u, rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        std::vector<std::string> row;
+        ASSERT_EQ(0, codec.DecodeRow(std::string(reinterpret_cast<const char*>(rows[i].buf()), rows[i].size()),
+                                     &row));
+        ASSERT_EQ("card5", row[0]);
+        ASSERT_EQ(std::to_string(2004 - i), row[3]);
+    }
+    pk_cnt = 0;
+    it->SeekToFirst();
+    while (it->Valid()) {
+        pk_cnt++;
+        it->Next();
+    }
+    ASSERT_EQ(10, pk_cnt);
+
+    it.reset(table->NewWindowIterator(2));
+    ASSERT_TRUE(it);
+    it->Seek("mcc9");
+    ASSERT_TRUE(it->Valid());
+    ASSERT_EQ("mcc9", it->GetKey().ToString());
+    it->Next();
+    ASSERT_FALSE(it->Valid());
+    it.reset();
+    delete table;
+    RemoveData(table_path);
+}
+
 TEST_F(DiskTableTest, Load) {
     std::map<std::string, uint32_t> mapping;
     mapping.insert(std::make_pair("idx0", 0));
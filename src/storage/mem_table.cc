@@ -16,7 +16,10 @@
 
 #include "storage/mem_table.h"
 
+#include <snappy.h>
+
 #include <algorithm>
+#include <string>
 #include <utility>
 
 #include "base/glog_wapper.h"
@@ -32,12 +35,30 @@ DECLARE_uint32(key_entry_max_height);
 DECLARE_uint32(absolute_default_skiplist_height);
 DECLARE_uint32(latest_default_skiplist_height);
 DECLARE_uint32(max_traverse_cnt);
+DECLARE_bool(gc_use_expire_index);
+DECLARE_string(mem_table_compression);
 
 namespace openmldb {
 namespace storage {
 
 static const uint32_t SEED = 0xe17a1465;
 
+::hybridse::base::RefCountedSlice UncompressRow(const DataBlock* block) {
+    size_t size = 0;
+    if (!snappy::GetUncompressedLength(block->data, block->size, &size)) {
+        PDLOG(WARNING, "fail to get uncompressed length of row. size %u", block->size);
+        return ::hybridse::base::RefCountedSlice();
+    }
+    // the buffer is freed by the slice
+    auto* buf = reinterpret_cast<char*>(malloc(size));
+    if (!snappy::RawUncompress(block->data, block->size, buf)) {
+        PDLOG(WARNING, "fail to uncompress row. size %u", block->size);
+        free(buf);
+        return ::hybridse::base::RefCountedSlice();
+    }
+    return ::hybridse::base::RefCountedSlice::CreateManaged(reinterpret_cast<int8_t*>(buf), size);
+}
+
 MemTable::MemTable(const std::string& name, uint32_t id, uint32_t pid, uint32_t seg_cnt,
                    const std::map<std::string, uint32_t>& mapping, uint64_t ttl, ::openmldb::type::TTLType ttl_type)
     : Table(::openmldb::common::StorageMode::kMemory, name, id, pid, ttl * 60 * 1000, true, 60 * 1000, mapping,
@@ -116,10 +137,18 @@ bool MemTable::Init() {
                 PDLOG(INFO, "init %u, %u segment. height %u tid %u pid %u", i, j, cur_key_entry_max_height, id_, pid_);
             }
         }
+        if (UseExpireIndex(*inner_indexs->at(i))) {
+            for (uint32_t j = 0; j < seg_cnt_; j++) {
+                seg_arr[j]->SetExpireIndex(true);
+            }
+        }
         segments_[i] = seg_arr;
         key_entry_max_height_ = cur_key_entry_max_height;
     }
-    PDLOG(INFO, "init table name %s, id %d, pid %d, seg_cnt %d", name_.c_str(), id_, pid_, seg_cnt_);
+    // rows of snappy compressed tables are compressed by the client already
+    compress_row_ = FLAGS_mem_table_compression == "snappy" && compress_type_ != ::openmldb::type::kSnappy;
+    PDLOG(INFO, "init table name %s, id %d, pid %d, seg_cnt %d, compress row %d", name_.c_str(), id_, pid_, seg_cnt_,
+          compress_row_);
     return true;
 }
 
@@ -159,7 +188,15 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
         }
         inner_index_key_map.emplace(inner_pos, iter->key());
     }
-    uint32_t real_ref_cnt = 0;
+    std::map<int32_t, uint64_t> ts_map;
+    if (!GetTsMap(time, value, inner_index_key_map, &ts_map)) {
+        return false;
+    }
+    return PutRow(Slice(value), inner_index_key_map, ts_map, nullptr);
+}
+
+bool MemTable::GetTsMap(uint64_t time, const std::string& value, const std::map<int32_t, Slice>& inner_index_key_map,
+                        std::map<int32_t, uint64_t>* ts_map) {
     const int8_t* data = reinterpret_cast<const int8_t*>(value.data());
     uint8_t version = codec::RowView::GetSchemaVersion(data);
     auto decoder = GetVersionDecoder(version);
@@ -167,7 +204,6 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
         PDLOG(WARNING, "invalid schema version %u, tid %u pid %u", version, id_, pid_);
         return false;
     }
-    std::map<int32_t, uint64_t> ts_map;
     for (const auto& kv : inner_index_key_map) {
         auto inner_index = table_index_.GetInnerIndex(kv.first);
         if (!inner_index) {
@@ -184,17 +220,40 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
                     PDLOG(WARNING, "get ts failed. tid %u pid %u", id_, pid_);
                     return false;
                 }
-                ts_map.emplace(ts_col->GetId(), ts);
+                ts_map->emplace(ts_col->GetId(), ts);
             }
+        }
+    }
+    return !ts_map->empty();
+}
+
+bool MemTable::PutRow(const Slice& value, const std::map<int32_t, Slice>& inner_index_key_map,
+                      const std::map<int32_t, uint64_t>& ts_map, const std::map<int32_t, uint32_t>* seg_idx_map) {
+    uint32_t real_ref_cnt = 0;
+    for (const auto& kv : inner_index_key_map) {
+        auto inner_index = table_index_.GetInnerIndex(kv.first);
+        if (!inner_index) {
+            PDLOG(WARNING, "invalid inner index pos %d. tid %u pid %u", kv.first, id_, pid_);
+            return false;
+        }
+        for (const auto& index_def : inner_index->GetIndex()) {
             if (index_def->IsReady()) {
                 real_ref_cnt++;
             }
         }
     }
-    if (ts_map.empty()) {
-        return false;
+    DataBlock* block = nullptr;
+    std::string compressed;
+    if (compress_row_) {
+        snappy::Compress(value.data(), value.size(), &compressed);
+    }
+    // keep the raw row if it does not shrink
+    if (compress_row_ && compressed.size() < value.size()) {
+        block = DataBlock::Create(real_ref_cnt, compressed.data(), compressed.size());
+        block->compressed = true;
+    } else {
+        block = DataBlock::Create(real_ref_cnt, value.data(), value.size());
     }
-    auto* block = new DataBlock(real_ref_cnt, value.c_str(), value.length());
     for (const auto& kv : inner_index_key_map) {
         auto inner_index = table_index_.GetInnerIndex(kv.first);
         bool need_put = false;
@@ -207,18 +266,91 @@ bool MemTable::Put(uint64_t time, const std::string& value, const Dimensions& di
         }
         if (need_put) {
             uint32_t seg_idx = 0;
-            if (seg_cnt_ > 1) {
+            if (seg_idx_map != nullptr) {
+                seg_idx = seg_idx_map->at(kv.first);
+            } else if (seg_cnt_ > 1) {
                 seg_idx = ::openmldb::base::hash(kv.second.data(), kv.second.size(), SEED) % seg_cnt_;
             }
             Segment* segment = segments_[kv.first][seg_idx];
-            segment->Put(::openmldb::base::Slice(kv.second), ts_map, block);
+            segment->Put(kv.second, ts_map, block);
         }
     }
     record_cnt_.fetch_add(1, std::memory_order_relaxed);
-    record_byte_size_.fetch_add(GetRecordSize(value.length()));
+    record_byte_size_.fetch_add(GetRecordSize(block->size));
     return true;
 }
 
+bool MemTable::BuildSnapshotRecord(const ::openmldb::api::LogEntry& entry, SnapshotRecord* record) {
+    record->Clear();
+    record->log_index = entry.log_index();
+    record->time = entry.ts();
+    record->term = entry.term();
+    record->pk.reset(entry.pk().data(), entry.pk().size());
+    record->value.reset(entry.value().data(), entry.value().size());
+    for (const auto& ts_dimension : entry.ts_dimensions()) {
+        record->ts_dimensions.push_back({ts_dimension.idx(), ts_dimension.ts()});
+    }
+    std::map<int32_t, Slice> inner_index_key_map;
+    bool valid = entry.value().length() >= codec::HEADER_LENGTH && entry.dimensions_size() > 0;
+    for (const auto& dimension : entry.dimensions()) {
+        uint32_t seg_idx = 0;
+        if (seg_cnt_ > 1) {
+            seg_idx = ::openmldb::base::hash(dimension.key().data(), dimension.key().size(), SEED) % seg_cnt_;
+        }
+        record->dimensions.push_back({dimension.idx(), seg_idx, Slice(dimension.key())});
+        int32_t inner_pos = table_index_.GetInnerIndexPos(dimension.idx());
+        if (inner_pos < 0) {
+            valid = false;
+            continue;
+        }
+        inner_index_key_map.emplace(inner_pos, dimension.key());
+    }
+    // the record is still written without ts, it takes the LogEntry path on loading
+    if (!valid || !GetTsMap(entry.ts(), entry.value(), inner_index_key_map, &record->ts_map)) {
+        record->ts_map.clear();
+        return false;
+    }
+    return true;
+}
+
+bool MemTable::Put(const SnapshotRecord& record, bool use_seg_idx) {
+    bool fast_path = !record.ts_map.empty();
+    std::map<int32_t, Slice> inner_index_key_map;
+    std::map<int32_t, uint32_t> seg_idx_map;
+    for (const auto& dim : record.dimensions) {
+        int32_t inner_pos = table_index_.GetInnerIndexPos(dim.idx);
+        if (inner_pos < 0 || (use_seg_idx && dim.seg_idx >= seg_cnt_)) {
+            fast_path = false;
+            break;
+        }
+        inner_index_key_map.emplace(inner_pos, dim.key);
+        seg_idx_map.emplace(inner_pos, dim.seg_idx);
+    }
+    if (fast_path) {
+        // indexes may have changed since the snapshot was made
+        for (const auto& kv : inner_index_key_map) {
+            auto inner_index = table_index_.GetInnerIndex(kv.first);
+            if (!inner_index) {
+                fast_path = false;
+                break;
+            }
+            for (const auto& index_def : inner_index->GetIndex()) {
+                auto ts_col = index_def->GetTsColumn();
+                if (ts_col && record.ts_map.find(ts_col->GetId()) == record.ts_map.end()) {
+                    fast_path = false;
+                    break;
+                }
+            }
+        }
+    }
+    if (fast_path) {
+        return PutRow(record.value, inner_index_key_map, record.ts_map, use_seg_idx ? &seg_idx_map : nullptr);
+    }
+    ::openmldb::api::LogEntry entry;
+    SnapshotRecordToLogEntry(record, &entry);
+    return Put(entry.ts(), entry.value(), entry.dimensions());
+}
+
 bool MemTable::Delete(const std::string& pk, uint32_t idx) {
     std::shared_ptr<IndexDef> index_def = GetIndex(idx);
     if (!index_def || !index_def->IsReady()) {
@@ -260,6 +392,7 @@ void MemTable::SchedGc() {
     uint64_t gc_idx_cnt = 0;
     uint64_t gc_record_cnt = 0;
     uint64_t gc_record_byte_size = 0;
+    uint64_t gc_visited_key_cnt = 0;
     auto inner_indexs = table_index_.GetAllInnerIndex();
     for (uint32_t i = 0; i < inner_indexs->size(); i++) {
         const std::vector<std::shared_ptr<IndexDef>>& real_index = inner_indexs->at(i)->GetIndex();
@@ -293,6 +426,14 @@ void MemTable::SchedGc() {
                 deleted_num++;
             }
         }
+        // the ttl type may be changed or the expire index turned off since the segments were created
+        if (segments_[i] != NULL && !UseExpireIndex(*inner_indexs->at(i))) {
+            for (uint32_t j = 0; j < seg_cnt_; j++) {
+                if (segments_[i][j] != NULL && segments_[i][j]->UseExpireIndex()) {
+                    segments_[i][j]->SetExpireIndex(false);
+                }
+            }
+        }
         if (!enable_gc_.load(std::memory_order_relaxed) || !need_gc) {
             continue;
         }
@@ -302,6 +443,7 @@ void MemTable::SchedGc() {
         for (uint32_t j = 0; j < seg_cnt_; j++) {
             uint64_t seg_gc_time = ::baidu::common::timer::get_micros() / 1000;
             Segment* segment = segments_[i][j];
+            uint64_t visited_key_cnt = segment->GetGcVisitedKeyCnt();
             segment->IncrGcVersion();
             segment->GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
             if (ttl_st_map.size() == 1) {
@@ -310,20 +452,31 @@ void MemTable::SchedGc() {
                 segment->ExecuteGc(ttl_st_map, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
             }
             seg_gc_time = ::baidu::common::timer::get_micros() / 1000 - seg_gc_time;
-            PDLOG(INFO, "gc segment[%u][%u] done consumed %lu for table %s tid %u pid %u", i, j, seg_gc_time,
-                  name_.c_str(), id_, pid_);
+            visited_key_cnt = segment->GetGcVisitedKeyCnt() - visited_key_cnt;
+            gc_visited_key_cnt += visited_key_cnt;
+            PDLOG(INFO, "gc segment[%u][%u] done consumed %lu visited key %lu for table %s tid %u pid %u", i, j,
+                  seg_gc_time, visited_key_cnt, name_.c_str(), id_, pid_);
         }
     }
     consumed = ::baidu::common::timer::get_micros() - consumed;
     record_cnt_.fetch_sub(gc_record_cnt, std::memory_order_relaxed);
     record_byte_size_.fetch_sub(gc_record_byte_size, std::memory_order_relaxed);
+    last_gc_consumed_.store(consumed / 1000, std::memory_order_relaxed);
+    last_gc_visited_key_cnt_.store(gc_visited_key_cnt, std::memory_order_relaxed);
     PDLOG(INFO,
-          "gc finished, gc_idx_cnt %lu, gc_record_cnt %lu consumed %lu ms for "
+          "gc finished, gc_idx_cnt %lu, gc_record_cnt %lu, visited key %lu consumed %lu ms for "
           "table %s tid %u pid %u",
-          gc_idx_cnt, gc_record_cnt, consumed / 1000, name_.c_str(), id_, pid_);
+          gc_idx_cnt, gc_record_cnt, gc_visited_key_cnt, consumed / 1000, name_.c_str(), id_, pid_);
     UpdateTTL();
 }
 
+bool MemTable::UseExpireIndex(const InnerIndexSt& inner_index) {
+    // only the segments gc by Gc4TTL alone can use the expire index
+    const auto& indexs = inner_index.GetIndex();
+    return FLAGS_gc_use_expire_index && indexs.size() == 1 && inner_index.GetTsIdx().size() <= 1 &&
+           indexs[0]->GetTTLType() == ::openmldb::storage::TTLType::kAbsoluteTime;
+}
+
 // tll as ms
 uint64_t MemTable::GetExpireTime(const TTLSt& ttl_st) {
     if (!enable_gc_.load(std::memory_order_relaxed) || ttl_st.abs_ttl == 0 ||
@@ -616,6 +769,11 @@ bool MemTable::AddIndex(const ::openmldb::common::ColumnKey& column_key) {
         index_def->SetInnerPos(inner_id);
         std::vector<std::shared_ptr<IndexDef>> index_vec = {index_def};
         auto inner_index_st = std::make_shared<InnerIndexSt>(inner_id, index_vec);
+        if (UseExpireIndex(*inner_index_st)) {
+            for (uint32_t j = 0; j < seg_cnt_; j++) {
+                segments_[inner_id][j]->SetExpireIndex(true);
+            }
+        }
         table_index_.AddInnerIndex(inner_index_st);
         table_index_.SetInnerIndexPos(new_table_meta->column_key_size() - 1, inner_id);
     }
@@ -1042,9 +1200,7 @@ void MemTableTraverseIterator::Seek(const std::string& key, uint64_t ts) {
     }
 }
 
-openmldb::base::Slice MemTableTraverseIterator::GetValue() const {
-    return openmldb::base::Slice(it_->GetValue()->data, it_->GetValue()->size);
-}
+openmldb::base::Slice MemTableTraverseIterator::GetValue() const { return GetBlockRow(it_->GetValue(), &row_buf_); }
 
 uint64_t MemTableTraverseIterator::GetKey() const {
     if (it_ != NULL && it_->Valid()) {
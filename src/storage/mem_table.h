@@ -26,6 +26,7 @@
 #include "proto/tablet.pb.h"
 #include "storage/iterator.h"
 #include "storage/segment.h"
+#include "storage/snapshot_record.h"
 #include "storage/table.h"
 #include "storage/ticket.h"
 #include "vm/catalog.h"
@@ -38,11 +39,14 @@ namespace storage {
 
 typedef google::protobuf::RepeatedPtrField<::openmldb::api::Dimension> Dimensions;
 
+// uncompress the row of a compressed block into a buffer owned by the returned slice
+::hybridse::base::RefCountedSlice UncompressRow(const DataBlock* block);
+
 class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
  public:
     MemTableWindowIterator(TimeEntries::Iterator* it, ::openmldb::storage::TTLType ttl_type, uint64_t expire_time,
                            uint64_t expire_cnt)
-        : it_(it), record_idx_(1), expire_value_(expire_time, expire_cnt, ttl_type), row_() {}
+        : it_(it), record_idx_(1), expire_value_(expire_time, expire_cnt, ttl_type), row_(), owned_row_(false) {}
 
     ~MemTableWindowIterator() { delete it_; }
 
@@ -62,7 +66,18 @@ class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
 
     // TODO(wangtaize) unify the row object
     inline const ::hybridse::codec::Row& GetValue() {
-        row_.Reset(reinterpret_cast<const int8_t*>(it_->GetValue()->data), it_->GetValue()->size);
+        const DataBlock* block = it_->GetValue();
+        if (block->compressed) {
+            // the engine may keep the row after Next, so it owns the uncompressed buffer
+            row_ = ::hybridse::codec::Row(UncompressRow(block));
+            owned_row_ = true;
+        } else {
+            if (owned_row_) {
+                row_ = ::hybridse::codec::Row();
+                owned_row_ = false;
+            }
+            row_.Reset(reinterpret_cast<const int8_t*>(block->data), block->size);
+        }
         return row_;
     }
     inline void Seek(const uint64_t& key) { it_->Seek(key); }
@@ -74,6 +89,7 @@ class MemTableWindowIterator : public ::hybridse::vm::RowIterator {
     uint32_t record_idx_;
     TTLSt expire_value_;
     ::hybridse::codec::Row row_;
+    bool owned_row_;
 };
 
 class MemTableKeyIterator : public ::hybridse::vm::WindowIterator {
@@ -142,6 +158,8 @@ class MemTableTraverseIterator : public TableIterator {
     TTLSt expire_value_;
     Ticket ticket_;
     uint64_t traverse_cnt_;
+    // the uncompressed current row, the value is valid until the next GetValue
+    mutable std::string row_buf_;
 };
 
 class MemTable : public Table {
@@ -160,6 +178,14 @@ class MemTable : public Table {
 
     bool Put(uint64_t time, const std::string& value, const Dimensions& dimensions) override;
 
+    // precompute the segment and ts of every dimension of the entry. ts_map of
+    // the record is left empty if the entry can not be put
+    bool BuildSnapshotRecord(const ::openmldb::api::LogEntry& entry, SnapshotRecord* record);
+
+    // put a record of native snapshot. use_seg_idx is false if the seg_cnt has
+    // changed since the snapshot was made
+    bool Put(const SnapshotRecord& record, bool use_seg_idx);
+
     bool GetBulkLoadInfo(::openmldb::api::BulkLoadInfoResponse* response);
 
     bool BulkLoad(const std::vector<DataBlock*>& data_blocks,
@@ -212,11 +238,25 @@ class MemTable : public Table {
 
     inline uint32_t GetKeyEntryHeight() const { return key_entry_max_height_; }
 
+    // the time in ms and the count of visited keys of the last gc
+    uint64_t GetLastGcConsumed() const { return last_gc_consumed_.load(std::memory_order_relaxed); }
+
+    uint64_t GetLastGcVisitedKeyCnt() const { return last_gc_visited_key_cnt_.load(std::memory_order_relaxed); }
+
     bool DeleteIndex(const std::string& idx_name) override;
 
     bool AddIndex(const ::openmldb::common::ColumnKey& column_key);
 
  private:
+    bool GetTsMap(uint64_t time, const std::string& value, const std::map<int32_t, Slice>& inner_index_key_map,
+                  std::map<int32_t, uint64_t>* ts_map);
+
+    // seg_idx_map is inner index pos -> seg_idx, the seg_idx is hashed from key if it is nullptr
+    bool PutRow(const Slice& value, const std::map<int32_t, Slice>& inner_index_key_map,
+                const std::map<int32_t, uint64_t>& ts_map, const std::map<int32_t, uint32_t>* seg_idx_map);
+
+    bool UseExpireIndex(const InnerIndexSt& inner_index);
+
     bool CheckAbsolute(const TTLSt& ttl, uint64_t ts);
 
     bool CheckLatest(uint32_t index_id, const std::string& key, uint64_t ts);
@@ -230,6 +270,10 @@ class MemTable : public Table {
     bool segment_released_;
     std::atomic<uint64_t> record_byte_size_;
     uint32_t key_entry_max_height_;
+    std::atomic<uint64_t> last_gc_consumed_{0};
+    std::atomic<uint64_t> last_gc_visited_key_cnt_{0};
+    // compress the rows stored in segments with snappy
+    bool compress_row_{false};
 };
 
 }  // namespace storage
@@ -17,9 +17,12 @@
 #include "codec/schema_codec.h"
 #include "codec/sdk_codec.h"
 #include "common/timer.h"
+#include "gflags/gflags.h"
 #include "gtest/gtest.h"
 #include "storage/mem_table.h"
 
+DECLARE_string(mem_table_compression);
+
 namespace openmldb {
 namespace storage {
 
@@ -95,6 +98,70 @@ TEST_F(MemTableIteratorTest, latest) {
     ASSERT_EQ(3, cnt);
 }
 
+TEST_F(MemTableIteratorTest, compressed_row) {
+    std::string compression = FLAGS_mem_table_compression;
+    FLAGS_mem_table_compression = "snappy";
+    ::openmldb::api::TableMeta table_meta;
+    table_meta.set_name("table1");
+    table_meta.set_tid(1);
+    table_meta.set_pid(0);
+    table_meta.set_mode(::openmldb::api::TableMode::kTableLeader);
+    table_meta.set_format_version(1);
+    codec::SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "card", ::openmldb::type::kString);
+    codec::SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "mcc", ::openmldb::type::kString);
+    codec::SchemaCodec::SetColumnDesc(table_meta.add_column_desc(), "ts", ::openmldb::type::kBigInt);
+    codec::SchemaCodec::SetIndex(table_meta.add_column_key(), "card", "card", "ts", ::openmldb::type::kAbsoluteTime, 0,
+                                 0);
+    MemTable table(table_meta);
+    table.Init();
+    FLAGS_mem_table_compression = compression;
+    codec::SDKCodec codec(table_meta);
+    uint64_t now = ::baidu::common::timer::get_micros() / 1000;
+    std::string mcc(200, 'm');
+    std::vector<std::string> values;
+    uint64_t raw_size = 0;
+    for (int i = 0; i < 10; i++) {
+        std::vector<std::string> row = {"card0", mcc, std::to_string(now - i)};
+        ::openmldb::api::PutRequest request;
+        ::openmldb::api::Dimension* dim = request.add_dimensions();
+        dim->set_idx(0);
+        dim->set_key("card0");
+        std::string value;
+        ASSERT_EQ(0, codec.EncodeRow(row, &value));
+        ASSERT_TRUE(table.Put(0, value, request.dimensions()));
+        raw_size += value.size();
+        values.push_back(value);
+    }
+    ASSERT_LT(table.GetRecordByteSize(), raw_size);
+    std::unique_ptr<::hybridse::vm::WindowIterator> it(table.NewWindowIterator(0));
+    it->Seek("card0");
+    ASSERT_TRUE(it->Valid());
+    std::unique_ptr<::hybridse::vm::RowIterator> wit = it->GetValue();
+    wit->SeekToFirst();
+    // the rows stay valid after the iterator moves on
+    std::vector<::hybridse::codec::Row> rows;
+    while (wit->Valid()) {
+        rows.push_back(wit->GetValue());
+        wit->Next();
+    }
+    ASSERT_EQ(values.size(), rows.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        ASSERT_EQ(values[i], rows[i].ToString());
+    }
+    Ticket ticket;
+    std::unique_ptr<TableIterator> tit(table.NewIterator(0, "card0", ticket));
+    tit->SeekToFirst();
+    // the table iterator reuses one row buffer, the value is read before Next
+    size_t cnt = 0;
+    while (tit->Valid()) {
+        ASSERT_LT(cnt, values.size());
+        ASSERT_EQ(values[cnt], tit->GetValue().ToString());
+        cnt++;
+        tit->Next();
+    }
+    ASSERT_EQ(values.size(), cnt);
+}
+
 }  // namespace storage
 }  // namespace openmldb
 
@@ -23,6 +23,7 @@
 #include <snappy.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <set>
 #include <utility>
 
@@ -53,6 +54,10 @@ DECLARE_uint32(load_table_batch);
 DECLARE_uint32(load_table_thread_num);
 DECLARE_uint32(load_table_queue_size);
 DECLARE_string(snapshot_compression);
+DECLARE_uint64(snapshot_chunk_size);
+DECLARE_string(snapshot_format);
+DECLARE_uint32(snapshot_delta_max_num);
+DECLARE_uint32(snapshot_delta_compact_ratio);
 
 namespace openmldb {
 namespace storage {
@@ -61,6 +66,179 @@ const std::string SNAPSHOT_SUBFIX = ".sdb";  // NOLINT
 const uint32_t KEY_NUM_DISPLAY = 1000000;    // NOLINT
 const std::string MANIFEST = "MANIFEST";     // NOLINT
 
+SnapshotReader::SnapshotReader(const std::string& snapshot_path, const ::openmldb::api::Manifest& manifest)
+    : snapshot_path_(snapshot_path),
+      files_(Snapshot::GetBaseSnapshotFiles(manifest)),
+      native_(manifest.format() == ::openmldb::api::kNativeFormat),
+      idx_(0),
+      seq_file_(NULL),
+      reader_(NULL) {}
+
+SnapshotReader::SnapshotReader(const std::string& snapshot_path, const std::vector<std::string>& files)
+    : snapshot_path_(snapshot_path), files_(files), native_(false), idx_(0), seq_file_(NULL), reader_(NULL) {}
+
+SnapshotReader::~SnapshotReader() { CloseFile(); }
+
+bool SnapshotReader::Init() {
+    if (files_.empty()) {
+        PDLOG(WARNING, "no snapshot file in %s", snapshot_path_.c_str());
+        return false;
+    }
+    return OpenFile(0);
+}
+
+bool SnapshotReader::OpenFile(uint32_t idx) {
+    CloseFile();
+    idx_ = idx;
+    path_ = snapshot_path_ + files_[idx];
+    FILE* fd = fopen(path_.c_str(), "rb");
+    if (fd == NULL) {
+        PDLOG(WARNING, "fail to open path %s for error %s", path_.c_str(), strerror(errno));
+        return false;
+    }
+    seq_file_ = ::openmldb::log::NewSeqFile(path_, fd);
+    reader_ = new ::openmldb::log::Reader(seq_file_, NULL, false, 0, MemTableSnapshot::IsCompressed(path_));
+    return true;
+}
+
+void SnapshotReader::CloseFile() {
+    delete reader_;
+    reader_ = NULL;
+    // will close the fd atomic
+    delete seq_file_;
+    seq_file_ = NULL;
+}
+
+::openmldb::log::Status SnapshotReader::ReadRecord(::openmldb::base::Slice* record, std::string* buffer) {
+    while (reader_ != NULL) {
+        ::openmldb::log::Status status = reader_->ReadRecord(record, buffer);
+        if (status.ok() && native_) {
+            if (!DecodeSnapshotRecord(*record, &native_record_)) {
+                return ::openmldb::log::Status::Corruption("fail to decode native snapshot record");
+            }
+            SnapshotRecordToLogEntry(native_record_, &entry_);
+            entry_.SerializeToString(&entry_buffer_);
+            record->reset(entry_buffer_.data(), entry_buffer_.size());
+            return status;
+        }
+        if (!status.IsEof() || idx_ + 1 >= files_.size()) {
+            return status;
+        }
+        if (!OpenFile(idx_ + 1)) {
+            return ::openmldb::log::Status::IOError(path_);
+        }
+    }
+    return ::openmldb::log::Status::Eof();
+}
+
+SnapshotWriter::SnapshotWriter(const std::string& snapshot_path, const std::string& snapshot_name,
+                               uint64_t chunk_size, std::shared_ptr<MemTable> table)
+    : snapshot_path_(snapshot_path),
+      snapshot_name_(snapshot_name),
+      chunk_size_(chunk_size),
+      table_(table),
+      wh_(NULL),
+      chunks_(),
+      committed_(false) {}
+
+SnapshotWriter::~SnapshotWriter() {
+    CloseChunk();
+    if (!committed_) {
+        for (const auto& chunk : chunks_) {
+            unlink((snapshot_path_ + chunk.name() + ".tmp").c_str());
+        }
+    }
+}
+
+bool SnapshotWriter::Init() { return OpenChunk(); }
+
+std::string SnapshotWriter::GetChunkName(uint32_t idx) const {
+    if (idx == 0) {
+        return snapshot_name_;
+    }
+    // xxx.sdb.snappy -> xxx_1.sdb.snappy
+    std::string name = snapshot_name_;
+    size_t pos = name.find(SNAPSHOT_SUBFIX);
+    if (pos == std::string::npos) {
+        pos = name.length();
+    }
+    return name.insert(pos, "_" + std::to_string(idx));
+}
+
+bool SnapshotWriter::OpenChunk() {
+    std::string chunk_name = GetChunkName(chunks_.size());
+    std::string tmp_file_path = snapshot_path_ + chunk_name + ".tmp";
+    FILE* fd = fopen(tmp_file_path.c_str(), "ab+");
+    if (fd == NULL) {
+        PDLOG(WARNING, "fail to create file %s", tmp_file_path.c_str());
+        return false;
+    }
+    wh_ = new WriteHandle(FLAGS_snapshot_compression, chunk_name + ".tmp", fd);
+    ::openmldb::api::SnapshotChunk chunk;
+    chunk.set_name(chunk_name);
+    chunk.set_count(0);
+    chunks_.push_back(chunk);
+    return true;
+}
+
+void SnapshotWriter::CloseChunk() {
+    if (wh_ != NULL) {
+        wh_->EndLog();
+        delete wh_;
+        wh_ = NULL;
+    }
+}
+
+::openmldb::log::Status SnapshotWriter::Write(const ::openmldb::base::Slice& record) {
+    if (wh_ != NULL && chunk_size_ > 0 && wh_->GetSize() >= chunk_size_) {
+        CloseChunk();
+        if (!OpenChunk()) {
+            return ::openmldb::log::Status::IOError("fail to create snapshot chunk");
+        }
+    }
+    if (wh_ == NULL) {
+        return ::openmldb::log::Status::IOError("snapshot writer is closed");
+    }
+    ::openmldb::log::Status status = wh_->Write(record);
+    if (status.ok()) {
+        chunks_.back().set_count(chunks_.back().count() + 1);
+    }
+    return status;
+}
+
+::openmldb::log::Status SnapshotWriter::Write(const ::openmldb::api::LogEntry& entry,
+                                              const ::openmldb::base::Slice& record) {
+    if (!table_) {
+        return Write(record);
+    }
+    table_->BuildSnapshotRecord(entry, &native_record_);
+    EncodeSnapshotRecord(native_record_, &native_buffer_);
+    return Write(::openmldb::base::Slice(native_buffer_));
+}
+
+bool SnapshotWriter::Commit() {
+    CloseChunk();
+    for (size_t idx = 0; idx < chunks_.size(); idx++) {
+        std::string full_path = snapshot_path_ + chunks_[idx].name();
+        if (rename((full_path + ".tmp").c_str(), full_path.c_str()) != 0) {
+            PDLOG(WARNING, "rename[%s] failed", chunks_[idx].name().c_str());
+            for (size_t i = 0; i < idx; i++) {
+                unlink((snapshot_path_ + chunks_[i].name()).c_str());
+            }
+            return false;
+        }
+    }
+    committed_ = true;
+    return true;
+}
+
+void SnapshotWriter::Remove() {
+    for (const auto& chunk : chunks_) {
+        PDLOG(WARNING, "delete snapshot file[%s]", chunk.name().c_str());
+        unlink((snapshot_path_ + chunk.name()).c_str());
+    }
+}
+
 MemTableSnapshot::MemTableSnapshot(uint32_t tid, uint32_t pid, LogParts* log_part, const std::string& db_root_path)
     : Snapshot(tid, pid), log_part_(log_part), db_root_path_(db_root_path) {}
 
@@ -86,25 +264,164 @@ bool MemTableSnapshot::Recover(std::shared_ptr<Table> table, uint64_t& latest_of
         return false;
     }
     if (ret == 0) {
-        RecoverFromSnapshot(manifest.name(), manifest.count(), table);
+        RecoverFromSnapshot(manifest, table);
         latest_offset = manifest.offset();
         offset_ = latest_offset;
     }
     return true;
 }
 
-void MemTableSnapshot::RecoverFromSnapshot(const std::string& snapshot_name, uint64_t expect_cnt,
-                                           std::shared_ptr<Table> table) {
-    std::string full_path = snapshot_path_ + "/" + snapshot_name;
+void MemTableSnapshot::RecoverFromSnapshot(const ::openmldb::api::Manifest& manifest, std::shared_ptr<Table> table) {
     std::atomic<uint64_t> g_succ_cnt(0);
     std::atomic<uint64_t> g_failed_cnt(0);
-    RecoverSingleSnapshot(full_path, table, &g_succ_cnt, &g_failed_cnt);
-    PDLOG(INFO, "[Recover] progress done stat: success count %lu, failed count %lu",
-          g_succ_cnt.load(std::memory_order_relaxed), g_failed_cnt.load(std::memory_order_relaxed));
-    if (g_succ_cnt.load(std::memory_order_relaxed) != expect_cnt) {
-        PDLOG(WARNING, "snapshot %s , expect cnt %lu but succ_cnt %lu", snapshot_name.c_str(), expect_cnt,
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    if (manifest.chunks_size() > 1 || manifest.format() == ::openmldb::api::kNativeFormat) {
+        RecoverChunks(manifest, table, &g_succ_cnt, &g_failed_cnt);
+    } else {
+        std::string full_path = snapshot_path_ + "/" + manifest.name();
+        RecoverSingleSnapshot(full_path, table, &g_succ_cnt, &g_failed_cnt);
+    }
+    uint64_t consumed = ::baidu::common::timer::get_micros() - start_time;
+    PDLOG(INFO, "[Recover] progress done stat: success count %lu, failed count %lu, chunk num %d, consumed %lums",
+          g_succ_cnt.load(std::memory_order_relaxed), g_failed_cnt.load(std::memory_order_relaxed),
+          manifest.chunks_size(), consumed / 1000);
+    if (g_succ_cnt.load(std::memory_order_relaxed) != manifest.count()) {
+        PDLOG(WARNING, "snapshot %s , expect cnt %lu but succ_cnt %lu", manifest.name().c_str(), manifest.count(),
               g_succ_cnt.load(std::memory_order_relaxed));
     }
+    RecoverDeltas(manifest, table);
+}
+
+void MemTableSnapshot::RecoverDeltas(const ::openmldb::api::Manifest& manifest, std::shared_ptr<Table> table) {
+    if (table == NULL || manifest.deltas_size() == 0) {
+        return;
+    }
+    // a delta is applied in log order, the tombstones delete the keys put before them
+    std::string buffer;
+    ::openmldb::api::LogEntry entry;
+    for (const auto& delta : manifest.deltas()) {
+        SnapshotReader reader(snapshot_path_, std::vector<std::string>{delta.name()});
+        if (!reader.Init()) {
+            PDLOG(WARNING, "fail to open delta snapshot %s. tid %u pid %u", delta.name().c_str(), tid_, pid_);
+            continue;
+        }
+        uint64_t succ_cnt = 0;
+        uint64_t failed_cnt = 0;
+        while (true) {
+            ::openmldb::base::Slice record;
+            ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
+            if (status.IsWaitRecord() || status.IsEof()) {
+                break;
+            }
+            if (!status.ok() || !entry.ParseFromArray(record.data(), record.size())) {
+                PDLOG(WARNING, "fail to read delta snapshot %s for tid %u, pid %u with error %s",
+                      delta.name().c_str(), tid_, pid_, status.ToString().c_str());
+                failed_cnt++;
+                continue;
+            }
+            if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+                if (entry.dimensions_size() > 0) {
+                    table->Delete(entry.dimensions(0).key(), entry.dimensions(0).idx());
+                }
+            } else {
+                table->Put(entry);
+            }
+            succ_cnt++;
+        }
+        PDLOG(INFO, "read delta snapshot %s for table tid %u pid %u completed, succ_cnt %lu, failed_cnt %lu",
+              delta.name().c_str(), tid_, pid_, succ_cnt, failed_cnt);
+        if (succ_cnt != delta.count()) {
+            PDLOG(WARNING, "delta snapshot %s , expect cnt %lu but succ_cnt %lu", delta.name().c_str(),
+                  delta.count(), succ_cnt);
+        }
+    }
+}
+
+void MemTableSnapshot::RecoverChunks(const ::openmldb::api::Manifest& manifest, std::shared_ptr<Table> table,
+                                     std::atomic<uint64_t>* g_succ_cnt, std::atomic<uint64_t>* g_failed_cnt) {
+    if (table == NULL) {
+        PDLOG(WARNING, "table input is NULL");
+        return;
+    }
+    // every chunk is read, parsed and put on its own thread
+    std::vector<::openmldb::api::SnapshotChunk> chunks(manifest.chunks().begin(), manifest.chunks().end());
+    if (chunks.empty()) {
+        chunks.emplace_back();
+        chunks.back().set_name(manifest.name());
+        chunks.back().set_count(manifest.count());
+    }
+    uint32_t thread_num = std::min(std::max(FLAGS_load_table_thread_num, 1u), static_cast<uint32_t>(chunks.size()));
+    ::openmldb::base::TaskPool load_pool(thread_num, chunks.size());
+    for (const auto& chunk : chunks) {
+        load_pool.AddTask(boost::bind(&MemTableSnapshot::RecoverChunk, this, snapshot_path_ + chunk.name(),
+                                      chunk.count(), boost::cref(manifest), table, g_succ_cnt, g_failed_cnt));
+    }
+    load_pool.Stop();
+}
+
+void MemTableSnapshot::RecoverChunk(const std::string& path, uint64_t expect_cnt,
+                                    const ::openmldb::api::Manifest& manifest, std::shared_ptr<Table> table,
+                                    std::atomic<uint64_t>* g_succ_cnt, std::atomic<uint64_t>* g_failed_cnt) {
+    std::shared_ptr<MemTable> mem_table;
+    bool use_seg_idx = false;
+    if (manifest.format() == ::openmldb::api::kNativeFormat) {
+        mem_table = std::dynamic_pointer_cast<MemTable>(table);
+        if (!mem_table) {
+            PDLOG(WARNING, "native snapshot can only be loaded into memtable. tid %u pid %u", tid_, pid_);
+            return;
+        }
+        use_seg_idx = manifest.seg_cnt() == mem_table->GetSegCnt();
+    }
+    FILE* fd = fopen(path.c_str(), "rb");
+    if (fd == NULL) {
+        PDLOG(WARNING, "fail to open path %s for error %s", path.c_str(), strerror(errno));
+        return;
+    }
+    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(path, fd);
+    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, IsCompressed(path));
+    std::string buffer;
+    ::openmldb::api::LogEntry entry;
+    SnapshotRecord native_record;
+    uint64_t succ_cnt = 0;
+    uint64_t failed_cnt = 0;
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    while (true) {
+        ::openmldb::base::Slice record;
+        ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
+        if (status.IsWaitRecord() || status.IsEof()) {
+            break;
+        }
+        if (!status.ok()) {
+            PDLOG(WARNING, "fail to read record for tid %u, pid %u with error %s", tid_, pid_,
+                  status.ToString().c_str());
+            failed_cnt++;
+            continue;
+        }
+        if (mem_table) {
+            if (!DecodeSnapshotRecord(record, &native_record)) {
+                failed_cnt++;
+                continue;
+            }
+            mem_table->Put(native_record, use_seg_idx);
+        } else {
+            if (!entry.ParseFromArray(record.data(), record.size())) {
+                failed_cnt++;
+                continue;
+            }
+            table->Put(entry);
+        }
+        succ_cnt++;
+    }
+    // will close the fd atomic
+    delete seq_file;
+    consumed = ::baidu::common::timer::get_micros() - consumed;
+    PDLOG(INFO, "read chunk %s for table tid %u pid %u completed, succ_cnt %lu, failed_cnt %lu, consumed %lums",
+          path.c_str(), tid_, pid_, succ_cnt, failed_cnt, consumed / 1000);
+    if (succ_cnt != expect_cnt) {
+        PDLOG(WARNING, "chunk %s , expect cnt %lu but succ_cnt %lu", path.c_str(), expect_cnt, succ_cnt);
+    }
+    g_succ_cnt->fetch_add(succ_cnt, std::memory_order_relaxed);
+    g_failed_cnt->fetch_add(failed_cnt, std::memory_order_relaxed);
 }
 
 void MemTableSnapshot::RecoverSingleSnapshot(const std::string& path, std::shared_ptr<Table> table,
@@ -197,80 +514,100 @@ void MemTableSnapshot::Put(std::string& path, std::shared_ptr<Table>& table, std
 }
 
 int MemTableSnapshot::TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest,
-                                  WriteHandle* wh, uint64_t& count, uint64_t& expired_key_num,
+                                  SnapshotWriter* writer, uint64_t& count, uint64_t& expired_key_num,
                                   uint64_t& deleted_key_num) {
-    std::string full_path = snapshot_path_ + manifest.name();
-    FILE* fd = fopen(full_path.c_str(), "rb");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to open path %s for error %s", full_path.c_str(), strerror(errno));
+    SnapshotReader reader(snapshot_path_, manifest);
+    if (!reader.Init()) {
         return -1;
     }
-    bool compressed = IsCompressed(full_path);
-    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(manifest.name(), fd);
-    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
-
-    std::string buffer;
-    std::string tmp_buf;
-    ::openmldb::api::LogEntry entry;
-    bool has_error = false;
     std::set<uint32_t> deleted_index;
     for (const auto& it : table->GetAllIndex()) {
         if (it->GetStatus() != ::openmldb::storage::IndexStatus::kReady) {
             deleted_index.insert(it->GetId());
         }
     }
+    uint64_t total = count + expired_key_num + deleted_key_num;
+    if (FilterSnapshot(table, &reader, deleted_index, writer, &count, &expired_key_num, &deleted_key_num) < 0) {
+        return -1;
+    }
+    if (expired_key_num + count + deleted_key_num - total != manifest.count()) {
+        PDLOG(WARNING,
+              "key num not match! total key num[%lu] load key num[%lu] ttl key "
+              "num[%lu]",
+              manifest.count(), count, expired_key_num);
+        return -1;
+    }
+    // the puts of the deltas go after the base snapshot, the tombstones are in deleted_keys_
+    for (const auto& delta : manifest.deltas()) {
+        SnapshotReader delta_reader(snapshot_path_, std::vector<std::string>{delta.name()});
+        if (!delta_reader.Init()) {
+            return -1;
+        }
+        total = count + expired_key_num + deleted_key_num;
+        if (FilterSnapshot(table, &delta_reader, deleted_index, writer, &count, &expired_key_num,
+                           &deleted_key_num) < 0) {
+            return -1;
+        }
+        if (expired_key_num + count + deleted_key_num - total != delta.count()) {
+            PDLOG(WARNING, "key num not match! delta snapshot %s key num[%lu]", delta.name().c_str(), delta.count());
+            return -1;
+        }
+    }
+    PDLOG(INFO, "load snapshot success. load key num[%lu] ttl key num[%lu] delta num[%d]", count, expired_key_num,
+          manifest.deltas_size());
+    return 0;
+}
+
+int MemTableSnapshot::FilterSnapshot(std::shared_ptr<Table> table, SnapshotReader* reader,
+                                     const std::set<uint32_t>& deleted_index, SnapshotWriter* writer,
+                                     uint64_t* count, uint64_t* expired_key_num, uint64_t* deleted_key_num) {
+    std::string buffer;
+    std::string tmp_buf;
+    ::openmldb::api::LogEntry entry;
     while (true) {
         ::openmldb::base::Slice record;
-        ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
+        ::openmldb::log::Status status = reader->ReadRecord(&record, &buffer);
         if (status.IsEof()) {
             break;
         }
         if (!status.ok()) {
             PDLOG(WARNING, "fail to read record for tid %u, pid %u with error %s", tid_, pid_,
                   status.ToString().c_str());
-            has_error = true;
-            break;
+            return -1;
         }
         if (!entry.ParseFromString(record.ToString())) {
             PDLOG(WARNING, "fail parse record for tid %u, pid %u with value %s", tid_, pid_,
                   ::openmldb::base::DebugString(record.ToString()).c_str());
-            has_error = true;
-            break;
+            return -1;
+        }
+        if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+            (*deleted_key_num)++;
+            continue;
         }
         int ret = RemoveDeletedKey(entry, deleted_index, &tmp_buf);
         if (ret == 1) {
-            deleted_key_num++;
+            (*deleted_key_num)++;
             continue;
         } else if (ret == 2) {
             record.reset(tmp_buf.data(), tmp_buf.size());
+            if (writer->IsNative()) {
+                entry.ParseFromString(tmp_buf);
+            }
         }
         if (table->IsExpire(entry)) {
-            expired_key_num++;
+            (*expired_key_num)++;
             continue;
         }
-        status = wh->Write(record);
+        status = writer->Write(entry, record);
         if (!status.ok()) {
             PDLOG(WARNING, "fail to write snapshot. status[%s]", status.ToString().c_str());
-            has_error = true;
-            break;
+            return -1;
         }
-        if ((count + expired_key_num + deleted_key_num) % KEY_NUM_DISPLAY == 0) {
-            PDLOG(INFO, "tackled key num[%lu] total[%lu]", count + expired_key_num, manifest.count());
+        if ((*count + *expired_key_num + *deleted_key_num) % KEY_NUM_DISPLAY == 0) {
+            PDLOG(INFO, "tackled key num[%lu] path[%s]", *count + *expired_key_num, reader->GetPath().c_str());
         }
-        count++;
-    }
-    delete seq_file;
-    if (expired_key_num + count + deleted_key_num != manifest.count()) {
-        PDLOG(WARNING,
-              "key num not match! total key num[%lu] load key num[%lu] ttl key "
-              "num[%lu]",
-              manifest.count(), count, expired_key_num);
-        has_error = true;
-    }
-    if (has_error) {
-        return -1;
+        (*count)++;
     }
-    PDLOG(INFO, "load snapshot success. load key num[%lu] ttl key num[%lu]", count, expired_key_num);
     return 0;
 }
 
@@ -342,53 +679,39 @@ uint64_t MemTableSnapshot::CollectDeletedKey(uint64_t end_offset) {
     return cur_offset;
 }
 
-int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_offset, uint64_t end_offset) {
-    if (making_snapshot_.load(std::memory_order_acquire)) {
-        PDLOG(INFO, "snapshot is doing now!");
-        return 0;
-    }
-    if (end_offset > 0 && end_offset <= offset_) {
-        PDLOG(WARNING, "end_offset %lu less than or equal offset_ %lu, do nothing", end_offset, offset_);
-        return -1;
-    }
-    making_snapshot_.store(true, std::memory_order_release);
-    std::string now_time = ::openmldb::base::GetNowTime();
-    std::string snapshot_name = now_time.substr(0, now_time.length() - 2) + ".sdb";
-    if (FLAGS_snapshot_compression != "off") {
-        snapshot_name.append(".");
-        snapshot_name.append(FLAGS_snapshot_compression);
-    }
-    std::string snapshot_name_tmp = snapshot_name + ".tmp";
-    std::string full_path = snapshot_path_ + snapshot_name;
-    std::string tmp_file_path = snapshot_path_ + snapshot_name_tmp;
-    FILE* fd = fopen(tmp_file_path.c_str(), "ab+");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to create file %s", tmp_file_path.c_str());
-        making_snapshot_.store(false, std::memory_order_release);
-        return -1;
-    }
-    uint64_t collected_offset = CollectDeletedKey(end_offset);
-    uint64_t start_time = ::baidu::common::timer::now_time();
-    WriteHandle* wh = new WriteHandle(FLAGS_snapshot_compression, snapshot_name_tmp, fd);
-    ::openmldb::api::Manifest manifest;
-    bool has_error = false;
-    uint64_t write_count = 0;
-    uint64_t expired_key_num = 0;
-    uint64_t deleted_key_num = 0;
-    uint64_t last_term = 0;
-    int result = GetLocalManifest(snapshot_path_ + MANIFEST, manifest);
-    if (result == 0) {
-        // filter old snapshot
-        if (TTLSnapshot(table, manifest, wh, write_count, expired_key_num, deleted_key_num) < 0) {
-            has_error = true;
+bool MemTableSnapshot::CollectDeltaDeletedKey(const ::openmldb::api::Manifest& manifest) {
+    std::string buffer;
+    ::openmldb::api::LogEntry entry;
+    for (const auto& delta : manifest.deltas()) {
+        SnapshotReader reader(snapshot_path_, std::vector<std::string>{delta.name()});
+        if (!reader.Init()) {
+            return false;
+        }
+        while (true) {
+            ::openmldb::base::Slice record;
+            ::openmldb::log::Status status = reader.ReadRecord(&record, &buffer);
+            if (status.IsEof()) {
+                break;
+            }
+            if (!status.ok() || !entry.ParseFromArray(record.data(), record.size())) {
+                PDLOG(WARNING, "fail to read delta snapshot %s for tid %u, pid %u with error %s",
+                      delta.name().c_str(), tid_, pid_, status.ToString().c_str());
+                return false;
+            }
+            if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete &&
+                entry.dimensions_size() > 0) {
+                std::string combined_key = entry.dimensions(0).key() + "|" + std::to_string(entry.dimensions(0).idx());
+                uint64_t& offset = deleted_keys_[combined_key];
+                offset = std::max(offset, entry.log_index());
+            }
         }
-        last_term = manifest.term();
-        DEBUGLOG("old manifest term is %lu", last_term);
-    } else if (result < 0) {
-        // parse manifest error
-        has_error = true;
     }
+    return true;
+}
 
+bool MemTableSnapshot::DumpBinlog(std::shared_ptr<Table> table, uint64_t collected_offset, bool keep_tombstone,
+                                  SnapshotWriter* writer, uint64_t* cur_offset, uint64_t* last_term,
+                                  uint64_t* write_count, uint64_t* expired_key_num, uint64_t* deleted_key_num) {
     // get deleted index
     std::set<uint32_t> deleted_index;
     for (const auto& it : table->GetAllIndex()) {
@@ -398,10 +721,10 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
     }
     ::openmldb::log::LogReader log_reader(log_part_, log_path_, false);
     log_reader.SetOffset(offset_);
-    uint64_t cur_offset = offset_;
+    *cur_offset = offset_;
     std::string buffer;
     std::string tmp_buf;
-    while (!has_error && cur_offset < collected_offset) {
+    while (*cur_offset < collected_offset) {
         buffer.clear();
         ::openmldb::base::Slice record;
         ::openmldb::log::Status status = log_reader.ReadNextRecord(&record, &buffer);
@@ -410,44 +733,53 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
             if (!entry.ParseFromString(record.ToString())) {
                 PDLOG(WARNING, "fail to parse LogEntry. record[%s] size[%ld]",
                       ::openmldb::base::DebugString(record.ToString()).c_str(), record.ToString().size());
-                has_error = true;
-                break;
+                return false;
             }
-            if (entry.log_index() <= cur_offset) {
+            if (entry.log_index() <= *cur_offset) {
                 continue;
             }
-            if (cur_offset + 1 != entry.log_index()) {
-                PDLOG(WARNING, "log missing expect offset %lu but %ld", cur_offset + 1, entry.log_index());
+            if (*cur_offset + 1 != entry.log_index()) {
+                PDLOG(WARNING, "log missing expect offset %lu but %ld", *cur_offset + 1, entry.log_index());
                 continue;
             }
-            cur_offset = entry.log_index();
+            *cur_offset = entry.log_index();
             if (entry.has_method_type() && entry.method_type() == ::openmldb::api::MethodType::kDelete) {
+                if (!keep_tombstone) {
+                    continue;
+                }
+                status = writer->Write(record);
+                if (!status.ok()) {
+                    PDLOG(WARNING, "fail to write snapshot. status[%s]", status.ToString().c_str());
+                    return false;
+                }
+                (*write_count)++;
                 continue;
             }
             if (entry.has_term()) {
-                last_term = entry.term();
+                *last_term = entry.term();
             }
             int ret = RemoveDeletedKey(entry, deleted_index, &tmp_buf);
             if (ret == 1) {
-                deleted_key_num++;
+                (*deleted_key_num)++;
                 continue;
             } else if (ret == 2) {
                 record.reset(tmp_buf.data(), tmp_buf.size());
+                if (writer->IsNative()) {
+                    entry.ParseFromString(tmp_buf);
+                }
             }
             if (table->IsExpire(entry)) {
-                expired_key_num++;
+                (*expired_key_num)++;
                 continue;
             }
-            ::openmldb::log::Status status = wh->Write(record);
+            status = writer->Write(entry, record);
             if (!status.ok()) {
-                PDLOG(WARNING, "fail to write snapshot. path[%s] status[%s]", tmp_file_path.c_str(),
-                      status.ToString().c_str());
-                has_error = true;
-                break;
+                PDLOG(WARNING, "fail to write snapshot. status[%s]", status.ToString().c_str());
+                return false;
             }
-            write_count++;
-            if ((write_count + expired_key_num + deleted_key_num) % KEY_NUM_DISPLAY == 0) {
-                PDLOG(INFO, "has write key num[%lu] expired key num[%lu]", write_count, expired_key_num);
+            (*write_count)++;
+            if ((*write_count + *expired_key_num + *deleted_key_num) % KEY_NUM_DISPLAY == 0) {
+                PDLOG(INFO, "has write key num[%lu] expired key num[%lu]", *write_count, *expired_key_num);
             }
         } else if (status.IsEof()) {
             continue;
@@ -460,59 +792,215 @@ int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_o
                 PDLOG(WARNING,
                       "read new binlog file. tid[%u] pid[%u] cur_log_index[%d] "
                       "end_log_index[%d] cur_offset[%lu]",
-                      tid_, pid_, cur_log_index, end_log_index, cur_offset);
+                      tid_, pid_, cur_log_index, end_log_index, *cur_offset);
                 continue;
             }
             DEBUGLOG("has read all record!");
             break;
         } else {
             PDLOG(WARNING, "fail to get record. status is %s", status.ToString().c_str());
-            has_error = true;
-            break;
+            return false;
         }
     }
-    if (wh != NULL) {
-        wh->EndLog();
-        delete wh;
-        wh = NULL;
+    return true;
+}
+
+int MemTableSnapshot::MakeSnapshot(std::shared_ptr<Table> table, uint64_t& out_offset, uint64_t end_offset) {
+    if (making_snapshot_.load(std::memory_order_acquire)) {
+        PDLOG(INFO, "snapshot is doing now!");
+        return 0;
     }
-    int ret = 0;
-    if (has_error) {
-        unlink(tmp_file_path.c_str());
+    if (end_offset > 0 && end_offset <= offset_) {
+        PDLOG(WARNING, "end_offset %lu less than or equal offset_ %lu, do nothing", end_offset, offset_);
+        return -1;
+    }
+    making_snapshot_.store(true, std::memory_order_release);
+    ::openmldb::api::Manifest manifest;
+    int ret = -1;
+    int result = GetLocalManifest(snapshot_path_ + MANIFEST, manifest);
+    if (result < 0) {
+        // parse manifest error
         ret = -1;
+    } else if (result == 0 && FLAGS_snapshot_delta_max_num > 0 && !NeedCompact(manifest)) {
+        ret = MakeDeltaSnapshot(table, manifest, end_offset, &out_offset);
     } else {
-        if (rename(tmp_file_path.c_str(), full_path.c_str()) == 0) {
-            if (GenManifest(snapshot_name, write_count, cur_offset, last_term) == 0) {
-                // delete old snapshot
-                if (manifest.has_name() && manifest.name() != snapshot_name) {
-                    DEBUGLOG("old snapshot[%s] has deleted", manifest.name().c_str());
-                    unlink((snapshot_path_ + manifest.name()).c_str());
-                }
-                uint64_t consumed = ::baidu::common::timer::now_time() - start_time;
-                PDLOG(INFO,
-                      "make snapshot[%s] success. update offset from %lu to %lu."
-                      "use %lu second. write key %lu expired key %lu deleted key "
-                      "%lu",
-                      snapshot_name.c_str(), offset_, cur_offset, consumed, write_count, expired_key_num,
-                      deleted_key_num);
-                offset_ = cur_offset;
-                out_offset = cur_offset;
-            } else {
-                PDLOG(WARNING, "GenManifest failed. delete snapshot file[%s]", full_path.c_str());
-                unlink(full_path.c_str());
-                ret = -1;
-            }
-        } else {
-            PDLOG(WARNING, "rename[%s] failed", snapshot_name.c_str());
-            unlink(tmp_file_path.c_str());
-            ret = -1;
-        }
+        ret = MakeFullSnapshot(table, manifest, result == 0, end_offset, &out_offset);
     }
     deleted_keys_.clear();
     making_snapshot_.store(false, std::memory_order_release);
     return ret;
 }
 
+bool MemTableSnapshot::NeedCompact(const ::openmldb::api::Manifest& manifest) {
+    if (manifest.deltas_size() >= static_cast<int>(FLAGS_snapshot_delta_max_num)) {
+        return true;
+    }
+    uint64_t delta_count = 0;
+    for (const auto& delta : manifest.deltas()) {
+        delta_count += delta.count();
+    }
+    return delta_count * 100 > manifest.count() * FLAGS_snapshot_delta_compact_ratio;
+}
+
+int MemTableSnapshot::MakeFullSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest,
+                                       bool has_manifest, uint64_t end_offset, uint64_t* out_offset) {
+    std::string now_time = ::openmldb::base::GetNowTime();
+    std::string snapshot_name = now_time.substr(0, now_time.length() - 2) + ".sdb";
+    if (FLAGS_snapshot_compression != "off") {
+        snapshot_name.append(".");
+        snapshot_name.append(FLAGS_snapshot_compression);
+    }
+    std::shared_ptr<MemTable> native_table;
+    if (FLAGS_snapshot_format == "native") {
+        native_table = std::dynamic_pointer_cast<MemTable>(table);
+    }
+    SnapshotWriter writer(snapshot_path_, snapshot_name, FLAGS_snapshot_chunk_size, native_table);
+    if (!writer.Init()) {
+        return -1;
+    }
+    uint64_t collected_offset = CollectDeletedKey(end_offset);
+    uint64_t start_time = ::baidu::common::timer::now_time();
+    bool has_error = false;
+    uint64_t write_count = 0;
+    uint64_t expired_key_num = 0;
+    uint64_t deleted_key_num = 0;
+    uint64_t last_term = 0;
+    if (has_manifest) {
+        // filter old snapshot. the tombstones of the deltas delete the keys put before them
+        if (!CollectDeltaDeletedKey(manifest) ||
+            TTLSnapshot(table, manifest, &writer, write_count, expired_key_num, deleted_key_num) < 0) {
+            has_error = true;
+        }
+        last_term = manifest.term();
+        DEBUGLOG("old manifest term is %lu", last_term);
+    }
+    uint64_t cur_offset = offset_;
+    if (!has_error && !DumpBinlog(table, collected_offset, false, &writer, &cur_offset, &last_term, &write_count,
+                                  &expired_key_num, &deleted_key_num)) {
+        has_error = true;
+    }
+    if (has_error || !writer.Commit()) {
+        return -1;
+    }
+    ::openmldb::api::Manifest new_manifest;
+    new_manifest.set_offset(cur_offset);
+    new_manifest.set_name(snapshot_name);
+    new_manifest.set_count(write_count);
+    new_manifest.set_term(last_term);
+    if (writer.IsNative()) {
+        new_manifest.set_format(::openmldb::api::kNativeFormat);
+        new_manifest.set_seg_cnt(native_table->GetSegCnt());
+    }
+    // a snapshot of one chunk keeps the single file layout
+    if (writer.GetChunks().size() > 1) {
+        for (const auto& chunk : writer.GetChunks()) {
+            new_manifest.add_chunks()->CopyFrom(chunk);
+        }
+    }
+    if (GenManifest(new_manifest) != 0) {
+        PDLOG(WARNING, "GenManifest failed. delete snapshot[%s]", snapshot_name.c_str());
+        writer.Remove();
+        return -1;
+    }
+    RemoveOldSnapshot(manifest, GetSnapshotFiles(new_manifest));
+    uint64_t consumed = ::baidu::common::timer::now_time() - start_time;
+    PDLOG(INFO,
+          "make snapshot[%s] success. update offset from %lu to %lu."
+          "use %lu second. write key %lu expired key %lu deleted key "
+          "%lu chunk num %lu",
+          snapshot_name.c_str(), offset_, cur_offset, consumed, write_count, expired_key_num, deleted_key_num,
+          writer.GetChunks().size());
+    offset_ = cur_offset;
+    *out_offset = cur_offset;
+    return 0;
+}
+
+int MemTableSnapshot::MakeDeltaSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest,
+                                        uint64_t end_offset, uint64_t* out_offset) {
+    // the start offset keeps the names of the deltas made in the same minute apart
+    std::string now_time = ::openmldb::base::GetNowTime();
+    std::string snapshot_name =
+        now_time.substr(0, now_time.length() - 2) + "_delta_" + std::to_string(offset_) + ".sdb";
+    if (FLAGS_snapshot_compression != "off") {
+        snapshot_name.append(".");
+        snapshot_name.append(FLAGS_snapshot_compression);
+    }
+    // deltas are small and applied in log order, so they are neither chunked nor native
+    SnapshotWriter writer(snapshot_path_, snapshot_name, 0);
+    if (!writer.Init()) {
+        return -1;
+    }
+    uint64_t collected_offset = CollectDeletedKey(end_offset);
+    uint64_t start_time = ::baidu::common::timer::now_time();
+    uint64_t write_count = 0;
+    uint64_t expired_key_num = 0;
+    uint64_t deleted_key_num = 0;
+    uint64_t last_term = manifest.term();
+    uint64_t cur_offset = offset_;
+    if (!DumpBinlog(table, collected_offset, true, &writer, &cur_offset, &last_term, &write_count, &expired_key_num,
+                    &deleted_key_num)) {
+        return -1;
+    }
+    if (cur_offset == offset_) {
+        PDLOG(INFO, "no new binlog after offset %lu, skip delta snapshot. tid %u pid %u", offset_, tid_, pid_);
+        *out_offset = offset_;
+        return 0;
+    }
+    if (!writer.Commit()) {
+        return -1;
+    }
+    ::openmldb::api::Manifest new_manifest(manifest);
+    new_manifest.set_offset(cur_offset);
+    new_manifest.set_term(last_term);
+    new_manifest.set_version(2);
+    ::openmldb::api::SnapshotDelta* delta = new_manifest.add_deltas();
+    delta->set_name(snapshot_name);
+    delta->set_count(write_count);
+    delta->set_start_offset(offset_);
+    delta->set_end_offset(cur_offset);
+    if (GenManifest(new_manifest) != 0) {
+        PDLOG(WARNING, "GenManifest failed. delete delta snapshot[%s]", snapshot_name.c_str());
+        writer.Remove();
+        return -1;
+    }
+    uint64_t consumed = ::baidu::common::timer::now_time() - start_time;
+    PDLOG(INFO,
+          "make delta snapshot[%s] success. update offset from %lu to %lu. use %lu second. "
+          "write key %lu expired key %lu deleted key %lu delta num %d",
+          snapshot_name.c_str(), offset_, cur_offset, consumed, write_count, expired_key_num, deleted_key_num,
+          new_manifest.deltas_size());
+    offset_ = cur_offset;
+    *out_offset = cur_offset;
+    return 0;
+}
+
+bool MemTableSnapshot::MergeDeltaSnapshot(std::shared_ptr<Table> table) {
+    ::openmldb::api::Manifest manifest;
+    int result = GetLocalManifest(snapshot_path_ + MANIFEST, manifest);
+    if (result < 0) {
+        return false;
+    }
+    if (result == 1 || manifest.deltas_size() == 0) {
+        return true;
+    }
+    PDLOG(INFO, "compact %d delta snapshots. tid %u pid %u", manifest.deltas_size(), tid_, pid_);
+    uint64_t offset = 0;
+    // end at offset_ so that no binlog is taken
+    int ret = MakeFullSnapshot(table, manifest, true, offset_, &offset);
+    deleted_keys_.clear();
+    return ret == 0;
+}
+
+void MemTableSnapshot::RemoveOldSnapshot(const ::openmldb::api::Manifest& old_manifest,
+                                         const std::vector<std::string>& new_files) {
+    for (const auto& name : GetSnapshotFiles(old_manifest)) {
+        if (std::find(new_files.begin(), new_files.end(), name) == new_files.end()) {
+            DEBUGLOG("old snapshot[%s] has deleted", name.c_str());
+            unlink((snapshot_path_ + name).c_str());
+        }
+    }
+}
+
 int MemTableSnapshot::RemoveDeletedKey(const ::openmldb::api::LogEntry& entry, const std::set<uint32_t>& deleted_index,
                                        std::string* buffer) {
     uint64_t cur_offset = entry.log_index();
@@ -669,15 +1157,10 @@ base::Status MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> t
         }
         index_vec.push_back(index_def);
     }
-    std::string full_path = snapshot_path_ + manifest.name();
-    FILE* fd = fopen(full_path.c_str(), "rb");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to open path %s for error %s", full_path.c_str(), strerror(errno));
+    SnapshotReader reader(snapshot_path_, manifest);
+    if (!reader.Init()) {
         return base::Status(base::ReturnCode::kError, "fail to open file");
     }
-    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(manifest.name(), fd);
-    bool compressed = IsCompressed(full_path);
-    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
     std::string buffer;
     ::openmldb::api::LogEntry entry;
     bool has_error = false;
@@ -769,7 +1252,6 @@ base::Status MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> t
         }
         (*count)++;
     }
-    delete seq_file;
     if (*expired_key_num + write_count + *deleted_key_num != manifest.count()) {
         PDLOG(WARNING, "key num not match! total key[%lu] load key[%lu] ttl key[%lu] delete key [%lu], tid %u pid %u",
                 manifest.count(), *count, *expired_key_num, *deleted_key_num, tid, pid);
@@ -789,15 +1271,10 @@ int MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> table, con
                                                uint64_t& expired_key_num, uint64_t& deleted_key_num) {
     uint32_t tid = table->GetId();
     uint32_t pid = table->GetPid();
-    std::string full_path = snapshot_path_ + manifest.name();
-    FILE* fd = fopen(full_path.c_str(), "rb");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to open path %s for error %s", full_path.c_str(), strerror(errno));
+    SnapshotReader reader(snapshot_path_, manifest);
+    if (!reader.Init()) {
         return -1;
     }
-    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(manifest.name(), fd);
-    bool compressed = IsCompressed(full_path);
-    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
     std::string buffer;
     ::openmldb::api::LogEntry entry;
     bool has_error = false;
@@ -927,7 +1404,6 @@ int MemTableSnapshot::ExtractIndexFromSnapshot(std::shared_ptr<Table> table, con
         }
         count++;
     }
-    delete seq_file;
     if (expired_key_num + count + deleted_key_num + schame_size_less_count + other_error_count != manifest.count()) {
         LOG(WARNING) << "key num not match ! total key num[" << manifest.count() << "] load key num[" << count
                      << "] ttl key num[" << expired_key_num << "] schema size less num[" << schame_size_less_count
@@ -1104,6 +1580,12 @@ int MemTableSnapshot::ExtractIndexData(std::shared_ptr<Table> table,
         PDLOG(INFO, "snapshot is doing now. tid %u, pid %u", tid, pid);
         return -1;
     }
+    // only the base snapshot and the binlog are read below
+    if (!MergeDeltaSnapshot(table)) {
+        PDLOG(WARNING, "fail to compact delta snapshots. tid %u, pid %u", tid, pid);
+        making_snapshot_.store(false, std::memory_order_release);
+        return -1;
+    }
     std::string snapshot_name = GenSnapshotName();
     std::string snapshot_name_tmp = snapshot_name + ".tmp";
     std::string full_path = snapshot_path_ + snapshot_name;
@@ -1160,10 +1642,7 @@ int MemTableSnapshot::ExtractIndexData(std::shared_ptr<Table> table,
         if (rename(tmp_file_path.c_str(), full_path.c_str()) == 0) {
             if (GenManifest(snapshot_name, write_count, cur_offset, last_term) == 0) {
                 // delete old snapshot
-                if (manifest.has_name() && manifest.name() != snapshot_name) {
-                    DEBUGLOG("old snapshot[%s] has deleted", manifest.name().c_str());
-                    unlink((snapshot_path_ + manifest.name()).c_str());
-                }
+                RemoveOldSnapshot(manifest, {snapshot_name});
                 uint64_t consumed = ::baidu::common::timer::now_time() - start_time;
                 PDLOG(INFO,
                       "make snapshot[%s] success. update offset from %lu to %lu."
@@ -1196,6 +1675,12 @@ int MemTableSnapshot::ExtractIndexData(std::shared_ptr<Table> table, const ::ope
         PDLOG(INFO, "snapshot is doing now. tid %u, pid %u", tid, pid);
         return -1;
     }
+    // only the base snapshot and the binlog are read below
+    if (!MergeDeltaSnapshot(table)) {
+        PDLOG(WARNING, "fail to compact delta snapshots. tid %u, pid %u", tid, pid);
+        making_snapshot_.store(false, std::memory_order_release);
+        return -1;
+    }
     std::string now_time = ::openmldb::base::GetNowTime();
     std::string snapshot_name = now_time.substr(0, now_time.length() - 2) + ".sdb";
     if (FLAGS_snapshot_compression != "off") {
@@ -1426,10 +1911,7 @@ int MemTableSnapshot::ExtractIndexData(std::shared_ptr<Table> table, const ::ope
         if (rename(tmp_file_path.c_str(), full_path.c_str()) == 0) {
             if (GenManifest(snapshot_name, write_count, cur_offset, last_term) == 0) {
                 // delete old snapshot
-                if (manifest.has_name() && manifest.name() != snapshot_name) {
-                    DEBUGLOG("old snapshot[%s] has deleted", manifest.name().c_str());
-                    unlink((snapshot_path_ + manifest.name()).c_str());
-                }
+                RemoveOldSnapshot(manifest, {snapshot_name});
                 uint64_t consumed = ::baidu::common::timer::now_time() - start_time;
                 PDLOG(INFO,
                       "make snapshot[%s] success. update offset from %lu to %lu."
@@ -1544,17 +2026,16 @@ bool MemTableSnapshot::DumpSnapshotIndexData(std::shared_ptr<Table> table,
         return false;
     }
     *snapshot_offset = manifest.offset();
-    std::string path = snapshot_path_ + "/" + manifest.name();
+    if (ret == 1) {
+        // no snapshot to dump
+        return true;
+    }
     uint64_t succ_cnt = 0;
     uint64_t failed_cnt = 0;
-    FILE* fd = fopen(path.c_str(), "rb");
-    if (fd == NULL) {
-        PDLOG(WARNING, "fail to open path %s for error %s", path.c_str(), strerror(errno));
+    SnapshotReader reader(snapshot_path_, manifest);
+    if (!reader.Init()) {
         return false;
     }
-    ::openmldb::log::SequentialFile* seq_file = ::openmldb::log::NewSeqFile(path, fd);
-    bool compressed = IsCompressed(path);
-    ::openmldb::log::Reader reader(seq_file, NULL, false, 0, compressed);
     ::openmldb::api::LogEntry entry;
     std::string buffer;
     std::string entry_buff;
@@ -1567,7 +2048,7 @@ bool MemTableSnapshot::DumpSnapshotIndexData(std::shared_ptr<Table> table,
             PDLOG(INFO,
                   "read path %s for table tid %u pid %u completed, succ_cnt "
                   "%lu, failed_cnt %lu",
-                  path.c_str(), tid_, pid_, succ_cnt, failed_cnt);
+                  reader.GetPath().c_str(), tid_, pid_, succ_cnt, failed_cnt);
             break;
         }
         if (!status.ok()) {
@@ -1592,7 +2073,6 @@ bool MemTableSnapshot::DumpSnapshotIndexData(std::shared_ptr<Table> table,
         ::openmldb::base::Slice new_record(entry_str);
         status = whs[index_pid]->Write(new_record);
         if (!status.ok()) {
-            delete seq_file;
             PDLOG(WARNING,
                   "fail to dump index entrylog in snapshot to pid[%u]. tid "
                   "%u pid %u",
@@ -1601,7 +2081,6 @@ bool MemTableSnapshot::DumpSnapshotIndexData(std::shared_ptr<Table> table,
         }
         succ_cnt++;
     }
-    delete seq_file;
     return true;
 }
 
@@ -1613,6 +2092,12 @@ bool MemTableSnapshot::DumpIndexData(std::shared_ptr<Table> table, const ::openm
         PDLOG(INFO, "snapshot is doing now. tid %u, pid %u", tid, pid);
         return false;
     }
+    // only the base snapshot and the binlog are read below
+    if (!MergeDeltaSnapshot(table)) {
+        PDLOG(WARNING, "fail to compact delta snapshots. tid %u, pid %u", tid, pid);
+        making_snapshot_.store(false, std::memory_order_release);
+        return false;
+    }
     std::map<std::string, uint32_t> column_desc_map;
     auto table_meta = table->GetTableMeta();
     for (int32_t i = 0; i < table_meta->column_desc_size(); ++i) {
@@ -29,7 +29,9 @@
 #include "log/log_writer.h"
 #include "log/sequential_file.h"
 #include "proto/tablet.pb.h"
+#include "storage/mem_table.h"
 #include "storage/snapshot.h"
+#include "storage/snapshot_record.h"
 
 using ::openmldb::api::LogEntry;
 namespace openmldb {
@@ -39,6 +41,80 @@ using ::openmldb::log::WriteHandle;
 
 typedef ::openmldb::base::Skiplist<uint32_t, uint64_t, ::openmldb::base::DefaultComparator> LogParts;
 
+// read the records of all the files of a base snapshot in order. records of native
+// snapshot are converted to LogEntry
+class SnapshotReader {
+ public:
+    SnapshotReader(const std::string& snapshot_path, const ::openmldb::api::Manifest& manifest);
+
+    // read the given files in LogEntry format, e.g. a delta snapshot
+    SnapshotReader(const std::string& snapshot_path, const std::vector<std::string>& files);
+    ~SnapshotReader();
+
+    bool Init();
+
+    // return Eof after the last record of the last file
+    ::openmldb::log::Status ReadRecord(::openmldb::base::Slice* record, std::string* buffer);
+
+    const std::string& GetPath() const { return path_; }
+
+ private:
+    bool OpenFile(uint32_t idx);
+    void CloseFile();
+
+    std::string snapshot_path_;
+    std::vector<std::string> files_;
+    bool native_;
+    SnapshotRecord native_record_;
+    ::openmldb::api::LogEntry entry_;
+    std::string entry_buffer_;
+    uint32_t idx_;
+    std::string path_;
+    ::openmldb::log::SequentialFile* seq_file_;
+    ::openmldb::log::Reader* reader_;
+};
+
+// write a snapshot into chunk files of about chunk_size bytes. the chunk files
+// keep the .tmp suffix until Commit, and are removed if it is never called.
+// entries are written in native format if the table is given
+class SnapshotWriter {
+ public:
+    SnapshotWriter(const std::string& snapshot_path, const std::string& snapshot_name, uint64_t chunk_size,
+                   std::shared_ptr<MemTable> table = nullptr);
+    ~SnapshotWriter();
+
+    bool Init();
+
+    ::openmldb::log::Status Write(const ::openmldb::base::Slice& record);
+
+    // record is the serialized entry
+    ::openmldb::log::Status Write(const ::openmldb::api::LogEntry& entry, const ::openmldb::base::Slice& record);
+
+    bool IsNative() const { return table_ != nullptr; }
+
+    bool Commit();
+
+    // remove the committed chunk files
+    void Remove();
+
+    const std::vector<::openmldb::api::SnapshotChunk>& GetChunks() const { return chunks_; }
+
+ private:
+    std::string GetChunkName(uint32_t idx) const;
+    bool OpenChunk();
+    void CloseChunk();
+
+    std::string snapshot_path_;
+    std::string snapshot_name_;
+    uint64_t chunk_size_;
+    std::shared_ptr<MemTable> table_;
+    SnapshotRecord native_record_;
+    std::string native_buffer_;
+    WriteHandle* wh_;
+    std::vector<::openmldb::api::SnapshotChunk> chunks_;
+    bool committed_;
+};
+
 // table snapshot
 class MemTableSnapshot : public Snapshot {
  public:
@@ -50,13 +126,16 @@ class MemTableSnapshot : public Snapshot {
 
     bool Recover(std::shared_ptr<Table> table, uint64_t& latest_offset) override;
 
-    void RecoverFromSnapshot(const std::string& snapshot_name, uint64_t expect_cnt, std::shared_ptr<Table> table);
+    void RecoverFromSnapshot(const ::openmldb::api::Manifest& manifest, std::shared_ptr<Table> table);
+
+    // apply the deltas of the manifest to table in order
+    void RecoverDeltas(const ::openmldb::api::Manifest& manifest, std::shared_ptr<Table> table);
 
     int MakeSnapshot(std::shared_ptr<Table> table,
                      uint64_t& out_offset,  // NOLINT
                      uint64_t end_offset) override;
 
-    int TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest, WriteHandle* wh,
+    int TTLSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest, SnapshotWriter* writer,
                     uint64_t& count, uint64_t& expired_key_num,  // NOLINT
                     uint64_t& deleted_key_num);                  // NOLINT
 
@@ -114,18 +193,56 @@ class MemTableSnapshot : public Snapshot {
     int RemoveDeletedKey(const ::openmldb::api::LogEntry& entry, const std::set<uint32_t>& deleted_index,
                          std::string* buffer);
 
+    static bool IsCompressed(const std::string& path);
+
  private:
     // load single snapshot to table
     void RecoverSingleSnapshot(const std::string& path, std::shared_ptr<Table> table, std::atomic<uint64_t>* g_succ_cnt,
                                std::atomic<uint64_t>* g_failed_cnt);
 
+    // load chunks of snapshot to table in parallel
+    void RecoverChunks(const ::openmldb::api::Manifest& manifest, std::shared_ptr<Table> table,
+                       std::atomic<uint64_t>* g_succ_cnt, std::atomic<uint64_t>* g_failed_cnt);
+
+    void RecoverChunk(const std::string& path, uint64_t expect_cnt, const ::openmldb::api::Manifest& manifest,
+                      std::shared_ptr<Table> table, std::atomic<uint64_t>* g_succ_cnt,
+                      std::atomic<uint64_t>* g_failed_cnt);
+
+    void RemoveOldSnapshot(const ::openmldb::api::Manifest& old_manifest, const std::vector<std::string>& new_files);
+
     uint64_t CollectDeletedKey(uint64_t end_offset);
 
+    // add the tombstones of the deltas to deleted_keys_
+    bool CollectDeltaDeletedKey(const ::openmldb::api::Manifest& manifest);
+
+    // filter the records of reader into writer. tombstones are skipped and counted as deleted keys
+    int FilterSnapshot(std::shared_ptr<Table> table, SnapshotReader* reader, const std::set<uint32_t>& deleted_index,
+                       SnapshotWriter* writer, uint64_t* count, uint64_t* expired_key_num,
+                       uint64_t* deleted_key_num);
+
+    // write the binlog after offset_ up to collected_offset into writer, the deletes are
+    // written as tombstones if keep_tombstone
+    bool DumpBinlog(std::shared_ptr<Table> table, uint64_t collected_offset, bool keep_tombstone,
+                    SnapshotWriter* writer, uint64_t* cur_offset, uint64_t* last_term, uint64_t* write_count,
+                    uint64_t* expired_key_num, uint64_t* deleted_key_num);
+
+    // rewrite the base snapshot, the deltas and the binlog into a new base snapshot
+    int MakeFullSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest,
+                         bool has_manifest, uint64_t end_offset, uint64_t* out_offset);
+
+    // write the binlog since the last snapshot into a new delta snapshot
+    int MakeDeltaSnapshot(std::shared_ptr<Table> table, const ::openmldb::api::Manifest& manifest,
+                          uint64_t end_offset, uint64_t* out_offset);
+
+    static bool NeedCompact(const ::openmldb::api::Manifest& manifest);
+
+    // compact the deltas into a new base snapshot without taking new binlog, for the
+    // paths which only read the base snapshot and the binlog
+    bool MergeDeltaSnapshot(std::shared_ptr<Table> table);
+
     int DecodeData(std::shared_ptr<Table> table, const openmldb::api::LogEntry& entry, uint32_t maxIdx,
                    std::vector<std::string>& row);  // NOLINT
 
-    inline bool IsCompressed(const std::string& path);
-
  private:
     LogParts* log_part_;
     std::string log_path_;
@@ -0,0 +1,245 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/pk_hash_index.h"
+
+#include <algorithm>
+
+#include "base/hash.h"
+
+namespace openmldb {
+namespace storage {
+
+// differ from the seed used to pick the segment, or all the keys of a segment
+// would share the low bits of their hash
+static const uint32_t PK_HASH_SEED = 0x9747b28c;
+// the chains just grow longer beyond it
+static const uint64_t MAX_BUCKET_CNT = 1ull << 30;
+// the buckets moved by every Insert and Remove during a resize. the old array is
+// drained before the new one is full, since an Insert adds one key
+static const uint64_t REHASH_BUCKET_NUM = 16;
+
+PkHashIndex::BucketArray::BucketArray(uint64_t bucket_cnt) : mask(bucket_cnt - 1), buckets(NULL) {
+    buckets = new std::atomic<HashNode*>[bucket_cnt];
+    for (uint64_t i = 0; i < bucket_cnt; i++) {
+        buckets[i].store(NULL, std::memory_order_relaxed);
+    }
+}
+
+PkHashIndex::BucketArray::~BucketArray() { delete[] buckets; }
+
+PkHashIndex::PkHashIndex(uint64_t init_bucket_cnt)
+    : table_(NULL), old_table_(NULL), rehash_idx_(0), init_bucket_cnt_(1), size_(0), byte_size_(0) {
+    // round up to power of two
+    while (init_bucket_cnt_ < init_bucket_cnt && init_bucket_cnt_ < MAX_BUCKET_CNT) {
+        init_bucket_cnt_ <<= 1;
+    }
+    table_.store(new BucketArray(init_bucket_cnt_), std::memory_order_release);
+    byte_size_.store(init_bucket_cnt_ * sizeof(std::atomic<HashNode*>), std::memory_order_relaxed);
+}
+
+PkHashIndex::~PkHashIndex() {
+    Clear();
+    delete table_.load(std::memory_order_relaxed);
+}
+
+uint64_t PkHashIndex::Hash(const ::openmldb::base::Slice& key) {
+    return ::openmldb::base::MurmurHash64A(key.data(), key.size(), PK_HASH_SEED);
+}
+
+PkHashIndex::HashNode* PkHashIndex::Find(const BucketArray* table, uint64_t hash,
+                                         const ::openmldb::base::Slice& key) {
+    HashNode* node = table->buckets[hash & table->mask].load(std::memory_order_acquire);
+    while (node != NULL) {
+        if (node->hash == hash && node->key.compare(key) == 0) {
+            return node;
+        }
+        node = node->next.load(std::memory_order_acquire);
+    }
+    return NULL;
+}
+
+bool PkHashIndex::Get(const ::openmldb::base::Slice& key, void** value) const {
+    uint64_t hash = Hash(key);
+    // table_ is published after old_table_, so old_table_ is the array being moved into table or NULL.
+    // the progress is loaded before the lookup, a bucket moved by then is found in table
+    BucketArray* table = table_.load(std::memory_order_acquire);
+    BucketArray* old_table = old_table_.load(std::memory_order_acquire);
+    uint64_t rehash_idx = rehash_idx_.load(std::memory_order_acquire);
+    HashNode* node = Find(table, hash, key);
+    if (node == NULL && old_table != NULL && old_table != table && (hash & old_table->mask) >= rehash_idx) {
+        node = Find(old_table, hash, key);
+    }
+    if (node == NULL) {
+        return false;
+    }
+    *value = node->value;
+    return true;
+}
+
+void PkHashIndex::Insert(const ::openmldb::base::Slice& key, void* value, uint64_t version) {
+    if (old_table_.load(std::memory_order_relaxed) == NULL) {
+        BucketArray* table = table_.load(std::memory_order_relaxed);
+        if (size_ >= table->mask + 1 && table->mask + 1 < MAX_BUCKET_CNT) {
+            Resize();
+        }
+    }
+    Rehash(version, REHASH_BUCKET_NUM);
+    BucketArray* table = table_.load(std::memory_order_relaxed);
+    auto* node = new HashNode();
+    node->hash = Hash(key);
+    node->key = key;
+    node->value = value;
+    std::atomic<HashNode*>& bucket = table->buckets[node->hash & table->mask];
+    node->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bucket.store(node, std::memory_order_release);
+    size_++;
+    byte_size_.fetch_add(sizeof(HashNode), std::memory_order_relaxed);
+}
+
+PkHashIndex::HashNode* PkHashIndex::Unlink(BucketArray* table, uint64_t hash, const ::openmldb::base::Slice& key) {
+    std::atomic<HashNode*>* prev = &table->buckets[hash & table->mask];
+    HashNode* node = prev->load(std::memory_order_relaxed);
+    while (node != NULL) {
+        if (node->hash == hash && node->key.compare(key) == 0) {
+            // readers on the node can still go on through its next
+            prev->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+            return node;
+        }
+        prev = &node->next;
+        node = prev->load(std::memory_order_relaxed);
+    }
+    return NULL;
+}
+
+bool PkHashIndex::Remove(const ::openmldb::base::Slice& key, uint64_t version) {
+    Rehash(version, REHASH_BUCKET_NUM);
+    uint64_t hash = Hash(key);
+    HashNode* node = Unlink(table_.load(std::memory_order_relaxed), hash, key);
+    BucketArray* old_table = old_table_.load(std::memory_order_relaxed);
+    if (node == NULL && old_table != NULL &&
+        (hash & old_table->mask) >= rehash_idx_.load(std::memory_order_relaxed)) {
+        node = Unlink(old_table, hash, key);
+    }
+    if (node == NULL) {
+        return false;
+    }
+    Retire(version, node);
+    size_--;
+    byte_size_.fetch_sub(sizeof(HashNode), std::memory_order_relaxed);
+    return true;
+}
+
+void PkHashIndex::Resize() {
+    BucketArray* old_table = table_.load(std::memory_order_relaxed);
+    uint64_t bucket_cnt = (old_table->mask + 1) << 1;
+    auto* new_table = new BucketArray(bucket_cnt);
+    rehash_idx_.store(0, std::memory_order_relaxed);
+    old_table_.store(old_table, std::memory_order_release);
+    table_.store(new_table, std::memory_order_release);
+    byte_size_.fetch_add(bucket_cnt * sizeof(std::atomic<HashNode*>), std::memory_order_relaxed);
+}
+
+// readers may still walk the old chains, so the nodes are copied into the new
+// bucket array and the old ones are retired
+void PkHashIndex::Rehash(uint64_t version, uint64_t bucket_num) {
+    BucketArray* old_table = old_table_.load(std::memory_order_relaxed);
+    if (old_table == NULL) {
+        return;
+    }
+    BucketArray* table = table_.load(std::memory_order_relaxed);
+    uint64_t old_bucket_cnt = old_table->mask + 1;
+    uint64_t idx = rehash_idx_.load(std::memory_order_relaxed);
+    uint64_t end = std::min(idx + bucket_num, old_bucket_cnt);
+    for (; idx < end; idx++) {
+        HashNode* node = old_table->buckets[idx].load(std::memory_order_relaxed);
+        while (node != NULL) {
+            auto* new_node = new HashNode();
+            new_node->hash = node->hash;
+            new_node->key = node->key;
+            new_node->value = node->value;
+            std::atomic<HashNode*>& bucket = table->buckets[node->hash & table->mask];
+            new_node->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            bucket.store(new_node, std::memory_order_release);
+            HashNode* tmp = node;
+            node = node->next.load(std::memory_order_relaxed);
+            Retire(version, tmp);
+        }
+        rehash_idx_.store(idx + 1, std::memory_order_release);
+    }
+    if (idx == old_bucket_cnt) {
+        old_table_.store(NULL, std::memory_order_release);
+        Retire(version, old_table);
+        byte_size_.fetch_sub(old_bucket_cnt * sizeof(std::atomic<HashNode*>), std::memory_order_relaxed);
+    }
+}
+
+void PkHashIndex::Retire(uint64_t version, HashNode* node) {
+    std::lock_guard<std::mutex> lock(retire_mu_);
+    retired_nodes_.emplace_back(version, node);
+}
+
+void PkHashIndex::Retire(uint64_t version, BucketArray* table) {
+    std::lock_guard<std::mutex> lock(retire_mu_);
+    retired_tables_.emplace_back(version, table);
+}
+
+void PkHashIndex::Reclaim(uint64_t version) {
+    std::lock_guard<std::mutex> lock(retire_mu_);
+    // the gc version never goes back, so the retired queues are ordered
+    while (!retired_nodes_.empty() && retired_nodes_.front().first <= version) {
+        delete retired_nodes_.front().second;
+        retired_nodes_.pop_front();
+    }
+    while (!retired_tables_.empty() && retired_tables_.front().first <= version) {
+        delete retired_tables_.front().second;
+        retired_tables_.pop_front();
+    }
+}
+
+void PkHashIndex::Clear() {
+    BucketArray* old_table = old_table_.load(std::memory_order_relaxed);
+    if (old_table != NULL) {
+        // the nodes of the moved buckets are retired already
+        for (uint64_t i = rehash_idx_.load(std::memory_order_relaxed); i <= old_table->mask; i++) {
+            HashNode* node = old_table->buckets[i].load(std::memory_order_relaxed);
+            while (node != NULL) {
+                HashNode* tmp = node;
+                node = node->next.load(std::memory_order_relaxed);
+                delete tmp;
+            }
+        }
+        delete old_table;
+        old_table_.store(NULL, std::memory_order_relaxed);
+    }
+    BucketArray* table = table_.load(std::memory_order_relaxed);
+    for (uint64_t i = 0; i <= table->mask; i++) {
+        HashNode* node = table->buckets[i].load(std::memory_order_relaxed);
+        while (node != NULL) {
+            HashNode* tmp = node;
+            node = node->next.load(std::memory_order_relaxed);
+            delete tmp;
+        }
+    }
+    delete table;
+    table_.store(new BucketArray(init_bucket_cnt_), std::memory_order_release);
+    size_ = 0;
+    byte_size_.store(init_bucket_cnt_ * sizeof(std::atomic<HashNode*>), std::memory_order_relaxed);
+    Reclaim(UINT64_MAX);
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_PK_HASH_INDEX_H_
+#define SRC_STORAGE_PK_HASH_INDEX_H_
+
+#include <atomic>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <utility>
+
+#include "base/slice.h"
+
+namespace openmldb {
+namespace storage {
+
+// a chained hash table from pk to the value of the key skiplist node, for point
+// lookups without string compares. Get is lock free, Insert and Remove must be
+// serialized by the caller. the key memory is owned by the caller.
+// unlinked nodes and replaced bucket arrays are retired with a gc version and
+// freed by Reclaim, so readers follow the same rule as the key skiplist.
+// the buckets are doubled incrementally, every Insert and Remove moves a few
+// buckets of the old array, so no single call copies the whole table
+class PkHashIndex {
+ public:
+    explicit PkHashIndex(uint64_t init_bucket_cnt);
+    ~PkHashIndex();
+
+    PkHashIndex(const PkHashIndex&) = delete;
+    PkHashIndex& operator=(const PkHashIndex&) = delete;
+
+    bool Get(const ::openmldb::base::Slice& key, void** value) const;
+
+    void Insert(const ::openmldb::base::Slice& key, void* value, uint64_t version);
+
+    bool Remove(const ::openmldb::base::Slice& key, uint64_t version);
+
+    // free the memory retired not later than version
+    void Reclaim(uint64_t version);
+
+    // drop all the keys and free all the memory, no reader is allowed
+    void Clear();
+
+    uint64_t GetSize() const { return size_; }
+
+    uint64_t GetByteSize() const { return byte_size_.load(std::memory_order_relaxed); }
+
+ private:
+    struct HashNode {
+        uint64_t hash;
+        ::openmldb::base::Slice key;
+        void* value;
+        std::atomic<HashNode*> next;
+    };
+
+    struct BucketArray {
+        explicit BucketArray(uint64_t bucket_cnt);
+        ~BucketArray();
+        uint64_t mask;
+        std::atomic<HashNode*>* buckets;
+    };
+
+    static uint64_t Hash(const ::openmldb::base::Slice& key);
+
+    static HashNode* Find(const BucketArray* table, uint64_t hash, const ::openmldb::base::Slice& key);
+
+    // unlink the node of key from table, return the node or NULL
+    static HashNode* Unlink(BucketArray* table, uint64_t hash, const ::openmldb::base::Slice& key);
+
+    void Resize();
+
+    // move at most bucket_num buckets of the old array into the current one
+    void Rehash(uint64_t version, uint64_t bucket_num);
+
+    void Retire(uint64_t version, HashNode* node);
+
+    void Retire(uint64_t version, BucketArray* table);
+
+ private:
+    std::atomic<BucketArray*> table_;
+    // the array being moved into table_, NULL if no resize is running
+    std::atomic<BucketArray*> old_table_;
+    // the buckets of old_table_ before this index are moved
+    std::atomic<uint64_t> rehash_idx_;
+    uint64_t init_bucket_cnt_;
+    uint64_t size_;
+    std::atomic<uint64_t> byte_size_;
+    std::mutex retire_mu_;
+    std::deque<std::pair<uint64_t, HashNode*>> retired_nodes_;
+    std::deque<std::pair<uint64_t, BucketArray*>> retired_tables_;
+};
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_PK_HASH_INDEX_H_
@@ -17,6 +17,10 @@
 #include "storage/segment.h"
 
 #include <gflags/gflags.h>
+#include <snappy.h>
+
+#include <algorithm>
+#include <iterator>
 
 #include "base/glog_wapper.h"
 #include "base/strings.h"
@@ -26,11 +30,37 @@
 DECLARE_int32(gc_safe_offset);
 DECLARE_uint32(skiplist_max_height);
 DECLARE_uint32(gc_deleted_pk_version_delta);
+DECLARE_uint32(gc_expire_bucket_interval);
+DECLARE_bool(segment_pk_hash_index);
+DECLARE_uint32(segment_pk_hash_bucket_cnt);
 
 namespace openmldb {
 namespace storage {
 
 static const SliceComparator scmp;
+
+// the key entry locks of all the segments, an entry takes the one its address hashes to
+static const uint32_t KEY_ENTRY_MUTEX_NUM = 1024;
+static std::mutex key_entry_mu[KEY_ENTRY_MUTEX_NUM];
+
+std::mutex& Segment::GetEntryMutex(const KeyEntry* entry) {
+    return key_entry_mu[(reinterpret_cast<uintptr_t>(entry) >> 4) % KEY_ENTRY_MUTEX_NUM];
+}
+
+// the copy of the key kept in an expire bucket
+static inline uint64_t GetExpireKeySize(size_t key_size) { return sizeof(std::string) + key_size; }
+
+Slice GetBlockRow(const DataBlock* block, std::string* buf) {
+    if (!block->compressed) {
+        return Slice(block->data, block->size);
+    }
+    if (!snappy::Uncompress(block->data, block->size, buf)) {
+        PDLOG(WARNING, "fail to uncompress row. size %u", block->size);
+        return Slice();
+    }
+    return Slice(*buf);
+}
+
 Segment::Segment()
     : entries_(NULL),
       mu_(),
@@ -39,7 +69,10 @@ Segment::Segment()
       pk_cnt_(0),
       ts_cnt_(1),
       gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      use_expire_index_(false),
+      gc_visited_key_cnt_(0),
+      pk_index_(FLAGS_segment_pk_hash_index ? new PkHashIndex(FLAGS_segment_pk_hash_bucket_cnt) : NULL) {
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     key_entry_max_height_ = (uint8_t)FLAGS_skiplist_max_height;
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
@@ -54,7 +87,10 @@ Segment::Segment(uint8_t height)
       key_entry_max_height_(height),
       ts_cnt_(1),
       gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      use_expire_index_(false),
+      gc_visited_key_cnt_(0),
+      pk_index_(FLAGS_segment_pk_hash_index ? new PkHashIndex(FLAGS_segment_pk_hash_bucket_cnt) : NULL) {
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
 }
@@ -68,7 +104,10 @@ Segment::Segment(uint8_t height, const std::vector<uint32_t>& ts_idx_vec)
       key_entry_max_height_(height),
       ts_cnt_(ts_idx_vec.size()),
       gc_version_(0),
-      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000) {
+      ttl_offset_(FLAGS_gc_safe_offset * 60 * 1000),
+      use_expire_index_(false),
+      gc_visited_key_cnt_(0),
+      pk_index_(FLAGS_segment_pk_hash_index ? new PkHashIndex(FLAGS_segment_pk_hash_bucket_cnt) : NULL) {
     entries_ = new KeyEntries((uint8_t)FLAGS_skiplist_max_height, 4, scmp);
     entry_free_list_ = new KeyEntryNodeList(4, 4, tcmp);
     for (uint32_t i = 0; i < ts_idx_vec.size(); i++) {
@@ -80,6 +119,30 @@ Segment::Segment(uint8_t height, const std::vector<uint32_t>& ts_idx_vec)
 Segment::~Segment() {
     delete entries_;
     delete entry_free_list_;
+    delete pk_index_;
+}
+
+int Segment::GetKeyEntry(const Slice& key, void*& value) {
+    if (pk_index_ != NULL) {
+        return pk_index_->Get(key, &value) ? 0 : -1;
+    }
+    return entries_->Get(key, value);
+}
+
+uint8_t Segment::InsertKey(const Slice& key, void* value) {
+    uint8_t height = entries_->Insert(key, value);
+    if (pk_index_ != NULL) {
+        pk_index_->Insert(key, value, gc_version_.load(std::memory_order_relaxed));
+    }
+    return height;
+}
+
+::openmldb::base::Node<Slice, void*>* Segment::RemoveKey(const Slice& key) {
+    ::openmldb::base::Node<Slice, void*>* entry_node = entries_->Remove(key);
+    if (entry_node != NULL && pk_index_ != NULL) {
+        pk_index_->Remove(key, gc_version_.load(std::memory_order_relaxed));
+    }
+    return entry_node;
 }
 
 uint64_t Segment::Release() {
@@ -129,10 +192,40 @@ uint64_t Segment::Release() {
     }
     delete f_it;
     entry_free_list_->Clear();
+    if (pk_index_ != NULL) {
+        pk_index_->Clear();
+    }
     idx_cnt_vec_.clear();
+    ClearExpireKeys();
     return cnt;
 }
 
+void Segment::ClearExpireKeys() {
+    std::map<uint64_t, std::vector<std::string>> buckets;
+    {
+        std::lock_guard<std::mutex> lock(expire_mu_);
+        buckets.swap(expire_buckets_);
+    }
+    uint64_t key_byte_size = 0;
+    for (const auto& kv : buckets) {
+        for (const auto& key : kv.second) {
+            key_byte_size += GetExpireKeySize(key.size());
+        }
+    }
+    idx_byte_size_.fetch_sub(key_byte_size, std::memory_order_relaxed);
+}
+
+void Segment::SetExpireIndex(bool enable) {
+    if (enable) {
+        use_expire_index_.store(ts_cnt_ <= 1, std::memory_order_relaxed);
+        return;
+    }
+    if (!use_expire_index_.exchange(false, std::memory_order_relaxed)) {
+        return;
+    }
+    ClearExpireKeys();
+}
+
 void Segment::ReleaseAndCount(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uint64_t& gc_record_byte_size) {
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
@@ -140,8 +233,8 @@ void Segment::ReleaseAndCount(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uin
         Slice key = it->GetKey();
         ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
-            entry_node = entries_->Remove(key);
+            std::lock_guard<std::shared_mutex> lock(mu_);
+            entry_node = RemoveKey(key);
         }
         if (entry_node != NULL) {
             FreeEntry(entry_node, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
@@ -159,7 +252,7 @@ void Segment::Put(const Slice& key, uint64_t time, const char* data, uint32_t si
     if (ts_cnt_ > 1) {
         return;
     }
-    auto* db = new DataBlock(1, data, size);
+    auto* db = DataBlock::Create(1, data, size);
     Put(key, time, db);
 }
 
@@ -167,37 +260,61 @@ void Segment::Put(const Slice& key, uint64_t time, DataBlock* row) {
     if (ts_cnt_ > 1) {
         return;
     }
-    std::lock_guard<std::mutex> lock(mu_);
+    {
+        std::shared_lock<std::shared_mutex> lock(mu_);
+        void* entry = NULL;
+        if (GetKeyEntry(key, entry) == 0 && entry != NULL) {
+            std::lock_guard<std::mutex> entry_lock(GetEntryMutex((KeyEntry*)entry));  // NOLINT
+            PutToEntry(key, (KeyEntry*)entry, time, row);                     // NOLINT
+            return;
+        }
+    }
+    std::lock_guard<std::shared_mutex> lock(mu_);
     PutUnlock(key, time, row);
 }
 
 void Segment::PutUnlock(const Slice& key, uint64_t time, DataBlock* row) {
     void* entry = nullptr;
-    uint32_t byte_size = 0;
-    int ret = entries_->Get(key, entry);
+    int ret = GetKeyEntry(key, entry);
     if (ret < 0 || entry == NULL) {
         char* pk = new char[key.size()];
         memcpy(pk, key.data(), key.size());
         // need to delete memory when free node
         Slice skey(pk, key.size());
         entry = (void*)new KeyEntry(key_entry_max_height_);  // NOLINT
-        uint8_t height = entries_->Insert(skey, entry);
-        byte_size += GetRecordPkIdxSize(height, key.size(), key_entry_max_height_);
+        uint8_t height = InsertKey(skey, entry);
+        idx_byte_size_.fetch_add(GetRecordPkIdxSize(height, key.size(), key_entry_max_height_),
+                                 std::memory_order_relaxed);
         pk_cnt_.fetch_add(1, std::memory_order_relaxed);
     }
+    PutToEntry(key, (KeyEntry*)entry, time, row);  // NOLINT
+}
+
+void Segment::PutToEntry(const Slice& key, KeyEntry* entry, uint64_t time, DataBlock* row) {
+    if (use_expire_index_.load(std::memory_order_relaxed)) {
+        auto& time_entries = entry->entries;
+        if (time_entries.IsEmpty() || time < time_entries.GetLast()->GetKey()) {
+            AddExpireKey(key, time);
+        }
+    }
     idx_cnt_.fetch_add(1, std::memory_order_relaxed);
-    uint8_t height = ((KeyEntry*)entry)->entries.Insert(time, row);  // NOLINT
-    ((KeyEntry*)entry)                                               // NOLINT
-        ->count_.fetch_add(1, std::memory_order_relaxed);
-    byte_size += GetRecordTsIdxSize(height);
-    idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
+    uint8_t height = entry->entries.Insert(time, row);
+    entry->count_.fetch_add(1, std::memory_order_relaxed);
+    idx_byte_size_.fetch_add(GetRecordTsIdxSize(height), std::memory_order_relaxed);
+}
+
+void Segment::PutToEntry(KeyEntry* entry, uint32_t idx_pos, uint64_t time, DataBlock* row) {
+    uint8_t height = entry->entries.Insert(time, row);
+    entry->count_.fetch_add(1, std::memory_order_relaxed);
+    idx_byte_size_.fetch_add(GetRecordTsIdxSize(height), std::memory_order_relaxed);
+    idx_cnt_vec_[idx_pos]->fetch_add(1, std::memory_order_relaxed);
 }
 
 void Segment::BulkLoadPut(unsigned int key_entry_id, const Slice& key, uint64_t time, DataBlock* row) {
     void* key_entry_or_list = nullptr;
     uint32_t byte_size = 0;
-    std::lock_guard<std::mutex> lock(mu_);  // TODO(hw): need lock?
-    int ret = entries_->Get(key, key_entry_or_list);
+    std::lock_guard<std::shared_mutex> lock(mu_);  // TODO(hw): need lock?
+    int ret = GetKeyEntry(key, key_entry_or_list);
     if (ts_cnt_ == 1) {
         PutUnlock(key, time, row);
     } else {
@@ -210,7 +327,7 @@ void Segment::BulkLoadPut(unsigned int key_entry_id, const Slice& key, uint64_t
                 entry_arr_tmp[i] = new KeyEntry(key_entry_max_height_);
             }
             auto entry_arr = (void*)entry_arr_tmp;  // NOLINT
-            uint8_t height = entries_->Insert(skey, entry_arr);
+            uint8_t height = InsertKey(skey, entry_arr);
             byte_size += GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_);
             pk_cnt_.fetch_add(1, std::memory_order_relaxed);
         }
@@ -237,15 +354,30 @@ void Segment::Put(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, D
         return;
     }
     void* entry_arr = NULL;
-    std::lock_guard<std::mutex> lock(mu_);
+    {
+        std::shared_lock<std::shared_mutex> lock(mu_);
+        if (GetKeyEntry(key, entry_arr) == 0 && entry_arr != NULL) {
+            for (const auto& kv : ts_map) {
+                auto pos = ts_idx_map_.find(kv.first);
+                if (pos == ts_idx_map_.end()) {
+                    continue;
+                }
+                KeyEntry* entry = ((KeyEntry**)entry_arr)[pos->second];  // NOLINT
+                std::lock_guard<std::mutex> entry_lock(GetEntryMutex(entry));
+                PutToEntry(entry, pos->second, kv.second, row);
+            }
+            return;
+        }
+    }
+    entry_arr = NULL;
+    std::lock_guard<std::shared_mutex> lock(mu_);
     for (const auto& kv : ts_map) {
-        uint32_t byte_size = 0;
         auto pos = ts_idx_map_.find(kv.first);
         if (pos == ts_idx_map_.end()) {
             continue;
         }
         if (entry_arr == NULL) {
-            int ret = entries_->Get(key, entry_arr);
+            int ret = GetKeyEntry(key, entry_arr);
             if (ret < 0 || entry_arr == NULL) {
                 char* pk = new char[key.size()];
                 memcpy(pk, key.data(), key.size());
@@ -255,18 +387,13 @@ void Segment::Put(const Slice& key, const std::map<int32_t, uint64_t>& ts_map, D
                     entry_arr_tmp[i] = new KeyEntry(key_entry_max_height_);
                 }
                 entry_arr = (void*)entry_arr_tmp;  // NOLINT
-                uint8_t height = entries_->Insert(skey, entry_arr);
-                byte_size += GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_);
+                uint8_t height = InsertKey(skey, entry_arr);
+                idx_byte_size_.fetch_add(GetRecordPkMultiIdxSize(height, key.size(), key_entry_max_height_, ts_cnt_),
+                                         std::memory_order_relaxed);
                 pk_cnt_.fetch_add(1, std::memory_order_relaxed);
             }
         }
-        uint8_t height = ((KeyEntry**)entry_arr)[pos->second]->entries.Insert(  // NOLINT
-            kv.second, row);
-        ((KeyEntry**)entry_arr)[pos->second]->count_.fetch_add(  // NOLINT
-            1, std::memory_order_relaxed);
-        byte_size += GetRecordTsIdxSize(height);
-        idx_byte_size_.fetch_add(byte_size, std::memory_order_relaxed);
-        idx_cnt_vec_[pos->second]->fetch_add(1, std::memory_order_relaxed);
+        PutToEntry(((KeyEntry**)entry_arr)[pos->second], pos->second, kv.second, row);  // NOLINT
     }
 }
 
@@ -275,7 +402,7 @@ bool Segment::Get(const Slice& key, const uint64_t time, DataBlock** block) {
         return false;
     }
     void* entry = NULL;
-    if (entries_->Get(key, entry) < 0 || entry == NULL) {
+    if (GetKeyEntry(key, entry) < 0 || entry == NULL) {
         return false;
     }
     *block = ((KeyEntry*)entry)->entries.Get(time);  // NOLINT
@@ -294,7 +421,7 @@ bool Segment::Get(const Slice& key, uint32_t idx, const uint64_t time, DataBlock
         return Get(key, time, block);
     }
     void* entry = NULL;
-    if (entries_->Get(key, entry) < 0 || entry == NULL) {
+    if (GetKeyEntry(key, entry) < 0 || entry == NULL) {
         return false;
     }
     *block = ((KeyEntry**)entry)[pos->second]->entries.Get(time);  // NOLINT
@@ -304,8 +431,8 @@ bool Segment::Get(const Slice& key, uint32_t idx, const uint64_t time, DataBlock
 bool Segment::Delete(const Slice& key) {
     ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
     {
-        std::lock_guard<std::mutex> lock(mu_);
-        entry_node = entries_->Remove(key);
+        std::lock_guard<std::shared_mutex> lock(mu_);
+        entry_node = RemoveKey(key);
         if (entry_node == NULL) {
             return false;
         }
@@ -408,6 +535,9 @@ void Segment::GcFreeList(uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt, uint64_t
     }
     uint64_t free_list_version = cur_version - FLAGS_gc_deleted_pk_version_delta;
     GcEntryFreeList(free_list_version, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    if (pk_index_ != NULL) {
+        pk_index_->Reclaim(free_list_version);
+    }
 }
 
 void Segment::ExecuteGc(const TTLSt& ttl_st, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
@@ -481,13 +611,15 @@ void Segment::Gc4Head(uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_reco
     }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
+    uint64_t visited = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
     while (it->Valid()) {
+        visited++;
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         ::openmldb::base::Node<uint64_t, DataBlock*>* node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                 node = entry->entries.SplitByPos(keep_cnt);
             }
@@ -501,6 +633,7 @@ void Segment::Gc4Head(uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_reco
     DEBUGLOG("[Gc4Head] segment gc keep cnt %lu consumed %lu, count %lu", keep_cnt,
              (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
+    gc_visited_key_cnt_.fetch_add(visited, std::memory_order_relaxed);
     delete it;
 }
 
@@ -508,9 +641,11 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                         uint64_t& gc_record_byte_size) {
     uint64_t old = gc_idx_cnt;
     uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint64_t visited = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
     while (it->Valid()) {
+        visited++;
         KeyEntry** entry_arr = (KeyEntry**)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
@@ -533,7 +668,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                         continue_flag = true;
                     } else {
                         node = NULL;
-                        std::lock_guard<std::mutex> lock(mu_);
+                        std::lock_guard<std::shared_mutex> lock(mu_);
                         SplitList(entry, kv.second.abs_ttl, &node);
                         if (entry->entries.IsEmpty()) {
                             empty_cnt++;
@@ -542,7 +677,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                     break;
                 }
                 case ::openmldb::storage::TTLType::kLatestTime: {
-                    std::lock_guard<std::mutex> lock(mu_);
+                    std::lock_guard<std::shared_mutex> lock(mu_);
                     if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                         node = entry->entries.SplitByPos(kv.second.lat_ttl);
                     }
@@ -554,7 +689,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                         continue_flag = true;
                     } else {
                         node = NULL;
-                        std::lock_guard<std::mutex> lock(mu_);
+                        std::lock_guard<std::shared_mutex> lock(mu_);
                         if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                             node = entry->entries.SplitByKeyAndPos(kv.second.abs_ttl, kv.second.lat_ttl);
                         }
@@ -567,7 +702,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                         continue_flag = true;
                     } else {
                         node = NULL;
-                        std::lock_guard<std::mutex> lock(mu_);
+                        std::lock_guard<std::shared_mutex> lock(mu_);
                         if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                             if (kv.second.abs_ttl == 0) {
                                 node = entry->entries.SplitByPos(kv.second.lat_ttl);
@@ -599,7 +734,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
             bool is_empty = true;
             ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
             {
-                std::lock_guard<std::mutex> lock(mu_);
+                std::lock_guard<std::shared_mutex> lock(mu_);
                 for (uint32_t i = 0; i < ts_cnt_; i++) {
                     if (!entry_arr[i]->entries.IsEmpty()) {
                         is_empty = false;
@@ -607,7 +742,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
                     }
                 }
                 if (is_empty) {
-                    entry_node = entries_->Remove(key);
+                    entry_node = RemoveKey(key);
                 }
             }
             if (entry_node != NULL) {
@@ -618,6 +753,7 @@ void Segment::GcAllType(const std::map<uint32_t, TTLSt>& ttl_st_map, uint64_t& g
     }
     DEBUGLOG("[GcAll] segment gc consumed %lu, count %lu", (::baidu::common::timer::get_micros() - consumed) / 1000,
              gc_idx_cnt - old);
+    gc_visited_key_cnt_.fetch_add(visited, std::memory_order_relaxed);
     delete it;
 }
 
@@ -631,11 +767,17 @@ void Segment::SplitList(KeyEntry* entry, uint64_t ts, ::openmldb::base::Node<uin
 // fast gc with no global pause
 void Segment::Gc4TTL(const uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
                      uint64_t& gc_record_byte_size) {
+    if (use_expire_index_.load(std::memory_order_relaxed)) {
+        Gc4TTLByExpireIndex(time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        return;
+    }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
+    uint64_t visited = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
     while (it->Valid()) {
+        visited++;
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
@@ -652,10 +794,10 @@ void Segment::Gc4TTL(const uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_rec
         node = NULL;
         ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             SplitList(entry, time, &node);
             if (entry->entries.IsEmpty()) {
-                entry_node = entries_->Remove(key);
+                entry_node = RemoveKey(key);
             }
         }
         if (entry_node != NULL) {
@@ -670,9 +812,82 @@ void Segment::Gc4TTL(const uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_rec
     DEBUGLOG("[Gc4TTL] segment gc with key %lu ,consumed %lu, count %lu", time,
              (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
+    gc_visited_key_cnt_.fetch_add(visited, std::memory_order_relaxed);
     delete it;
 }
 
+void Segment::AddExpireKey(const Slice& key, uint64_t time) {
+    uint64_t interval = std::max(FLAGS_gc_expire_bucket_interval, 1u);
+    {
+        std::lock_guard<std::mutex> lock(expire_mu_);
+        // the index may be disabled and cleared since the caller checked it
+        if (!use_expire_index_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        expire_buckets_[time - time % interval].emplace_back(key.data(), key.size());
+    }
+    idx_byte_size_.fetch_add(GetExpireKeySize(key.size()), std::memory_order_relaxed);
+}
+
+void Segment::Gc4TTLByExpireIndex(const uint64_t time, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
+                                  uint64_t& gc_record_byte_size) {
+    uint64_t consumed = ::baidu::common::timer::get_micros();
+    uint64_t old = gc_idx_cnt;
+    // every key holding records not later than time is in one of the buckets starting not later than time
+    std::vector<std::string> keys;
+    {
+        std::lock_guard<std::mutex> lock(expire_mu_);
+        auto end = expire_buckets_.upper_bound(time);
+        for (auto iter = expire_buckets_.begin(); iter != end; ++iter) {
+            keys.insert(keys.end(), std::make_move_iterator(iter->second.begin()),
+                        std::make_move_iterator(iter->second.end()));
+        }
+        expire_buckets_.erase(expire_buckets_.begin(), end);
+    }
+    uint64_t key_byte_size = 0;
+    for (const auto& key : keys) {
+        key_byte_size += GetExpireKeySize(key.size());
+    }
+    idx_byte_size_.fetch_sub(key_byte_size, std::memory_order_relaxed);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    for (const auto& key : keys) {
+        Slice skey(key);
+        KeyEntry* entry = NULL;
+        ::openmldb::base::Node<uint64_t, DataBlock*>* node = NULL;
+        ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
+        {
+            std::lock_guard<std::shared_mutex> lock(mu_);
+            void* value = NULL;
+            if (GetKeyEntry(skey, value) < 0 || value == NULL) {
+                // the key has been deleted
+                continue;
+            }
+            entry = (KeyEntry*)value;  // NOLINT
+            if (!entry->entries.IsEmpty() && entry->entries.GetLast()->GetKey() <= time) {
+                SplitList(entry, time, &node);
+            }
+            if (entry->entries.IsEmpty()) {
+                entry_node = RemoveKey(skey);
+            } else {
+                AddExpireKey(skey, entry->entries.GetLast()->GetKey());
+            }
+        }
+        if (entry_node != NULL) {
+            std::lock_guard<std::mutex> lock(gc_mu_);
+            entry_free_list_->Insert(gc_version_.load(std::memory_order_relaxed), entry_node);
+        }
+        uint64_t entry_gc_idx_cnt = 0;
+        FreeList(node, entry_gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        entry->count_.fetch_sub(entry_gc_idx_cnt, std::memory_order_relaxed);
+        gc_idx_cnt += entry_gc_idx_cnt;
+    }
+    DEBUGLOG("[Gc4TTLByExpireIndex] segment gc with key %lu ,consumed %lu, count %lu, visited key %lu", time,
+             (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old, keys.size());
+    idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
+    gc_visited_key_cnt_.fetch_add(keys.size(), std::memory_order_relaxed);
+}
+
 void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64_t& gc_idx_cnt, uint64_t& gc_record_cnt,
                             uint64_t& gc_record_byte_size) {
     if (time == 0 || keep_cnt == 0) {
@@ -681,9 +896,11 @@ void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64
     }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
+    uint64_t visited = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
     while (it->Valid()) {
+        visited++;
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         ::openmldb::base::Node<uint64_t, DataBlock*>* node = entry->entries.GetLast();
         it->Next();
@@ -698,7 +915,7 @@ void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64
         }
         node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                 node = entry->entries.SplitByKeyAndPos(time, keep_cnt);
             }
@@ -713,6 +930,7 @@ void Segment::Gc4TTLAndHead(const uint64_t time, const uint64_t keep_cnt, uint64
         "count %lu",
         time, keep_cnt, (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
+    gc_visited_key_cnt_.fetch_add(visited, std::memory_order_relaxed);
     delete it;
 }
 
@@ -730,9 +948,11 @@ void Segment::Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt, uint64_
     }
     uint64_t consumed = ::baidu::common::timer::get_micros();
     uint64_t old = gc_idx_cnt;
+    uint64_t visited = 0;
     KeyEntries::Iterator* it = entries_->NewIterator();
     it->SeekToFirst();
     while (it->Valid()) {
+        visited++;
         KeyEntry* entry = (KeyEntry*)it->GetValue();  // NOLINT
         Slice key = it->GetKey();
         it->Next();
@@ -743,12 +963,12 @@ void Segment::Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt, uint64_
         node = NULL;
         ::openmldb::base::Node<Slice, void*>* entry_node = NULL;
         {
-            std::lock_guard<std::mutex> lock(mu_);
+            std::lock_guard<std::shared_mutex> lock(mu_);
             if (entry->refs_.load(std::memory_order_acquire) <= 0) {
                 node = entry->entries.SplitByKeyOrPos(time, keep_cnt);
             }
             if (entry->entries.IsEmpty()) {
-                entry_node = entries_->Remove(key);
+                entry_node = RemoveKey(key);
             }
         }
         if (entry_node != NULL) {
@@ -765,6 +985,7 @@ void Segment::Gc4TTLOrHead(const uint64_t time, const uint64_t keep_cnt, uint64_
         "count %lu",
         time, keep_cnt, (::baidu::common::timer::get_micros() - consumed) / 1000, gc_idx_cnt - old);
     idx_cnt_.fetch_sub(gc_idx_cnt - old, std::memory_order_relaxed);
+    gc_visited_key_cnt_.fetch_add(visited, std::memory_order_relaxed);
     delete it;
 }
 
@@ -773,7 +994,7 @@ int Segment::GetCount(const Slice& key, uint64_t& count) {
         return -1;
     }
     void* entry = NULL;
-    if (entries_->Get(key, entry) < 0 || entry == NULL) {
+    if (GetKeyEntry(key, entry) < 0 || entry == NULL) {
         return -1;
     }
     count = ((KeyEntry*)entry)->count_.load(std::memory_order_relaxed);  // NOLINT
@@ -789,7 +1010,7 @@ int Segment::GetCount(const Slice& key, uint32_t idx, uint64_t& count) {
         return GetCount(key, count);
     }
     void* entry_arr = NULL;
-    if (entries_->Get(key, entry_arr) < 0 || entry_arr == NULL) {
+    if (GetKeyEntry(key, entry_arr) < 0 || entry_arr == NULL) {
         return -1;
     }
     count = ((KeyEntry**)entry_arr)[pos->second]->count_.load(  // NOLINT
@@ -803,7 +1024,7 @@ MemTableIterator* Segment::NewIterator(const Slice& key, Ticket& ticket) {
         return new MemTableIterator(NULL);
     }
     void* entry = NULL;
-    if (entries_->Get(key, entry) < 0 || entry == NULL) {
+    if (GetKeyEntry(key, entry) < 0 || entry == NULL) {
         return new MemTableIterator(NULL);
     }
     ticket.Push((KeyEntry*)entry);                                           // NOLINT
@@ -819,7 +1040,7 @@ MemTableIterator* Segment::NewIterator(const Slice& key, uint32_t idx, Ticket& t
         return NewIterator(key, ticket);
     }
     void* entry_arr = NULL;
-    if (entries_->Get(key, entry_arr) < 0 || entry_arr == NULL) {
+    if (GetKeyEntry(key, entry_arr) < 0 || entry_arr == NULL) {
         return new MemTableIterator(NULL);
     }
     ticket.Push(((KeyEntry**)entry_arr)[pos->second]);                                         // NOLINT
@@ -856,7 +1077,7 @@ void MemTableIterator::Next() {
 }
 
 ::openmldb::base::Slice MemTableIterator::GetValue() const {
-    return ::openmldb::base::Slice(it_->GetValue()->data, it_->GetValue()->size);
+    return GetBlockRow(it_->GetValue(), &row_buf_);
 }
 
 uint64_t MemTableIterator::GetKey() const { return it_->GetKey(); }
@@ -21,12 +21,15 @@
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <shared_mutex>  // NOLINT
+#include <string>
 #include <vector>
 
 #include "base/skiplist.h"
 #include "base/slice.h"
 #include "proto/tablet.pb.h"
 #include "storage/iterator.h"
+#include "storage/pk_hash_index.h"
 #include "storage/schema.h"
 #include "storage/ticket.h"
 
@@ -43,16 +46,21 @@ class Ticket;
 struct DataBlock {
     // dimension count down
     uint8_t dim_cnt_down;
+    // the data is allocated inline after the block
+    bool inline_data;
+    // the data is a snappy compressed row
+    bool compressed;
     uint32_t size;
     char* data;
 
-    DataBlock(uint8_t dim_cnt, const char* input, uint32_t len) : dim_cnt_down(dim_cnt), size(len), data(NULL) {
+    DataBlock(uint8_t dim_cnt, const char* input, uint32_t len)
+        : dim_cnt_down(dim_cnt), inline_data(false), compressed(false), size(len), data(NULL) {
         data = new char[len];
         memcpy(data, input, len);
     }
 
     DataBlock(uint8_t dim_cnt, char* input, uint32_t len, bool skip_copy)
-        : dim_cnt_down(dim_cnt), size(len), data(NULL) {
+        : dim_cnt_down(dim_cnt), inline_data(false), compressed(false), size(len), data(NULL) {
         if (skip_copy) {
             data = input;
         } else {
@@ -61,12 +69,31 @@ struct DataBlock {
         }
     }
 
+    // copy the data inline with one allocation, the block is freed by delete
+    static DataBlock* Create(uint8_t dim_cnt, const char* input, uint32_t len) {
+        void* mem = ::operator new(sizeof(DataBlock) + len);
+        char* inline_buf = reinterpret_cast<char*>(mem) + sizeof(DataBlock);
+        memcpy(inline_buf, input, len);
+        auto* block = new (mem) DataBlock(dim_cnt, inline_buf, len, true);
+        block->inline_data = true;
+        return block;
+    }
+
+    static void operator delete(void* p) { ::operator delete(p); }
+
     ~DataBlock() {
-        delete[] data;
+        if (!inline_data) {
+            delete[] data;
+        }
         data = NULL;
     }
 };
 
+// the raw row of the block. a compressed row is uncompressed into buf, so the
+// slice is valid until buf is reused. an empty slice is returned if the row is
+// corrupted
+Slice GetBlockRow(const DataBlock* block, std::string* buf);
+
 // the desc time comparator
 struct TimeComparator {
     int operator()(const uint64_t& a, const uint64_t& b) const {
@@ -96,6 +123,8 @@ class MemTableIterator : public TableIterator {
 
  private:
     TimeEntries::Iterator* it_;
+    // the uncompressed current row, the value is valid until the next GetValue
+    mutable std::string row_buf_;
 };
 
 class KeyEntry {
@@ -157,6 +186,7 @@ class Segment {
 
     void Put(const Slice& key, uint64_t time, DataBlock* row);
 
+    // need hold mu_ exclusively
     void PutUnlock(const Slice& key, uint64_t time, DataBlock* row);
 
     void BulkLoadPut(unsigned int key_entry_id, const Slice& key, uint64_t time, DataBlock* row);
@@ -226,7 +256,10 @@ class Segment {
 
     const std::map<uint32_t, uint32_t>& GetTsIdxMap() const { return ts_idx_map_; }
 
-    inline uint64_t GetIdxByteSize() { return idx_byte_size_.load(std::memory_order_relaxed); }
+    inline uint64_t GetIdxByteSize() {
+        uint64_t byte_size = idx_byte_size_.load(std::memory_order_relaxed);
+        return pk_index_ == NULL ? byte_size : byte_size + pk_index_->GetByteSize();
+    }
 
     inline uint64_t GetPkCnt() { return pk_cnt_.load(std::memory_order_relaxed); }
 
@@ -234,8 +267,11 @@ class Segment {
                     uint64_t& gc_record_cnt,         // NOLINT
                     uint64_t& gc_record_byte_size);  // NOLINT
 
+    // the ordered keys for traversal, point lookups go through the pk hash index if enabled
     KeyEntries* GetKeyEntries() { return entries_; }
 
+    bool UsePkHashIndex() const { return pk_index_ != NULL; }
+
     int GetCount(const Slice& key, uint64_t& count);                // NOLINT
     int GetCount(const Slice& key, uint32_t idx, uint64_t& count);  // NOLINT
 
@@ -245,12 +281,46 @@ class Segment {
                          uint64_t& gc_record_cnt,         // NOLINT
                          uint64_t& gc_record_byte_size);  // NOLINT
 
+    // index keys by the time bucket of their oldest record, Gc4TTL then only
+    // visits the keys of expired buckets. it must be set before any put and
+    // only works for segments with single ts. disabling it drops the indexed keys
+    void SetExpireIndex(bool enable);
+
+    bool UseExpireIndex() const { return use_expire_index_.load(std::memory_order_relaxed); }
+
+    // the total count of keys visited by gc
+    uint64_t GetGcVisitedKeyCnt() const { return gc_visited_key_cnt_.load(std::memory_order_relaxed); }
+
  private:
+    // lookup through the pk hash index if enabled, otherwise the key skiplist
+    int GetKeyEntry(const Slice& key, void*& value);  // NOLINT
+
+    // need hold mu_ exclusively
+    uint8_t InsertKey(const Slice& key, void* value);
+    ::openmldb::base::Node<Slice, void*>* RemoveKey(const Slice& key);
+
+    // need hold mu_ exclusively, or hold it shared with the lock of entry
+    void PutToEntry(const Slice& key, KeyEntry* entry, uint64_t time, DataBlock* row);
+    void PutToEntry(KeyEntry* entry, uint32_t idx_pos, uint64_t time, DataBlock* row);
+
+    // serialize the puts to a key entry while mu_ is held shared. the locks are striped
+    // over all the segments to keep KeyEntry and Segment small
+    static std::mutex& GetEntryMutex(const KeyEntry* entry);
+
     void FreeList(::openmldb::base::Node<uint64_t, DataBlock*>* node, uint64_t& gc_idx_cnt,  // NOLINT
                   uint64_t& gc_record_cnt,         // NOLINT
                   uint64_t& gc_record_byte_size);  // NOLINT
     void SplitList(KeyEntry* entry, uint64_t ts, ::openmldb::base::Node<uint64_t, DataBlock*>** node);
 
+    void AddExpireKey(const Slice& key, uint64_t time);
+
+    // drop the keys of the expire index and their byte size
+    void ClearExpireKeys();
+
+    void Gc4TTLByExpireIndex(const uint64_t time, uint64_t& gc_idx_cnt,  // NOLINT
+                             uint64_t& gc_record_cnt,                    // NOLINT
+                             uint64_t& gc_record_byte_size);             // NOLINT
+
     void GcEntryFreeList(uint64_t version, uint64_t& gc_idx_cnt,  // NOLINT
                          uint64_t& gc_record_cnt,                 // NOLINT
                          uint64_t& gc_record_byte_size);          // NOLINT
@@ -260,8 +330,10 @@ class Segment {
 
  private:
     KeyEntries* entries_;
-    // only Put need mutex
-    std::mutex mu_;
+    // puts to existing keys hold it shared and lock the KeyEntry, so puts to
+    // different keys do not wait for each other. changing the key list and
+    // gc on the time entries hold it exclusively
+    std::shared_mutex mu_;
     std::mutex gc_mu_;
     std::atomic<uint64_t> idx_cnt_;
     std::atomic<uint64_t> idx_byte_size_;
@@ -273,6 +345,15 @@ class Segment {
     std::map<uint32_t, uint32_t> ts_idx_map_;
     std::vector<std::shared_ptr<std::atomic<uint64_t>>> idx_cnt_vec_;
     uint64_t ttl_offset_;
+    std::atomic<bool> use_expire_index_;
+    // bucket start time -> keys whose oldest record was in the bucket when added.
+    // a key may be found in stale buckets, it is checked again on gc. the keys are
+    // copies since the key entries may be freed first, they are counted in idx_byte_size_
+    std::map<uint64_t, std::vector<std::string>> expire_buckets_;
+    std::mutex expire_mu_;
+    std::atomic<uint64_t> gc_visited_key_cnt_;
+    // NULL if segment_pk_hash_index is off
+    PkHashIndex* pk_index_;
 };
 
 }  // namespace storage
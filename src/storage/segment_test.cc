@@ -16,16 +16,25 @@
 
 #include "storage/segment.h"
 
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "base/glog_wapper.h"  // NOLINT
 #include "base/slice.h"
+#include "gflags/gflags.h"
 #include "gtest/gtest.h"
 #include "storage/record.h"
 
 using ::openmldb::base::Slice;
 
+DECLARE_uint32(gc_expire_bucket_interval);
+DECLARE_bool(segment_pk_hash_index);
+DECLARE_uint32(segment_pk_hash_bucket_cnt);
+
 namespace openmldb {
 namespace storage {
 
@@ -51,6 +60,16 @@ TEST_F(SegmentTest, DataBlock) {
     delete db;
 }
 
+TEST_F(SegmentTest, InlineDataBlock) {
+    const char* test = "test";
+    DataBlock* db = DataBlock::Create(1, test, 4);
+    ASSERT_TRUE(db->inline_data);
+    ASSERT_EQ(4, (int64_t)db->size);
+    ASSERT_EQ(reinterpret_cast<char*>(db) + sizeof(DataBlock), db->data);
+    ASSERT_EQ(0, memcmp(test, db->data, 4));
+    delete db;
+}
+
 TEST_F(SegmentTest, PutAndGet) {
     Segment segment;
     const char* test = "test";
@@ -66,6 +85,29 @@ TEST_F(SegmentTest, PutAndGet) {
     ASSERT_EQ(e, t);
 }
 
+TEST_F(SegmentTest, ConcurrentPut) {
+    Segment segment;
+    std::vector<std::thread> threads;
+    for (uint64_t idx = 0; idx < 8; idx++) {
+        threads.emplace_back([&segment, idx] {
+            for (uint64_t i = 0; i < 10000; i++) {
+                std::string key = "pk" + std::to_string(i % 100);
+                segment.Put(Slice(key), idx * 10000 + i, "test", 4);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(100u, segment.GetPkCnt());
+    ASSERT_EQ(80000u, segment.GetIdxCnt());
+    for (uint32_t i = 0; i < 100; i++) {
+        uint64_t count = 0;
+        ASSERT_EQ(0, segment.GetCount(Slice("pk" + std::to_string(i)), count));
+        ASSERT_EQ(800u, count);
+    }
+}
+
 TEST_F(SegmentTest, PutAndScan) {
     Segment segment;
     Slice pk("test1");
@@ -250,6 +292,134 @@ TEST_F(SegmentTest, TestGc4TTL) {
     ASSERT_EQ(2 * GetRecordSize(5), (int64_t)gc_record_byte_size);
 }
 
+TEST_F(SegmentTest, TestGc4TTLByExpireIndex) {
+    uint32_t interval = FLAGS_gc_expire_bucket_interval;
+    FLAGS_gc_expire_bucket_interval = 10;
+    Segment full_segment;
+    Segment segment;
+    segment.SetExpireIndex(true);
+    ASSERT_TRUE(segment.UseExpireIndex());
+    // key i holds records from 1000 + i * 10 to 1000 + i * 10 + 4
+    for (int i = 0; i < 100; i++) {
+        std::string key = "PK" + std::to_string(i);
+        for (int j = 4; j >= 0; j--) {
+            full_segment.Put(Slice(key), 1000 + i * 10 + j, "test", 4);
+            segment.Put(Slice(key), 1000 + i * 10 + j, "test", 4);
+        }
+    }
+    // out of order put moves the key to an earlier bucket
+    segment.Put("PK50", 900, "test", 4);
+    full_segment.Put("PK50", 900, "test", 4);
+    // the keys in the expire buckets are counted
+    ASSERT_GT(segment.GetIdxByteSize(), full_segment.GetIdxByteSize());
+    for (uint64_t time : {999, 1052, 1052, 1200, 2000}) {
+        uint64_t gc_idx_cnt = 0, gc_record_cnt = 0, gc_record_byte_size = 0;
+        uint64_t full_gc_idx_cnt = 0, full_gc_record_cnt = 0, full_gc_record_byte_size = 0;
+        uint64_t visited = segment.GetGcVisitedKeyCnt();
+        segment.Gc4TTL(time, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+        full_segment.Gc4TTL(time, full_gc_idx_cnt, full_gc_record_cnt, full_gc_record_byte_size);
+        ASSERT_EQ(full_gc_idx_cnt, gc_idx_cnt);
+        ASSERT_EQ(full_gc_record_cnt, gc_record_cnt);
+        ASSERT_EQ(full_gc_record_byte_size, gc_record_byte_size);
+        ASSERT_EQ(full_segment.GetIdxCnt(), segment.GetIdxCnt());
+        ASSERT_EQ(full_segment.GetPkCnt(), segment.GetPkCnt());
+        if (time == 999) {
+            ASSERT_EQ(1u, gc_idx_cnt);
+            ASSERT_EQ(1u, segment.GetGcVisitedKeyCnt() - visited);
+        } else if (time == 1052) {
+            // keys 0 - 5 hold expired records
+            ASSERT_LE(segment.GetGcVisitedKeyCnt() - visited, 7u);
+        }
+    }
+    ASSERT_EQ(0u, segment.GetIdxCnt());
+    ASSERT_EQ(full_segment.GetIdxByteSize(), segment.GetIdxByteSize());
+    ASSERT_LT(segment.GetGcVisitedKeyCnt(), full_segment.GetGcVisitedKeyCnt());
+    FLAGS_gc_expire_bucket_interval = interval;
+}
+
+TEST_F(SegmentTest, DisableExpireIndex) {
+    Segment full_segment;
+    Segment segment;
+    segment.SetExpireIndex(true);
+    for (int i = 0; i < 10; i++) {
+        std::string key = "PK" + std::to_string(i);
+        full_segment.Put(Slice(key), 1000 + i, "test", 4);
+        segment.Put(Slice(key), 1000 + i, "test", 4);
+    }
+    ASSERT_GT(segment.GetIdxByteSize(), full_segment.GetIdxByteSize());
+    // the indexed keys are dropped and not added any more
+    segment.SetExpireIndex(false);
+    ASSERT_FALSE(segment.UseExpireIndex());
+    ASSERT_EQ(full_segment.GetIdxByteSize(), segment.GetIdxByteSize());
+    full_segment.Put("PK0", 900, "test", 4);
+    segment.Put("PK0", 900, "test", 4);
+    ASSERT_EQ(full_segment.GetIdxByteSize(), segment.GetIdxByteSize());
+}
+
+TEST_F(SegmentTest, PkHashIndex) {
+    bool use_hash_index = FLAGS_segment_pk_hash_index;
+    uint32_t bucket_cnt = FLAGS_segment_pk_hash_bucket_cnt;
+    FLAGS_segment_pk_hash_index = true;
+    FLAGS_segment_pk_hash_bucket_cnt = 4;
+    Segment segment;
+    ASSERT_TRUE(segment.UsePkHashIndex());
+    // enough keys to resize the buckets a few times, the keys are found while the buckets are moved
+    for (int i = 0; i < 1000; i++) {
+        std::string key = "PK" + std::to_string(i);
+        segment.Put(Slice(key), 9768, "test1", 5);
+        segment.Put(Slice(key), 9769, "test2", 5);
+        for (int j = 0; j <= i; j += 7) {
+            uint64_t count = 0;
+            ASSERT_EQ(0, segment.GetCount(Slice("PK" + std::to_string(j)), count));
+        }
+    }
+    ASSERT_EQ(1000u, segment.GetPkCnt());
+    for (int i = 0; i < 1000; i++) {
+        std::string key = "PK" + std::to_string(i);
+        uint64_t count = 0;
+        ASSERT_EQ(0, segment.GetCount(Slice(key), count));
+        ASSERT_EQ(2u, count);
+        Ticket ticket;
+        std::unique_ptr<MemTableIterator> it(segment.NewIterator(Slice(key), ticket));
+        it->SeekToFirst();
+        ASSERT_TRUE(it->Valid());
+        ASSERT_EQ(9769u, it->GetKey());
+    }
+    ASSERT_TRUE(segment.Delete("PK1"));
+    ASSERT_FALSE(segment.Delete("PK1"));
+    uint64_t count = 0;
+    ASSERT_EQ(-1, segment.GetCount("PK1", count));
+    uint64_t gc_idx_cnt = 0, gc_record_cnt = 0, gc_record_byte_size = 0;
+    segment.Gc4TTL(9768, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    ASSERT_EQ(999u, gc_idx_cnt);
+    segment.Gc4TTL(9769, gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    for (int i = 0; i < 4; i++) {
+        segment.IncrGcVersion();
+        segment.GcFreeList(gc_idx_cnt, gc_record_cnt, gc_record_byte_size);
+    }
+    ASSERT_EQ(0u, segment.GetPkCnt());
+    ASSERT_EQ(2000u, gc_idx_cnt);
+    ASSERT_EQ(-1, segment.GetCount("PK2", count));
+    segment.Put("PK2", 9770, "test3", 5);
+    ASSERT_EQ(0, segment.GetCount("PK2", count));
+    ASSERT_EQ(1u, count);
+
+    // removes while the buckets are moved
+    Segment segment2;
+    for (int i = 0; i < 1000; i++) {
+        std::string key = "PK" + std::to_string(i);
+        segment2.Put(Slice(key), 9768, "test1", 5);
+        if (i % 2 == 1) {
+            ASSERT_TRUE(segment2.Delete(Slice("PK" + std::to_string(i / 2))));
+        }
+    }
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ(i < 500 ? -1 : 0, segment2.GetCount(Slice("PK" + std::to_string(i)), count));
+    }
+    FLAGS_segment_pk_hash_index = use_hash_index;
+    FLAGS_segment_pk_hash_bucket_cnt = bucket_cnt;
+}
+
 TEST_F(SegmentTest, TestGc4TTLAndHead) {
     Segment segment;
     segment.Put("PK1", 9766, "test1", 5);
@@ -31,16 +31,20 @@ namespace storage {
 const std::string MANIFEST = "MANIFEST";  // NOLINT
 
 int Snapshot::GenManifest(const std::string& snapshot_name, uint64_t key_count, uint64_t offset, uint64_t term) {
-    DEBUGLOG("record offset[%lu]. add snapshot[%s] key_count[%lu]", offset, snapshot_name.c_str(), key_count);
-    std::string full_path = snapshot_path_ + MANIFEST;
-    std::string tmp_file = snapshot_path_ + MANIFEST + ".tmp";
     ::openmldb::api::Manifest manifest;
-    std::string manifest_info;
     manifest.set_offset(offset);
     manifest.set_name(snapshot_name);
     manifest.set_count(key_count);
     manifest.set_term(term);
-    manifest_info.clear();
+    return GenManifest(manifest);
+}
+
+int Snapshot::GenManifest(const ::openmldb::api::Manifest& manifest) {
+    DEBUGLOG("record offset[%lu]. add snapshot[%s] key_count[%lu] chunk_num[%d] delta_num[%d]", manifest.offset(),
+             manifest.name().c_str(), manifest.count(), manifest.chunks_size(), manifest.deltas_size());
+    std::string full_path = snapshot_path_ + MANIFEST;
+    std::string tmp_file = snapshot_path_ + MANIFEST + ".tmp";
+    std::string manifest_info;
     google::protobuf::TextFormat::PrintToString(manifest, &manifest_info);
     FILE* fd_write = fopen(tmp_file.c_str(), "w");
     if (fd_write == NULL) {
@@ -81,5 +85,25 @@ int Snapshot::GetLocalManifest(const std::string& full_path, ::openmldb::api::Ma
     return 0;
 }
 
+std::vector<std::string> Snapshot::GetSnapshotFiles(const ::openmldb::api::Manifest& manifest) {
+    std::vector<std::string> files = GetBaseSnapshotFiles(manifest);
+    for (const auto& delta : manifest.deltas()) {
+        files.push_back(delta.name());
+    }
+    return files;
+}
+
+std::vector<std::string> Snapshot::GetBaseSnapshotFiles(const ::openmldb::api::Manifest& manifest) {
+    std::vector<std::string> files;
+    if (manifest.chunks_size() > 0) {
+        for (const auto& chunk : manifest.chunks()) {
+            files.push_back(chunk.name());
+        }
+    } else if (manifest.has_name()) {
+        files.push_back(manifest.name());
+    }
+    return files;
+}
+
 }  // namespace storage
 }  // namespace openmldb
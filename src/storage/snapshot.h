@@ -18,6 +18,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "log/log_writer.h"
 #include "proto/tablet.pb.h"
@@ -38,8 +39,13 @@ class Snapshot {
                          uint64_t& latest_offset) = 0;  // NOLINT
     uint64_t GetOffset() { return offset_; }
     int GenManifest(const std::string& snapshot_name, uint64_t key_count, uint64_t offset, uint64_t term);
+    int GenManifest(const ::openmldb::api::Manifest& manifest);
     static int GetLocalManifest(const std::string& full_path,
                                 ::openmldb::api::Manifest& manifest);  // NOLINT
+    // names of all the files the snapshot of the manifest consists of
+    static std::vector<std::string> GetSnapshotFiles(const ::openmldb::api::Manifest& manifest);
+    // names of the files of the base snapshot, the deltas excluded
+    static std::vector<std::string> GetBaseSnapshotFiles(const ::openmldb::api::Manifest& manifest);
 
  protected:
     uint32_t tid_;
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "storage/snapshot_record.h"
+
+#include <string.h>
+
+#include "base/endianconv.h"
+
+namespace openmldb {
+namespace storage {
+
+// version | log_index | time | value_size | value | dim_cnt | [idx | seg_idx | key_size | key] |
+// ts_cnt | [ts_col_id | ts] | term | pk_size | pk | ts_dim_cnt | [idx | ts]
+// the fields from term on are added in version 2, version 1 records are still decoded
+static const uint8_t SNAPSHOT_RECORD_VERSION = 2;
+static const uint32_t SNAPSHOT_RECORD_HEADER_SIZE = 1 + 8 + 8 + 4;
+
+static inline void AppendFixed32(uint32_t value, std::string* buffer) {
+    memrev32ifbe(static_cast<void*>(&value));
+    buffer->append(reinterpret_cast<const char*>(&value), 4);
+}
+
+static inline void AppendFixed64(uint64_t value, std::string* buffer) {
+    memrev64ifbe(static_cast<void*>(&value));
+    buffer->append(reinterpret_cast<const char*>(&value), 8);
+}
+
+static inline bool ReadFixed32(const char** cur, const char* end, uint32_t* value) {
+    if (end - *cur < 4) {
+        return false;
+    }
+    memcpy(value, *cur, 4);
+    memrev32ifbe(static_cast<void*>(value));
+    *cur += 4;
+    return true;
+}
+
+static inline bool ReadFixed64(const char** cur, const char* end, uint64_t* value) {
+    if (end - *cur < 8) {
+        return false;
+    }
+    memcpy(value, *cur, 8);
+    memrev64ifbe(static_cast<void*>(value));
+    *cur += 8;
+    return true;
+}
+
+static inline bool ReadBytes(const char** cur, const char* end, ::openmldb::base::Slice* value) {
+    uint32_t size = 0;
+    if (!ReadFixed32(cur, end, &size) || static_cast<uint64_t>(end - *cur) < size) {
+        return false;
+    }
+    value->reset(*cur, size);
+    *cur += size;
+    return true;
+}
+
+void EncodeSnapshotRecord(const SnapshotRecord& record, std::string* buffer) {
+    buffer->clear();
+    uint32_t size = SNAPSHOT_RECORD_HEADER_SIZE + record.value.size() + 4 + record.ts_map.size() * 12 + 4 + 8 + 4 +
+                    record.pk.size() + 4 + record.ts_dimensions.size() * 12;
+    for (const auto& dim : record.dimensions) {
+        size += 12 + dim.key.size();
+    }
+    buffer->reserve(size);
+    buffer->push_back(static_cast<char>(SNAPSHOT_RECORD_VERSION));
+    AppendFixed64(record.log_index, buffer);
+    AppendFixed64(record.time, buffer);
+    AppendFixed32(record.value.size(), buffer);
+    buffer->append(record.value.data(), record.value.size());
+    AppendFixed32(record.dimensions.size(), buffer);
+    for (const auto& dim : record.dimensions) {
+        AppendFixed32(dim.idx, buffer);
+        AppendFixed32(dim.seg_idx, buffer);
+        AppendFixed32(dim.key.size(), buffer);
+        buffer->append(dim.key.data(), dim.key.size());
+    }
+    AppendFixed32(record.ts_map.size(), buffer);
+    for (const auto& kv : record.ts_map) {
+        AppendFixed32(static_cast<uint32_t>(kv.first), buffer);
+        AppendFixed64(kv.second, buffer);
+    }
+    AppendFixed64(record.term, buffer);
+    AppendFixed32(record.pk.size(), buffer);
+    buffer->append(record.pk.data(), record.pk.size());
+    AppendFixed32(record.ts_dimensions.size(), buffer);
+    for (const auto& ts_dim : record.ts_dimensions) {
+        AppendFixed32(ts_dim.idx, buffer);
+        AppendFixed64(ts_dim.ts, buffer);
+    }
+}
+
+bool DecodeSnapshotRecord(const ::openmldb::base::Slice& data, SnapshotRecord* record) {
+    record->Clear();
+    const char* cur = data.data();
+    const char* end = data.data() + data.size();
+    if (data.size() < SNAPSHOT_RECORD_HEADER_SIZE) {
+        return false;
+    }
+    uint8_t version = static_cast<uint8_t>(*cur);
+    if (version < 1 || version > SNAPSHOT_RECORD_VERSION) {
+        return false;
+    }
+    cur++;
+    if (!ReadFixed64(&cur, end, &record->log_index) || !ReadFixed64(&cur, end, &record->time) ||
+        !ReadBytes(&cur, end, &record->value)) {
+        return false;
+    }
+    uint32_t dim_cnt = 0;
+    if (!ReadFixed32(&cur, end, &dim_cnt)) {
+        return false;
+    }
+    record->dimensions.resize(dim_cnt);
+    for (auto& dim : record->dimensions) {
+        if (!ReadFixed32(&cur, end, &dim.idx) || !ReadFixed32(&cur, end, &dim.seg_idx) ||
+            !ReadBytes(&cur, end, &dim.key)) {
+            return false;
+        }
+    }
+    uint32_t ts_cnt = 0;
+    if (!ReadFixed32(&cur, end, &ts_cnt)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < ts_cnt; i++) {
+        uint32_t ts_col_id = 0;
+        uint64_t ts = 0;
+        if (!ReadFixed32(&cur, end, &ts_col_id) || !ReadFixed64(&cur, end, &ts)) {
+            return false;
+        }
+        record->ts_map.emplace(static_cast<int32_t>(ts_col_id), ts);
+    }
+    if (version < 2) {
+        return cur == end;
+    }
+    uint32_t ts_dim_cnt = 0;
+    if (!ReadFixed64(&cur, end, &record->term) || !ReadBytes(&cur, end, &record->pk) ||
+        !ReadFixed32(&cur, end, &ts_dim_cnt)) {
+        return false;
+    }
+    record->ts_dimensions.resize(ts_dim_cnt);
+    for (auto& ts_dim : record->ts_dimensions) {
+        if (!ReadFixed32(&cur, end, &ts_dim.idx) || !ReadFixed64(&cur, end, &ts_dim.ts)) {
+            return false;
+        }
+    }
+    return cur == end;
+}
+
+void SnapshotRecordToLogEntry(const SnapshotRecord& record, ::openmldb::api::LogEntry* entry) {
+    entry->Clear();
+    entry->set_log_index(record.log_index);
+    if (record.term > 0) {
+        entry->set_term(record.term);
+    }
+    if (!record.pk.empty()) {
+        entry->set_pk(record.pk.data(), record.pk.size());
+    }
+    entry->set_ts(record.time);
+    entry->set_value(record.value.data(), record.value.size());
+    for (const auto& dim : record.dimensions) {
+        auto* dimension = entry->add_dimensions();
+        dimension->set_key(dim.key.data(), dim.key.size());
+        dimension->set_idx(dim.idx);
+    }
+    for (const auto& ts_dim : record.ts_dimensions) {
+        auto* ts_dimension = entry->add_ts_dimensions();
+        ts_dimension->set_idx(ts_dim.idx);
+        ts_dimension->set_ts(ts_dim.ts);
+    }
+}
+
+}  // namespace storage
+}  // namespace openmldb
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_STORAGE_SNAPSHOT_RECORD_H_
+#define SRC_STORAGE_SNAPSHOT_RECORD_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/slice.h"
+#include "proto/tablet.pb.h"
+
+namespace openmldb {
+namespace storage {
+
+struct SnapshotDimension {
+    uint32_t idx;
+    uint32_t seg_idx;
+    ::openmldb::base::Slice key;
+};
+
+struct SnapshotTsDimension {
+    uint32_t idx;
+    uint64_t ts;
+};
+
+// a row of the native snapshot format. the slices point into the buffer it is
+// decoded from, or into the LogEntry it is built from
+struct SnapshotRecord {
+    uint64_t log_index = 0;
+    uint64_t time = 0;
+    uint64_t term = 0;
+    ::openmldb::base::Slice pk;
+    ::openmldb::base::Slice value;
+    std::vector<SnapshotDimension> dimensions;
+    // the ts dimensions of the LogEntry, kept to restore it
+    std::vector<SnapshotTsDimension> ts_dimensions;
+    // ts col id -> ts, empty if ts could not be decoded when the record was built
+    std::map<int32_t, uint64_t> ts_map;
+
+    void Clear() {
+        log_index = 0;
+        time = 0;
+        term = 0;
+        pk.clear();
+        value.clear();
+        dimensions.clear();
+        ts_dimensions.clear();
+        ts_map.clear();
+    }
+};
+
+void EncodeSnapshotRecord(const SnapshotRecord& record, std::string* buffer);
+
+bool DecodeSnapshotRecord(const ::openmldb::base::Slice& data, SnapshotRecord* record);
+
+void SnapshotRecordToLogEntry(const SnapshotRecord& record, ::openmldb::api::LogEntry* entry);
+
+}  // namespace storage
+}  // namespace openmldb
+#endif  // SRC_STORAGE_SNAPSHOT_RECORD_H_
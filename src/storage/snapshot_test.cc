@@ -37,11 +37,18 @@
 #include "storage/binlog.h"
 #include "storage/mem_table.h"
 #include "storage/mem_table_snapshot.h"
+#include "storage/snapshot_record.h"
 #include "storage/ticket.h"
 #include "test/util.h"
 
 DECLARE_string(db_root_path);
 DECLARE_string(snapshot_compression);
+DECLARE_uint64(snapshot_chunk_size);
+DECLARE_string(snapshot_format);
+DECLARE_uint32(load_binlog_thread_num);
+DECLARE_uint32(load_table_batch);
+DECLARE_uint32(snapshot_delta_max_num);
+DECLARE_uint32(snapshot_delta_compact_ratio);
 
 using ::openmldb::api::LogEntry;
 namespace openmldb {
@@ -1708,6 +1715,413 @@ TEST_F(SnapshotTest, Recover_large_snapshot_and_binlog) {
     delete it;
 }
 
+TEST_F(SnapshotTest, Recover_chunked_snapshot) {
+    std::string snapshot_dir = FLAGS_db_root_path + "/102_0/snapshot/";
+    std::string binlog_dir = FLAGS_db_root_path + "/102_0/binlog/";
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, binlog_dir, binlog_index, offset);
+    uint64_t total = 100000;
+    for (uint64_t count = 0; count < total; count++) {
+        offset++;
+        auto entry = ::openmldb::test::PackKVEntry(offset, "key" + std::to_string(count % 100),
+                "value" + std::to_string(count), count + 1, 1);
+        std::string buffer;
+        entry.SerializeToString(&buffer);
+        ::openmldb::base::Slice slice(buffer);
+        ::openmldb::log::Status status = wh->Write(slice);
+        ASSERT_TRUE(status.ok());
+    }
+    wh->Sync();
+    uint64_t chunk_size = FLAGS_snapshot_chunk_size;
+    FLAGS_snapshot_chunk_size = 256 * 1024;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    {
+        MemTableSnapshot snapshot(102, 0, log_part, FLAGS_db_root_path);
+        snapshot.Init();
+        std::shared_ptr<MemTable> table =
+            std::make_shared<MemTable>("test", 102, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+        table->Init();
+        uint64_t offset_value = 0;
+        ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    }
+    ::openmldb::api::Manifest manifest;
+    ASSERT_EQ(0, GetManifest(snapshot_dir + "MANIFEST", &manifest));
+    ASSERT_EQ(total, manifest.count());
+    if (FLAGS_snapshot_compression == "off") {
+        ASSERT_GT(manifest.chunks_size(), 1);
+    }
+    if (manifest.chunks_size() > 0) {
+        ASSERT_EQ(manifest.name(), manifest.chunks(0).name());
+        uint64_t chunk_cnt = 0;
+        for (const auto& chunk : manifest.chunks()) {
+            chunk_cnt += chunk.count();
+        }
+        ASSERT_EQ(total, chunk_cnt);
+    }
+    std::vector<std::string> vec;
+    ASSERT_EQ(0, ::openmldb::base::GetFileName(snapshot_dir, vec));
+    ASSERT_EQ(Snapshot::GetSnapshotFiles(manifest).size() + 1, vec.size());
+
+    MemTableSnapshot snapshot(102, 0, log_part, FLAGS_db_root_path);
+    snapshot.Init();
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 102, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    uint64_t snapshot_offset = 0;
+    ASSERT_TRUE(snapshot.Recover(table, snapshot_offset));
+    ASSERT_EQ(total, snapshot_offset);
+    ASSERT_EQ(total, table->GetRecordCnt());
+    Ticket ticket;
+    TableIterator* it = table->NewIterator("key7", ticket);
+    it->SeekToFirst();
+    uint64_t num = 0;
+    while (it->Valid()) {
+        uint64_t count = it->GetKey() - 1;
+        ASSERT_EQ(7u, count % 100);
+        std::string value_str(it->GetValue().data(), it->GetValue().size());
+        ASSERT_EQ("value" + std::to_string(count), ::openmldb::test::DecodeV(value_str));
+        num++;
+        it->Next();
+    }
+    delete it;
+    ASSERT_EQ(total / 100, num);
+
+    // make snapshot again from the chunked one
+    uint64_t offset_value = 0;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ::openmldb::api::Manifest new_manifest;
+    ASSERT_EQ(0, GetManifest(snapshot_dir + "MANIFEST", &new_manifest));
+    ASSERT_EQ(total, new_manifest.count());
+    vec.clear();
+    ASSERT_EQ(0, ::openmldb::base::GetFileName(snapshot_dir, vec));
+    ASSERT_EQ(Snapshot::GetSnapshotFiles(new_manifest).size() + 1, vec.size());
+    FLAGS_snapshot_chunk_size = chunk_size;
+    RemoveData(FLAGS_db_root_path);
+}
+
+TEST_F(SnapshotTest, Recover_native_snapshot) {
+    std::string snapshot_dir = FLAGS_db_root_path + "/103_0/snapshot/";
+    std::string binlog_dir = FLAGS_db_root_path + "/103_0/binlog/";
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, binlog_dir, binlog_index, offset);
+    uint64_t total = 10000;
+    for (uint64_t count = 0; count < total; count++) {
+        offset++;
+        auto entry = ::openmldb::test::PackKVEntry(offset, "key" + std::to_string(count % 100),
+                "value" + std::to_string(count), count + 1, 1);
+        std::string buffer;
+        entry.SerializeToString(&buffer);
+        ::openmldb::base::Slice slice(buffer);
+        ::openmldb::log::Status status = wh->Write(slice);
+        ASSERT_TRUE(status.ok());
+    }
+    wh->Sync();
+    std::string format = FLAGS_snapshot_format;
+    FLAGS_snapshot_format = "native";
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    {
+        MemTableSnapshot snapshot(103, 0, log_part, FLAGS_db_root_path);
+        snapshot.Init();
+        std::shared_ptr<MemTable> table =
+            std::make_shared<MemTable>("test", 103, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+        table->Init();
+        uint64_t offset_value = 0;
+        ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    }
+    ::openmldb::api::Manifest manifest;
+    ASSERT_EQ(0, GetManifest(snapshot_dir + "MANIFEST", &manifest));
+    ASSERT_EQ(total, manifest.count());
+    ASSERT_EQ(::openmldb::api::kNativeFormat, manifest.format());
+    ASSERT_EQ(8u, manifest.seg_cnt());
+
+    // the precomputed segments are used if seg_cnt is not changed, or else the keys are hashed again
+    for (uint32_t seg_cnt : {8u, 4u}) {
+        MemTableSnapshot snapshot(103, 0, log_part, FLAGS_db_root_path);
+        snapshot.Init();
+        std::shared_ptr<MemTable> table = std::make_shared<MemTable>("test", 103, 0, seg_cnt, mapping, 0,
+                                                                     ::openmldb::type::TTLType::kAbsoluteTime);
+        table->Init();
+        uint64_t snapshot_offset = 0;
+        ASSERT_TRUE(snapshot.Recover(table, snapshot_offset));
+        ASSERT_EQ(total, snapshot_offset);
+        ASSERT_EQ(total, table->GetRecordCnt());
+        Ticket ticket;
+        TableIterator* it = table->NewIterator("key7", ticket);
+        it->SeekToFirst();
+        uint64_t num = 0;
+        while (it->Valid()) {
+            uint64_t count = it->GetKey() - 1;
+            ASSERT_EQ(7u, count % 100);
+            std::string value_str(it->GetValue().data(), it->GetValue().size());
+            ASSERT_EQ("value" + std::to_string(count), ::openmldb::test::DecodeV(value_str));
+            num++;
+            it->Next();
+        }
+        delete it;
+        ASSERT_EQ(total / 100, num);
+    }
+
+    // the native snapshot is read as LogEntry when making a snapshot of the old format
+    FLAGS_snapshot_format = "logentry";
+    MemTableSnapshot snapshot(103, 0, log_part, FLAGS_db_root_path);
+    snapshot.Init();
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 103, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    uint64_t snapshot_offset = 0;
+    ASSERT_TRUE(snapshot.Recover(table, snapshot_offset));
+    uint64_t offset_value = 0;
+    ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+    ::openmldb::api::Manifest new_manifest;
+    ASSERT_EQ(0, GetManifest(snapshot_dir + "MANIFEST", &new_manifest));
+    ASSERT_EQ(total, new_manifest.count());
+    ASSERT_EQ(::openmldb::api::kLogEntryFormat, new_manifest.format());
+    FLAGS_snapshot_format = format;
+    RemoveData(FLAGS_db_root_path);
+}
+
+TEST_F(SnapshotTest, SnapshotRecordToLogEntry) {
+    std::string pk = "pk1";
+    std::string value = "value1";
+    std::string key = "key1";
+    SnapshotRecord record;
+    record.log_index = 10;
+    record.time = 1000;
+    record.term = 3;
+    record.pk.reset(pk.data(), pk.size());
+    record.value.reset(value.data(), value.size());
+    record.dimensions.push_back({1, 2, ::openmldb::base::Slice(key)});
+    record.ts_dimensions.push_back({0, 1001});
+    record.ts_dimensions.push_back({1, 1002});
+    record.ts_map.emplace(2, 1003);
+    std::string buffer;
+    EncodeSnapshotRecord(record, &buffer);
+
+    SnapshotRecord decoded;
+    ASSERT_TRUE(DecodeSnapshotRecord(::openmldb::base::Slice(buffer), &decoded));
+    ASSERT_EQ(1003u, decoded.ts_map[2]);
+    ASSERT_EQ(2u, decoded.dimensions[0].seg_idx);
+    LogEntry entry;
+    SnapshotRecordToLogEntry(decoded, &entry);
+    ASSERT_EQ(10u, entry.log_index());
+    ASSERT_EQ(1000u, entry.ts());
+    ASSERT_EQ(3u, entry.term());
+    ASSERT_EQ(pk, entry.pk());
+    ASSERT_EQ(value, entry.value());
+    ASSERT_EQ(1, entry.dimensions_size());
+    ASSERT_EQ(key, entry.dimensions(0).key());
+    ASSERT_EQ(1u, entry.dimensions(0).idx());
+    ASSERT_EQ(2, entry.ts_dimensions_size());
+    ASSERT_EQ(1001u, entry.ts_dimensions(0).ts());
+    ASSERT_EQ(1u, entry.ts_dimensions(1).idx());
+    ASSERT_EQ(1002u, entry.ts_dimensions(1).ts());
+
+    // a version 1 record ends at the ts map
+    std::string old_buffer = buffer.substr(0, buffer.size() - (8 + 4 + pk.size() + 4 + 2 * 12));
+    old_buffer[0] = 1;
+    ASSERT_TRUE(DecodeSnapshotRecord(::openmldb::base::Slice(old_buffer), &decoded));
+    SnapshotRecordToLogEntry(decoded, &entry);
+    ASSERT_EQ(value, entry.value());
+    ASSERT_FALSE(entry.has_term());
+    ASSERT_FALSE(entry.has_pk());
+    ASSERT_EQ(0, entry.ts_dimensions_size());
+}
+
+TEST_F(SnapshotTest, Recover_binlog_parallel) {
+    std::string binlog_dir = FLAGS_db_root_path + "/104_0/binlog/";
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, binlog_dir, binlog_index, offset);
+    auto write_entry = [&](const ::openmldb::api::LogEntry& entry) {
+        std::string buffer;
+        entry.SerializeToString(&buffer);
+        ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+    };
+    uint64_t total = 1000;
+    for (uint64_t count = 0; count < total; count++) {
+        offset++;
+        write_entry(::openmldb::test::PackKVEntry(offset, "key" + std::to_string(count % 20),
+                                                  "value" + std::to_string(count), count + 1, 1));
+    }
+    // the entries of key3 before the delete are removed, the ones after it are kept
+    offset++;
+    ::openmldb::api::LogEntry delete_entry;
+    delete_entry.set_log_index(offset);
+    delete_entry.set_method_type(::openmldb::api::MethodType::kDelete);
+    ::openmldb::api::Dimension* dimension = delete_entry.add_dimensions();
+    dimension->set_key("key3");
+    dimension->set_idx(0);
+    write_entry(delete_entry);
+    for (uint64_t count = total; count < total + 5; count++) {
+        offset++;
+        write_entry(::openmldb::test::PackKVEntry(offset, "key3", "value" + std::to_string(count), count + 1, 1));
+    }
+    wh->Sync();
+    uint32_t thread_num = FLAGS_load_binlog_thread_num;
+    uint32_t batch = FLAGS_load_table_batch;
+    FLAGS_load_binlog_thread_num = 4;
+    FLAGS_load_table_batch = 7;
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    std::shared_ptr<MemTable> table =
+        std::make_shared<MemTable>("test", 104, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    table->Init();
+    uint64_t latest_offset = 0;
+    Binlog binlog(log_part, binlog_dir);
+    ASSERT_TRUE(binlog.RecoverFromBinlog(table, 0, latest_offset));
+    FLAGS_load_binlog_thread_num = thread_num;
+    FLAGS_load_table_batch = batch;
+    ASSERT_EQ(offset, latest_offset);
+    for (uint32_t key_idx = 0; key_idx < 20; key_idx++) {
+        Ticket ticket;
+        TableIterator* it = table->NewIterator("key" + std::to_string(key_idx), ticket);
+        it->SeekToFirst();
+        uint64_t num = 0;
+        uint64_t last_ts = UINT64_MAX;
+        while (it->Valid()) {
+            ASSERT_LT(it->GetKey(), last_ts);
+            last_ts = it->GetKey();
+            if (key_idx == 3) {
+                ASSERT_GT(it->GetKey(), total);
+            }
+            num++;
+            it->Next();
+        }
+        delete it;
+        ASSERT_EQ(key_idx == 3 ? 5u : total / 20, num);
+    }
+    RemoveData(FLAGS_db_root_path);
+}
+
+TEST_F(SnapshotTest, MakeDeltaSnapshot) {
+    std::string snapshot_dir = FLAGS_db_root_path + "/105_0/snapshot/";
+    std::string binlog_dir = FLAGS_db_root_path + "/105_0/binlog/";
+    LogParts* log_part = new LogParts(12, 4, scmp);
+    uint64_t offset = 0;
+    uint32_t binlog_index = 0;
+    WriteHandle* wh = NULL;
+    RollWLogFile(&wh, log_part, binlog_dir, binlog_index, offset);
+    uint64_t count = 0;
+    auto write_entry = [&](const ::openmldb::api::LogEntry& entry) {
+        std::string buffer;
+        entry.SerializeToString(&buffer);
+        ASSERT_TRUE(wh->Write(::openmldb::base::Slice(buffer)).ok());
+    };
+    auto write_puts = [&](uint64_t num) {
+        for (uint64_t i = 0; i < num; i++) {
+            offset++;
+            write_entry(::openmldb::test::PackKVEntry(offset, "key" + std::to_string(count % 20),
+                                                      "value" + std::to_string(count), count + 1, 1));
+            count++;
+        }
+        wh->Sync();
+    };
+    std::map<std::string, uint32_t> mapping;
+    mapping.insert(std::make_pair("idx0", 0));
+    auto make_snapshot = [&]() {
+        MemTableSnapshot snapshot(105, 0, log_part, FLAGS_db_root_path);
+        snapshot.Init();
+        std::shared_ptr<MemTable> table =
+            std::make_shared<MemTable>("test", 105, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+        table->Init();
+        uint64_t snapshot_offset = 0;
+        ASSERT_TRUE(snapshot.Recover(table, snapshot_offset));
+        uint64_t offset_value = 0;
+        ASSERT_EQ(0, snapshot.MakeSnapshot(table, offset_value, 0));
+        ASSERT_EQ(offset, offset_value);
+    };
+    // the keys are loaded from the snapshot only, none of the binlog is replayed
+    auto check_recover = [&](uint64_t key3_num, uint64_t other_num) {
+        MemTableSnapshot snapshot(105, 0, log_part, FLAGS_db_root_path);
+        snapshot.Init();
+        std::shared_ptr<MemTable> table =
+            std::make_shared<MemTable>("test", 105, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+        table->Init();
+        uint64_t snapshot_offset = 0;
+        ASSERT_TRUE(snapshot.Recover(table, snapshot_offset));
+        ASSERT_EQ(offset, snapshot_offset);
+        for (uint32_t key_idx = 0; key_idx < 20; key_idx++) {
+            Ticket ticket;
+            TableIterator* it = table->NewIterator("key" + std::to_string(key_idx), ticket);
+            it->SeekToFirst();
+            uint64_t num = 0;
+            while (it->Valid()) {
+                num++;
+                it->Next();
+            }
+            delete it;
+            ASSERT_EQ(key_idx == 3 ? key3_num : other_num, num);
+        }
+    };
+    uint32_t delta_max_num = FLAGS_snapshot_delta_max_num;
+    FLAGS_snapshot_delta_max_num = 2;
+    write_puts(1000);
+    make_snapshot();
+    ::openmldb::api::Manifest manifest;
+    ASSERT_EQ(0, GetManifest(snapshot_dir + "MANIFEST", &manifest));
+    ASSERT_EQ(1000u, manifest.count());
+    ASSERT_EQ(0, manifest.deltas_size());
+    std::string base_name = manifest.name();
+
+    // the puts of key3 before the delete are dropped from the delta, the delete is kept as a tombstone
+    write_puts(100);
+    offset++;
+    ::openmldb::api::LogEntry delete_entry;
+    delete_entry.set_log_index(offset);
+    delete_entry.set_method_type(::openmldb::api::MethodType::kDelete);
+    ::openmldb::api::Dimension* dimension = delete_entry.add_dimensions();
+    dimension->set_key("key3");
+    dimension->set_idx(0);
+    write_entry(delete_entry);
+    for (uint64_t i = 0; i < 5; i++) {
+        offset++;
+        write_entry(::openmldb::test::PackKVEntry(offset, "key3", "value" + std::to_string(i), 10000 + i, 1));
+    }
+    wh->Sync();
+    make_snapshot();
+    ASSERT_EQ(0, GetManifest(snapshot_dir + "MANIFEST", &manifest));
+    ASSERT_EQ(base_name, manifest.name());
+    ASSERT_EQ(1000u, manifest.count());
+    ASSERT_EQ(offset, manifest.offset());
+    ASSERT_EQ(2u, manifest.version());
+    ASSERT_EQ(1, manifest.deltas_size());
+    ASSERT_EQ(101u, manifest.deltas(0).count());
+    ASSERT_EQ(1000u, manifest.deltas(0).start_offset());
+    ASSERT_EQ(offset, manifest.deltas(0).end_offset());
+    check_recover(5, 55);
+
+    write_puts(20);
+    make_snapshot();
+    ASSERT_EQ(0, GetManifest(snapshot_dir + "MANIFEST", &manifest));
+    ASSERT_EQ(2, manifest.deltas_size());
+    check_recover(6, 56);
+
+    // the max delta num is reached, so the deltas are compacted into a new base snapshot
+    write_puts(20);
+    make_snapshot();
+    ASSERT_EQ(0, GetManifest(snapshot_dir + "MANIFEST", &manifest));
+    ASSERT_EQ(0, manifest.deltas_size());
+    ASSERT_EQ(1u, manifest.version());
+    ASSERT_EQ(offset, manifest.offset());
+    ASSERT_EQ(1090u, manifest.count());
+    std::vector<std::string> vec;
+    ASSERT_EQ(0, ::openmldb::base::GetFileName(snapshot_dir, vec));
+    ASSERT_EQ(Snapshot::GetSnapshotFiles(manifest).size() + 1, vec.size());
+    check_recover(7, 57);
+    FLAGS_snapshot_delta_max_num = delta_max_num;
+    RemoveData(FLAGS_db_root_path);
+}
+
 }  // namespace storage
 }  // namespace openmldb
 
@@ -0,0 +1,355 @@
+/*
+ * Copyright 2021 4Paradigm
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base/file_util.h"
+#include "base/strings.h"
+#include "benchmark/benchmark.h"
+#include "codec/codec.h"
+#include "gflags/gflags.h"
+#include "log/log_writer.h"
+#include "storage/binlog.h"
+#include "storage/disk_table.h"
+#include "storage/mem_table.h"
+#include "storage/mem_table_snapshot.h"
+
+DECLARE_uint32(load_table_thread_num);
+DECLARE_uint32(load_binlog_thread_num);
+DECLARE_bool(binlog_read_mmap);
+DECLARE_int32(binlog_name_length);
+DECLARE_bool(segment_pk_hash_index);
+
+namespace openmldb {
+namespace storage {
+
+// the comparator before SplitKeyAndTs, it copies the pk of both sides
+class CopyKeyTSComparator : public rocksdb::Comparator {
+ public:
+    const char* Name() const override { return "KeyTSComparator"; }
+
+    int Compare(const rocksdb::Slice& a, const rocksdb::Slice& b) const override {
+        std::string key1, key2;
+        uint64_t ts1 = 0, ts2 = 0;
+        ParseKeyAndTs(a, key1, ts1);
+        ParseKeyAndTs(b, key2, ts2);
+        int ret = key1.compare(key2);
+        if (ret != 0) {
+            return ret;
+        }
+        if (ts1 > ts2) return -1;
+        if (ts1 < ts2) return 1;
+        return 0;
+    }
+    void FindShortestSeparator(std::string* /*start*/, const rocksdb::Slice& /*limit*/) const override {}
+    void FindShortSuccessor(std::string* /*key*/) const override {}
+};
+
+static std::vector<std::string> GenKeys(uint32_t pk_len, uint32_t pk_cnt, uint32_t ts_cnt) {
+    std::vector<std::string> keys;
+    keys.reserve(pk_cnt * ts_cnt);
+    for (uint32_t i = 0; i < pk_cnt; i++) {
+        std::string pk = std::to_string(i);
+        pk.resize(pk_len, 'k');
+        for (uint32_t j = 0; j < ts_cnt; j++) {
+            keys.push_back(CombineKeyTs(pk, 1652000000000 + j));
+        }
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+    return keys;
+}
+
+template <class C>
+static void RunCompare(benchmark::State* state) {
+    C cmp;
+    auto keys = GenKeys(state->range(0), 1000, 10);
+    std::vector<rocksdb::Slice> slices(keys.begin(), keys.end());
+    for (auto _ : *state) {
+        auto sorted = slices;
+        std::sort(sorted.begin(), sorted.end(),
+                  [&cmp](const rocksdb::Slice& a, const rocksdb::Slice& b) { return cmp.Compare(a, b) < 0; });
+        benchmark::DoNotOptimize(sorted.data());
+    }
+    state->SetItemsProcessed(state->iterations() * slices.size());
+}
+
+static void BM_CopyKeyTSComparatorSort(benchmark::State& state) {  // NOLINT
+    RunCompare<CopyKeyTSComparator>(&state);
+}
+
+static void BM_KeyTSComparatorSort(benchmark::State& state) {  // NOLINT
+    RunCompare<KeyTSComparator>(&state);
+}
+
+static const ::openmldb::base::DefaultComparator scmp;
+
+// write a snapshot of row_cnt rows of the table, chunk_size 0 means a single file
+static bool GenSnapshot(MemTableSnapshot* snapshot, const std::string& snapshot_path, uint64_t row_cnt,
+                        uint64_t chunk_size, std::shared_ptr<MemTable> table, bool native) {
+    SnapshotWriter writer(snapshot_path, "bm.sdb", chunk_size, native ? table : nullptr);
+    if (!writer.Init()) {
+        return false;
+    }
+    ::openmldb::codec::RowBuilder builder(*table->GetSchema());
+    ::openmldb::api::LogEntry entry;
+    std::string buffer;
+    for (uint64_t i = 0; i < row_cnt; i++) {
+        std::string key = "key" + std::to_string(i % 10000);
+        std::string row;
+        row.resize(builder.CalTotalLength(key.size()));
+        builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+        builder.AppendString(key.c_str(), key.size());
+        entry.Clear();
+        entry.set_log_index(i + 1);
+        entry.set_ts(1652000000000 + i);
+        entry.set_value(row);
+        auto dim = entry.add_dimensions();
+        dim->set_key(key);
+        dim->set_idx(0);
+        entry.SerializeToString(&buffer);
+        if (!writer.Write(entry, ::openmldb::base::Slice(buffer)).ok()) {
+            return false;
+        }
+    }
+    if (!writer.Commit()) {
+        return false;
+    }
+    ::openmldb::api::Manifest manifest;
+    manifest.set_offset(row_cnt);
+    manifest.set_name("bm.sdb");
+    manifest.set_count(row_cnt);
+    manifest.set_term(1);
+    if (native) {
+        manifest.set_format(::openmldb::api::kNativeFormat);
+        manifest.set_seg_cnt(table->GetSegCnt());
+    }
+    if (writer.GetChunks().size() > 1) {
+        for (const auto& chunk : writer.GetChunks()) {
+            manifest.add_chunks()->CopyFrom(chunk);
+        }
+    }
+    return snapshot->GenManifest(manifest) == 0;
+}
+
+static void BM_SnapshotRecover(benchmark::State& state) {  // NOLINT
+    const uint64_t row_cnt = 1000000;
+    uint32_t thread_num = FLAGS_load_table_thread_num;
+    FLAGS_load_table_thread_num = state.range(1);
+    std::string root_path = "/tmp/storage_bm_" + std::to_string(getpid());
+    LogParts log_part(12, 4, scmp);
+    MemTableSnapshot snapshot(1, 0, &log_part, root_path);
+    std::map<std::string, uint32_t> mapping = {{"idx0", 0}};
+    auto gen_table = std::make_shared<MemTable>("bm", 1, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+    gen_table->Init();
+    if (!snapshot.Init() || !GenSnapshot(&snapshot, root_path + "/1_0/snapshot/", row_cnt,
+                                         state.range(0) * 1024 * 1024, gen_table, state.range(2) != 0)) {
+        state.SkipWithError("fail to generate snapshot");
+        ::openmldb::base::RemoveDirRecursive(root_path);
+        return;
+    }
+    gen_table.reset();
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto table = std::make_shared<MemTable>("bm", 1, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+        table->Init();
+        state.ResumeTiming();
+        uint64_t offset = 0;
+        snapshot.Recover(table, offset);
+        state.PauseTiming();
+        if (table->GetRecordCnt() != row_cnt) {
+            state.SkipWithError("record count mismatch");
+        }
+        table.reset();
+        state.ResumeTiming();
+    }
+    state.counters["rows/s"] = benchmark::Counter(state.iterations() * row_cnt, benchmark::Counter::kIsRate);
+    FLAGS_load_table_thread_num = thread_num;
+    ::openmldb::base::RemoveDirRecursive(root_path);
+}
+
+// replay a binlog of 1M rows of 10000 keys, like the recovery after a crash without a recent snapshot
+static void BM_BinlogRecover(benchmark::State& state) {  // NOLINT
+    const uint64_t row_cnt = 1000000;
+    uint32_t thread_num = FLAGS_load_binlog_thread_num;
+    bool read_mmap = FLAGS_binlog_read_mmap;
+    FLAGS_load_binlog_thread_num = state.range(0);
+    FLAGS_binlog_read_mmap = state.range(1) != 0;
+    std::string binlog_path = "/tmp/storage_bm_" + std::to_string(getpid()) + "/binlog/";
+    ::openmldb::base::MkdirRecur(binlog_path);
+    LogParts log_part(12, 4, scmp);
+    std::map<std::string, uint32_t> mapping = {{"idx0", 0}};
+    {
+        auto gen_table =
+            std::make_shared<MemTable>("bm", 1, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+        gen_table->Init();
+        std::string name = ::openmldb::base::FormatToString(0, FLAGS_binlog_name_length) + ".log";
+        FILE* fd = fopen((binlog_path + name).c_str(), "wb");
+        ::openmldb::log::WriteHandle wh("off", name, fd);
+        log_part.Insert(0, 0);
+        ::openmldb::codec::RowBuilder builder(*gen_table->GetSchema());
+        ::openmldb::api::LogEntry entry;
+        std::string buffer;
+        for (uint64_t i = 0; i < row_cnt; i++) {
+            std::string key = "key" + std::to_string(i % 10000);
+            std::string row;
+            row.resize(builder.CalTotalLength(key.size()));
+            builder.SetBuffer(reinterpret_cast<int8_t*>(&row[0]), row.size());
+            builder.AppendString(key.c_str(), key.size());
+            entry.Clear();
+            entry.set_log_index(i + 1);
+            entry.set_ts(1652000000000 + i);
+            entry.set_value(row);
+            auto dim = entry.add_dimensions();
+            dim->set_key(key);
+            dim->set_idx(0);
+            entry.SerializeToString(&buffer);
+            wh.Write(::openmldb::base::Slice(buffer));
+        }
+        wh.EndLog();
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto table = std::make_shared<MemTable>("bm", 1, 0, 8, mapping, 0, ::openmldb::type::TTLType::kAbsoluteTime);
+        table->Init();
+        state.ResumeTiming();
+        uint64_t latest_offset = 0;
+        Binlog binlog(&log_part, binlog_path);
+        binlog.RecoverFromBinlog(table, 0, latest_offset);
+        state.PauseTiming();
+        if (table->GetRecordCnt() != row_cnt) {
+            state.SkipWithError("record count mismatch");
+        }
+        table.reset();
+        state.ResumeTiming();
+    }
+    state.counters["rows/s"] = benchmark::Counter(state.iterations() * row_cnt, benchmark::Counter::kIsRate);
+    FLAGS_load_binlog_thread_num = thread_num;
+    FLAGS_binlog_read_mmap = read_mmap;
+    ::openmldb::base::RemoveDirRecursive("/tmp/storage_bm_" + std::to_string(getpid()));
+}
+
+// point lookups of random keys on a segment, with and without the pk hash index
+static void BM_SegmentLookup(benchmark::State& state) {  // NOLINT
+    const uint64_t key_cnt = state.range(0) * 1000000;
+    bool use_hash_index = FLAGS_segment_pk_hash_index;
+    FLAGS_segment_pk_hash_index = state.range(1) != 0;
+    Segment segment;
+    FLAGS_segment_pk_hash_index = use_hash_index;
+    std::string key;
+    for (uint64_t i = 0; i < key_cnt; i++) {
+        key = "key" + std::to_string(i);
+        segment.Put(Slice(key), 1652000000000, "value", 5);
+    }
+    std::mt19937_64 rand(0);
+    std::vector<std::string> keys(4096);
+    for (auto& k : keys) {
+        k = "key" + std::to_string(rand() % key_cnt);
+    }
+    std::vector<uint64_t> latency;
+    latency.reserve(10000000);
+    uint64_t pos = 0;
+    for (auto _ : state) {
+        const std::string& k = keys[pos++ & (keys.size() - 1)];
+        auto start = std::chrono::steady_clock::now();
+        uint64_t count = 0;
+        int ret = segment.GetCount(Slice(k), count);
+        auto end = std::chrono::steady_clock::now();
+        benchmark::DoNotOptimize(ret);
+        if (latency.size() < latency.capacity()) {
+            latency.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        }
+    }
+    if (!latency.empty()) {
+        std::sort(latency.begin(), latency.end());
+        state.counters["p50_ns"] = latency[latency.size() / 2];
+        state.counters["p99_ns"] = latency[latency.size() * 99 / 100];
+    }
+    segment.Release();
+}
+
+static Segment* put_segment = NULL;
+
+// puts of all the threads to one segment, each thread writes its own keys
+static void BM_SegmentPut(benchmark::State& state) {  // NOLINT
+    if (state.thread_index == 0) {
+        put_segment = new Segment();
+    }
+    const uint64_t key_cnt = state.range(0);
+    std::vector<std::string> keys(key_cnt);
+    for (uint64_t i = 0; i < key_cnt; i++) {
+        keys[i] = "key" + std::to_string(state.thread_index) + "_" + std::to_string(i);
+    }
+    uint64_t time = 1652000000000;
+    uint64_t pos = 0;
+    for (auto _ : state) {
+        put_segment->Put(Slice(keys[pos % key_cnt]), time + pos, "value", 5);
+        pos++;
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index == 0) {
+        put_segment->Release();
+        delete put_segment;
+        put_segment = NULL;
+    }
+}
+
+BENCHMARK(BM_CopyKeyTSComparatorSort)->ArgNames({"pk_len"})->Args({8})->Args({32})->Args({128});
+BENCHMARK(BM_KeyTSComparatorSort)->ArgNames({"pk_len"})->Args({8})->Args({32})->Args({128});
+BENCHMARK(BM_SnapshotRecover)
+    ->ArgNames({"chunk_mb", "threads", "native"})
+    ->Args({0, 3, 0})
+    ->Args({4, 1, 0})
+    ->Args({4, 4, 0})
+    ->Args({4, 16, 0})
+    ->Args({0, 1, 1})
+    ->Args({4, 1, 1})
+    ->Args({4, 4, 1})
+    ->Args({4, 16, 1})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BinlogRecover)
+    ->ArgNames({"threads", "mmap"})
+    ->Args({1, 0})
+    ->Args({1, 1})
+    ->Args({4, 1})
+    ->Args({8, 1})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+// key count in millions, a table of 8 segments holding 100M keys has 12.5M keys per segment.
+// the iterations are fixed so that the keys are only loaded once
+BENCHMARK(BM_SegmentLookup)
+    ->ArgNames({"mkeys", "hash"})
+    ->Args({1, 0})
+    ->Args({1, 1})
+    ->Args({12, 0})
+    ->Args({12, 1})
+    ->Args({100, 0})
+    ->Args({100, 1})
+    ->Iterations(2000000);
+BENCHMARK(BM_SegmentPut)->ArgNames({"keys"})->Arg(1000)->ThreadRange(1, 32)->UseRealTime();
+
+}  // namespace storage
+}  // namespace openmldb
+
+BENCHMARK_MAIN();
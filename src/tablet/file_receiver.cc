@@ -16,6 +16,8 @@
 
 #include "tablet/file_receiver.h"
 
+#include <unistd.h>
+
 #include "base/file_util.h"
 #include "base/glog_wapper.h"
 #include "base/strings.h"
@@ -24,7 +26,15 @@ namespace openmldb {
 namespace tablet {
 
 FileReceiver::FileReceiver(const std::string& file_name, const std::string& dir_name, const std::string& path)
-    : file_name_(file_name), dir_name_(dir_name), path_(path), size_(0), block_id_(0), file_(NULL) {}
+    : file_name_(file_name),
+      dir_name_(dir_name),
+      path_(path),
+      size_(0),
+      block_id_(0),
+      file_(NULL),
+      file_size_(0),
+      stream_num_(0),
+      stream_offsets_() {}
 
 FileReceiver::~FileReceiver() {
     if (file_) fclose(file_);
@@ -50,6 +60,24 @@ bool FileReceiver::Init() {
     }
     file_ = file;
     block_id_ = 0;
+    size_ = 0;
+    stream_num_ = 0;
+    return true;
+}
+
+bool FileReceiver::Init(uint64_t file_size, uint32_t stream_num, bool resume) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (resume && file_ != NULL && stream_num_ == stream_num && file_size_ == file_size) {
+        PDLOG(INFO, "resume receiving file %s%s. received size %lu total size %lu", path_.c_str(), file_name_.c_str(),
+              size_, file_size_);
+        return true;
+    }
+    if (!Init()) {
+        return false;
+    }
+    file_size_ = file_size;
+    stream_num_ = stream_num;
+    stream_offsets_.assign(stream_num, -1);
     return true;
 }
 
@@ -80,6 +108,47 @@ int FileReceiver::WriteData(const std::string& data, uint64_t block_id) {
     return 0;
 }
 
+int FileReceiver::WriteData(const std::string& data, uint32_t stream_id, uint64_t offset) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (file_ == NULL || stream_id >= stream_num_ || offset + data.size() > file_size_) {
+            PDLOG(WARNING, "invalid block. name %s%s stream_id %u offset %lu size %lu", path_.c_str(),
+                  file_name_.c_str(), stream_id, offset, data.size());
+            return -1;
+        }
+        int64_t cur_offset = stream_offsets_[stream_id];
+        if (cur_offset >= 0 && offset < static_cast<uint64_t>(cur_offset)) {
+            DEBUGLOG("block of offset %lu has been received", offset);
+            return 0;
+        }
+        if (cur_offset >= 0 && offset != static_cast<uint64_t>(cur_offset)) {
+            PDLOG(WARNING, "offset mismatch. name %s%s stream_id %u offset %lu cur_offset %ld", path_.c_str(),
+                  file_name_.c_str(), stream_id, offset, cur_offset);
+            return -1;
+        }
+    }
+    // the streams write disjoint ranges, so the write needs no lock
+    ssize_t r = pwrite(fileno(file_), data.c_str(), data.size(), offset);
+    if (r < 0 || static_cast<size_t>(r) < data.size()) {
+        PDLOG(WARNING, "write error. name %s%s", path_.c_str(), file_name_.c_str());
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    stream_offsets_[stream_id] = offset + data.size();
+    size_ += data.size();
+    return 0;
+}
+
+std::vector<int64_t> FileReceiver::GetProgress() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return stream_offsets_;
+}
+
+bool FileReceiver::IsComplete() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return size_ == file_size_;
+}
+
 void FileReceiver::SaveFile() {
     std::string full_path = path_ + file_name_;
     std::string tmp_file_path = full_path + ".tmp";
@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <mutex>  // NOLINT
 #include <string>
+#include <vector>
 
 namespace openmldb {
 namespace tablet {
@@ -28,7 +30,16 @@ class FileReceiver {
     FileReceiver(const FileReceiver&) = delete;
     FileReceiver& operator=(const FileReceiver&) = delete;
     bool Init();
+    // receive the file from stream_num streams in parallel. the blocks received before
+    // are kept if resume and the file is of the same size and stream num
+    bool Init(uint64_t file_size, uint32_t stream_num, bool resume);
     int WriteData(const std::string& data, uint64_t block_id);
+    // write a block of a stream at offset, a stream sends its blocks in order
+    int WriteData(const std::string& data, uint32_t stream_id, uint64_t offset);
+    // the offset each stream has received up to, -1 if nothing is received
+    std::vector<int64_t> GetProgress();
+    bool IsParallel() const { return stream_num_ > 0; }
+    bool IsComplete();
     void SaveFile();
     uint64_t GetBlockId();
 
@@ -39,6 +50,10 @@ class FileReceiver {
     uint64_t size_;
     uint64_t block_id_;
     FILE* file_;
+    uint64_t file_size_;
+    uint32_t stream_num_;
+    std::vector<int64_t> stream_offsets_;
+    std::mutex mu_;
 };
 
 }  // namespace tablet
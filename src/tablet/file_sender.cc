@@ -16,6 +16,10 @@
 
 #include "tablet/file_sender.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <thread>  // NOLINT
 #include <vector>
 
@@ -24,6 +28,7 @@
 #include "boost/algorithm/string/predicate.hpp"
 #include "common/timer.h"
 #include "gflags/gflags.h"
+#include "log/crc32c.h"
 
 DECLARE_int32(send_file_max_try);
 DECLARE_uint32(stream_block_size);
@@ -34,17 +39,19 @@ DECLARE_int32(stream_close_wait_time_ms);
 DECLARE_int32(retry_send_file_wait_time_ms);
 DECLARE_int32(request_max_retry);
 DECLARE_int32(request_timeout_ms);
+DECLARE_uint32(send_file_stream_num);
 
 namespace openmldb {
 namespace tablet {
 
-FileSender::FileSender(uint32_t tid, uint32_t pid, const std::string& endpoint)
+FileSender::FileSender(uint32_t tid, uint32_t pid, const std::string& endpoint,
+                       std::shared_ptr<::openmldb::base::TokenBucket> limiter)
     : tid_(tid),
       pid_(pid),
       endpoint_(endpoint),
       cur_try_time_(0),
       max_try_time_(FLAGS_send_file_max_try),
-      limit_time_(0),
+      limiter_(limiter),
       channel_(NULL),
       stub_(NULL) {}
 
@@ -54,11 +61,9 @@ FileSender::~FileSender() {
 }
 
 bool FileSender::Init() {
-    // compute the used time(microseconds) that send a block by limit bandwidth.
-    // limit_time = (FLAGS_stream_block_size / FLAGS_stream_bandwidth_limit) *
-    // 1000 * 1000
-    if (FLAGS_stream_bandwidth_limit > 0) {
-        limit_time_ = (FLAGS_stream_block_size * 1000000) / FLAGS_stream_bandwidth_limit;
+    if (!limiter_) {
+        limiter_ = std::make_shared<::openmldb::base::TokenBucket>(
+            FLAGS_stream_bandwidth_limit > 0 ? FLAGS_stream_bandwidth_limit : 0);
     }
     channel_ = new brpc::Channel();
     brpc::ChannelOptions options;
@@ -78,7 +83,7 @@ int FileSender::WriteData(const std::string& file_name, const std::string& dir_n
     if (buffer == NULL) {
         return -1;
     }
-    uint64_t cur_time = ::baidu::common::timer::get_micros();
+    limiter_->Acquire(len);
     ::openmldb::api::SendDataRequest request;
     request.set_tid(tid_);
     request.set_pid(pid_);
@@ -91,27 +96,75 @@ int FileSender::WriteData(const std::string& file_name, const std::string& dir_n
     brpc::Controller cntl;
     if (block_id > 0) {
         cntl.request_attachment().append(buffer, len);
+        request.set_checksum(::openmldb::log::Value(buffer, len));
     }
     if (len > 0 && len < FLAGS_stream_block_size) {
         request.set_eof(true);
     }
     ::openmldb::api::GeneralResponse response;
-    stub_->SendData(&cntl, &request, &response, NULL);
-    if (cntl.Failed()) {
+    return Call(file_name, &cntl, request, &response);
+}
+
+int FileSender::Call(const std::string& file_name, brpc::Controller* cntl,
+                     const ::openmldb::api::SendDataRequest& request, ::openmldb::api::GeneralResponse* response) {
+    stub_->SendData(cntl, &request, response, NULL);
+    if (cntl->Failed()) {
         PDLOG(WARNING, "send data failed. tid %u pid %u file %s error msg %s", tid_, pid_, file_name.c_str(),
-              cntl.ErrorText().c_str());
+              cntl->ErrorText().c_str());
         return -1;
-    } else if (response.code() != 0) {
+    } else if (response->code() != 0) {
         PDLOG(WARNING, "send data failed. tid %u pid %u file %s error msg %s", tid_, pid_, file_name.c_str(),
-              response.msg().c_str());
+              response->msg().c_str());
         return -1;
     }
-    uint64_t time_used = ::baidu::common::timer::get_micros() - cur_time;
-    if (limit_time_ > time_used && len > FLAGS_stream_block_size / 2) {
-        uint64_t sleep_time = limit_time_ - time_used;
-        DEBUGLOG("sleep %lu us, limit_time %lu time_used %lu", sleep_time, limit_time_, time_used);
-        std::this_thread::sleep_for(std::chrono::microseconds(sleep_time));
+    return 0;
+}
+
+int FileSender::WriteBlock(const std::string& file_name, const std::string& dir_name, const char* buffer,
+                           size_t len, uint32_t stream_id, uint64_t offset, bool eof) {
+    limiter_->Acquire(len);
+    ::openmldb::api::SendDataRequest request;
+    request.set_tid(tid_);
+    request.set_pid(pid_);
+    request.set_file_name(file_name);
+    if (!dir_name.empty()) {
+        request.set_dir_name(dir_name);
     }
+    // block id 0 is for the init request
+    request.set_block_id(offset / FLAGS_stream_block_size + 1);
+    request.set_block_size(len);
+    request.set_stream_id(stream_id);
+    request.set_offset(offset);
+    request.set_eof(eof);
+    brpc::Controller cntl;
+    if (len > 0) {
+        cntl.request_attachment().append(buffer, len);
+        request.set_checksum(::openmldb::log::Value(buffer, len));
+    }
+    ::openmldb::api::GeneralResponse response;
+    return Call(file_name, &cntl, request, &response);
+}
+
+int FileSender::InitReceiver(const std::string& file_name, const std::string& dir_name, uint64_t file_size,
+                             uint32_t stream_num, bool resume, std::vector<int64_t>* progress) {
+    ::openmldb::api::SendDataRequest request;
+    request.set_tid(tid_);
+    request.set_pid(pid_);
+    request.set_file_name(file_name);
+    if (!dir_name.empty()) {
+        request.set_dir_name(dir_name);
+    }
+    request.set_block_id(0);
+    request.set_block_size(0);
+    request.set_stream_num(stream_num);
+    request.set_file_size(file_size);
+    request.set_resume(resume);
+    brpc::Controller cntl;
+    ::openmldb::api::GeneralResponse response;
+    if (Call(file_name, &cntl, request, &response) < 0) {
+        return -1;
+    }
+    progress->assign(response.additional_ids().begin(), response.additional_ids().end());
     return 0;
 }
 
@@ -139,7 +192,13 @@ int FileSender::SendFile(const std::string& file_name, const std::string& dir_na
                   file_size);
         }
         try_times--;
-        if (SendFileInternal(file_name, dir_name, full_path, file_size) < 0) {
+        uint64_t block_num = (file_size + FLAGS_stream_block_size - 1) / FLAGS_stream_block_size;
+        uint32_t stream_num = std::min<uint64_t>(FLAGS_send_file_stream_num, block_num);
+        // a retry resumes from the blocks the receiver has got
+        bool resume = try_times + 1 < FLAGS_send_file_max_try;
+        int ret = stream_num > 1 ? SendFileParallel(file_name, dir_name, full_path, file_size, stream_num, resume)
+                                 : SendFileInternal(file_name, dir_name, full_path, file_size);
+        if (ret < 0) {
             continue;
         }
         if (CheckFile(file_name, dir_name, file_size) < 0) {
@@ -204,6 +263,86 @@ int FileSender::SendFileInternal(const std::string& file_name, const std::string
     return ret;
 }
 
+int FileSender::SendFileParallel(const std::string& file_name, const std::string& dir_name,
+                                 const std::string& full_path, uint64_t file_size, uint32_t stream_num, bool resume) {
+    std::vector<int64_t> progress;
+    if (InitReceiver(file_name, dir_name, file_size, stream_num, resume, &progress) < 0) {
+        PDLOG(WARNING, "Init file receiver failed. tid[%u] pid[%u] file %s", tid_, pid_, file_name.c_str());
+        return -1;
+    }
+    if (progress.size() != stream_num) {
+        PDLOG(WARNING, "receiver %s does not support parallel streams, send file %s by one stream", endpoint_.c_str(),
+              file_name.c_str());
+        return SendFileInternal(file_name, dir_name, full_path, file_size);
+    }
+    uint64_t block_num = (file_size + FLAGS_stream_block_size - 1) / FLAGS_stream_block_size;
+    uint64_t range_size = (block_num + stream_num - 1) / stream_num * FLAGS_stream_block_size;
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> streams;
+    for (uint32_t idx = 0; idx < stream_num; idx++) {
+        uint64_t start = std::min(file_size, idx * range_size);
+        uint64_t end = std::min(file_size, start + range_size);
+        if (progress[idx] >= 0 && static_cast<uint64_t>(progress[idx]) > start &&
+            static_cast<uint64_t>(progress[idx]) <= end) {
+            start = progress[idx];
+        }
+        streams.emplace_back([this, &file_name, &dir_name, &full_path, &failed, idx, start, end] {
+            if (SendRange(file_name, dir_name, full_path, idx, start, end, &failed) < 0) {
+                failed.store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto& stream : streams) {
+        stream.join();
+    }
+    if (failed.load(std::memory_order_relaxed)) {
+        return -1;
+    }
+    // the receiver saves the file once it has got all the bytes
+    if (WriteBlock(file_name, dir_name, NULL, 0, 0, file_size, true) < 0) {
+        return -1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(FLAGS_stream_close_wait_time_ms));
+    return 0;
+}
+
+int FileSender::SendRange(const std::string& file_name, const std::string& dir_name, const std::string& full_path,
+                          uint32_t stream_id, uint64_t start, uint64_t end, const std::atomic<bool>* failed) {
+    if (start >= end) {
+        return 0;
+    }
+    int fd = open(full_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        PDLOG(WARNING, "fail to open file %s", full_path.c_str());
+        return -1;
+    }
+    std::vector<char> buffer(FLAGS_stream_block_size);
+    int ret = 0;
+    uint64_t offset = start;
+    while (offset < end && !failed->load(std::memory_order_relaxed)) {
+        size_t len = std::min<uint64_t>(FLAGS_stream_block_size, end - offset);
+        ssize_t r = pread(fd, buffer.data(), len, offset);
+        if (r < 0 || static_cast<size_t>(r) != len) {
+            PDLOG(WARNING, "read file %s error. error message: %s", file_name.c_str(), strerror(errno));
+            ret = -1;
+            break;
+        }
+        if (WriteBlock(file_name, dir_name, buffer.data(), len, stream_id, offset, false) < 0) {
+            PDLOG(WARNING, "data write failed. tid[%u] pid[%u] file %s stream %u", tid_, pid_, file_name.c_str(),
+                  stream_id);
+            ret = -1;
+            break;
+        }
+        offset += len;
+    }
+    close(fd);
+    if (ret == 0) {
+        PDLOG(INFO, "stream %u sent range [%lu, %lu). tid[%u] pid[%u] file[%s] endpoint[%s]", stream_id, start, end,
+              tid_, pid_, file_name.c_str(), endpoint_.c_str());
+    }
+    return ret;
+}
+
 int FileSender::CheckFile(const std::string& file_name, const std::string& dir_name, uint64_t file_size) {
     ::openmldb::api::CheckFileRequest check_request;
     ::openmldb::api::GeneralResponse response;
@@ -19,8 +19,12 @@
 #include <brpc/channel.h>
 #include <brpc/controller.h>
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "base/token_bucket.h"
 #include "proto/tablet.pb.h"
 
 namespace openmldb {
@@ -28,25 +32,46 @@ namespace tablet {
 
 class FileSender {
  public:
-    FileSender(uint32_t tid, uint32_t pid, const std::string& endpoint);
+    // limiter is shared by the senders of a tablet. a sender without it is limited
+    // by stream_bandwidth_limit alone
+    FileSender(uint32_t tid, uint32_t pid, const std::string& endpoint,
+               std::shared_ptr<::openmldb::base::TokenBucket> limiter = nullptr);
     ~FileSender();
     bool Init();
     int SendFile(const std::string& file_name, const std::string& dir_name, const std::string& full_path);
     int SendFile(const std::string& file_name, const std::string& full_path);
     int SendFileInternal(const std::string& file_name, const std::string& dir_name, const std::string& full_path,
                          uint64_t file_size);
+    // split the file into ranges of whole blocks and send them by stream_num streams in
+    // parallel. the ranges go on from where the receiver is if resume
+    int SendFileParallel(const std::string& file_name, const std::string& dir_name, const std::string& full_path,
+                         uint64_t file_size, uint32_t stream_num, bool resume);
     int SendDir(const std::string& dir_name, const std::string& full_path);
     int WriteData(const std::string& file_name, const std::string& dir_name, const char* buffer, size_t len,
                   uint64_t block_id);
     int CheckFile(const std::string& file_name, const std::string& dir_name, uint64_t file_size);
 
  private:
+    // progress is the offset each stream of the receiver has received up to
+    int InitReceiver(const std::string& file_name, const std::string& dir_name, uint64_t file_size,
+                     uint32_t stream_num, bool resume, std::vector<int64_t>* progress);
+
+    int SendRange(const std::string& file_name, const std::string& dir_name, const std::string& full_path,
+                  uint32_t stream_id, uint64_t start, uint64_t end, const std::atomic<bool>* failed);
+
+    // send a block of a stream, or the empty block with eof after all the streams are done
+    int WriteBlock(const std::string& file_name, const std::string& dir_name, const char* buffer, size_t len,
+                   uint32_t stream_id, uint64_t offset, bool eof);
+
+    int Call(const std::string& file_name, brpc::Controller* cntl, const ::openmldb::api::SendDataRequest& request,
+             ::openmldb::api::GeneralResponse* response);
+
     uint32_t tid_;
     uint32_t pid_;
     std::string endpoint_;
     uint32_t cur_try_time_;
     uint32_t max_try_time_;
-    uint64_t limit_time_;
+    std::shared_ptr<::openmldb::base::TokenBucket> limiter_;
     brpc::Channel* channel_;
     ::openmldb::api::TabletServer_Stub* stub_;
 };
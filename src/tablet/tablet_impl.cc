@@ -31,6 +31,7 @@
 #include <snappy.h>
 
 #include <algorithm>
+#include <functional>
 #include <thread>  // NOLINT
 #include <utility>
 #include <vector>
@@ -39,6 +40,7 @@
 #include "boost/bind.hpp"
 #include "boost/container/deque.hpp"
 #include "config.h"  // NOLINT
+#include "version.h"  // NOLINT
 #ifdef TCMALLOC_ENABLE
 #include "gperftools/malloc_extension.h"
 #endif
@@ -49,12 +51,14 @@
 #include "base/status.h"
 #include "base/strings.h"
 #include "brpc/controller.h"
+#include "bthread/bthread.h"
 #include "butil/iobuf.h"
 #include "codec/codec.h"
 #include "codec/row_codec.h"
 #include "codec/sql_rpc_row_codec.h"
 #include "common/timer.h"
 #include "glog/logging.h"
+#include "log/crc32c.h"
 #include "schema/schema_adapter.h"
 #include "storage/binlog.h"
 #include "storage/segment.h"
@@ -89,6 +93,8 @@ DECLARE_uint32(task_check_interval);
 DECLARE_uint32(load_index_max_wait_time);
 DECLARE_bool(use_name);
 DECLARE_bool(enable_distsql);
+DECLARE_bool(enable_jit_object_cache);
+DECLARE_uint32(jit_object_cache_max_size);
 DECLARE_string(snapshot_compression);
 DECLARE_string(file_compression);
 
@@ -100,6 +106,8 @@ DECLARE_int32(zk_session_timeout);
 DECLARE_int32(zk_keep_alive_check_interval);
 
 DECLARE_int32(binlog_sync_to_disk_interval);
+DECLARE_int32(binlog_sync_wait_time);
+DECLARE_uint32(binlog_sync_worker_num);
 DECLARE_int32(binlog_delete_interval);
 DECLARE_uint32(absolute_ttl_max);
 DECLARE_uint32(latest_ttl_max);
@@ -109,6 +117,7 @@ DECLARE_uint32(snapshot_ttl_check_interval);
 DECLARE_uint32(put_slow_log_threshold);
 DECLARE_uint32(query_slow_log_threshold);
 DECLARE_int32(snapshot_pool_size);
+DECLARE_int32(stream_bandwidth_limit);
 
 namespace openmldb {
 namespace tablet {
@@ -122,6 +131,7 @@ TabletImpl::TabletImpl()
     : tables_(),
       mu_(),
       gc_pool_(FLAGS_gc_pool_size),
+      transport_(),
       replicators_(),
       snapshots_(),
       zk_client_(NULL),
@@ -140,7 +150,10 @@ TabletImpl::TabletImpl()
       sp_cache_(std::shared_ptr<SpCache>(new SpCache())),
       notify_path_(),
       globalvar_changed_notify_path_(),
-      startup_mode_(::openmldb::type::StartupMode::kStandalone) {}
+      startup_mode_(::openmldb::type::StartupMode::kStandalone) {
+    send_file_limiter_ = std::make_shared<::openmldb::base::TokenBucket>(
+        FLAGS_stream_bandwidth_limit > 0 ? FLAGS_stream_bandwidth_limit : 0);
+}
 
 TabletImpl::~TabletImpl() {
     task_pool_.Stop(true);
@@ -168,6 +181,13 @@ bool TabletImpl::Init(const std::string& zk_cluster, const std::string& zk_path,
     global_variables_->emplace("enable_trace", "false");
 
     deploy_collector_ = std::make_unique<::openmldb::statistics::DeployQueryTimeCollector>();
+    if (FLAGS_binlog_sync_worker_num > 0) {
+        transport_ = std::make_unique<::openmldb::replica::ReplicateTransport>(FLAGS_binlog_sync_worker_num);
+        if (transport_->Start() != 0) {
+            PDLOG(WARNING, "fail to start replicate transport");
+            return false;
+        }
+    }
 
     ::openmldb::base::SplitString(FLAGS_db_root_path, ",", mode_root_paths_);
     ::openmldb::base::SplitString(FLAGS_recycle_bin_root_path, ",", mode_recycle_root_paths_);
@@ -190,6 +210,24 @@ bool TabletImpl::Init(const std::string& zk_cluster, const std::string& zk_path,
     } else {
         options.SetClusterOptimized(false);
     }
+    if (FLAGS_enable_jit_object_cache && !mode_root_paths_.empty()) {
+        // the objects call the engine functions by names, so they are only reused by the same version
+        std::string cache_root = mode_root_paths_[0] + "/jit_cache";
+        std::string version = std::to_string(OPENMLDB_VERSION_MAJOR) + "." + std::to_string(OPENMLDB_VERSION_MINOR) +
+                              "." + std::to_string(OPENMLDB_VERSION_BUG) + "." + OPENMLDB_COMMIT_ID;
+        // the objects of the other versions are never loaded again
+        std::vector<std::string> version_dirs;
+        ::openmldb::base::GetSubDir(cache_root, version_dirs);
+        for (const auto& dir : version_dirs) {
+            if (dir != version && !::openmldb::base::RemoveDirRecursive(cache_root + "/" + dir)) {
+                PDLOG(WARNING, "fail to remove jit object cache dir %s/%s", cache_root.c_str(), dir.c_str());
+            }
+        }
+        std::string cache_dir = cache_root + "/" + version;
+        options.jit_options().SetObjectCacheDir(cache_dir);
+        options.jit_options().SetObjectCacheMaxSize(static_cast<uint64_t>(FLAGS_jit_object_cache_max_size) << 20);
+        PDLOG(INFO, "jit object cache dir %s", cache_dir.c_str());
+    }
     engine_ = std::unique_ptr<::hybridse::vm::Engine>(new ::hybridse::vm::Engine(catalog_, options));
     catalog_->SetLocalTablet(
         std::shared_ptr<::hybridse::vm::Tablet>(new ::hybridse::vm::LocalTablet(engine_.get(), sp_cache_)));
@@ -717,6 +755,97 @@ void TabletImpl::Put(RpcController* controller, const ::openmldb::api::PutReques
     }
 }
 
+void TabletImpl::BatchPut(RpcController* controller, const ::openmldb::api::BatchPutRequest* request,
+                          ::openmldb::api::BatchPutResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    if (follower_.load(std::memory_order_relaxed)) {
+        response->set_code(::openmldb::base::ReturnCode::kIsFollowerCluster);
+        response->set_msg("is follower cluster");
+        return;
+    }
+    uint64_t start_time = ::baidu::common::timer::get_micros();
+    std::shared_ptr<Table> table = GetTable(request->tid(), request->pid());
+    if (!table) {
+        PDLOG(WARNING, "table is not exist. tid %u, pid %u", request->tid(), request->pid());
+        response->set_code(::openmldb::base::ReturnCode::kTableIsNotExist);
+        response->set_msg("table is not exist");
+        return;
+    }
+    if (!table->IsLeader()) {
+        response->set_code(::openmldb::base::ReturnCode::kTableIsFollower);
+        response->set_msg("table is follower");
+        return;
+    }
+    if (table->GetTableStat() == ::openmldb::storage::kLoading) {
+        PDLOG(WARNING, "table is loading. tid %u, pid %u", request->tid(), request->pid());
+        response->set_code(::openmldb::base::ReturnCode::kTableIsLoading);
+        response->set_msg("table is loading");
+        return;
+    }
+    uint32_t idx_cnt = table->GetIdxCnt();
+    uint32_t failed_cnt = 0;
+    std::vector<::openmldb::api::LogEntry> entries;
+    entries.reserve(request->rows_size());
+    for (const auto& row : request->rows()) {
+        if (row.dimensions_size() == 0 || CheckDimessionPut(row.dimensions(), idx_cnt) != 0) {
+            response->add_row_codes(::openmldb::base::ReturnCode::kInvalidDimensionParameter);
+            failed_cnt++;
+            continue;
+        }
+        if (!table->Put(row.time(), row.value(), row.dimensions())) {
+            response->add_row_codes(::openmldb::base::ReturnCode::kPutFailed);
+            failed_cnt++;
+            continue;
+        }
+        response->add_row_codes(::openmldb::base::ReturnCode::kOk);
+        entries.emplace_back();
+        ::openmldb::api::LogEntry& entry = entries.back();
+        entry.set_ts(row.time());
+        entry.set_value(row.value());
+        entry.mutable_dimensions()->CopyFrom(row.dimensions());
+    }
+
+    // like Put, a row is put once it is in the table. the rows are not removed if the binlog append fails
+    std::shared_ptr<LogReplicator> replicator = GetReplicator(request->tid(), request->pid());
+    if (!replicator) {
+        PDLOG(WARNING, "fail to find table tid %u pid %u leader's log replicator", request->tid(), request->pid());
+    } else if (!entries.empty()) {
+        uint64_t term = replicator->GetLeaderTerm();
+        for (auto& entry : entries) {
+            entry.set_term(term);
+        }
+        uint32_t appended = replicator->BatchAppendEntry(&entries);
+        if (appended < entries.size()) {
+            PDLOG(WARNING, "fail to append %lu of %lu entries to binlog. tid %u pid %u", entries.size() - appended,
+                  entries.size(), request->tid(), request->pid());
+        }
+    }
+
+    if (!UpdateAggrs(request->tid(), request->pid(), entries)) {
+        response->set_code(::openmldb::base::ReturnCode::kError);
+        response->set_msg("update aggr failed");
+        return;
+    }
+    if (failed_cnt > 0) {
+        response->set_code(::openmldb::base::ReturnCode::kPutFailed);
+        response->set_msg("put failed for " + std::to_string(failed_cnt) + " rows");
+    } else {
+        response->set_code(::openmldb::base::ReturnCode::kOk);
+    }
+
+    uint64_t end_time = ::baidu::common::timer::get_micros();
+    if (start_time + FLAGS_put_slow_log_threshold < end_time) {
+        PDLOG(INFO, "slow log[batch put]. rows %d time %lu. tid %u, pid %u", request->rows_size(),
+              end_time - start_time, request->tid(), request->pid());
+    }
+
+    if (replicator && !entries.empty()) {
+        if (FLAGS_binlog_notify_on_put) {
+            replicator->Notify();
+        }
+    }
+}
+
 int TabletImpl::CheckTableMeta(const openmldb::api::TableMeta* table_meta, std::string& msg) {
     msg.clear();
     if (table_meta->name().empty()) {
@@ -1381,7 +1510,8 @@ void TabletImpl::Traverse(RpcController* controller, const ::openmldb::api::Trav
         DEBUGLOG("tid %u, pid %u seek to first", request->tid(), request->pid());
         it->SeekToFirst();
     }
-    std::map<std::string, std::vector<std::pair<uint64_t, openmldb::base::Slice>>> value_map;
+    // the iterator reuses its row buffer, so keep a copy of each value until the response is encoded
+    std::map<std::string, std::vector<std::pair<uint64_t, std::string>>> value_map;
     uint32_t total_block_size = 0;
     bool remove_duplicated_record = false;
     if (request->has_enable_remove_duplicated_record()) {
@@ -1402,11 +1532,11 @@ void TabletImpl::Traverse(RpcController* controller, const ::openmldb::api::Trav
         last_pk = it->GetPK();
         last_time = it->GetKey();
         if (value_map.find(last_pk) == value_map.end()) {
-            value_map.insert(std::make_pair(last_pk, std::vector<std::pair<uint64_t, openmldb::base::Slice>>()));
+            value_map.insert(std::make_pair(last_pk, std::vector<std::pair<uint64_t, std::string>>()));
             value_map[last_pk].reserve(request->limit());
         }
         openmldb::base::Slice value = it->GetValue();
-        value_map[last_pk].push_back(std::make_pair(it->GetKey(), value));
+        value_map[last_pk].emplace_back(it->GetKey(), std::string(value.data(), value.size()));
         total_block_size += last_pk.length() + value.size();
         scount++;
         if (it->GetCount() >= FLAGS_max_traverse_cnt) {
@@ -1438,7 +1568,7 @@ void TabletImpl::Traverse(RpcController* controller, const ::openmldb::api::Trav
     uint32_t offset = 0;
     for (const auto& kv : value_map) {
         for (const auto& pair : kv.second) {
-            DEBUGLOG("encode pk %s ts %lu size %u", kv.first.c_str(), pair.first, pair.second.size());
+            DEBUGLOG("encode pk %s ts %lu size %lu", kv.first.c_str(), pair.first, pair.second.size());
             ::openmldb::codec::EncodeFull(kv.first, pair.first, pair.second.data(), pair.second.size(), rbuffer,
                                           offset);
             offset += (4 + 4 + 8 + kv.first.length() + pair.second.size());
@@ -2066,6 +2196,59 @@ void TabletImpl::DelReplica(RpcController* controller, const ::openmldb::api::Re
 void TabletImpl::AppendEntries(RpcController* controller, const ::openmldb::api::AppendEntriesRequest* request,
                                ::openmldb::api::AppendEntriesResponse* response, Closure* done) {
     brpc::ClosureGuard done_guard(done);
+    AppendEntries(request, static_cast<brpc::Controller*>(controller)->request_attachment(), response);
+}
+
+static void* RunAppendEntriesTask(void* args) {
+    auto* task = static_cast<std::function<void()>*>(args);
+    (*task)();
+    return NULL;
+}
+
+void TabletImpl::BatchAppendEntries(RpcController* controller,
+                                    const ::openmldb::api::BatchAppendEntriesRequest* request,
+                                    ::openmldb::api::BatchAppendEntriesResponse* response, Closure* done) {
+    brpc::ClosureGuard done_guard(done);
+    // the raw records of the requests are put in the attachment one after another
+    butil::IOBuf attachment = static_cast<brpc::Controller*>(controller)->request_attachment();
+    int cnt = request->requests_size();
+    std::vector<butil::IOBuf> sub_attachments(cnt);
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(cnt);
+    for (int i = 0; i < cnt; i++) {
+        const auto& sub_request = request->requests(i);
+        uint64_t size = 0;
+        for (auto record_size : sub_request.record_size()) {
+            size += record_size;
+        }
+        attachment.cutn(&sub_attachments[i], size);
+        auto* sub_response = response->add_responses();
+        tasks.emplace_back([this, &sub_request, &sub_attachments, i, sub_response] {
+            AppendEntries(&sub_request, sub_attachments[i], sub_response);
+        });
+    }
+    // the partitions are applied concurrently so that one waiting for its previous batch does not stall the others
+    std::vector<bthread_t> tids;
+    for (int i = 0; i + 1 < cnt; i++) {
+        bthread_t tid;
+        if (bthread_start_background(&tid, NULL, RunAppendEntriesTask, &tasks[i]) == 0) {
+            tids.push_back(tid);
+        } else {
+            tasks[i]();
+        }
+    }
+    if (cnt > 0) {
+        tasks[cnt - 1]();
+    }
+    for (auto tid : tids) {
+        bthread_join(tid, NULL);
+    }
+    response->set_code(::openmldb::base::ReturnCode::kOk);
+    response->set_msg("ok");
+}
+
+void TabletImpl::AppendEntries(const ::openmldb::api::AppendEntriesRequest* request, const butil::IOBuf& attachment,
+                               ::openmldb::api::AppendEntriesResponse* response) {
     uint32_t tid = request->tid();
     uint32_t pid = request->pid();
     std::shared_ptr<Table> table = GetTable(tid, pid);
@@ -2107,7 +2290,7 @@ void TabletImpl::AppendEntries(RpcController* controller, const ::openmldb::api:
     response->set_code(::openmldb::base::ReturnCode::kOk);
     response->set_msg("ok");
     uint64_t last_log_offset = replicator->GetOffset();
-    if (request->pre_log_index() == 0 && request->entries_size() == 0) {
+    if (request->pre_log_index() == 0 && request->entries_size() == 0 && request->record_size_size() == 0) {
         response->set_log_offset(last_log_offset);
         if (!FLAGS_zk_cluster.empty() && request->term() > term) {
             replicator->SetLeaderTerm(request->term());
@@ -2118,14 +2301,44 @@ void TabletImpl::AppendEntries(RpcController* controller, const ::openmldb::api:
         PDLOG(INFO, "first sync log_index! log_offset[%lu] tid[%u] pid[%u]", last_log_offset, tid, pid);
         return;
     }
-    for (int32_t i = 0; i < request->entries_size(); i++) {
-        const auto& entry = request->entries(i);
+    if (request->pre_log_index() > last_log_offset) {
+        // the batches of a pipelined leader may arrive out of order, wait for the one before
+        if (!request->pipelined() || !replicator->WaitOffset(request->pre_log_index(), FLAGS_binlog_sync_wait_time)) {
+            PDLOG(WARNING, "pre log index %lu gt log offset %lu. tid %u pid %u", request->pre_log_index(),
+                  replicator->GetOffset(), tid, pid);
+            response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+            response->set_msg("fail to append entries to replicator");
+            return;
+        }
+        last_log_offset = replicator->GetOffset();
+    }
+    // the raw records are written to binlog as they are and only parsed for the table
+    bool raw_record = request->record_size_size() > 0;
+    std::string raw_buffer;
+    std::vector<::openmldb::base::Slice> raw_records;
+    if (raw_record && !LogReplicator::SplitRawRecords(*request, attachment, &raw_buffer, &raw_records)) {
+        response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+        response->set_msg("fail to append entries to replicator");
+        return;
+    }
+    int32_t entry_cnt = raw_record ? raw_records.size() : request->entries_size();
+    ::openmldb::api::LogEntry raw_entry;
+    for (int32_t i = 0; i < entry_cnt; i++) {
+        if (raw_record && !raw_entry.ParseFromArray(raw_records[i].data(), raw_records[i].size())) {
+            PDLOG(WARNING, "bad protobuf format of raw record. tid %u pid %u", tid, pid);
+            response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
+            response->set_msg("fail to append entries to replicator");
+            return;
+        }
+        const auto& entry = raw_record ? raw_entry : request->entries(i);
         if (entry.log_index() <= last_log_offset) {
-            PDLOG(WARNING, "entry log_index %lu cur log_offset %lu tid %u pid %u", request->entries(i).log_index(),
+            PDLOG(WARNING, "entry log_index %lu cur log_offset %lu tid %u pid %u", entry.log_index(),
                     last_log_offset, tid, pid);
             continue;
         }
-        if (!replicator->ApplyEntry(entry)) {
+        bool ok = raw_record ? replicator->ApplyEntry(entry.log_index(), raw_records[i])
+                             : replicator->ApplyEntry(entry);
+        if (!ok) {
             PDLOG(WARNING, "fail to write binlog. tid %u pid %u", tid, pid);
             response->set_code(::openmldb::base::ReturnCode::kFailToAppendEntriesToReplicator);
             response->set_msg("fail to append entries to replicator");
@@ -2283,6 +2496,8 @@ void TabletImpl::GetTableStatus(RpcController* controller, const ::openmldb::api
                 status->set_record_idx_byte_size(mem_table->GetRecordIdxByteSize());
                 status->set_record_pk_cnt(mem_table->GetRecordPkCnt());
                 status->set_skiplist_height(mem_table->GetKeyEntryHeight());
+                status->set_gc_consumed(mem_table->GetLastGcConsumed());
+                status->set_gc_visited_key_cnt(mem_table->GetLastGcVisitedKeyCnt());
                 uint64_t record_idx_cnt = 0;
                 auto indexs = table->GetAllIndex();
                 for (const auto& index_def : indexs) {
@@ -2532,7 +2747,10 @@ void TabletImpl::SendData(RpcController* controller, const ::openmldb::api::Send
                     std::make_pair(combine_key, std::make_shared<FileReceiver>(request->file_name(), dir_name, path)));
                 iter = file_receiver_map_.find(combine_key);
             }
-            if (!iter->second->Init()) {
+            bool init_ok = request->stream_num() > 0
+                               ? iter->second->Init(request->file_size(), request->stream_num(), request->resume())
+                               : iter->second->Init();
+            if (!init_ok) {
                 PDLOG(WARNING, "file receiver init failed. tid %u, pid %u, file_name %s", tid, pid,
                       request->file_name().c_str());
                 response->set_code(::openmldb::base::ReturnCode::kFileReceiverInitFailed);
@@ -2541,6 +2759,9 @@ void TabletImpl::SendData(RpcController* controller, const ::openmldb::api::Send
                 return;
             }
             PDLOG(INFO, "file receiver init ok. tid %u, pid %u, file_name %s", tid, pid, request->file_name().c_str());
+            for (int64_t offset : iter->second->GetProgress()) {
+                response->add_additional_ids(offset);
+            }
             response->set_code(::openmldb::base::ReturnCode::kOk);
             response->set_msg("ok");
         } else if (iter == file_receiver_map_.end()) {
@@ -2558,12 +2779,13 @@ void TabletImpl::SendData(RpcController* controller, const ::openmldb::api::Send
         response->set_msg("cannot find receiver");
         return;
     }
-    if (receiver->GetBlockId() == request->block_id()) {
+    // the blocks of parallel streams are checked by offset instead of block id
+    if (receiver->GetBlockId() == request->block_id() || (receiver->IsParallel() && request->block_id() == 0)) {
         response->set_msg("ok");
         response->set_code(::openmldb::base::ReturnCode::kOk);
         return;
     }
-    if (request->block_id() != receiver->GetBlockId() + 1) {
+    if (!receiver->IsParallel() && request->block_id() != receiver->GetBlockId() + 1) {
         response->set_msg("block_id mismatch");
         PDLOG(WARNING,
               "block_id mismatch. tid %u, pid %u, file_name %s, request "
@@ -2582,13 +2804,33 @@ void TabletImpl::SendData(RpcController* controller, const ::openmldb::api::Send
         response->set_msg("receive data error");
         return;
     }
-    if (receiver->WriteData(data, request->block_id()) < 0) {
+    if (request->has_checksum() && ::openmldb::log::Value(data.c_str(), data.size()) != request->checksum()) {
+        PDLOG(WARNING, "checksum mismatch. tid %u, pid %u, file_name %s, block_id %lu", tid, pid,
+              request->file_name().c_str(), request->block_id());
+        response->set_code(::openmldb::base::ReturnCode::kReceiveDataError);
+        response->set_msg("checksum mismatch");
+        return;
+    }
+    int ret = 0;
+    if (!receiver->IsParallel()) {
+        ret = receiver->WriteData(data, request->block_id());
+    } else if (!data.empty()) {
+        ret = receiver->WriteData(data, request->stream_id(), request->offset());
+    }
+    if (ret < 0) {
         PDLOG(WARNING, "receiver write data failed. tid %u, pid %u, file_name %s", tid, pid,
               request->file_name().c_str());
         response->set_code(::openmldb::base::ReturnCode::kWriteDataFailed);
         response->set_msg("write data failed");
         return;
     }
+    // the parallel streams send an empty block with eof after all of them are done
+    if (request->eof() && receiver->IsParallel() && !receiver->IsComplete()) {
+        PDLOG(WARNING, "file is incomplete. tid %u, pid %u, file_name %s", tid, pid, request->file_name().c_str());
+        response->set_code(::openmldb::base::ReturnCode::kReceiveDataError);
+        response->set_msg("file is incomplete");
+        return;
+    }
     if (request->eof()) {
         receiver->SaveFile();
         std::lock_guard<std::mutex> lock(mu_);
@@ -2680,7 +2922,7 @@ void TabletImpl::SendSnapshotInternal(const std::string& endpoint, uint32_t tid,
             }
             real_endpoint = iter->second;
         }
-        FileSender sender(remote_tid, pid, real_endpoint);
+        FileSender sender(remote_tid, pid, real_endpoint, send_file_limiter_);
         if (!sender.Init()) {
             PDLOG(WARNING, "Init FileSender failed. tid[%u] pid[%u] endpoint[%s]", tid, pid, endpoint.c_str());
             break;
@@ -2694,7 +2936,7 @@ void TabletImpl::SendSnapshotInternal(const std::string& endpoint, uint32_t tid,
         }
         full_path.append("snapshot/");
         std::string manifest_file = full_path + "MANIFEST";
-        std::string snapshot_file;
+        std::vector<std::string> snapshot_files;
         {
             int fd = open(manifest_file.c_str(), O_RDONLY);
             if (fd < 0) {
@@ -2709,11 +2951,18 @@ void TabletImpl::SendSnapshotInternal(const std::string& endpoint, uint32_t tid,
                 PDLOG(WARNING, "parse manifest failed. tid[%u] pid[%u]", tid, pid);
                 break;
             }
-            snapshot_file = manifest.name();
+            snapshot_files = ::openmldb::storage::Snapshot::GetSnapshotFiles(manifest);
+        }
+        // send snapshot files
+        bool send_failed = false;
+        for (const auto& snapshot_file : snapshot_files) {
+            if (sender.SendFile(snapshot_file, full_path + snapshot_file) < 0) {
+                PDLOG(WARNING, "send snapshot %s failed. tid[%u] pid[%u]", snapshot_file.c_str(), tid, pid);
+                send_failed = true;
+                break;
+            }
         }
-        // send snapshot file
-        if (sender.SendFile(snapshot_file, full_path + snapshot_file) < 0) {
-            PDLOG(WARNING, "send snapshot failed. tid[%u] pid[%u]", tid, pid);
+        if (send_failed) {
             break;
         }
         // send manifest file
@@ -3535,6 +3784,9 @@ int TabletImpl::CreateTableInternal(const ::openmldb::api::TableMeta* table_meta
         msg.assign("fail create replicator for table");
         return -1;
     }
+    if (transport_) {
+        replicator->SetTransport(transport_.get());
+    }
     ok = replicator->Init();
     if (!ok) {
         PDLOG(WARNING, "fail to init replicator for table tid %u, pid %u", tid, pid);
@@ -3855,8 +4107,26 @@ bool TabletImpl::UpdateAggrs(uint32_t tid, uint32_t pid, const std::string& valu
     if (!aggrs) {
         return true;
     }
+    return UpdateAggrs(*aggrs, tid, pid, value, dimensions, log_offset);
+}
+
+bool TabletImpl::UpdateAggrs(uint32_t tid, uint32_t pid, const std::vector<::openmldb::api::LogEntry>& entries) {
+    auto aggrs = GetAggregators(tid, pid);
+    if (!aggrs) {
+        return true;
+    }
+    for (const auto& entry : entries) {
+        if (!UpdateAggrs(*aggrs, tid, pid, entry.value(), entry.dimensions(), entry.log_index())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TabletImpl::UpdateAggrs(const Aggrs& aggrs, uint32_t tid, uint32_t pid, const std::string& value,
+                             const ::openmldb::storage::Dimensions& dimensions, uint64_t log_offset) {
     for (auto iter = dimensions.begin(); iter != dimensions.end(); ++iter) {
-        for (auto aggr : *aggrs) {
+        for (auto aggr : aggrs) {
             if (aggr->GetIndexPos() != iter->idx()) {
                 continue;
             }
@@ -4153,16 +4423,20 @@ bool TabletImpl::GetClusterRouter() {
 }
 
 int TabletImpl::CheckDimessionPut(const ::openmldb::api::PutRequest* request, uint32_t idx_cnt) {
-    for (int32_t i = 0; i < request->dimensions_size(); i++) {
-        if (idx_cnt <= request->dimensions(i).idx()) {
+    return CheckDimessionPut(request->dimensions(), idx_cnt);
+}
+
+int TabletImpl::CheckDimessionPut(const ::openmldb::storage::Dimensions& dimensions, uint32_t idx_cnt) {
+    for (const auto& dimension : dimensions) {
+        if (idx_cnt <= dimension.idx()) {
             PDLOG(WARNING,
                   "invalid put request dimensions, request idx %u is greater "
                   "than table idx cnt %u",
-                  request->dimensions(i).idx(), idx_cnt);
+                  dimension.idx(), idx_cnt);
             return -1;
         }
-        if (request->dimensions(i).key().length() <= 0) {
-            PDLOG(WARNING, "invalid put request dimension key is empty with idx %u", request->dimensions(i).idx());
+        if (dimension.key().length() <= 0) {
+            PDLOG(WARNING, "invalid put request dimension key is empty with idx %u", dimension.idx());
             return 1;
         }
     }
@@ -4461,7 +4735,7 @@ void TabletImpl::SendIndexDataInternal(std::shared_ptr<::openmldb::storage::Tabl
                 }
                 real_endpoint = iter->second;
             }
-            FileSender sender(tid, kv.first, real_endpoint);
+            FileSender sender(tid, kv.first, real_endpoint, send_file_limiter_);
             if (!sender.Init()) {
                 PDLOG(WARNING,
                       "Init FileSender failed. tid[%u] pid[%u] des_pid[%u] "
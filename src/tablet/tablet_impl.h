@@ -29,6 +29,7 @@
 #include <vector>
 
 #include "base/spinlock.h"
+#include "base/token_bucket.h"
 #include "catalog/tablet_catalog.h"
 #include "common/thread_pool.h"
 #include "nameserver/system_table.h"
@@ -95,6 +96,9 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     void Put(RpcController* controller, const ::openmldb::api::PutRequest* request,
              ::openmldb::api::PutResponse* response, Closure* done);
 
+    void BatchPut(RpcController* controller, const ::openmldb::api::BatchPutRequest* request,
+                  ::openmldb::api::BatchPutResponse* response, Closure* done);
+
     void Get(RpcController* controller, const ::openmldb::api::GetRequest* request,
              ::openmldb::api::GetResponse* response, Closure* done);
 
@@ -131,6 +135,9 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     void AppendEntries(RpcController* controller, const ::openmldb::api::AppendEntriesRequest* request,
                        ::openmldb::api::AppendEntriesResponse* response, Closure* done);
 
+    void BatchAppendEntries(RpcController* controller, const ::openmldb::api::BatchAppendEntriesRequest* request,
+                            ::openmldb::api::BatchAppendEntriesResponse* response, Closure* done);
+
     void UpdateTableMetaForAddField(RpcController* controller,
                                     const ::openmldb::api::UpdateTableMetaForAddFieldRequest* request,
                                     ::openmldb::api::GeneralResponse* response, Closure* done);
@@ -293,6 +300,10 @@ class TabletImpl : public ::openmldb::api::TabletServer {
                                 ::google::protobuf::Closure* done) override;
 
  private:
+    // append the entries of a partition, the raw records are in attachment
+    void AppendEntries(const ::openmldb::api::AppendEntriesRequest* request, const butil::IOBuf& attachment,
+                       ::openmldb::api::AppendEntriesResponse* response);
+
     bool CreateMultiDir(const std::vector<std::string>& dirs);
     // Get table by table id , no need external synchronization
     // Get table by table id , and Need external synchronization
@@ -384,6 +395,7 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     std::shared_ptr<::openmldb::api::TaskInfo> FindMultiTask(const ::openmldb::api::TaskInfo& task_info);
 
     int CheckDimessionPut(const ::openmldb::api::PutRequest* request, uint32_t idx_cnt);
+    int CheckDimessionPut(const ::openmldb::storage::Dimensions& dimensions, uint32_t idx_cnt);
 
     // sync log data from page cache to disk
     void SchedSyncDisk(uint32_t tid, uint32_t pid);
@@ -424,6 +436,12 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     bool UpdateAggrs(uint32_t tid, uint32_t pid, const std::string& value,
                      const ::openmldb::storage::Dimensions& dimensions, uint64_t log_offset);
 
+    // update the aggregators of one table with a group of binlog entries
+    bool UpdateAggrs(uint32_t tid, uint32_t pid, const std::vector<::openmldb::api::LogEntry>& entries);
+
+    bool UpdateAggrs(const Aggrs& aggrs, uint32_t tid, uint32_t pid, const std::string& value,
+                     const ::openmldb::storage::Dimensions& dimensions, uint64_t log_offset);
+
     inline bool IsClusterMode() const {
         return startup_mode_ == ::openmldb::type::StartupMode::kCluster;
     }
@@ -453,6 +471,9 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     std::mutex mu_;
     SpinMutex spin_mutex_;
     ThreadPool gc_pool_;
+    // the shared replication streams to the followers, null if binlog_sync_worker_num is 0.
+    // it is declared before replicators_ so that it outlives them
+    std::unique_ptr<::openmldb::replica::ReplicateTransport> transport_;
     Replicators replicators_;
     Snapshots snapshots_;
     Aggregators aggregators_;
@@ -464,6 +485,8 @@ class TabletImpl : public ::openmldb::api::TabletServer {
     std::map<uint64_t, std::list<std::shared_ptr<::openmldb::api::TaskInfo>>> task_map_;
     std::set<std::string> sync_snapshot_set_;
     std::map<std::string, std::shared_ptr<FileReceiver>> file_receiver_map_;
+    // shared by all the file senders, so stream_bandwidth_limit bounds the total bandwidth
+    std::shared_ptr<::openmldb::base::TokenBucket> send_file_limiter_;
     BulkLoadMgr bulk_load_mgr_;
     std::vector<std::string> mode_root_paths_;
     std::vector<std::string> mode_recycle_root_paths_;
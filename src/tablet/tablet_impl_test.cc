@@ -2123,6 +2123,71 @@ TEST_F(TabletImplTest, Recover) {
     }
 }
 
+TEST_F(TabletImplTest, BatchPut) {
+    uint32_t id = counter++;
+    MockClosure closure;
+    TabletImpl tablet;
+    tablet.Init("");
+    ::openmldb::api::CreateTableRequest request;
+    ::openmldb::api::TableMeta* table_meta = request.mutable_table_meta();
+    table_meta->set_name("t0");
+    table_meta->set_tid(id);
+    table_meta->set_pid(1);
+    AddDefaultSchema(0, 0, ::openmldb::type::TTLType::kAbsoluteTime, table_meta);
+    table_meta->set_mode(::openmldb::api::TableMode::kTableLeader);
+    ::openmldb::api::CreateTableResponse response;
+    tablet.CreateTable(NULL, &request, &response, &closure);
+    ASSERT_EQ(0, response.code());
+
+    ::openmldb::api::BatchPutRequest brequest;
+    brequest.set_tid(id);
+    brequest.set_pid(1);
+    for (int i = 0; i < 10; i++) {
+        auto row = brequest.add_rows();
+        ::openmldb::test::SetDimension(0, "test" + std::to_string(i % 2), row->add_dimensions());
+        row->set_time(9527 + i);
+        row->set_value(::openmldb::test::EncodeKV("test" + std::to_string(i % 2), "value" + std::to_string(i)));
+    }
+    // the row with invalid dimension should fail alone
+    auto invalid_row = brequest.add_rows();
+    ::openmldb::test::SetDimension(1, "test0", invalid_row->add_dimensions());
+    invalid_row->set_time(9527);
+    invalid_row->set_value(::openmldb::test::EncodeKV("test0", "invalid"));
+    ::openmldb::api::BatchPutResponse bresponse;
+    tablet.BatchPut(NULL, &brequest, &bresponse, &closure);
+    ASSERT_EQ(::openmldb::base::ReturnCode::kPutFailed, bresponse.code());
+    ASSERT_EQ(11, bresponse.row_codes_size());
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQ(0, bresponse.row_codes(i));
+    }
+    ASSERT_EQ(::openmldb::base::ReturnCode::kInvalidDimensionParameter, bresponse.row_codes(10));
+
+    ::openmldb::api::ScanRequest sr;
+    sr.set_tid(id);
+    sr.set_pid(1);
+    sr.set_pk("test0");
+    sr.set_st(9540);
+    sr.set_et(9526);
+    ::openmldb::api::ScanResponse srp;
+    tablet.Scan(NULL, &sr, &srp, &closure);
+    ASSERT_EQ(0, srp.code());
+    ASSERT_EQ(5, (signed)srp.count());
+
+    // every put row gets its own binlog offset
+    ::openmldb::api::GetTableStatusRequest gr;
+    ::openmldb::api::GetTableStatusResponse gp;
+    tablet.GetTableStatus(NULL, &gr, &gp, &closure);
+    ASSERT_EQ(0, gp.code());
+    bool found = false;
+    for (const auto& status : gp.all_table_status()) {
+        if (status.tid() == id && status.pid() == 1) {
+            ASSERT_EQ(10u, status.offset());
+            found = true;
+        }
+    }
+    ASSERT_TRUE(found);
+}
+
 TEST_F(TabletImplTest, LoadWithDeletedKey) {
     uint32_t id = counter++;
     MockClosure closure;